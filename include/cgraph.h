@@ -0,0 +1,66 @@
+/*  =========================================================================
+    cgraph - Compressed adjacency of a graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef CGRAPH_H_INCLUDED
+#define CGRAPH_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create compressed copy of graph
+GRAPHS_EXPORT cgraph_t *
+    cgraph_new (graph_t *graph);
+
+//  Get number of nodes
+GRAPHS_EXPORT int
+    cgraph_nodes (cgraph_t *self);
+
+//  Get number of edges
+GRAPHS_EXPORT int
+    cgraph_edges (cgraph_t *self);
+
+//  Get the largest number of edges going out of one node
+GRAPHS_EXPORT int
+    cgraph_max_degree (cgraph_t *self);
+
+//  Decode edges going out of node into targets and weights, which must
+//  have room for cgraph_max_degree items. Targets come sorted, as in
+//  graph_targets. Returns number of edges, 0 if node is out of range.
+GRAPHS_EXPORT int
+    cgraph_decode (cgraph_t *self, int node, int *targets, int *weights);
+
+//  Get bytes taken by the compressed adjacency
+GRAPHS_EXPORT size_t
+    cgraph_size (cgraph_t *self);
+
+//  Create plain copy of the graph
+GRAPHS_EXPORT graph_t *
+    cgraph_graph (cgraph_t *self);
+
+//  Destroy the compressed graph
+GRAPHS_EXPORT void
+    cgraph_destroy (cgraph_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    cgraph_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+/*  =========================================================================
+    dbitset - Bit-packed boolean matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DBITSET_H_INCLUDED
+#define DBITSET_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new matrix of x bits by y rows, all clear. Every row starts on
+//  its own cache line. Returns NULL if it does not fit into memory.
+GRAPHS_EXPORT dbitset_t *
+    dbitset_new (unsigned int x, unsigned int y);
+
+//  Create square matrix of edges of dense graph: bit x of row y is set
+//  where int element x of row y is positive and not INT_MAX. Returns NULL
+//  if elements are not int.
+GRAPHS_EXPORT dbitset_t *
+    dbitset_from_matrix (matrix_t *matrix);
+
+//  Get number of bits in a row
+GRAPHS_EXPORT unsigned int
+    dbitset_x (dbitset_t *self);
+
+//  Get number of rows
+GRAPHS_EXPORT unsigned int
+    dbitset_y (dbitset_t *self);
+
+//  Set bit x of row y
+GRAPHS_EXPORT void
+    dbitset_set (dbitset_t *self, unsigned int x, unsigned int y);
+
+//  Clear bit x of row y
+GRAPHS_EXPORT void
+    dbitset_clear (dbitset_t *self, unsigned int x, unsigned int y);
+
+//  Return true if bit x of row y is set
+GRAPHS_EXPORT bool
+    dbitset_get (dbitset_t *self, unsigned int x, unsigned int y);
+
+//  Get words of row y for word-parallel loops: bit x is bit x % 64 of word
+//  x / 64. Bits past the end of the row are always clear.
+GRAPHS_EXPORT uint64_t *
+    dbitset_row (dbitset_t *self, unsigned int y);
+
+//  Clear all bits
+GRAPHS_EXPORT void
+    dbitset_zero (dbitset_t *self);
+
+//  Get number of bits set in row y
+GRAPHS_EXPORT size_t
+    dbitset_count (dbitset_t *self, unsigned int y);
+
+//  Set bits of row y which are set in row other_y of other matrix, of the
+//  same width; other may be self. Returns number of bits which were clear.
+GRAPHS_EXPORT size_t
+    dbitset_or (dbitset_t *self, unsigned int y, dbitset_t *other, unsigned int other_y);
+
+//  Clear bits of row y which are clear in row other_y of other matrix, of
+//  the same width; other may be self
+GRAPHS_EXPORT void
+    dbitset_and (dbitset_t *self, unsigned int y, dbitset_t *other, unsigned int other_y);
+
+//  Get first bit set in row y at x or after it, -1 if there is none. Loop
+//  over bits of a row with
+//
+//      for (int x = dbitset_next (self, y, 0); x != -1; x = dbitset_next (self, y, x + 1))
+GRAPHS_EXPORT int
+    dbitset_next (dbitset_t *self, unsigned int y, unsigned int x);
+
+//  Replace edges of square matrix by its transitive closure: bit x of row
+//  y is set if x is reachable from y by a path of one or more edges.
+//  Returns 0 if done, -1 if matrix is not square.
+GRAPHS_EXPORT int
+    dbitset_closure (dbitset_t *self);
+
+//  Destroy the matrix
+GRAPHS_EXPORT void
+    dbitset_destroy (dbitset_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dbitset_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+/*  =========================================================================
+    dclient - Pipelined query client
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DCLIENT_H_INCLUDED
+#define DCLIENT_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new client sending queries to handle, which is a dijkstra
+//  actor or a DEALER socket connected to dservice. At most window queries
+//  are outstanding at once. Handle must outlive the client.
+GRAPHS_EXPORT dclient_t *
+    dclient_new (void *handle, size_t window);
+
+//  Send query for shortest paths from node, in layout as TASK command of
+//  dijkstra takes it (NULL for default). Deadline is wall clock msecs, 0
+//  for none. If window is full, waits for a reply first. Returns the
+//  correlation id of the query, 0 if interrupted.
+GRAPHS_EXPORT uint32_t
+    dclient_query (dclient_t *self, int from, const char *layout, int64_t deadline);
+
+//  Receive next reply, in whatever order replies come. Sets correlation
+//  id of the query if id_p is not NULL. Reply holds status "DONE", "ERROR"
+//  or "EXPIRED" followed by the result frames. Caller destroys the reply.
+//  Returns NULL if no query is outstanding or if interrupted.
+GRAPHS_EXPORT zmsg_t *
+    dclient_recv (dclient_t *self, uint32_t *id_p);
+
+//  Get number of queries sent and not received yet by caller
+GRAPHS_EXPORT size_t
+    dclient_outstanding (dclient_t *self);
+
+//  Get window size
+GRAPHS_EXPORT size_t
+    dclient_window (dclient_t *self);
+
+//  Destroy the client, replies not received yet are dropped
+GRAPHS_EXPORT void
+    dclient_destroy (dclient_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dclient_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*  =========================================================================
+    dconnect - Connectivity index of a graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DCONNECT_H_INCLUDED
+#define DCONNECT_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create connectivity index of graph. Graph is handled as undirected if
+//  every edge has its reverse, otherwise strongly connected components
+//  are indexed too.
+GRAPHS_EXPORT dconnect_t *
+    dconnect_new (graph_t *graph);
+
+//  Create connectivity index from components of nodes, as returned by
+//  dconnect_component, and strong components, as returned by
+//  dconnect_strong_component, or NULL for undirected graph. Returns NULL
+//  if components are not numbered by their smallest node.
+GRAPHS_EXPORT dconnect_t *
+    dconnect_new_from_components (int nodes, const int *component, const int *strong);
+
+//  Rebuild the index from graph, which must have all edges added to the
+//  index since it was built
+GRAPHS_EXPORT void
+    dconnect_rebuild (dconnect_t *self, graph_t *graph);
+
+//  Return false if there is surely no path from node to node. True means
+//  path may exist; for undirected graphs it surely does.
+GRAPHS_EXPORT bool
+    dconnect_reachable (dconnect_t *self, int from, int to);
+
+//  Get (weakly) connected component of node, -1 if node is out of range
+GRAPHS_EXPORT int
+    dconnect_component (dconnect_t *self, int node);
+
+//  Get strongly connected component of node, -1 if the graph is undirected
+//  or the index is stale
+GRAPHS_EXPORT int
+    dconnect_strong_component (dconnect_t *self, int node);
+
+//  Update the index with new edge from node to node
+GRAPHS_EXPORT void
+    dconnect_add_edge (dconnect_t *self, int from, int to);
+
+//  Is graph indexed as directed?
+GRAPHS_EXPORT bool
+    dconnect_directed (dconnect_t *self);
+
+//  Does the strong component index need rebuild? Reachable keeps working,
+//  but only weakly connected components are used meanwhile.
+GRAPHS_EXPORT bool
+    dconnect_stale (dconnect_t *self);
+
+//  Destroy the index
+GRAPHS_EXPORT void
+    dconnect_destroy (dconnect_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dconnect_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,6 +19,9 @@ extern "C" {
 #endif
 
 //  @interface
+//  Version of the QUERY protocol
+#define DIJKSTRA_PROTOCOL_VERSION "1"
+
 //  Create new dijkstra actor instance.
 //  @TODO: Describe the purpose of this actor!
 //
@@ -36,10 +39,153 @@ extern "C" {
 //
 //      zstr_sendx (dijkstra, "START", NULL);
 //
+//  Optional path names a precomputation file (see dprecomp). If the file
+//  was computed for the same graph, adjacency, relabeling, connectivity
+//  index, landmark tables of the oracle and hierarchy of distance tables
+//  are taken from it; otherwise they are computed and saved there for the
+//  next start:
+//
+//      zstr_sendx (dijkstra, "START", "/var/lib/graphs/graph.pre", NULL);
+//
 //  Stop dijkstra actor.
 //
 //      zstr_sendx (dijkstra, "STOP", NULL);
 //
+//  Search shortest paths from node 0. Actor replies with "DONE" and a frame
+//  holding packed vector of dnode_t (see matrix_from_chunk):
+//
+//      zstr_sendx (dijkstra, "TASK", "0", NULL);
+//
+//  Optional layout argument selects the result layout. "AOS" is the default
+//  above, "SOA" returns separate distance and parent arrays and "DIST" only
+//  distances, both packed as dresult_t (see dresult_from_chunk):
+//
+//      zstr_sendx (dijkstra, "TASK", "0", "DIST", NULL);
+//
+//  Sparse graphs are searched over adjacency lists. Their nodes can be
+//  relabeled for memory locality by "BFS", "RCM" (Reverse Cuthill-McKee)
+//  or "DEGREE" order; "NONE" drops relabeling. TASK keeps using and
+//  returning original node ids:
+//
+//      zstr_sendx (dijkstra, "REORDER", "RCM", NULL);
+//
+//  Sparse graphs can be searched over compressed adjacency (see cgraph),
+//  "VARINT", which takes about a third of the memory; "NONE" goes back to
+//  plain adjacency. KPATHS and MSF build plain adjacency when they need it:
+//
+//      zstr_sendx (dijkstra, "COMPRESS", "VARINT", NULL);
+//
+//  Search engine is chosen by planner from statistics of the graph and
+//  kind of query: dense graphs are scanned as arrays ("DENSE"), sparse
+//  ones searched over adjacency breadth first if all edges weigh the same
+//  ("BFS"), with bucket queue if weights are small ("BUCKETS") or with
+//  binary heap ("HEAP"). Verbose actor logs the choice. TASK, ROUTE and
+//  RADIUS take the engine as optional last argument, "AUTO" for the
+//  planned one; engine which cannot answer the query exactly is rejected:
+//
+//      zstr_sendx (dijkstra, "TASK", "0", "DIST", "HEAP", NULL);
+//
+//  Invalid TASK requests are answered with "ERROR" and a reason, e.g.
+//  "invalid node".
+//
+//  QUERY is TASK which can be pipelined. It carries protocol version, a
+//  correlation id chosen by the caller and a deadline in wall clock msecs
+//  (see zclock_time), or "0" for none:
+//
+//      zstr_sendx (dijkstra, "QUERY", DIJKSTRA_PROTOCOL_VERSION, "42",
+//                  "0", "0", "DIST", NULL);
+//
+//  Replies may come in different order than queries. Waiting queries are
+//  answered by earliest deadline first. Reply repeats version and id and
+//  has status "DONE", "ERROR" or "EXPIRED" followed by the same frames as
+//  TASK reply. Queries past their deadline are not searched at all:
+//
+//      "REPLY", DIJKSTRA_PROTOCOL_VERSION, "42", "DONE", result
+//
+//  Client side windowing is provided by dclient.
+//
+//  Find up to k shortest loopless paths from node to node, here 3 paths
+//  from 0 to 5. Actor replies with "DONE" followed by one frame per path,
+//  cheapest first. Frame holds array of int: cost of the path, then nodes
+//  of the path from first to last:
+//
+//      zstr_sendx (dijkstra, "KPATHS", "0", "5", "3", NULL);
+//
+//  Find shortest path from node to node, here from 0 to 5. Search stops as
+//  soon as the target is settled. Actor replies with "DONE" and a frame of
+//  the same format as KPATHS; distance is INT_MAX and there are no nodes if
+//  no path exists. Targets which cannot be reached according to the
+//  connectivity index (see dconnect) are answered without search:
+//
+//      zstr_sendx (dijkstra, "ROUTE", "0", "5", NULL);
+//
+//  Find nodes within distance of node, here within 100 of node 0. Search
+//  stops at the limit, so its cost grows with the number of nodes found,
+//  not with the graph. Actor replies with "DONE" and a frame of int
+//  triples, node, distance and parent (-1 for node 0 itself), nearest
+//  first:
+//
+//      zstr_sendx (dijkstra, "RADIUS", "0", "100", NULL);
+//
+//  Estimate distances from node to node, here from 0 to 5 and from 3 to 9,
+//  by distance oracle over landmarks (see doracle). Estimate takes time
+//  independent of the graph and does not touch exact searches. Actor
+//  replies with "DONE" and a frame of int pairs, one per pair of nodes:
+//  estimate, which is an upper bound, and lower bound of the distance.
+//  Estimate is INT_MAX if no path is known, lower bound if surely there
+//  is none. Oracle is built on first use:
+//
+//      zstr_sendx (dijkstra, "ESTIMATE", "0", "5", "3", "9", NULL);
+//
+//  Set number of landmarks of the oracle, 16 by default, and build it in
+//  parallel now. More landmarks take more memory and give tighter
+//  estimates:
+//
+//      zstr_sendx (dijkstra, "ORACLE", "32", NULL);
+//
+//  Compute distances from every source to every target (see dtable), by
+//  searches over contraction hierarchy of the graph, built on first use
+//  and rebuilt when edges change. Request holds frame of source nodes and
+//  frame of target nodes, as int arrays, and optionally the number of
+//  threads. Actor replies with "DONE" and a frame with matrix of sources
+//  by targets packed as chunk (see matrix_from_chunk), INT_MAX where there
+//  is no path:
+//
+//      zmsg_t *msg = zmsg_new ();
+//      zmsg_addstr (msg, "TABLE");
+//      zmsg_addmem (msg, sources, source_count * sizeof (int));
+//      zmsg_addmem (msg, targets, target_count * sizeof (int));
+//      zmsg_send (&msg, dijkstra);
+//
+//  Add edge from node to node with weight, or change its weight, in the
+//  distance matrix given to the actor. Connectivity index is updated in
+//  place, search structures are rebuilt on next use:
+//
+//      zstr_sendx (dijkstra, "EDGE", "0", "5", "10", NULL);
+//
+//  Serve versions published in store (see dversion) instead of the matrix
+//  given at start. Every request is served from the latest version at the
+//  time it is taken, and EDGE publishes a new version. Store must outlive
+//  the actor:
+//
+//      zmsg_t *msg = zmsg_new ();
+//      zmsg_addstr (msg, "STORE");
+//      zmsg_addptr (msg, store);
+//      zmsg_send (&msg, dijkstra);
+//
+//  Compute minimum spanning forest of the graph, taking edges as
+//  undirected, by parallel Boruvka (see msf). Optional argument sets the
+//  number of threads, by default it depends on CPUs and graph size. Actor
+//  replies with "DONE", total weight and a frame of int triples, from, to
+//  and weight of every forest edge, lightest first:
+//
+//      zstr_sendx (dijkstra, "MSF", NULL);
+//
+//  Serve TASK requests coming from dservice broker at endpoint, in addition
+//  to the pipe. Used by dservice to build its worker pool:
+//
+//      zstr_sendx (dijkstra, "WORKER", "inproc://dservice-backend", NULL);
+//
 //  This is the dijkstra constructor as a zactor_fn;
 GRAPHS_EXPORT void
     dijkstra_actor (zsock_t *pipe, void *args);
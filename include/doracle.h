@@ -0,0 +1,72 @@
+/*  =========================================================================
+    doracle - Approximate distance oracle over landmarks
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DORACLE_H_INCLUDED
+#define DORACLE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Build oracle for graph with up to landmarks landmarks. More landmarks
+//  take more memory and preprocessing and give tighter estimates. Threads
+//  is the number of threads to use, 0 picks it from the number of CPUs.
+//  Returns NULL if graph is NULL or landmarks is not positive.
+GRAPHS_EXPORT doracle_t *
+    doracle_new (graph_t *graph, int landmarks, int threads);
+
+//  Create oracle from data of doracle_as_chunk, copying it. Returns NULL
+//  unless data holds oracle of a graph of nodes nodes built for landmarks
+//  landmarks.
+GRAPHS_EXPORT doracle_t *
+    doracle_new_from_data (const void *data, size_t size, int nodes, int landmarks);
+
+//  Estimate distance from node to node. Returns upper bound of the
+//  distance, which is a length of some path, or INT_MAX if no path is
+//  known. Lower bound is stored to lower_p, if not NULL; it is INT_MAX
+//  if there surely is no path. Time depends on number of landmarks only.
+GRAPHS_EXPORT int
+    doracle_estimate (doracle_t *self, int from, int to, int *lower_p);
+
+//  Get number of landmarks
+GRAPHS_EXPORT int
+    doracle_landmarks (doracle_t *self);
+
+//  Get landmark at index, -1 if index is out of range
+GRAPHS_EXPORT int
+    doracle_landmark (doracle_t *self, int index);
+
+//  Get bytes taken by distance tables
+GRAPHS_EXPORT size_t
+    doracle_size (doracle_t *self);
+
+//  Convert landmarks and distance tables to chunk, to be saved
+GRAPHS_EXPORT zchunk_t *
+    doracle_as_chunk (doracle_t *self);
+
+//  Destroy the oracle
+GRAPHS_EXPORT void
+    doracle_destroy (doracle_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    doracle_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+/*  =========================================================================
+    dpartition - Graph partitioning into shards
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DPARTITION_H_INCLUDED
+#define DPARTITION_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Split nodes of graph into shards of about the same size with few edges
+//  between them. Returns NULL if graph is NULL or shards is not positive.
+GRAPHS_EXPORT dpartition_t *
+    dpartition_new (graph_t *graph, int shards);
+
+//  Get number of shards
+GRAPHS_EXPORT int
+    dpartition_shards (dpartition_t *self);
+
+//  Get number of nodes
+GRAPHS_EXPORT int
+    dpartition_nodes (dpartition_t *self);
+
+//  Get shard of node, -1 if node is out of range
+GRAPHS_EXPORT int
+    dpartition_shard (dpartition_t *self, int node);
+
+//  Get number of nodes in shard
+GRAPHS_EXPORT int
+    dpartition_size (dpartition_t *self, int shard);
+
+//  Get number of edges going from one shard to another
+GRAPHS_EXPORT int
+    dpartition_cut (dpartition_t *self);
+
+//  Get number of nodes with an edge to or from another shard
+GRAPHS_EXPORT int
+    dpartition_boundary (dpartition_t *self);
+
+//  Get id of the partitioning, the same for all its shard files
+GRAPHS_EXPORT uint64_t
+    dpartition_id (dpartition_t *self);
+
+//  Save shard of graph to precomputation file (see dprecomp), which
+//  dshard serves. Graph must be the one partitioned. Returns 0 if saved,
+//  -1 on error.
+GRAPHS_EXPORT int
+    dpartition_save (dpartition_t *self, graph_t *graph, int shard, const char *path);
+
+//  Destroy the partitioning
+GRAPHS_EXPORT void
+    dpartition_destroy (dpartition_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dpartition_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
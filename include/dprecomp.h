@@ -0,0 +1,77 @@
+/*  =========================================================================
+    dprecomp - Precomputed indexes persisted in a file
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DPRECOMP_H_INCLUDED
+#define DPRECOMP_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Get hash of distance matrix, which tags files computed from it
+GRAPHS_EXPORT uint64_t
+    dprecomp_hash (matrix_t *distances);
+
+//  Create precomputation file for graph with hash. Sections are written
+//  as they are added, the file replaces path only once it is saved.
+//  Returns NULL if the file cannot be created.
+GRAPHS_EXPORT dprecomp_t *
+    dprecomp_new (const char *path, uint64_t hash);
+
+//  Map precomputation file. Returns NULL if there is no file at path, it
+//  is damaged or it was computed for a graph with another hash. Hash 0
+//  accepts a file computed for any graph.
+GRAPHS_EXPORT dprecomp_t *
+    dprecomp_open (const char *path, uint64_t hash);
+
+//  Add section of size bytes to new file. Tags are up to 15 characters.
+//  Returns 0 if written, -1 on error.
+GRAPHS_EXPORT int
+    dprecomp_add (dprecomp_t *self, const char *tag, const void *data, size_t size);
+
+//  Add adjacency of graph as section. Returns 0 if written, -1 on error.
+GRAPHS_EXPORT int
+    dprecomp_add_graph (dprecomp_t *self, const char *tag, graph_t *graph);
+
+//  Finish new file and move it to its path. Returns 0 if done, -1 on error.
+GRAPHS_EXPORT int
+    dprecomp_save (dprecomp_t *self);
+
+//  Get section of mapped file and its size, NULL if there is no such
+//  section. Data is valid while the file is, and may be changed in memory;
+//  changes are never written back.
+GRAPHS_EXPORT void *
+    dprecomp_section (dprecomp_t *self, const char *tag, size_t *size_p);
+
+//  Create graph over adjacency section of mapped file, without copying
+//  it. Returns NULL if there is no such section or it does not hold valid
+//  adjacency. Graph must be destroyed before the file.
+GRAPHS_EXPORT graph_t *
+    dprecomp_graph (dprecomp_t *self, const char *tag);
+
+//  Close the file. New file which was not saved is removed.
+GRAPHS_EXPORT void
+    dprecomp_destroy (dprecomp_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dprecomp_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/*  =========================================================================
+    dresult - Search result in struct-of-arrays layout
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DRESULT_H_INCLUDED
+#define DRESULT_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new result for size nodes. Distances are kept in one int array,
+//  parents (if requested) in a second array of 16-bit indexes when size is
+//  below 65536 and 32-bit indexes otherwise.
+GRAPHS_EXPORT dresult_t *
+    dresult_new (unsigned int size, bool with_parents);
+
+//  Get number of nodes
+GRAPHS_EXPORT int
+    dresult_size (dresult_t *self);
+
+//  Get size of one parent index in bytes, 0 for distance-only results
+GRAPHS_EXPORT size_t
+    dresult_parent_width (dresult_t *self);
+
+//  Get distance of node
+GRAPHS_EXPORT int
+    dresult_distance (dresult_t *self, unsigned int node);
+
+//  Get parent of node, -1 if node has no parent or parents are not kept
+GRAPHS_EXPORT int
+    dresult_parent (dresult_t *self, unsigned int node);
+
+//  Set distance and parent of node. Parent is ignored for distance-only
+//  results.
+GRAPHS_EXPORT void
+    dresult_set (dresult_t *self, unsigned int node, int distance, int parent);
+
+//  Get the distance array, size items
+GRAPHS_EXPORT int *
+    dresult_distances (dresult_t *self);
+
+//  Convert result to chunk
+GRAPHS_EXPORT zchunk_t *
+    dresult_as_chunk (dresult_t *self);
+
+//  Convert chunk to result, destroys the chunk. Returns NULL if chunk is
+//  too short for the result it describes.
+GRAPHS_EXPORT dresult_t *
+    dresult_from_chunk (zchunk_t **chunk_ptr);
+
+//  Destroy the result
+GRAPHS_EXPORT void
+    dresult_destroy (dresult_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dresult_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+/*  =========================================================================
+    dsearch - Shortest path search over sparse graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DSEARCH_H_INCLUDED
+#define DSEARCH_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Queues of the search
+#define DSEARCH_HEAP    0       //  Binary heap, any weights
+#define DSEARCH_BUCKETS 1       //  Bucket queue, small integer weights
+#define DSEARCH_BFS     2       //  First in first out, all weights equal
+
+//  Create a new search over graph. Graph must outlive the search.
+GRAPHS_EXPORT dsearch_t *
+    dsearch_new (graph_t *graph);
+
+//  Create a new search over compressed graph, which must outlive the
+//  search. Results are the same as over the plain graph.
+GRAPHS_EXPORT dsearch_t *
+    dsearch_new_compressed (cgraph_t *graph);
+
+//  Set queue of next runs, DSEARCH_HEAP by default. Bucket queue keeps
+//  one bucket per distance up to max_weight ahead of the nearest node,
+//  which must be at least the largest weight of the graph. BFS visits
+//  nodes in order of hops, so it finds shortest paths only if all edges
+//  weigh the same. Returns 0 if set, -1 if queue is unknown.
+GRAPHS_EXPORT int
+    dsearch_set_queue (dsearch_t *self, int queue, int max_weight);
+
+//  Get queue of the search
+GRAPHS_EXPORT int
+    dsearch_queue (dsearch_t *self);
+
+//  Search shortest paths from node to all nodes of the graph
+GRAPHS_EXPORT void
+    dsearch_run (dsearch_t *self, int from);
+
+//  Search shortest path from node to node, stops as soon as the target is
+//  settled. Distances of nodes not settled are upper bounds only.
+GRAPHS_EXPORT void
+    dsearch_run_to (dsearch_t *self, int from, int to);
+
+//  Search shortest paths from node to nodes at distance up to limit. Cost
+//  grows with the number of nodes within limit, not of the graph. Nodes
+//  within limit are the ones settled, see dsearch_settled_node.
+GRAPHS_EXPORT void
+    dsearch_run_within (dsearch_t *self, int from, int limit);
+
+//  Get distance of node found by the last run, INT_MAX if not reached
+GRAPHS_EXPORT int
+    dsearch_distance (dsearch_t *self, int node);
+
+//  Get parent of node found by the last run, -1 if none
+GRAPHS_EXPORT int
+    dsearch_parent (dsearch_t *self, int node);
+
+//  Get number of nodes settled by the last run
+GRAPHS_EXPORT int
+    dsearch_settled (dsearch_t *self);
+
+//  Get node settled by the last run at index, nodes come nearest first.
+//  Returns -1 if index is out of range.
+GRAPHS_EXPORT int
+    dsearch_settled_node (dsearch_t *self, int index);
+
+//  Destroy the search
+GRAPHS_EXPORT void
+    dsearch_destroy (dsearch_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dsearch_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
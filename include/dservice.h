@@ -0,0 +1,104 @@
+/*  =========================================================================
+    dservice - Shortest path query service
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DSERVICE_H_INCLUDED
+#define DSERVICE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create new dservice actor instance serving queries over distance matrix.
+//  Matrix must outlive the actor, it may be NULL if STORE is sent.
+//
+//      zactor_t *dservice = zactor_new (dservice_actor, distances);
+//
+//  Destroy dservice instance.
+//
+//      zactor_destroy (&dservice);
+//
+//  Enable verbose logging of commands and activity:
+//
+//      zstr_send (dservice, "VERBOSE");
+//
+//  Set number of workers, default is 4. Must be sent before START:
+//
+//      zstr_sendx (dservice, "WORKERS", "8", NULL);
+//
+//  Bind query endpoint, e.g. ipc:// or tcp://127.0.0.1:*. Actor replies
+//  with the port number for tcp endpoints, 0 for others and -1 on error:
+//
+//      zstr_sendx (dservice, "BIND", "tcp://127.0.0.1:*", NULL);
+//      char *port = zstr_recv (dservice);
+//
+//  Serve versions published in store (see dversion) instead of the matrix.
+//  Must be sent before START, store must outlive the actor:
+//
+//      zmsg_t *msg = zmsg_new ();
+//      zmsg_addstr (msg, "STORE");
+//      zmsg_addptr (msg, store);
+//      zmsg_send (&msg, dservice);
+//
+//  Add edge from node to node with weight, or change its weight, and
+//  publish it as a new version of the store. Searches running meanwhile
+//  finish on the version they started with:
+//
+//      zstr_sendx (dservice, "EDGE", "0", "5", "10", NULL);
+//
+//  Start workers and serve queries.
+//
+//      zstr_sendx (dservice, "START", NULL);
+//
+//  Optional path names a precomputation file given to every worker's START
+//  (see dijkstra). Workers map the same file, so its pages are shared:
+//
+//      zstr_sendx (dservice, "START", "/var/lib/graphs/graph.pre", NULL);
+//
+//  Get number of requests answered so far. Actor replies with the number:
+//
+//      zstr_sendx (dservice, "STATS", NULL);
+//      char *answered = zstr_recv (dservice);
+//
+//  Write events traced so far in all threads of the process to file as
+//  Chrome trace (see dtrace). Actor replies with the number of events,
+//  -1 on error:
+//
+//      zstr_sendx (dservice, "TRACE", "/tmp/graphs-trace.json", NULL);
+//      char *events = zstr_recv (dservice);
+//
+//  Clients talk to the endpoint with REQ sockets, or DEALER sockets which
+//  send an empty delimiter frame first. Requests are the same as the TASK,
+//  QUERY, KPATHS, ROUTE, RADIUS, ESTIMATE, TABLE and MSF commands of the
+//  dijkstra actor and get the same replies:
+//
+//      zstr_sendx (client, "TASK", "0", "DIST", NULL);
+//
+//  Replies to pipelined QUERY requests come back from several workers out
+//  of order, dclient matches them by correlation id.
+//
+//  This is the dservice constructor as a zactor_fn;
+GRAPHS_EXPORT void
+    dservice_actor (zsock_t *pipe, void *args);
+
+//  Self test of this actor
+GRAPHS_EXPORT void
+    dservice_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
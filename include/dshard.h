@@ -0,0 +1,85 @@
+/*  =========================================================================
+    dshard - Shard of partitioned graph served to other processes
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DSHARD_H_INCLUDED
+#define DSHARD_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create new dshard actor instance.
+//
+//      zactor_t *dshard = zactor_new (dshard_actor, NULL);
+//
+//  Destroy dshard instance.
+//
+//      zactor_destroy (&dshard);
+//
+//  Enable verbose logging of commands and activity:
+//
+//      zstr_send (dshard, "VERBOSE");
+//
+//  Load shard file saved by dpartition. Actor replies 0 if loaded, -1 on
+//  error. The file is mapped, only the shard's own nodes are in memory:
+//
+//      zstr_sendx (dshard, "LOAD", "/var/lib/graphs/graph.shard-0", NULL);
+//      char *rc = zstr_recv (dshard);
+//
+//  Bind endpoint, e.g. ipc:// or tcp://127.0.0.1:*. Actor replies with the
+//  port number for tcp endpoints, 0 for others and -1 on error:
+//
+//      zstr_sendx (dshard, "BIND", "ipc:///tmp/graph-0.ipc", NULL);
+//      char *port = zstr_recv (dshard);
+//
+//  Get number of requests answered so far. Actor replies with the number:
+//
+//      zstr_sendx (dshard, "STATS", NULL);
+//      char *answered = zstr_recv (dshard);
+//
+//  Clients, usually dshards, talk to the endpoint with DEALER sockets
+//  which send an empty delimiter frame first, or REQ sockets. Nodes are
+//  global ids of the whole graph. Requests are:
+//
+//      INFO                Replies "DONE", shard, number of shards, nodes
+//                          of graph, id of partitioning in hex and a frame
+//                          of global ids of the shard's nodes.
+//      OVERLAY             Replies "DONE" and a frame of int triples
+//                          (from, to, distance): shortest distances within
+//                          the shard between its boundary nodes, and edges
+//                          leaving the shard.
+//      FROM node target    Replies "DONE", distance from node to target
+//                          within the shard (INT_MAX if there is none or
+//                          target is -1 or in another shard) and a frame of
+//                          int pairs (boundary node, distance from node).
+//      TO node             Replies "DONE" and a frame of int pairs
+//                          (boundary node, distance to node).
+//
+//  Other requests get "ERROR" and a reason.
+//
+//  This is the dshard constructor as a zactor_fn;
+GRAPHS_EXPORT void
+    dshard_actor (zsock_t *pipe, void *args);
+
+//  Self test of this actor
+GRAPHS_EXPORT void
+    dshard_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/*  =========================================================================
+    dshards - Shortest paths over shards served by dshard processes
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DSHARDS_H_INCLUDED
+#define DSHARDS_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new client of shards, not connected to any yet
+GRAPHS_EXPORT dshards_t *
+    dshards_new (void);
+
+//  Connect to endpoint of dshard actor, which must serve a shard of the
+//  same partitioning as the ones connected before and not one of them.
+//  Returns 0 if connected, -1 on error or if shard does not reply.
+GRAPHS_EXPORT int
+    dshards_connect (dshards_t *self, const char *endpoint);
+
+//  Get number of shards of the partitioning, 0 before first connect
+GRAPHS_EXPORT int
+    dshards_shards (dshards_t *self);
+
+//  Get number of shards connected
+GRAPHS_EXPORT int
+    dshards_connected (dshards_t *self);
+
+//  Get number of nodes of the whole graph
+GRAPHS_EXPORT int
+    dshards_nodes (dshards_t *self);
+
+//  Get shortest distance from node to node of the whole graph. All shards
+//  must be connected. Returns INT_MAX if there is no path, -1 on error.
+//  Shard which does not reply in time is connected again, and the next
+//  query tries again.
+GRAPHS_EXPORT int
+    dshards_distance (dshards_t *self, int from, int to);
+
+//  Get number of boundary nodes in the overlay, 0 until first distance
+GRAPHS_EXPORT int
+    dshards_overlay_nodes (dshards_t *self);
+
+//  Get number of edges in the overlay, 0 until first distance
+GRAPHS_EXPORT int
+    dshards_overlay_edges (dshards_t *self);
+
+//  Destroy the client
+GRAPHS_EXPORT void
+    dshards_destroy (dshards_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dshards_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/*  =========================================================================
+    dsnapshot - Copy-on-write version of a distance matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DSNAPSHOT_H_INCLUDED
+#define DSNAPSHOT_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create snapshot holding a copy of matrix, as version 1. Rows are copied
+//  and shared in blocks of block_rows rows, 0 for one row per block.
+GRAPHS_EXPORT dsnapshot_t *
+    dsnapshot_new (matrix_t *source, int block_rows);
+
+//  Create next version of snapshot. It shares all blocks with snapshot
+//  until they are changed.
+GRAPHS_EXPORT dsnapshot_t *
+    dsnapshot_fork (dsnapshot_t *self);
+
+//  Set element, copying its block first if the block is shared. Snapshot
+//  must not be changed once readers may see it.
+GRAPHS_EXPORT void
+    dsnapshot_set (dsnapshot_t *self, unsigned int x, unsigned int y, void *element);
+
+//  Set int element
+GRAPHS_EXPORT void
+    dsnapshot_set_int (dsnapshot_t *self, unsigned int x, unsigned int y, int element);
+
+//  Get matrix view of snapshot, owned by the snapshot. View is built on
+//  first call after a change, so call it once before sharing the snapshot
+//  between threads.
+GRAPHS_EXPORT matrix_t *
+    dsnapshot_matrix (dsnapshot_t *self);
+
+//  Get version number
+GRAPHS_EXPORT uint64_t
+    dsnapshot_version (dsnapshot_t *self);
+
+//  Get number of blocks copied since the snapshot was forked
+GRAPHS_EXPORT size_t
+    dsnapshot_copied (dsnapshot_t *self);
+
+//  Take another reference to snapshot. Safe from any thread.
+GRAPHS_EXPORT dsnapshot_t *
+    dsnapshot_ref (dsnapshot_t *self);
+
+//  Drop reference to snapshot, destroying it with the last one. Safe from
+//  any thread.
+GRAPHS_EXPORT void
+    dsnapshot_destroy (dsnapshot_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dsnapshot_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
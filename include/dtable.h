@@ -0,0 +1,79 @@
+/*  =========================================================================
+    dtable - Many-to-many distance tables by bucket scans
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DTABLE_H_INCLUDED
+#define DTABLE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create tables over graph. Builds contraction hierarchy of the graph,
+//  which takes time, so one instance should serve many tables. Graph is
+//  not used after. Returns NULL if graph is NULL or empty.
+GRAPHS_EXPORT dtable_t *
+    dtable_new (graph_t *graph);
+
+//  Create tables over hierarchy of dtable_up and dtable_down graphs saved
+//  before, taking them over; shortcuts is dtable_shortcuts of the saved
+//  tables. Returns NULL, and destroys the graphs, if either is missing or
+//  they differ in nodes.
+GRAPHS_EXPORT dtable_t *
+    dtable_new_from_hierarchy (graph_t **up_p, graph_t **down_p, int shortcuts);
+
+//  Compute shortest distances from every source to every target: element
+//  j of row i is the distance from sources [i] to targets [j], INT_MAX if
+//  there is no path. Threads is the number of threads to use, 0 picks it
+//  from the number of CPUs. Returns NULL if some node is out of range or
+//  there are no sources or no targets.
+GRAPHS_EXPORT matrix_t *
+    dtable_compute (dtable_t *self, const int *sources, int source_count,
+                    const int *targets, int target_count, int threads);
+
+//  Get edges from every node to higher nodes in the hierarchy, to save it
+GRAPHS_EXPORT graph_t *
+    dtable_up (dtable_t *self);
+
+//  Get edges from every node to lower nodes in the hierarchy, which are
+//  edges coming down reversed, to save it
+GRAPHS_EXPORT graph_t *
+    dtable_down (dtable_t *self);
+
+//  Get number of shortcut edges added to the graph by its hierarchy
+GRAPHS_EXPORT int
+    dtable_shortcuts (dtable_t *self);
+
+//  Get number of bucket entries deposited for the last table
+GRAPHS_EXPORT size_t
+    dtable_buckets (dtable_t *self);
+
+//  Get number of nodes settled by all searches of the last table
+GRAPHS_EXPORT size_t
+    dtable_settled (dtable_t *self);
+
+//  Destroy the tables
+GRAPHS_EXPORT void
+    dtable_destroy (dtable_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dtable_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
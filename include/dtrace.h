@@ -0,0 +1,101 @@
+/*  =========================================================================
+    dtrace - Tracepoints exported as Chrome trace
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DTRACE_H_INCLUDED
+#define DTRACE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Events kept per thread, latest ones win
+#define DTRACE_RING_SIZE    16384
+
+//  Tracepoints mark where a phase of work begins and ends. Names must be
+//  string literals, or strings which live as long as the process. While
+//  tracing is disabled a tracepoint costs one load and branch; build with
+//  -DGRAPHS_NO_TRACE to remove them altogether.
+//
+//      DTRACE_BEGIN ("search");
+//      ...
+//      DTRACE_END ("search");
+//
+//  Asynchronous spans may end in another place or thread, and overlap;
+//  begin and end are matched by name and id:
+//
+//      DTRACE_ASYNC_BEGIN ("queued", (uint64_t) (uintptr_t) query);
+//      DTRACE_ASYNC_END ("queued", (uint64_t) (uintptr_t) query);
+#if defined (GRAPHS_NO_TRACE)
+#   define DTRACE_BEGIN(name)
+#   define DTRACE_END(name)
+#   define DTRACE_ASYNC_BEGIN(name,id)
+#   define DTRACE_ASYNC_END(name,id)
+#else
+#   define DTRACE_BEGIN(name) \
+        do { if (dtrace_active) dtrace_event ('B', (name), 0); } while (0)
+#   define DTRACE_END(name) \
+        do { if (dtrace_active) dtrace_event ('E', (name), 0); } while (0)
+#   define DTRACE_ASYNC_BEGIN(name,id) \
+        do { if (dtrace_active) dtrace_event ('b', (name), (id)); } while (0)
+#   define DTRACE_ASYNC_END(name,id) \
+        do { if (dtrace_active) dtrace_event ('e', (name), (id)); } while (0)
+#endif
+
+//  Nonzero while tracing is enabled, read by the tracepoints
+GRAPHS_EXPORT extern volatile int dtrace_active;
+
+//  Enable or disable tracing. Every thread records events into its own
+//  ring of the latest DTRACE_RING_SIZE events, without locking.
+GRAPHS_EXPORT void
+    dtrace_enable (bool enable);
+
+//  Return true if tracing is enabled
+GRAPHS_EXPORT bool
+    dtrace_enabled (void);
+
+//  Record event of phase 'B' (begin), 'E' (end), 'b' (async begin) or 'e'
+//  (async end) in the ring of the calling thread. Use the macros above.
+GRAPHS_EXPORT void
+    dtrace_event (char phase, const char *name, uint64_t id);
+
+//  Write events of all threads to path as Chrome trace JSON, which
+//  Perfetto and chrome://tracing open. Threads keep recording meanwhile;
+//  events they overwrite during the dump may come out torn, so disable
+//  tracing first for an exact copy. Returns number of events written, -1
+//  if the file cannot be written.
+GRAPHS_EXPORT int
+    dtrace_dump (const char *path);
+
+//  Dump events to path when the process exits. Later calls replace the
+//  path, NULL cancels the dump.
+GRAPHS_EXPORT void
+    dtrace_dump_at_exit (const char *path);
+
+//  Forget events recorded so far. Tracing must be disabled, and threads
+//  which were recording done with their last event, as they advance their
+//  ring without locking.
+GRAPHS_EXPORT void
+    dtrace_clear (void);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dtrace_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+/*  =========================================================================
+    dversion - Published versions of a distance matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DVERSION_H_INCLUDED
+#define DVERSION_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create store publishing a copy of matrix as version 1. Versions share
+//  rows in blocks of block_rows rows, 0 for one row per block.
+GRAPHS_EXPORT dversion_t *
+    dversion_new (matrix_t *distances, int block_rows);
+
+//  Get the latest published version. Never blocks, safe from any thread.
+//  Caller owns a reference and drops it with dsnapshot_destroy.
+GRAPHS_EXPORT dsnapshot_t *
+    dversion_acquire (dversion_t *self);
+
+//  Get number of the latest published version. Never blocks.
+GRAPHS_EXPORT uint64_t
+    dversion_current (dversion_t *self);
+
+//  Set element in the version being prepared. Writers are serialized, but
+//  do not block readers.
+GRAPHS_EXPORT void
+    dversion_set (dversion_t *self, unsigned int x, unsigned int y, void *element);
+
+//  Set int element in the version being prepared
+GRAPHS_EXPORT void
+    dversion_set_int (dversion_t *self, unsigned int x, unsigned int y, int element);
+
+//  Publish the version being prepared, if any. Returns number of the
+//  latest published version.
+GRAPHS_EXPORT uint64_t
+    dversion_publish (dversion_t *self);
+
+//  Get number of replaced versions the store still holds, because a reader
+//  might have been taking them when they were replaced
+GRAPHS_EXPORT size_t
+    dversion_retired (dversion_t *self);
+
+//  Destroy the store. Snapshots acquired from it stay valid.
+GRAPHS_EXPORT void
+    dversion_destroy (dversion_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    dversion_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
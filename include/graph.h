@@ -0,0 +1,96 @@
+/*  =========================================================================
+    graph - Sparse adjacency of a distance graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef GRAPH_H_INCLUDED
+#define GRAPH_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a graph from a distance matrix. Row y holds weights of edges
+//  going out of node y, zero or negative weight means there is no edge.
+//  Returns NULL if matrix is not a square matrix of int.
+GRAPHS_EXPORT graph_t *
+    graph_new_from_matrix (matrix_t *distances);
+
+//  Create a graph of nodes from edges from [i] -> to [i] with weight [i].
+//  Edges with weight <= 0 or nodes out of range are skipped.
+GRAPHS_EXPORT graph_t *
+    graph_new_from_edges (int nodes, int edges, const int *from, const int *to, const int *weight);
+
+//  Create a graph over adjacency arrays owned by caller, which must outlive
+//  the graph: offsets of nodes + 1 items, targets and weights of edges in
+//  the layout of graph_offset. Returns NULL if offsets are not ascending.
+GRAPHS_EXPORT graph_t *
+    graph_new_view (int nodes, int *offsets, int *targets, int *weights);
+
+//  Get number of nodes
+GRAPHS_EXPORT int
+    graph_nodes (graph_t *self);
+
+//  Get number of edges
+GRAPHS_EXPORT int
+    graph_edges (graph_t *self);
+
+//  Get number of edges going out of node
+GRAPHS_EXPORT int
+    graph_degree (graph_t *self, int node);
+
+//  Get targets of edges going out of node, sorted by target
+GRAPHS_EXPORT const int *
+    graph_targets (graph_t *self, int node);
+
+//  Get weights of edges going out of node, in the order of targets
+GRAPHS_EXPORT const int *
+    graph_weights (graph_t *self, int node);
+
+//  Change weight of existing edge from node to node. Returns 0 if done, -1
+//  if there is no such edge; edges cannot be added in place.
+GRAPHS_EXPORT int
+    graph_set_weight (graph_t *self, int from, int to, int weight);
+
+//  Get index of the first edge going out of node. Edges of all nodes are
+//  numbered consecutively, so edge i of node has index offset + i.
+GRAPHS_EXPORT int
+    graph_offset (graph_t *self, int node);
+
+//  Create a graph with all edges reversed
+GRAPHS_EXPORT graph_t *
+    graph_reverse (graph_t *self);
+
+//  Create a copy of the graph with node u renamed to new_id [u]
+GRAPHS_EXPORT graph_t *
+    graph_permute (graph_t *self, const int *new_id);
+
+//  Get average distance between ids of adjacent nodes. Smaller span means
+//  neighbours are closer to each other in memory.
+GRAPHS_EXPORT double
+    graph_edge_span (graph_t *self);
+
+//  Destroy the graph
+GRAPHS_EXPORT void
+    graph_destroy (graph_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    graph_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -69,17 +69,77 @@
 //  These classes are stable or legacy and built in all releases
 //  Draft classes are by default not built in stable releases
 #ifdef GRAPHS_BUILD_DRAFT_API
+typedef struct _dtrace_t dtrace_t;
+#define DTRACE_T_DEFINED
+typedef struct _dbitset_t dbitset_t;
+#define DBITSET_T_DEFINED
 typedef struct _matrix_t matrix_t;
 #define MATRIX_T_DEFINED
+typedef struct _dresult_t dresult_t;
+#define DRESULT_T_DEFINED
+typedef struct _graph_t graph_t;
+#define GRAPH_T_DEFINED
+typedef struct _cgraph_t cgraph_t;
+#define CGRAPH_T_DEFINED
+typedef struct _dsearch_t dsearch_t;
+#define DSEARCH_T_DEFINED
+typedef struct _reorder_t reorder_t;
+#define REORDER_T_DEFINED
+typedef struct _dclient_t dclient_t;
+#define DCLIENT_T_DEFINED
+typedef struct _kpaths_t kpaths_t;
+#define KPATHS_T_DEFINED
+typedef struct _dconnect_t dconnect_t;
+#define DCONNECT_T_DEFINED
+typedef struct _msf_t msf_t;
+#define MSF_T_DEFINED
+typedef struct _dsnapshot_t dsnapshot_t;
+#define DSNAPSHOT_T_DEFINED
+typedef struct _dversion_t dversion_t;
+#define DVERSION_T_DEFINED
+typedef struct _dprecomp_t dprecomp_t;
+#define DPRECOMP_T_DEFINED
+typedef struct _doracle_t doracle_t;
+#define DORACLE_T_DEFINED
+typedef struct _dpartition_t dpartition_t;
+#define DPARTITION_T_DEFINED
+typedef struct _dtable_t dtable_t;
+#define DTABLE_T_DEFINED
 typedef struct _dijkstra_t dijkstra_t;
 #define DIJKSTRA_T_DEFINED
+typedef struct _dservice_t dservice_t;
+#define DSERVICE_T_DEFINED
+typedef struct _dshard_t dshard_t;
+#define DSHARD_T_DEFINED
+typedef struct _dshards_t dshards_t;
+#define DSHARDS_T_DEFINED
 #endif // GRAPHS_BUILD_DRAFT_API
 
 
 //  Public classes, each with its own header file
 #ifdef GRAPHS_BUILD_DRAFT_API
+#include "dtrace.h"
+#include "dbitset.h"
 #include "matrix.h"
+#include "dresult.h"
+#include "graph.h"
+#include "cgraph.h"
+#include "dsearch.h"
+#include "reorder.h"
+#include "dclient.h"
+#include "kpaths.h"
+#include "dconnect.h"
+#include "msf.h"
+#include "dsnapshot.h"
+#include "dversion.h"
+#include "dprecomp.h"
+#include "doracle.h"
+#include "dpartition.h"
+#include "dtable.h"
 #include "dijkstra.h"
+#include "dservice.h"
+#include "dshard.h"
+#include "dshards.h"
 #endif // GRAPHS_BUILD_DRAFT_API
 
 #ifdef GRAPHS_BUILD_DRAFT_API
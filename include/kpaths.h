@@ -0,0 +1,68 @@
+/*  =========================================================================
+    kpaths - K shortest loopless paths
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef KPATHS_H_INCLUDED
+#define KPATHS_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new path finder over graph. Graph must outlive the finder.
+GRAPHS_EXPORT kpaths_t *
+    kpaths_new (graph_t *graph);
+
+//  Find up to k shortest loopless paths from node to node, ordered by
+//  cost. Returns number of paths found, which is less than k if there are
+//  no more paths.
+GRAPHS_EXPORT int
+    kpaths_find (kpaths_t *self, int from, int to, int k);
+
+//  Get cost of path found by the last search, -1 if index is out of range
+GRAPHS_EXPORT int
+    kpaths_cost (kpaths_t *self, int index);
+
+//  Get number of nodes of path found by the last search, including both
+//  ends
+GRAPHS_EXPORT int
+    kpaths_length (kpaths_t *self, int index);
+
+//  Get nodes of path found by the last search, from first to last
+GRAPHS_EXPORT const int *
+    kpaths_nodes (kpaths_t *self, int index);
+
+//  Get number of spur searches run by the last search
+GRAPHS_EXPORT size_t
+    kpaths_searches (kpaths_t *self);
+
+//  Get number of spur paths taken from the shortest path tree without
+//  search by the last search
+GRAPHS_EXPORT size_t
+    kpaths_reused (kpaths_t *self);
+
+//  Destroy the path finder
+GRAPHS_EXPORT void
+    kpaths_destroy (kpaths_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    kpaths_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,10 +19,32 @@ extern "C" {
 #endif
 
 //  @interface
-//  Create a new matrix
+//  Allocation flags for matrix_new_with
+#define MATRIX_HUGEPAGES    1   //  Transparent huge pages
+#define MATRIX_HUGETLB      2   //  Explicit huge pages, transparent if none reserved
+#define MATRIX_NUMA_LOCAL   4   //  Place on NUMA node of the calling thread
+
+//  Element types of matrix algebra
+#define MATRIX_INT          0   //  int, INT_MAX means no path
+#define MATRIX_FLOAT        1   //  float, INFINITY means no path
+
+//  Create a new matrix. Rows are zeroed, padded and aligned to 64 bytes.
+//  Returns NULL if the matrix would not fit into memory.
 GRAPHS_EXPORT matrix_t *
     matrix_new (unsigned int x, unsigned int y, size_t element_size);
 
+//  Create a new matrix with rows padded and aligned to row_alignment bytes
+//  (power of two, 64 at least; 0 for default) and allocation flags.
+GRAPHS_EXPORT matrix_t *
+    matrix_new_with (unsigned int x, unsigned int y, size_t element_size,
+                     size_t row_alignment, int flags);
+
+//  Create a matrix viewing y rows of x elements owned by the caller. Row
+//  pointers are copied, rows themselves are not, and must outlive the view.
+//  Rows of a view are not contiguous, use matrix_get_ptr for every row.
+GRAPHS_EXPORT matrix_t *
+    matrix_new_view (unsigned int x, unsigned int y, size_t element_size, void **rows);
+
 //  set element
 GRAPHS_EXPORT void
     matrix_set (matrix_t *self, unsigned int x, unsigned int y, void *element);
@@ -50,11 +72,40 @@ GRAPHS_EXPORT int
 GRAPHS_EXPORT int
     matrix_y (matrix_t *self);
 
+//  Get number of bytes between two rows, including padding. Rows of a view
+//  are not evenly spaced, for views this is the size of row elements.
+GRAPHS_EXPORT size_t
+    matrix_row_size (matrix_t *self);
+
+//  Get size of one element in bytes
+GRAPHS_EXPORT size_t
+    matrix_element_size (matrix_t *self);
+
+//  Create transposed copy of matrix: element x of row y becomes element y
+//  of row x. Elements may be of any size. Returns NULL if out of memory.
+GRAPHS_EXPORT matrix_t *
+    matrix_transpose (matrix_t *self);
+
+//  Create min-plus product of matrices of MATRIX_INT or MATRIX_FLOAT
+//  elements: element x of row y is the smallest a (k, y) + b (x, k) over
+//  all k, so product of distance tables is a table of paths through them.
+//  Int elements must not be negative. Threads 0 picks a number by size of
+//  the product. Returns NULL if width of a is not height of b.
+GRAPHS_EXPORT matrix_t *
+    matrix_min_plus (matrix_t *a, matrix_t *b, int type, int threads);
+
+//  Replace every element by the element of other matrix if that is
+//  smaller, elements are MATRIX_INT or MATRIX_FLOAT. Returns 0 if done,
+//  -1 if sizes of the matrices differ.
+GRAPHS_EXPORT int
+    matrix_min (matrix_t *self, matrix_t *other, int type);
+
 //  Convert matrix to chunk
 GRAPHS_EXPORT zchunk_t *
     matrix_as_chunk (matrix_t *self);
 
-//  Convert chunk to matrix
+//  Convert chunk to matrix, destroys the chunk. Returns NULL if chunk is
+//  too short for the matrix it describes.
 GRAPHS_EXPORT matrix_t *
     matrix_from_chunk (zchunk_t **chunk_ptr);
 
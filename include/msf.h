@@ -0,0 +1,70 @@
+/*  =========================================================================
+    msf - Minimum spanning forest by parallel Boruvka
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef MSF_H_INCLUDED
+#define MSF_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Compute minimum spanning forest of graph, taking edges as undirected.
+//  Threads is the number of threads to use, 0 picks it from the number of
+//  CPUs and the size of the graph.
+GRAPHS_EXPORT msf_t *
+    msf_new (graph_t *graph, int threads);
+
+//  Get number of edges in the forest
+GRAPHS_EXPORT int
+    msf_edges (msf_t *self);
+
+//  Get sources of forest edges, ordered by weight
+GRAPHS_EXPORT const int *
+    msf_from (msf_t *self);
+
+//  Get targets of forest edges
+GRAPHS_EXPORT const int *
+    msf_to (msf_t *self);
+
+//  Get weights of forest edges
+GRAPHS_EXPORT const int *
+    msf_weights (msf_t *self);
+
+//  Get total weight of the forest
+GRAPHS_EXPORT int64_t
+    msf_weight (msf_t *self);
+
+//  Get number of trees in the forest, isolated nodes included
+GRAPHS_EXPORT int
+    msf_components (msf_t *self);
+
+//  Get number of Boruvka rounds it took
+GRAPHS_EXPORT int
+    msf_rounds (msf_t *self);
+
+//  Destroy the forest
+GRAPHS_EXPORT void
+    msf_destroy (msf_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    msf_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
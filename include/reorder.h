@@ -0,0 +1,70 @@
+/*  =========================================================================
+    reorder - Locality-improving node relabeling
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef REORDER_H_INCLUDED
+#define REORDER_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Reordering methods
+#define REORDER_BFS     1       //  Breadth-first visit order
+#define REORDER_RCM     2       //  Reverse Cuthill-McKee
+#define REORDER_DEGREE  3       //  Descending degree
+
+//  Compute new node ids of graph with method
+GRAPHS_EXPORT reorder_t *
+    reorder_new (graph_t *graph, int method);
+
+//  Create reordering from new ids of nodes 0 .. size - 1, e.g. saved from
+//  another one. Returns NULL if ids are not a permutation.
+GRAPHS_EXPORT reorder_t *
+    reorder_new_from_ids (int size, const int *new_id);
+
+//  Get method by name ("BFS", "RCM" or "DEGREE"), -1 if name is unknown
+GRAPHS_EXPORT int
+    reorder_method (const char *name);
+
+//  Get number of nodes
+GRAPHS_EXPORT int
+    reorder_size (reorder_t *self);
+
+//  Get new id of node, -1 if out of range
+GRAPHS_EXPORT int
+    reorder_to_new (reorder_t *self, int node);
+
+//  Get original id of node, -1 if out of range
+GRAPHS_EXPORT int
+    reorder_to_old (reorder_t *self, int node);
+
+//  Create copy of graph with nodes renamed to new ids
+GRAPHS_EXPORT graph_t *
+    reorder_graph (reorder_t *self, graph_t *graph);
+
+//  Destroy the reordering
+GRAPHS_EXPORT void
+    reorder_destroy (reorder_t **self_p);
+
+//  Self test of this class
+GRAPHS_EXPORT void
+    reorder_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
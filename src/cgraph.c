@@ -0,0 +1,391 @@
+/*  =========================================================================
+    cgraph - Compressed adjacency of a graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    cgraph - Compressed adjacency of a graph
+@discuss
+    Edges of every node are stored as one record of byte aligned varints
+    (7 bits per byte, high bit set on all bytes but the last): length of
+    the record in bytes, then for each edge the gap from the previous
+    target and the weight. First target is stored relative to the node
+    itself, zigzag encoded, so graphs relabeled for locality (see reorder)
+    take about one byte per target. Weights are kept exact, shortest paths
+    stay the same as over graph_t.
+
+    Only the first record of every group of CGRAPH_GROUP nodes has its
+    offset kept; records before the wanted one are skipped by their length.
+    They mostly share its cache line anyway. Searches decode one record at
+    a time, as they settle its node.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Nodes sharing one 64 bit base offset
+#define CGRAPH_GROUP_BITS   3
+#define CGRAPH_GROUP        (1 << CGRAPH_GROUP_BITS)
+
+//  Structure of our class
+
+struct _cgraph_t {
+    int nodes;
+    int edges;
+    int max_degree;
+    uint64_t *base;             //  Offset of first record of every group
+    uint8_t *data;              //  Records of all nodes
+    size_t data_size;
+};
+
+
+static inline uint32_t
+s_zigzag (int value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static inline int
+s_unzigzag (uint32_t value)
+{
+    return (int) (value >> 1) ^ -(int) (value & 1);
+}
+
+static inline size_t
+s_varint_size (uint32_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline uint8_t *
+s_varint_put (uint8_t *data, uint32_t value)
+{
+    while (value >= 0x80) {
+        *data++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *data++ = (uint8_t) value;
+    return data;
+}
+
+//  Most values fit one byte, which takes the branch predicted
+
+static inline uint32_t
+s_varint_get (const uint8_t **data_p)
+{
+    const uint8_t *data = *data_p;
+    uint32_t value = *data++;
+    if (value >= 0x80) {
+        value &= 0x7f;
+        int shift = 7;
+        uint32_t byte;
+        do {
+            byte = *data++;
+            value |= (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+    }
+    *data_p = data;
+    return value;
+}
+
+//  Encode edges of node at data, or only measure them if data is NULL.
+//  Returns their size.
+
+static size_t
+s_encode (graph_t *graph, int node, uint8_t *data)
+{
+    int degree = graph_degree (graph, node);
+    const int *targets = graph_targets (graph, node);
+    const int *weights = graph_weights (graph, node);
+    size_t size = 0;
+    int previous = node;
+    for (int i = 0; i < degree; i++) {
+        uint32_t gap = i ? (uint32_t) (targets [i] - previous)
+                         : s_zigzag (targets [i] - node);
+        size += s_varint_size (gap) + s_varint_size (weights [i]);
+        if (data) {
+            data = s_varint_put (data, gap);
+            data = s_varint_put (data, weights [i]);
+        }
+        previous = targets [i];
+    }
+    return size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create compressed copy of graph
+
+cgraph_t *
+cgraph_new (graph_t *graph)
+{
+    if (!graph) return NULL;
+
+    cgraph_t *self = (cgraph_t *) zmalloc (sizeof (cgraph_t));
+    assert (self);
+    self->nodes = graph_nodes (graph);
+    self->edges = graph_edges (graph);
+    int groups = (self->nodes + CGRAPH_GROUP - 1) >> CGRAPH_GROUP_BITS;
+    self->base = (uint64_t *) malloc ((groups + 1) * sizeof (uint64_t));
+    assert (self->base);
+
+    //  Measure records first, so data is allocated once
+    size_t size = 0;
+    for (int u = 0; u < self->nodes; u++) {
+        if ((u & (CGRAPH_GROUP - 1)) == 0)
+            self->base [u >> CGRAPH_GROUP_BITS] = size;
+        size_t length = s_encode (graph, u, NULL);
+        assert (length <= UINT32_MAX);
+        size += s_varint_size ((uint32_t) length) + length;
+        if (graph_degree (graph, u) > self->max_degree)
+            self->max_degree = graph_degree (graph, u);
+    }
+    self->data_size = size;
+    self->data = (uint8_t *) malloc (size + 1);
+    assert (self->data);
+    uint8_t *data = self->data;
+    for (int u = 0; u < self->nodes; u++) {
+        size_t length = s_encode (graph, u, NULL);
+        data = s_varint_put (data, (uint32_t) length);
+        s_encode (graph, u, data);
+        data += length;
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+cgraph_nodes (cgraph_t *self)
+{
+    if (!self) return 0;
+    return self->nodes;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges
+
+int
+cgraph_edges (cgraph_t *self)
+{
+    if (!self) return 0;
+    return self->edges;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get the largest number of edges going out of one node
+
+int
+cgraph_max_degree (cgraph_t *self)
+{
+    if (!self) return 0;
+    return self->max_degree;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Decode edges going out of node
+
+int
+cgraph_decode (cgraph_t *self, int node, int *targets, int *weights)
+{
+    if (!self || node < 0 || node >= self->nodes) return 0;
+    const uint8_t *data = self->data + self->base [node >> CGRAPH_GROUP_BITS];
+    for (int skip = node & (CGRAPH_GROUP - 1); skip; skip--) {
+        uint32_t length = s_varint_get (&data);
+        data += length;
+    }
+    uint32_t length = s_varint_get (&data);
+    if (length == 0)
+        return 0;
+    const uint8_t *end = data + length;
+    int target = node + s_unzigzag (s_varint_get (&data));
+    targets [0] = target;
+    weights [0] = (int) s_varint_get (&data);
+    int degree = 1;
+    while (data < end) {
+        target += (int) s_varint_get (&data);
+        targets [degree] = target;
+        weights [degree++] = (int) s_varint_get (&data);
+    }
+    return degree;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get bytes taken by the compressed adjacency
+
+size_t
+cgraph_size (cgraph_t *self)
+{
+    if (!self) return 0;
+    int groups = (self->nodes + CGRAPH_GROUP - 1) >> CGRAPH_GROUP_BITS;
+    return sizeof (cgraph_t) + (groups + 1) * sizeof (uint64_t) + self->data_size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create plain copy of the graph
+
+graph_t *
+cgraph_graph (cgraph_t *self)
+{
+    if (!self || self->nodes <= 0) return NULL;
+    int *from = (int *) malloc ((self->edges + 1) * sizeof (int));
+    int *to = (int *) malloc ((self->edges + 1) * sizeof (int));
+    int *weight = (int *) malloc ((self->edges + 1) * sizeof (int));
+    assert (from && to && weight);
+    int edges = 0;
+    for (int u = 0; u < self->nodes; u++) {
+        int degree = cgraph_decode (self, u, to + edges, weight + edges);
+        for (int i = 0; i < degree; i++)
+            from [edges + i] = u;
+        edges += degree;
+    }
+    graph_t *graph = graph_new_from_edges (self->nodes, edges, from, to, weight);
+    free (from);
+    free (to);
+    free (weight);
+    return graph;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the compressed graph
+
+void
+cgraph_destroy (cgraph_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        cgraph_t *self = *self_p;
+        free (self->base);
+        free (self->data);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+cgraph_test (bool verbose)
+{
+    printf (" * cgraph: ");
+
+    //  @selftest
+    assert (s_unzigzag (s_zigzag (-5)) == -5);
+    assert (s_unzigzag (s_zigzag (INT_MAX)) == INT_MAX);
+    assert (s_unzigzag (s_zigzag (INT_MIN + 1)) == INT_MIN + 1);
+
+    //  Targets below and above the node, weights of several bytes, node 3
+    //  without edges
+    int from [] = { 0, 0, 1, 1, 2, 4, 4 };
+    int to [] = { 1, 4, 0, 2, 1, 0, 3 };
+    int weight [] = { 1, 200, 1, 70000, 1, INT_MAX, 5 };
+    graph_t *graph = graph_new_from_edges (5, 7, from, to, weight);
+    cgraph_t *self = cgraph_new (graph);
+    assert (self);
+    assert (cgraph_nodes (self) == 5);
+    assert (cgraph_edges (self) == 7);
+    assert (cgraph_max_degree (self) == 2);
+    int targets [2], weights [2];
+    assert (cgraph_decode (self, 3, targets, weights) == 0);
+    assert (cgraph_decode (self, 5, targets, weights) == 0);
+    for (int u = 0; u < 5; u++) {
+        int degree = cgraph_decode (self, u, targets, weights);
+        assert (degree == graph_degree (graph, u));
+        for (int i = 0; i < degree; i++) {
+            assert (targets [i] == graph_targets (graph, u) [i]);
+            assert (weights [i] == graph_weights (graph, u) [i]);
+        }
+    }
+    graph_t *copy = cgraph_graph (self);
+    assert (graph_edges (copy) == 7);
+    assert (graph_weights (copy, 4) [0] == INT_MAX);
+    graph_destroy (&copy);
+    cgraph_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Relabeled grid takes a fraction of the plain adjacency, searches
+    //  over both agree
+    const int side = 100;
+    const int nodes = side * side;
+    int *gfrom = (int *) malloc (4 * nodes * sizeof (int));
+    int *gto = (int *) malloc (4 * nodes * sizeof (int));
+    int *gweight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (gfrom && gto && gweight);
+    int edges = 0;
+    srandom (5);
+    for (int u = 0; u < nodes; u++) {
+        int neighbours [2] = { u % side + 1 < side ? u + 1 : -1, u + side < nodes ? u + side : -1 };
+        for (int n = 0; n < 2; n++) {
+            if (neighbours [n] == -1)
+                continue;
+            int w = 1 + random () % 100;
+            gfrom [edges] = u; gto [edges] = neighbours [n]; gweight [edges++] = w;
+            gfrom [edges] = neighbours [n]; gto [edges] = u; gweight [edges++] = w;
+        }
+    }
+    graph = graph_new_from_edges (nodes, edges, gfrom, gto, gweight);
+    reorder_t *order = reorder_new (graph, REORDER_RCM);
+    graph_t *relabeled = reorder_graph (order, graph);
+    self = cgraph_new (relabeled);
+    size_t plain = (nodes + 1) * sizeof (int) + 2 * (size_t) edges * sizeof (int);
+    if (verbose)
+        printf ("\n%zu bytes plain, %zu compressed\n", plain, cgraph_size (self));
+    assert (cgraph_size (self) * 3 < plain);
+    dsearch_t *search = dsearch_new (relabeled);
+    dsearch_t *packed = dsearch_new_compressed (self);
+    assert (packed);
+    dsearch_run (search, 77);
+    dsearch_run (packed, 77);
+    for (int u = 0; u < nodes; u++) {
+        assert (dsearch_distance (packed, u) == dsearch_distance (search, u));
+        assert (dsearch_parent (packed, u) == dsearch_parent (search, u));
+    }
+    dsearch_destroy (&packed);
+    dsearch_destroy (&search);
+    cgraph_destroy (&self);
+    graph_destroy (&relabeled);
+    reorder_destroy (&order);
+    graph_destroy (&graph);
+    free (gfrom);
+    free (gto);
+    free (gweight);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,415 @@
+/*  =========================================================================
+    dbitset - Bit-packed boolean matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dbitset - Bit-packed boolean matrix
+@discuss
+    Visited flags, reachability and transitive closures take one bit per
+    entry instead of an int element of matrix_t, 32 times less memory.
+    Operations on rows work a 64-bit word at a time: OR and AND of rows,
+    population count and search for the next set bit, which skips clear
+    words whole.
+
+    Transitive closure is Warshall's algorithm over rows: once paths
+    through nodes below k are known, every row which reaches k takes the
+    row of k, so the work is n * n / 64 word operations per node.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DBITSET_ROW_ALIGNMENT   64
+#define DBITSET_ROW_WORDS       (DBITSET_ROW_ALIGNMENT / sizeof (uint64_t))
+
+//  Structure of our class
+
+struct _dbitset_t {
+    unsigned int x;             //  Bits in a row
+    unsigned int y;             //  Rows
+    size_t row_words;           //  Words between two rows, with padding
+    uint64_t *words;
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new bit matrix
+
+dbitset_t *
+dbitset_new (unsigned int x, unsigned int y)
+{
+    size_t row_words = ((size_t) x + 63) / 64;
+    row_words = (row_words + DBITSET_ROW_WORDS - 1) / DBITSET_ROW_WORDS * DBITSET_ROW_WORDS;
+    if (row_words && y > SIZE_MAX / sizeof (uint64_t) / row_words)
+        return NULL;
+    size_t size = row_words * y * sizeof (uint64_t);
+
+    dbitset_t *self = (dbitset_t *) zmalloc (sizeof (dbitset_t));
+    assert (self);
+    if (posix_memalign ((void **) &self->words, DBITSET_ROW_ALIGNMENT, size ? size : 1) != 0) {
+        free (self);
+        return NULL;
+    }
+    memset (self->words, 0, size);
+    self->x = x;
+    self->y = y;
+    self->row_words = row_words;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create bit matrix of edges of dense graph
+
+dbitset_t *
+dbitset_from_matrix (matrix_t *matrix)
+{
+    if (!matrix || matrix_element_size (matrix) != sizeof (int))
+        return NULL;
+    dbitset_t *self = dbitset_new (matrix_x (matrix), matrix_y (matrix));
+    if (!self)
+        return NULL;
+    for (unsigned int y = 0; y < self->y; y++) {
+        const int *row = (const int *) matrix_get_ptr (matrix, 0, y);
+        uint64_t *bits = self->words + y * self->row_words;
+        for (unsigned int x = 0; x < self->x; x++)
+            if (row [x] > 0 && row [x] != INT_MAX)
+                bits [x / 64] |= (uint64_t) 1 << (x % 64);
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of bits in a row
+
+unsigned int
+dbitset_x (dbitset_t *self)
+{
+    assert (self);
+    return self->x;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of rows
+
+unsigned int
+dbitset_y (dbitset_t *self)
+{
+    assert (self);
+    return self->y;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set bit x of row y
+
+void
+dbitset_set (dbitset_t *self, unsigned int x, unsigned int y)
+{
+    assert (self);
+    assert (x < self->x && y < self->y);
+    self->words [y * self->row_words + x / 64] |= (uint64_t) 1 << (x % 64);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Clear bit x of row y
+
+void
+dbitset_clear (dbitset_t *self, unsigned int x, unsigned int y)
+{
+    assert (self);
+    assert (x < self->x && y < self->y);
+    self->words [y * self->row_words + x / 64] &= ~((uint64_t) 1 << (x % 64));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if bit x of row y is set
+
+bool
+dbitset_get (dbitset_t *self, unsigned int x, unsigned int y)
+{
+    assert (self);
+    assert (x < self->x && y < self->y);
+    return (self->words [y * self->row_words + x / 64] >> (x % 64)) & 1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get words of row y
+
+uint64_t *
+dbitset_row (dbitset_t *self, unsigned int y)
+{
+    assert (self);
+    assert (y < self->y);
+    return self->words + y * self->row_words;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Clear all bits
+
+void
+dbitset_zero (dbitset_t *self)
+{
+    assert (self);
+    memset (self->words, 0, self->row_words * self->y * sizeof (uint64_t));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of bits set in row y
+
+size_t
+dbitset_count (dbitset_t *self, unsigned int y)
+{
+    const uint64_t *row = dbitset_row (self, y);
+    size_t count = 0;
+    for (size_t i = 0; i < self->row_words; i++)
+        count += __builtin_popcountll (row [i]);
+    return count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set bits of row y which are set in row of other matrix
+
+size_t
+dbitset_or (dbitset_t *self, unsigned int y, dbitset_t *other, unsigned int other_y)
+{
+    uint64_t *row = dbitset_row (self, y);
+    const uint64_t *source = dbitset_row (other, other_y);
+    assert (self->x == other->x);
+    size_t added = 0;
+    for (size_t i = 0; i < self->row_words; i++) {
+        added += __builtin_popcountll (source [i] & ~row [i]);
+        row [i] |= source [i];
+    }
+    return added;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Clear bits of row y which are clear in row of other matrix
+
+void
+dbitset_and (dbitset_t *self, unsigned int y, dbitset_t *other, unsigned int other_y)
+{
+    uint64_t *row = dbitset_row (self, y);
+    const uint64_t *source = dbitset_row (other, other_y);
+    assert (self->x == other->x);
+    for (size_t i = 0; i < self->row_words; i++)
+        row [i] &= source [i];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get first bit set in row y at x or after it
+
+int
+dbitset_next (dbitset_t *self, unsigned int y, unsigned int x)
+{
+    const uint64_t *row = dbitset_row (self, y);
+    if (x >= self->x)
+        return -1;
+    size_t i = x / 64;
+    uint64_t word = row [i] & (~(uint64_t) 0 << (x % 64));
+    size_t words = ((size_t) self->x + 63) / 64;
+    while (!word) {
+        if (++i == words)
+            return -1;
+        word = row [i];
+    }
+    return (int) (i * 64 + __builtin_ctzll (word));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Replace edges of square matrix by its transitive closure
+
+int
+dbitset_closure (dbitset_t *self)
+{
+    assert (self);
+    if (self->x != self->y)
+        return -1;
+
+    size_t words = ((size_t) self->x + 63) / 64;
+    for (unsigned int k = 0; k < self->y; k++) {
+        const uint64_t *through = self->words + k * self->row_words;
+        uint64_t mask = (uint64_t) 1 << (k % 64);
+        for (unsigned int y = 0; y < self->y; y++) {
+            uint64_t *row = self->words + y * self->row_words;
+            if (row [k / 64] & mask)
+                for (size_t i = 0; i < words; i++)
+                    row [i] |= through [i];
+        }
+    }
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the matrix
+
+void
+dbitset_destroy (dbitset_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dbitset_t *self = *self_p;
+        free (self->words);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dbitset_test (bool verbose)
+{
+    printf (" * dbitset: ");
+
+    //  @selftest
+    //  Rows of odd width, set and cleared around word boundaries
+    dbitset_t *self = dbitset_new (130, 3);
+    assert (self);
+    assert (dbitset_x (self) == 130);
+    assert (dbitset_y (self) == 3);
+    for (unsigned int y = 0; y < 3; y++)
+        assert ((uintptr_t) dbitset_row (self, y) % 64 == 0);
+    assert (dbitset_next (self, 0, 0) == -1);
+    dbitset_set (self, 0, 1);
+    dbitset_set (self, 63, 1);
+    dbitset_set (self, 64, 1);
+    dbitset_set (self, 129, 1);
+    assert (dbitset_get (self, 63, 1));
+    assert (!dbitset_get (self, 63, 0));
+    assert (!dbitset_get (self, 62, 1));
+    assert (dbitset_count (self, 1) == 4);
+    assert (dbitset_row (self, 1) [1] == 1);
+    int expect [] = { 0, 63, 64, 129 };
+    int found = 0;
+    for (int x = dbitset_next (self, 1, 0); x != -1; x = dbitset_next (self, 1, x + 1))
+        assert (x == expect [found++]);
+    assert (found == 4);
+    assert (dbitset_next (self, 1, 65) == 129);
+    assert (dbitset_next (self, 1, 130) == -1);
+    dbitset_clear (self, 64, 1);
+    assert (!dbitset_get (self, 64, 1));
+    assert (dbitset_next (self, 1, 64) == 129);
+
+    //  Row operations, in place and between rows
+    dbitset_set (self, 5, 0);
+    dbitset_set (self, 63, 0);
+    assert (dbitset_or (self, 0, self, 1) == 2);
+    assert (dbitset_count (self, 0) == 4);
+    assert (dbitset_or (self, 0, self, 1) == 0);
+    dbitset_and (self, 0, self, 2);
+    assert (dbitset_count (self, 0) == 0);
+    dbitset_t *other = dbitset_new (130, 1);
+    dbitset_set (other, 129, 0);
+    dbitset_set (other, 100, 0);
+    dbitset_and (self, 1, other, 0);
+    assert (dbitset_count (self, 1) == 1);
+    assert (dbitset_get (self, 129, 1));
+    dbitset_zero (self);
+    assert (dbitset_count (self, 1) == 0);
+    dbitset_destroy (&other);
+    dbitset_destroy (&self);
+    assert (self == NULL);
+    assert (dbitset_new (UINT_MAX, UINT_MAX) == NULL);
+
+    //  Edges of dense graph, and closure of random graph against search
+    int nodes = 150;
+    matrix_t *graph = matrix_new (nodes, nodes, sizeof (int));
+    unsigned int seed = 11;
+    for (int edge = 0; edge < 170; edge++)
+        matrix_set_int (graph, rand_r (&seed) % nodes, rand_r (&seed) % nodes, 1 + rand_r (&seed) % 9);
+    matrix_set_int (graph, 1, 0, INT_MAX);
+    self = dbitset_from_matrix (graph);
+    assert (self);
+    assert (!dbitset_get (self, 1, 0));
+    for (int y = 0; y < nodes; y++)
+        for (int x = 0; x < nodes; x++)
+            assert (dbitset_get (self, x, y) == (matrix_as_int (graph, x, y) > 0
+                                                  && matrix_as_int (graph, x, y) != INT_MAX));
+    assert (dbitset_closure (self) == 0);
+    int *queue = (int *) malloc (nodes * sizeof (int));
+    bool *seen = (bool *) malloc (nodes * sizeof (bool));
+    assert (queue && seen);
+    for (int from = 0; from < nodes; from++) {
+        memset (seen, 0, nodes * sizeof (bool));
+        int head = 0, tail = 0;
+        queue [tail++] = from;
+        while (head < tail) {
+            int node = queue [head++];
+            for (int to = 0; to < nodes; to++) {
+                int weight = matrix_as_int (graph, to, node);
+                if (weight > 0 && weight != INT_MAX && !seen [to]) {
+                    seen [to] = true;
+                    queue [tail++] = to;
+                }
+            }
+        }
+        for (int to = 0; to < nodes; to++)
+            assert (dbitset_get (self, to, from) == seen [to]);
+    }
+    free (queue);
+    free (seen);
+    dbitset_destroy (&self);
+
+    self = dbitset_new (3, 4);
+    assert (dbitset_closure (self) == -1);
+    dbitset_destroy (&self);
+    matrix_destroy (&graph);
+    graph = vector_new (4, sizeof (double));
+    assert (dbitset_from_matrix (graph) == NULL);
+    vector_destroy (&graph);
+
+    if (verbose) {
+        nodes = 2000;
+        self = dbitset_new (nodes, nodes);
+        for (int edge = 0; edge < nodes; edge++)
+            dbitset_set (self, rand_r (&seed) % nodes, rand_r (&seed) % nodes);
+        int64_t start = zclock_usecs ();
+        dbitset_closure (self);
+        printf ("\nclosure of %d nodes in %" PRId64 " us, %zu bytes instead of %zu\n",
+                nodes, zclock_usecs () - start,
+                (size_t) nodes * self->row_words * sizeof (uint64_t),
+                (size_t) nodes * nodes * sizeof (int));
+        dbitset_destroy (&self);
+    }
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,338 @@
+/*  =========================================================================
+    dclient - Pipelined query client
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dclient - Pipelined query client
+@discuss
+    Keeps a window of QUERY requests in flight instead of waiting for every
+    reply, so round trips overlap. Replies are matched to queries by their
+    correlation ids. Replies received while waiting for window space are
+    kept until the caller asks for them.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _dclient_t {
+    void *handle;               //  Actor or socket we talk to, not owned
+    bool delimited;             //  DEALER socket needs empty delimiter
+    size_t window;              //  Maximum of outstanding queries
+    size_t in_flight;           //  Queries without reply received
+    zlist_t *received;          //  Replies not taken by caller yet
+    uint32_t sequence;          //  Last correlation id
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new client
+
+dclient_t *
+dclient_new (void *handle, size_t window)
+{
+    if (!handle || !window) return NULL;
+
+    dclient_t *self = (dclient_t *) zmalloc (sizeof (dclient_t));
+    assert (self);
+    self->handle = handle;
+    self->delimited = !zactor_is (handle) && zsock_type (handle) == ZMQ_DEALER;
+    self->window = window;
+    self->received = zlist_new ();
+    return self;
+}
+
+
+//  Receive one reply into received list. Returns -1 if interrupted.
+
+static int
+s_dclient_receive (dclient_t *self)
+{
+    while (true) {
+        zmsg_t *reply = zmsg_recv (self->handle);
+        if (!reply)
+            return -1;          //  Interrupted
+        if (self->delimited) {
+            zframe_t *empty = zmsg_pop (reply);
+            zframe_destroy (&empty);
+        }
+        char *command = zmsg_popstr (reply);
+        char *version = zmsg_popstr (reply);
+        bool valid = command && streq (command, "REPLY")
+                  && version && streq (version, DIJKSTRA_PROTOCOL_VERSION)
+                  && zmsg_size (reply) >= 2;
+        zstr_free (&command);
+        zstr_free (&version);
+        if (valid) {
+            //  Correlation id stays first frame until caller takes reply
+            zlist_append (self->received, reply);
+            self->in_flight--;
+            return 0;
+        }
+        zsys_warning ("dclient: dropped invalid reply");
+        zmsg_destroy (&reply);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send query for shortest paths from node
+
+uint32_t
+dclient_query (dclient_t *self, int from, const char *layout, int64_t deadline)
+{
+    assert (self);
+    while (self->in_flight >= self->window)
+        if (s_dclient_receive (self) == -1)
+            return 0;
+
+    if (++self->sequence == 0)
+        self->sequence = 1;     //  Zero means no id
+    zmsg_t *request = zmsg_new ();
+    if (self->delimited)
+        zmsg_addmem (request, "", 0);
+    zmsg_addstr (request, "QUERY");
+    zmsg_addstr (request, DIJKSTRA_PROTOCOL_VERSION);
+    zmsg_addstrf (request, "%" PRIu32, self->sequence);
+    zmsg_addstrf (request, "%" PRId64, deadline);
+    zmsg_addstrf (request, "%d", from);
+    if (layout)
+        zmsg_addstr (request, layout);
+    if (zmsg_send (&request, self->handle) == -1) {
+        zmsg_destroy (&request);
+        return 0;
+    }
+    self->in_flight++;
+    return self->sequence;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Receive next reply
+
+zmsg_t *
+dclient_recv (dclient_t *self, uint32_t *id_p)
+{
+    assert (self);
+    if (!zlist_size (self->received)) {
+        if (!self->in_flight || s_dclient_receive (self) == -1)
+            return NULL;
+    }
+    zmsg_t *reply = (zmsg_t *) zlist_pop (self->received);
+    char *id = zmsg_popstr (reply);
+    if (id_p)
+        *id_p = (uint32_t) strtoul (id, NULL, 10);
+    zstr_free (&id);
+    return reply;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of queries sent and not received yet by caller
+
+size_t
+dclient_outstanding (dclient_t *self)
+{
+    if (!self) return 0;
+    return self->in_flight + zlist_size (self->received);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get window size
+
+size_t
+dclient_window (dclient_t *self)
+{
+    if (!self) return 0;
+    return self->window;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the client
+
+void
+dclient_destroy (dclient_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dclient_t *self = *self_p;
+        zmsg_t *reply = (zmsg_t *) zlist_pop (self->received);
+        while (reply) {
+            zmsg_destroy (&reply);
+            reply = (zmsg_t *) zlist_pop (self->received);
+        }
+        zlist_destroy (&self->received);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Check reply to DIST query from node of the 4 node test graph
+static void
+s_check_reply (zmsg_t *reply, int from)
+{
+    char *status = zmsg_popstr (reply);
+    assert (streq (status, "DONE"));
+    zstr_free (&status);
+    zframe_t *frame = zmsg_pop (reply);
+    zchunk_t *chunk = zchunk_unpack (frame);
+    zframe_destroy (&frame);
+    dresult_t *result = dresult_from_chunk (&chunk);
+    assert (dresult_distance (result, from) == 0);
+    assert (dresult_distance (result, 3) == (from == 3 ? 0 : 3));
+    dresult_destroy (&result);
+}
+
+void
+dclient_test (bool verbose)
+{
+    printf (" * dclient: ");
+
+    //  @selftest
+    //  Distance between x and y is max (x, y)
+    matrix_t *d = matrix_new (4, 4, sizeof (int));
+    for (int x = 1; x < 4; x++) {
+        for (int y = 0; y < x; y++) {
+            matrix_set_int (d, x, y, x);
+            matrix_set_int (d, y, x, x);
+        }
+    }
+    zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+    assert (dijkstra);
+    zstr_sendx (dijkstra, "START", NULL);
+
+    //  Window of 3 queries over 10 queries to the actor
+    dclient_t *self = dclient_new (dijkstra, 3);
+    assert (self);
+    assert (dclient_window (self) == 3);
+    int from_of [11] = { 0 };
+    for (int i = 0; i < 10; i++) {
+        uint32_t id = dclient_query (self, i % 4, "DIST", 0);
+        assert (id == (uint32_t) i + 1);
+        from_of [id] = i % 4;
+        assert (dclient_outstanding (self) <= 10);
+    }
+    assert (dclient_outstanding (self) == 10);
+    bool seen [11] = { false };
+    zmsg_t *reply;
+    uint32_t id;
+    while ((reply = dclient_recv (self, &id))) {
+        assert (id >= 1 && id <= 10 && !seen [id]);
+        seen [id] = true;
+        s_check_reply (reply, from_of [id]);
+        zmsg_destroy (&reply);
+    }
+    assert (dclient_outstanding (self) == 0);
+
+    //  Queries with the earliest deadline are answered first, expired ones
+    //  are answered without search
+    dclient_destroy (&self);
+    self = dclient_new (dijkstra, 10);
+    int64_t now = zclock_time ();
+    uint32_t late = dclient_query (self, 1, "DIST", 0);
+    uint32_t urgent = dclient_query (self, 2, "DIST", now + 60000);
+    uint32_t expired = dclient_query (self, 3, "DIST", now - 1000);
+    uint32_t order [3];
+    for (int i = 0; i < 3; i++) {
+        reply = dclient_recv (self, &order [i]);
+        assert (reply);
+        char *status = zmsg_popstr (reply);
+        if (order [i] == expired)
+            assert (streq (status, "EXPIRED"));
+        else
+            assert (streq (status, "DONE"));
+        zstr_free (&status);
+        zmsg_destroy (&reply);
+    }
+    //  All queries may be answered before the next one arrives, but when
+    //  queued together, deadline order wins
+    if (order [0] != late) {
+        assert (order [0] == expired);
+        assert (order [1] == urgent);
+        assert (order [2] == late);
+    }
+
+    //  Invalid node gets error with the correlation id
+    uint32_t bad = dclient_query (self, 99, NULL, 0);
+    reply = dclient_recv (self, &id);
+    assert (id == bad);
+    char *status = zmsg_popstr (reply);
+    assert (streq (status, "ERROR"));
+    zstr_free (&status);
+    zmsg_destroy (&reply);
+    dclient_destroy (&self);
+
+    //  Unsupported protocol version is refused
+    zstr_sendx (dijkstra, "QUERY", "0", "7", "0", "0", NULL);
+    char *command, *version, *correlation, *reason;
+    zstr_recvx (dijkstra, &command, &version, &correlation, &status, &reason, NULL);
+    assert (streq (command, "REPLY"));
+    assert (streq (correlation, "7"));
+    assert (streq (status, "ERROR"));
+    zstr_free (&command);
+    zstr_free (&version);
+    zstr_free (&correlation);
+    zstr_free (&status);
+    zstr_free (&reason);
+    zactor_destroy (&dijkstra);
+
+    //  Same over dservice, replies come from several workers
+    zactor_t *dservice = zactor_new (dservice_actor, d);
+    zstr_sendx (dservice, "WORKERS", "2", NULL);
+    zstr_sendx (dservice, "BIND", "inproc://dclient-test", NULL);
+    char *rc = zstr_recv (dservice);
+    assert (streq (rc, "0"));
+    zstr_free (&rc);
+    zstr_sendx (dservice, "START", NULL);
+    zsock_t *dealer = zsock_new_dealer (">inproc://dclient-test");
+    assert (dealer);
+    self = dclient_new (dealer, 4);
+    memset (seen, 0, sizeof (seen));
+    for (int i = 0; i < 10; i++) {
+        id = dclient_query (self, i % 4, "DIST", 0);
+        from_of [id] = i % 4;
+    }
+    while ((reply = dclient_recv (self, &id))) {
+        assert (!seen [id]);
+        seen [id] = true;
+        s_check_reply (reply, from_of [id]);
+        zmsg_destroy (&reply);
+    }
+    for (int i = 1; i <= 10; i++)
+        assert (seen [i]);
+    dclient_destroy (&self);
+    zsock_destroy (&dealer);
+    zactor_destroy (&dservice);
+    matrix_destroy (&d);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,518 @@
+/*  =========================================================================
+    dconnect - Connectivity index of a graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dconnect - Connectivity index of a graph
+@discuss
+    Answers in constant time whether a search from one node can reach
+    another at all, so hopeless searches are not started.
+
+    Connected components, taking edges as undirected, are kept in a
+    lock-free union-find forest, so large graphs are united by several
+    threads at once. New edges are a single union. For undirected graphs
+    this answers reachability exactly.
+
+    Directed graphs get their strongly connected components indexed too,
+    by Tarjan's method. Components are numbered in the order Tarjan closes
+    them, which is a reverse topological order of the condensation: every
+    edge goes from a component to the same or a lower numbered one. Node
+    cannot reach nodes of higher numbered components. A new edge which
+    keeps this order changes nothing; one which breaks it may merge
+    components, so the strong index is marked stale until rebuilt, and
+    only the connected components are used meanwhile.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Graphs with less edges are united by one thread
+#define DCONNECT_PARALLEL_EDGES (1 << 16)
+#define DCONNECT_MAX_THREADS    16
+
+//  Structure of our class
+
+struct _dconnect_t {
+    int nodes;
+    dunion_t *forest;           //  Connected components
+    bool directed;              //  Some edge has no reverse
+    bool stale;                 //  Strong index no longer valid
+    int *strong;                //  Strong component of node, NULL if undirected
+};
+
+typedef struct {
+    graph_t *graph;
+    dunion_t *forest;
+    int begin;                  //  First node to unite with its neighbours
+    int end;
+} s_union_task_t;
+
+
+static void *
+s_union_worker (void *args)
+{
+    s_union_task_t *task = (s_union_task_t *) args;
+    for (int u = task->begin; u < task->end; u++) {
+        int degree = graph_degree (task->graph, u);
+        const int *targets = graph_targets (task->graph, u);
+        for (int i = 0; i < degree; i++)
+            dunion_unite (task->forest, u, targets [i]);
+    }
+    return NULL;
+}
+
+//  Build connected components with threads, each taking a range of nodes
+//  with about the same number of edges
+
+static void
+s_dconnect_unite_all (dconnect_t *self, graph_t *graph, int threads)
+{
+    dunion_reset (self->forest);
+    int edges = graph_edges (graph);
+    if (threads > DCONNECT_MAX_THREADS)
+        threads = DCONNECT_MAX_THREADS;
+    if (threads < 1)
+        threads = 1;
+
+    s_union_task_t tasks [DCONNECT_MAX_THREADS];
+    pthread_t thread [DCONNECT_MAX_THREADS];
+    int begin = 0;
+    for (int t = 0; t < threads; t++) {
+        //  Range ends where its share of edges does
+        int64_t share = (int64_t) edges * (t + 1) / threads;
+        int end = begin;
+        while (end < self->nodes && graph_offset (graph, end) < share)
+            end++;
+        if (t == threads - 1)
+            end = self->nodes;
+        tasks [t].graph = graph;
+        tasks [t].forest = self->forest;
+        tasks [t].begin = begin;
+        tasks [t].end = end;
+        begin = end;
+    }
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+        if (pthread_create (&thread [t], NULL, s_union_worker, &tasks [t]) == 0)
+            started = t;
+        else
+            break;
+    s_union_worker (&tasks [0]);
+    //  Ranges of threads which did not start are done here
+    for (int t = started + 1; t < threads; t++)
+        s_union_worker (&tasks [t]);
+    for (int t = 1; t <= started; t++)
+        pthread_join (thread [t], NULL);
+
+    dunion_flatten (self->forest);
+}
+
+//  Number of threads worth starting for graph
+
+static int
+s_dconnect_threads (graph_t *graph)
+{
+    long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    long useful = graph_edges (graph) / DCONNECT_PARALLEL_EDGES + 1;
+    return (int) (cpus < useful ? (cpus > 0 ? cpus : 1) : useful);
+}
+
+//  Does every edge have its reverse?
+
+static bool
+s_symmetric (graph_t *graph)
+{
+    int nodes = graph_nodes (graph);
+    for (int u = 0; u < nodes; u++) {
+        int degree = graph_degree (graph, u);
+        const int *targets = graph_targets (graph, u);
+        for (int i = 0; i < degree; i++) {
+            //  Adjacency is sorted by target
+            int v = targets [i];
+            const int *back = graph_targets (graph, v);
+            int low = 0;
+            int high = graph_degree (graph, v);
+            while (low < high) {
+                int middle = (low + high) / 2;
+                if (back [middle] < u)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            if (low == graph_degree (graph, v) || back [low] != u)
+                return false;
+        }
+    }
+    return true;
+}
+
+//  Number strongly connected components by iterative Tarjan's method
+
+static void
+s_dconnect_strong (dconnect_t *self, graph_t *graph)
+{
+    int nodes = self->nodes;
+    int *index = (int *) malloc (nodes * sizeof (int));
+    int *low = (int *) malloc (nodes * sizeof (int));
+    int *stack = (int *) malloc (nodes * sizeof (int));
+    int *call_node = (int *) malloc (nodes * sizeof (int));
+    int *call_edge = (int *) malloc (nodes * sizeof (int));
+    bool *on_stack = (bool *) zmalloc (nodes * sizeof (bool));
+    assert (index && low && stack && call_node && call_edge && on_stack);
+    for (int u = 0; u < nodes; u++)
+        index [u] = -1;
+
+    int counter = 0;
+    int components = 0;
+    int stack_size = 0;
+    for (int root = 0; root < nodes; root++) {
+        if (index [root] != -1)
+            continue;
+        int calls = 0;
+        call_node [calls] = root;
+        call_edge [calls++] = 0;
+        index [root] = low [root] = counter++;
+        stack [stack_size++] = root;
+        on_stack [root] = true;
+        while (calls) {
+            int u = call_node [calls - 1];
+            int i = call_edge [calls - 1];
+            if (i < graph_degree (graph, u)) {
+                call_edge [calls - 1]++;
+                int v = graph_targets (graph, u) [i];
+                if (index [v] == -1) {
+                    index [v] = low [v] = counter++;
+                    stack [stack_size++] = v;
+                    on_stack [v] = true;
+                    call_node [calls] = v;
+                    call_edge [calls++] = 0;
+                }
+                else
+                if (on_stack [v] && index [v] < low [u])
+                    low [u] = index [v];
+                continue;
+            }
+            calls--;
+            if (low [u] == index [u]) {
+                int w;
+                do {
+                    w = stack [--stack_size];
+                    on_stack [w] = false;
+                    self->strong [w] = components;
+                } while (w != u);
+                components++;
+            }
+            if (calls) {
+                int p = call_node [calls - 1];
+                if (low [u] < low [p])
+                    low [p] = low [u];
+            }
+        }
+    }
+    free (index);
+    free (low);
+    free (stack);
+    free (call_node);
+    free (call_edge);
+    free (on_stack);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create connectivity index of graph
+
+dconnect_t *
+dconnect_new (graph_t *graph)
+{
+    if (!graph) return NULL;
+
+    dconnect_t *self = (dconnect_t *) zmalloc (sizeof (dconnect_t));
+    assert (self);
+    dconnect_rebuild (self, graph);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create connectivity index from components computed before
+
+dconnect_t *
+dconnect_new_from_components (int nodes, const int *component, const int *strong)
+{
+    if (nodes <= 0 || !component) return NULL;
+    for (int u = 0; u < nodes; u++) {
+        int root = component [u];
+        if (root < 0 || root >= nodes || component [root] != root)
+            return NULL;        //  Not a component numbering of ours
+    }
+    dconnect_t *self = (dconnect_t *) zmalloc (sizeof (dconnect_t));
+    assert (self);
+    self->nodes = nodes;
+    self->forest = dunion_new (nodes);
+    //  Roots are the smallest nodes, uniting with them keeps them roots
+    for (int u = 0; u < nodes; u++)
+        dunion_unite (self->forest, u, component [u]);
+    dunion_flatten (self->forest);
+    if (strong) {
+        self->directed = true;
+        self->strong = (int *) malloc ((nodes + 1) * sizeof (int));
+        assert (self->strong);
+        memcpy (self->strong, strong, nodes * sizeof (int));
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Rebuild the index from graph
+
+void
+dconnect_rebuild (dconnect_t *self, graph_t *graph)
+{
+    assert (self);
+    assert (graph);
+    if (self->nodes != graph_nodes (graph)) {
+        self->nodes = graph_nodes (graph);
+        dunion_destroy (&self->forest);
+        self->forest = dunion_new (self->nodes);
+    }
+    free (self->strong);
+    self->strong = NULL;
+    self->stale = false;
+    s_dconnect_unite_all (self, graph, s_dconnect_threads (graph));
+    self->directed = !s_symmetric (graph);
+    if (self->directed) {
+        self->strong = (int *) malloc ((self->nodes + 1) * sizeof (int));
+        assert (self->strong);
+        s_dconnect_strong (self, graph);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return false if there is surely no path from node to node
+
+bool
+dconnect_reachable (dconnect_t *self, int from, int to)
+{
+    assert (self);
+    if (from < 0 || from >= self->nodes || to < 0 || to >= self->nodes)
+        return false;
+    if (dunion_find (self->forest, from) != dunion_find (self->forest, to))
+        return false;
+    if (self->strong && !self->stale && self->strong [from] < self->strong [to])
+        return false;
+    return true;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get connected component of node
+
+int
+dconnect_component (dconnect_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return -1;
+    return dunion_find (self->forest, node);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get strongly connected component of node
+
+int
+dconnect_strong_component (dconnect_t *self, int node)
+{
+    if (!self || !self->strong || self->stale || node < 0 || node >= self->nodes)
+        return -1;
+    return self->strong [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Update the index with new edge
+
+void
+dconnect_add_edge (dconnect_t *self, int from, int to)
+{
+    assert (self);
+    if (from < 0 || from >= self->nodes || to < 0 || to >= self->nodes)
+        return;
+    dunion_unite (self->forest, from, to);
+    if (self->strong && self->strong [from] < self->strong [to])
+        self->stale = true;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Is graph indexed as directed?
+
+bool
+dconnect_directed (dconnect_t *self)
+{
+    assert (self);
+    return self->directed;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Does the strong component index need rebuild?
+
+bool
+dconnect_stale (dconnect_t *self)
+{
+    assert (self);
+    return self->stale;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the index
+
+void
+dconnect_destroy (dconnect_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dconnect_t *self = *self_p;
+        dunion_destroy (&self->forest);
+        free (self->strong);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dconnect_test (bool verbose)
+{
+    printf (" * dconnect: ");
+
+    //  @selftest
+    //  Undirected: triangles 0 1 2 and 3 4 5, node 6 alone
+    int from [] = { 0, 1, 1, 2, 2, 0, 3, 4, 4, 5, 5, 3 };
+    int to [] = { 1, 0, 2, 1, 0, 2, 4, 3, 5, 4, 3, 5 };
+    int weight [] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    graph_t *graph = graph_new_from_edges (7, 12, from, to, weight);
+    dconnect_t *self = dconnect_new (graph);
+    assert (self);
+    assert (!dconnect_directed (self));
+    assert (dconnect_reachable (self, 0, 2));
+    assert (dconnect_reachable (self, 5, 3));
+    assert (!dconnect_reachable (self, 0, 3));
+    assert (!dconnect_reachable (self, 6, 0));
+    assert (dconnect_component (self, 1) == dconnect_component (self, 2));
+    assert (dconnect_strong_component (self, 1) == -1);
+    dconnect_add_edge (self, 2, 3);
+    dconnect_add_edge (self, 3, 2);
+    assert (dconnect_reachable (self, 0, 5));
+    assert (!dconnect_reachable (self, 0, 6));
+    dconnect_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Directed: chain 0 -> 1 -> 2 -> 3, cycle 3 <-> 4, node 5 alone
+    int dfrom [] = { 0, 1, 2, 3, 4 };
+    int dto [] = { 1, 2, 3, 4, 3 };
+    graph = graph_new_from_edges (6, 5, dfrom, dto, weight);
+    self = dconnect_new (graph);
+    assert (dconnect_directed (self));
+    assert (dconnect_reachable (self, 0, 4));
+    assert (dconnect_reachable (self, 4, 3));
+    assert (!dconnect_reachable (self, 4, 0));
+    assert (!dconnect_reachable (self, 2, 1));
+    assert (!dconnect_reachable (self, 0, 5));
+    assert (dconnect_strong_component (self, 3) == dconnect_strong_component (self, 4));
+    assert (dconnect_strong_component (self, 0) != dconnect_strong_component (self, 1));
+
+    //  Saved components give the same index
+    int component [6], strong [6];
+    for (int u = 0; u < 6; u++) {
+        component [u] = dconnect_component (self, u);
+        strong [u] = dconnect_strong_component (self, u);
+    }
+    dconnect_t *copy = dconnect_new_from_components (6, component, strong);
+    assert (copy);
+    assert (dconnect_directed (copy));
+    for (int u = 0; u < 6; u++)
+        for (int v = 0; v < 6; v++)
+            assert (dconnect_reachable (copy, u, v) == dconnect_reachable (self, u, v));
+    dconnect_destroy (&copy);
+    component [5] = 4;
+    assert (dconnect_new_from_components (6, component, strong) == NULL);
+
+    //  Edge along the order keeps the index valid
+    dconnect_add_edge (self, 0, 3);
+    assert (!dconnect_stale (self));
+    assert (!dconnect_reachable (self, 3, 0));
+    //  Edge against the order closes cycle 0 1 2 3 4
+    dconnect_add_edge (self, 4, 0);
+    assert (dconnect_stale (self));
+    assert (dconnect_reachable (self, 4, 0));
+    graph_destroy (&graph);
+    int rfrom [] = { 0, 1, 2, 3, 4, 0, 4 };
+    int rto [] = { 1, 2, 3, 4, 3, 3, 0 };
+    graph = graph_new_from_edges (6, 7, rfrom, rto, weight);
+    dconnect_rebuild (self, graph);
+    assert (!dconnect_stale (self));
+    assert (dconnect_strong_component (self, 0) == dconnect_strong_component (self, 3));
+    assert (dconnect_reachable (self, 2, 1));
+    assert (!dconnect_reachable (self, 5, 0));
+    dconnect_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Parallel union gives the same components as one thread
+    const int nodes = 50000;
+    int edges = 60000;
+    int *pfrom = (int *) malloc (edges * sizeof (int));
+    int *pto = (int *) malloc (edges * sizeof (int));
+    int *pweight = (int *) malloc (edges * sizeof (int));
+    assert (pfrom && pto && pweight);
+    srandom (3);
+    for (int i = 0; i < edges; i++) {
+        pfrom [i] = random () % nodes;
+        pto [i] = random () % nodes;
+        pweight [i] = 1;
+    }
+    graph = graph_new_from_edges (nodes, edges, pfrom, pto, pweight);
+    self = dconnect_new (graph);
+    dconnect_t *parallel = dconnect_new (graph);
+    s_dconnect_unite_all (parallel, graph, 4);
+    for (int u = 0; u < nodes; u++)
+        assert (dconnect_component (self, u) == dconnect_component (parallel, u));
+    //  Roots are the smallest node of every component
+    for (int i = 0; i < edges; i++)
+        assert (dconnect_component (self, pfrom [i]) <= pfrom [i]);
+    dconnect_destroy (&parallel);
+    dconnect_destroy (&self);
+    graph_destroy (&graph);
+    free (pfrom);
+    free (pto);
+    free (pweight);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,202 @@
+/*  =========================================================================
+    dheap - Binary min-heap of nodes keyed by distance
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dheap - Binary min-heap of nodes keyed by distance
+@discuss
+    Heap has no position index, so it costs nothing per node of the graph
+    and clearing it is O(1). Searches push a node again when its distance
+    improves and skip entries whose key is no longer the node distance.
+@end
+*/
+
+#include "graphs_classes.h"
+
+typedef struct {
+    int key;
+    int node;
+} dheap_item_t;
+
+//  Structure of our class
+
+struct _dheap_t {
+    dheap_item_t *items;
+    size_t size;
+    size_t capacity;
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new heap
+
+dheap_t *
+dheap_new (size_t capacity)
+{
+    dheap_t *self = (dheap_t *) zmalloc (sizeof (dheap_t));
+    assert (self);
+    self->capacity = capacity ? capacity : 16;
+    self->items = (dheap_item_t *) malloc (self->capacity * sizeof (dheap_item_t));
+    assert (self->items);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Push node with key
+
+void
+dheap_push (dheap_t *self, int node, int key)
+{
+    assert (self);
+    if (self->size == self->capacity) {
+        self->capacity *= 2;
+        self->items = (dheap_item_t *) realloc (self->items, self->capacity * sizeof (dheap_item_t));
+        assert (self->items);
+    }
+    size_t i = self->size++;
+    while (i > 0) {
+        size_t up = (i - 1) / 2;
+        if (self->items [up].key <= key)
+            break;
+        self->items [i] = self->items [up];
+        i = up;
+    }
+    self->items [i].key = key;
+    self->items [i].node = node;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Pop node with the smallest key
+
+bool
+dheap_pop (dheap_t *self, int *node_p, int *key_p)
+{
+    assert (self);
+    if (!self->size)
+        return false;
+    if (node_p)
+        *node_p = self->items [0].node;
+    if (key_p)
+        *key_p = self->items [0].key;
+
+    dheap_item_t last = self->items [--self->size];
+    size_t i = 0;
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= self->size)
+            break;
+        if (child + 1 < self->size && self->items [child + 1].key < self->items [child].key)
+            child++;
+        if (last.key <= self->items [child].key)
+            break;
+        self->items [i] = self->items [child];
+        i = child;
+    }
+    self->items [i] = last;
+    return true;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get smallest key
+
+int
+dheap_min (dheap_t *self)
+{
+    assert (self);
+    return self->size ? self->items [0].key : INT_MAX;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of entries
+
+size_t
+dheap_size (dheap_t *self)
+{
+    assert (self);
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Remove all entries
+
+void
+dheap_clear (dheap_t *self)
+{
+    assert (self);
+    self->size = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the heap
+
+void
+dheap_destroy (dheap_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dheap_t *self = *self_p;
+        free (self->items);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dheap_test (bool verbose)
+{
+    printf (" * dheap: ");
+
+    //  @selftest
+    dheap_t *self = dheap_new (2);
+    assert (self);
+    assert (dheap_min (self) == INT_MAX);
+    for (int i = 0; i < 100; i++)
+        dheap_push (self, i, (i * 37) % 101);
+    assert (dheap_size (self) == 100);
+    assert (dheap_min (self) == 0);
+    int node, key, last = -1;
+    while (dheap_pop (self, &node, &key)) {
+        assert (key >= last);
+        assert (key == (node * 37) % 101);
+        last = key;
+    }
+    assert (dheap_size (self) == 0);
+    dheap_push (self, 5, 5);
+    dheap_clear (self);
+    assert (!dheap_pop (self, NULL, NULL));
+    dheap_destroy (&self);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,61 @@
+/*  =========================================================================
+    dheap - Binary min-heap of nodes keyed by distance
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DHEAP_H_INCLUDED
+#define DHEAP_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new heap. Heap grows as needed.
+GRAPHS_PRIVATE dheap_t *
+    dheap_new (size_t capacity);
+
+//  Push node with key. There is no decrease-key; push the node again and
+//  skip stale entries when they are popped.
+GRAPHS_PRIVATE void
+    dheap_push (dheap_t *self, int node, int key);
+
+//  Pop node with the smallest key. Returns false if heap is empty.
+GRAPHS_PRIVATE bool
+    dheap_pop (dheap_t *self, int *node_p, int *key_p);
+
+//  Get smallest key without removing it, INT_MAX if heap is empty
+GRAPHS_PRIVATE int
+    dheap_min (dheap_t *self);
+
+//  Get number of entries
+GRAPHS_PRIVATE size_t
+    dheap_size (dheap_t *self);
+
+//  Remove all entries
+GRAPHS_PRIVATE void
+    dheap_clear (dheap_t *self);
+
+//  Destroy the heap
+GRAPHS_PRIVATE void
+    dheap_destroy (dheap_t **self_p);
+
+//  Self test of this class
+GRAPHS_PRIVATE void
+    dheap_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
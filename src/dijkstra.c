@@ -20,20 +20,105 @@
 
 #include "graphs_classes.h"
 
+//  Graphs with less than 1/DIJKSTRA_SPARSE_RATIO of all possible edges are
+//  searched over sparse adjacency, denser ones with vectorised scans of
+//  the dense matrix
+#define DIJKSTRA_SPARSE_RATIO 16
+
+//  Landmarks of distance oracle unless ORACLE says otherwise
+#define DIJKSTRA_ORACLE_LANDMARKS 16
+
+//  Sparse graphs with weights up to this are searched with bucket queue,
+//  which takes one int per unit of the largest weight; override may use
+//  it up to DIJKSTRA_MAX_BUCKETS
+#define DIJKSTRA_BUCKET_WEIGHTS 1024
+#define DIJKSTRA_MAX_BUCKETS    (1 << 20)
+
+//  Kinds of queries the planner chooses engine for
+#define DIJKSTRA_QUERY_TASK     0
+#define DIJKSTRA_QUERY_ROUTE    1
+#define DIJKSTRA_QUERY_RADIUS   2
+#define DIJKSTRA_QUERIES        3
+
+//  Search engines
+#define DIJKSTRA_ENGINE_DENSE   0   //  Array-based scans of matrix rows
+#define DIJKSTRA_ENGINE_HEAP    1   //  Binary heap over adjacency
+#define DIJKSTRA_ENGINE_BUCKETS 2   //  Bucket queue over adjacency
+#define DIJKSTRA_ENGINE_BFS     3   //  Breadth-first over adjacency
+#define DIJKSTRA_ENGINES        4
+
+static const char *s_engine_names [DIJKSTRA_ENGINES] = { "DENSE", "HEAP", "BUCKETS", "BFS" };
+static const char *s_query_names [DIJKSTRA_QUERIES] = { "TASK", "ROUTE", "RADIUS" };
+
 
 //  Structure of our actor
 
 struct _dijkstra_t {
     zsock_t *pipe;              //  Actor command pipe
     zpoller_t *poller;          //  Socket poller
+    zsock_t *worker;            //  Requests from dservice broker, if any
+    zlist_t *queries;           //  QUERY requests waiting for search
     bool terminated;            //  Did caller ask us to quit?
     bool verbose;               //  Verbose logging enabled?
 
     matrix_t *distances;
     int from;                   // search for path from node
     int to;                     // search for path to node
+
+    bool prepared;              // search engine chosen for distances
+    graph_t *graph;             // sparse adjacency, NULL for dense graphs
+    reorder_t *order;           // node relabeling, NULL if none
+    graph_t *relabeled;         // graph with relabeled nodes
+    dsearch_t *search;          // search over graph or relabeled graph
+    graph_t *dense_graph;       // adjacency of dense or compressed graph for kpaths
+    dsearch_t *dense_search;    // search over dense_graph for RADIUS
+    kpaths_t *kpaths;           // k shortest paths finder, built on demand
+    int reorder_method;         // relabeling of sparse graph, -1 for none
+    dconnect_t *connect;        // connectivity index, built on demand
+    dversion_t *store;          // published versions we serve, not owned
+    dsnapshot_t *snapshot;      // version distances come from, if store
+    dprecomp_t *precomp;        // mapped precomputation file, if any
+    bool compress;              // search sparse graph compressed?
+    cgraph_t *packed;           // compressed graph, replaces graph and relabeled
+    doracle_t *oracle;          // distance oracle, built on demand
+    int oracle_landmarks;       // landmarks of the oracle
+    dtable_t *table;            // many-to-many distance tables, built on demand
+    bool planned;               // statistics gathered and engines chosen
+    size_t edges;               // statistics of the graph
+    int min_weight;
+    int max_weight;
+    int plan [DIJKSTRA_QUERIES];    // engine chosen for every kind of query
+    int engine;                 // engine of the request being served
 };
 
+//  QUERY request waiting in the queue
+
+typedef struct {
+    zmsg_t *request;            //  Task arguments
+    zframe_t *client;           //  Client envelope, NULL on pipe
+    zsock_t *reply_to;          //  Pipe or worker socket
+    char *id;                   //  Correlation id
+    int64_t deadline;           //  Wall clock msecs, 0 if none
+} dijkstra_query_t;
+
+static void
+s_query_destroy (dijkstra_query_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dijkstra_query_t *self = *self_p;
+        zmsg_destroy (&self->request);
+        zframe_destroy (&self->client);
+        zstr_free (&self->id);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+static void
+    dijkstra_invalidate (dijkstra_t *self);
+
 
 //  --------------------------------------------------------------------------
 //  Create a new dijkstra instance
@@ -47,7 +132,10 @@ dijkstra_new (zsock_t *pipe, void *args)
     self->pipe = pipe;
     self->terminated = false;
     self->poller = zpoller_new (self->pipe, NULL);
+    self->queries = zlist_new ();
     self->distances = (matrix_t *) args;
+    self->reorder_method = -1;
+    self->oracle_landmarks = DIJKSTRA_ORACLE_LANDMARKS;
     return self;
 }
 
@@ -61,96 +149,1370 @@ dijkstra_destroy (dijkstra_t **self_p)
     assert (self_p);
     if (*self_p) {
         dijkstra_t *self = *self_p;
+        dijkstra_invalidate (self);
+        dconnect_destroy (&self->connect);
+        dsnapshot_destroy (&self->snapshot);
+        dijkstra_query_t *query = (dijkstra_query_t *) zlist_pop (self->queries);
+        while (query) {
+            s_query_destroy (&query);
+            query = (dijkstra_query_t *) zlist_pop (self->queries);
+        }
+        zlist_destroy (&self->queries);
         //  Free object itself
         zpoller_destroy (&self->poller);
+        zsock_destroy (&self->worker);
         free (self);
         *self_p = NULL;
     }
 }
 
-static void add_to_queue (matrix_t *queue, int *len, int value)
+//  Build search over sparse graph, relabeled by the chosen method if any
+
+static void
+dijkstra_relabel (dijkstra_t *self)
+{
+    dsearch_destroy (&self->search);
+    graph_destroy (&self->relabeled);
+    reorder_destroy (&self->order);
+    if (self->reorder_method != -1) {
+        self->order = reorder_new (self->graph, self->reorder_method);
+        self->relabeled = reorder_graph (self->order, self->graph);
+        self->search = dsearch_new (self->relabeled);
+        if (self->verbose)
+            zsys_info ("dijkstra: reordered, edge span %.1f -> %.1f",
+                       graph_edge_span (self->graph), graph_edge_span (self->relabeled));
+    }
+    else
+        self->search = dsearch_new (self->graph);
+}
+
+//  Replace adjacency of sparse graph by compressed one, if asked for. It is
+//  searched in relabeled ids, if any; plain adjacency is not kept.
+
+static void
+dijkstra_compress (dijkstra_t *self)
+{
+    if (!self->compress || !self->graph)
+        return;
+    size_t plain_size = (graph_nodes (self->graph) + 1) * sizeof (int)
+                      + 2 * (size_t) graph_edges (self->graph) * sizeof (int);
+    dsearch_destroy (&self->search);
+    self->packed = cgraph_new (self->relabeled ? self->relabeled : self->graph);
+    self->search = dsearch_new_compressed (self->packed);
+    graph_destroy (&self->relabeled);
+    graph_destroy (&self->graph);
+    //  Hierarchy of distance tables may still view precomputation file
+    if (!self->table)
+        dprecomp_destroy (&self->precomp);
+    if (self->verbose)
+        zsys_info ("dijkstra: adjacency compressed from %zu to %zu bytes",
+                   plain_size, cgraph_size (self->packed));
+}
+
+//  Choose search engine for the distance matrix. Sparse graphs get their
+//  adjacency list built here.
+
+static void
+dijkstra_prepare (dijkstra_t *self)
 {
-    for (int i = 0; i < *len; i++) {
-        if (vector_as_int (queue, i) == value) return;
+    if (self->prepared || !self->distances)
+        return;
+    self->prepared = true;
+    int number_of_nodes = matrix_x (self->distances);
+    if (matrix_element_size (self->distances) != sizeof (int))
+        return;
+    size_t edges = 0;
+    for (int y = 0; y < number_of_nodes; y++) {
+        const int *row = (const int *) matrix_get_ptr (self->distances, 0, y);
+        for (int x = 0; x < number_of_nodes; x++)
+            edges += row [x] > 0;
+    }
+    if (edges * DIJKSTRA_SPARSE_RATIO < (size_t) number_of_nodes * number_of_nodes) {
+        self->graph = graph_new_from_matrix (self->distances);
+        dijkstra_relabel (self);
     }
-    *len += 1;
-    vector_set_int (queue, *len, value);
+    if (self->verbose)
+        zsys_info ("dijkstra: %d nodes, %zu edges, %s search", number_of_nodes, edges,
+                   self->graph ? "sparse" : "dense");
+    dijkstra_compress (self);
+}
+
+//  Drop everything built from the distance matrix, after it has changed.
+//  Connectivity index is kept, it is updated edge by edge.
+
+static void
+dijkstra_invalidate (dijkstra_t *self)
+{
+    kpaths_destroy (&self->kpaths);
+    doracle_destroy (&self->oracle);
+    dtable_destroy (&self->table);
+    dsearch_destroy (&self->dense_search);
+    graph_destroy (&self->dense_graph);
+    dsearch_destroy (&self->search);
+    graph_destroy (&self->relabeled);
+    reorder_destroy (&self->order);
+    graph_destroy (&self->graph);
+    cgraph_destroy (&self->packed);
+    //  Graphs above may have been views over the file
+    dprecomp_destroy (&self->precomp);
+    self->prepared = false;
+    self->planned = false;
+}
+
+//  Drop what depends on edge weights but not on which edges exist: k
+//  shortest paths, oracle, distance tables and adjacency of dense graph.
+//  Sparse graph and its search are kept, weights are patched into them.
+
+static void
+dijkstra_invalidate_weights (dijkstra_t *self)
+{
+    kpaths_destroy (&self->kpaths);
+    doracle_destroy (&self->oracle);
+    dtable_destroy (&self->table);
+    dsearch_destroy (&self->dense_search);
+    graph_destroy (&self->dense_graph);
+    self->planned = false;
+}
+
+//  Get adjacency of the graph, dense graphs get it built on first use
+
+static graph_t *
+dijkstra_adjacency (dijkstra_t *self)
+{
+    dijkstra_prepare (self);
+    if (self->graph)
+        return self->graph;
+    if (!self->dense_graph && self->distances)
+        self->dense_graph = graph_new_from_matrix (self->distances);
+    return self->dense_graph;
 }
 
-static int pop_from_queue (matrix_t *queue, int *len, int idx)
+//  Get connectivity index, built on first use and rebuilt when edges added
+//  since have made it stale
+
+static dconnect_t *
+dijkstra_connect (dijkstra_t *self)
 {
-    int result = matrix_as_int (queue, idx, 0);
-    if (idx < matrix_x (queue) - 1) {
-        for (int i = idx; i < *len; ++i) {
-            vector_set_int (queue, i, vector_as_int (queue, i + 1));
+    if (self->connect && !dconnect_stale (self->connect))
+        return self->connect;
+    graph_t *graph = dijkstra_adjacency (self);
+    if (!graph)
+        return NULL;
+    if (self->connect)
+        dconnect_rebuild (self->connect, graph);
+    else
+        self->connect = dconnect_new (graph);
+    //  Compressed graph does not keep plain adjacency unless kpaths use it
+    if (self->packed && !self->kpaths && !self->dense_search)
+        graph_destroy (&self->dense_graph);
+    if (self->verbose)
+        zsys_info ("dijkstra: connectivity of %s graph indexed",
+                   dconnect_directed (self->connect) ? "directed" : "undirected");
+    return self->connect;
+}
+
+//  Copy weights of rows which differ between two versions into the sparse
+//  graph. Versions share the rows nobody changed, so only rows at new
+//  addresses are compared. Returns false if some edge was added or
+//  removed, the graph must be rebuilt then.
+
+static bool
+dijkstra_patch (dijkstra_t *self, matrix_t *previous, matrix_t *latest)
+{
+    int number_of_nodes = matrix_x (latest);
+    if (matrix_x (previous) != matrix_x (latest)
+    ||  matrix_y (previous) != matrix_y (latest)
+    ||  matrix_element_size (latest) != sizeof (int))
+        return false;
+    for (int y = 0; y < number_of_nodes; y++) {
+        const int *row = (const int *) matrix_get_ptr (latest, 0, y);
+        if (row == matrix_get_ptr (previous, 0, y))
+            continue;
+        int edges = 0;
+        for (int x = 0; x < number_of_nodes; x++)
+            edges += row [x] > 0;
+        if (edges != graph_degree (self->graph, y))
+            return false;
+        for (int x = 0; x < number_of_nodes; x++) {
+            if (row [x] <= 0)
+                continue;
+            if (graph_set_weight (self->graph, y, x, row [x]) == -1)
+                return false;
+            if (self->order
+            &&  graph_set_weight (self->relabeled, reorder_to_new (self->order, y),
+                                  reorder_to_new (self->order, x), row [x]) == -1)
+                return false;
         }
     }
-    *len -= 1;
-    return result;
+    return true;
+}
+
+//  Switch to the latest version published in store, if there is a newer
+//  one. Request being served keeps the version it started with. Dense
+//  search reads the new rows as they are, sparse graph gets new weights
+//  patched in; anything else built from the old version is dropped and
+//  rebuilt on next use.
+
+static void
+dijkstra_refresh (dijkstra_t *self)
+{
+    if (!self->store
+    ||  dversion_current (self->store) == dsnapshot_version (self->snapshot))
+        return;
+    dsnapshot_t *previous = self->snapshot;
+    self->snapshot = dversion_acquire (self->store);
+    self->distances = dsnapshot_matrix (self->snapshot);
+    dijkstra_invalidate_weights (self);
+    bool patched = self->graph && previous
+                && dijkstra_patch (self, dsnapshot_matrix (previous), self->distances);
+    if (!patched) {
+        bool dense = self->prepared && !self->graph && !self->packed;
+        dijkstra_invalidate (self);
+        dconnect_destroy (&self->connect);
+        self->prepared = dense;
+    }
+    dsnapshot_destroy (&previous);
+    if (self->verbose)
+        zsys_info ("dijkstra: serving version %" PRIu64 "%s",
+                   dsnapshot_version (self->snapshot), patched ? ", weights patched" : "");
+}
+
+//  Relabel nodes of sparse graph for better memory locality. Queries and
+//  results keep using original ids. Method NONE drops relabeling. Method
+//  is applied again whenever the graph is rebuilt.
+
+static void
+dijkstra_reorder (dijkstra_t *self, const char *method)
+{
+    int reorder_method_id = -1;
+    if (method && !streq (method, "NONE")) {
+        reorder_method_id = reorder_method (method);
+        if (reorder_method_id == -1) {
+            zsys_error ("dijkstra: unknown reorder method '%s'", method);
+            return;
+        }
+    }
+    self->reorder_method = reorder_method_id;
+    if (!self->prepared) {
+        //  Graph is built already relabeled
+        dijkstra_prepare (self);
+    }
+    else
+    if (self->packed) {
+        //  Compressed graph is built again from the matrix
+        dijkstra_invalidate (self);
+        dijkstra_prepare (self);
+    }
+    else
+    if (self->graph)
+        dijkstra_relabel (self);
+    if (!self->graph && !self->packed && self->verbose)
+        zsys_info ("dijkstra: dense graph is not reordered");
+}
+
+//  Search sparse graph over compressed adjacency, method "VARINT", or over
+//  plain one, method "NONE"
+
+static void
+dijkstra_set_compress (dijkstra_t *self, const char *method)
+{
+    bool compress;
+    if (method && streq (method, "VARINT"))
+        compress = true;
+    else
+    if (method && streq (method, "NONE"))
+        compress = false;
+    else {
+        zsys_error ("dijkstra: unknown compress method '%s'", method ? method : "");
+        return;
+    }
+    if (compress == self->compress)
+        return;
+    self->compress = compress;
+    if (compress)
+        dijkstra_compress (self);
+    else
+    if (self->packed) {
+        dijkstra_invalidate (self);
+        dijkstra_prepare (self);
+    }
+}
+
+//  Add edge, or change its weight, in the distance matrix. New weight of
+//  an edge the sparse graph has is patched in, and dense search reads the
+//  matrix as it is; only a new edge of sparse or compressed graph makes
+//  the graph rebuilt.
+
+static void
+dijkstra_add_edge (dijkstra_t *self, int from, int to, int weight)
+{
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    if (from < 0 || from >= number_of_nodes || to < 0 || to >= number_of_nodes
+    ||  from == to || weight <= 0
+    ||  matrix_element_size (self->distances) != sizeof (int)) {
+        zsys_error ("dijkstra: invalid edge %d -> %d (%d)", from, to, weight);
+        return;
+    }
+    //  Row holds edges going out of node
+    if (self->store) {
+        dversion_set_int (self->store, to, from, weight);
+        dversion_publish (self->store);
+        dijkstra_refresh (self);
+        return;
+    }
+    bool added = matrix_as_int (self->distances, to, from) <= 0;
+    matrix_set_int (self->distances, to, from, weight);
+    dijkstra_invalidate_weights (self);
+    bool dense = self->prepared && !self->graph && !self->packed;
+    bool patched = !added && self->graph
+                && graph_set_weight (self->graph, from, to, weight) == 0
+                && (!self->order
+                ||  graph_set_weight (self->relabeled, reorder_to_new (self->order, from),
+                                      reorder_to_new (self->order, to), weight) == 0);
+    if (!dense && !patched)
+        dijkstra_invalidate (self);
+    if (self->connect)
+        dconnect_add_edge (self->connect, from, to);
+}
+
+//  Get search for queries which need not settle the whole graph: the one
+//  over sparse graph, or one over adjacency of dense graph, built on first
+//  use
+
+static dsearch_t *
+dijkstra_bounded_search (dijkstra_t *self)
+{
+    dijkstra_prepare (self);
+    if (self->search)
+        return self->search;
+    if (!self->dense_search) {
+        graph_t *graph = dijkstra_adjacency (self);
+        if (graph)
+            self->dense_search = dsearch_new (graph);
+    }
+    return self->dense_search;
+}
+
+//  Gather statistics of the graph and choose engine for every kind of
+//  query. Dense graphs are scanned as arrays, which beats any queue once
+//  most nodes have edges to most others; adjacency is searched breadth
+//  first if all edges weigh the same, with bucket queue if weights are
+//  small and with binary heap otherwise. RADIUS settles only nodes within
+//  the limit, which array scans cannot do.
+
+static void
+dijkstra_plan (dijkstra_t *self)
+{
+    dijkstra_prepare (self);
+    if (self->planned || !self->distances)
+        return;
+    self->planned = true;
+    int number_of_nodes = matrix_x (self->distances);
+    size_t edges = 0;
+    int min_weight = INT_MAX;
+    int max_weight = 0;
+    if (self->graph || self->packed) {
+        cgraph_t *packed = self->graph ? NULL : self->packed;
+        int *targets = NULL, *weights = NULL;
+        if (packed) {
+            targets = (int *) malloc ((cgraph_max_degree (packed) + 1) * sizeof (int));
+            weights = (int *) malloc ((cgraph_max_degree (packed) + 1) * sizeof (int));
+            assert (targets && weights);
+        }
+        for (int u = 0; u < number_of_nodes; u++) {
+            int degree = packed ? cgraph_decode (packed, u, targets, weights)
+                                : graph_degree (self->graph, u);
+            const int *row = packed ? weights : graph_weights (self->graph, u);
+            for (int i = 0; i < degree; i++) {
+                if (row [i] < min_weight)
+                    min_weight = row [i];
+                if (row [i] > max_weight)
+                    max_weight = row [i];
+            }
+            edges += degree;
+        }
+        free (targets);
+        free (weights);
+    }
+    else
+    if (matrix_element_size (self->distances) == sizeof (int)) {
+        for (int y = 0; y < number_of_nodes; y++) {
+            const int *row = (const int *) matrix_get_ptr (self->distances, 0, y);
+            for (int x = 0; x < number_of_nodes; x++)
+                if (row [x] > 0) {
+                    if (row [x] < min_weight)
+                        min_weight = row [x];
+                    if (row [x] > max_weight)
+                        max_weight = row [x];
+                    edges++;
+                }
+        }
+    }
+    self->edges = edges;
+    self->min_weight = edges ? min_weight : 0;
+    self->max_weight = max_weight;
+
+    int queue = DIJKSTRA_ENGINE_HEAP;
+    if (edges && min_weight == max_weight)
+        queue = DIJKSTRA_ENGINE_BFS;
+    else
+    if (edges && max_weight <= DIJKSTRA_BUCKET_WEIGHTS)
+        queue = DIJKSTRA_ENGINE_BUCKETS;
+    bool sparse = self->search != NULL;
+    self->plan [DIJKSTRA_QUERY_TASK] = sparse ? queue : DIJKSTRA_ENGINE_DENSE;
+    self->plan [DIJKSTRA_QUERY_ROUTE] = sparse ? queue : DIJKSTRA_ENGINE_DENSE;
+    self->plan [DIJKSTRA_QUERY_RADIUS] = queue;
+    if (self->verbose)
+        zsys_info ("dijkstra: %d nodes, %zu edges, weights %d .. %d: %s for TASK and ROUTE, %s for RADIUS",
+                   number_of_nodes, edges, self->min_weight, self->max_weight,
+                   s_engine_names [self->plan [DIJKSTRA_QUERY_TASK]],
+                   s_engine_names [self->plan [DIJKSTRA_QUERY_RADIUS]]);
+}
+
+//  Get engine for query: the one named by the request, if any, or the one
+//  planned. Returns -1 if the name is unknown or the engine cannot answer
+//  the query exactly.
+
+static int
+dijkstra_choose (dijkstra_t *self, int query, const char *name)
+{
+    dijkstra_plan (self);
+    if (!name || streq (name, "AUTO"))
+        return self->plan [query];
+    int engine = -1;
+    for (int i = 0; i < DIJKSTRA_ENGINES; i++)
+        if (streq (name, s_engine_names [i]))
+            engine = i;
+    if ((engine == DIJKSTRA_ENGINE_DENSE && query == DIJKSTRA_QUERY_RADIUS)
+    ||  (engine == DIJKSTRA_ENGINE_BFS && self->min_weight != self->max_weight)
+    ||  (engine == DIJKSTRA_ENGINE_BUCKETS && self->max_weight > DIJKSTRA_MAX_BUCKETS))
+        engine = -1;
+    if (self->verbose && engine != self->plan [query])
+        zsys_info ("dijkstra: %s asks for %s engine instead of %s%s", s_query_names [query], name,
+                   s_engine_names [self->plan [query]], engine == -1 ? ", rejected" : "");
+    return engine;
+}
+
+//  Get search over adjacency set up for engine other than DENSE
+
+static dsearch_t *
+dijkstra_engine_search (dijkstra_t *self, int engine)
+{
+    dsearch_t *search = dijkstra_bounded_search (self);
+    if (search) {
+        int queue = engine == DIJKSTRA_ENGINE_BUCKETS ? DSEARCH_BUCKETS
+                  : engine == DIJKSTRA_ENGINE_BFS ? DSEARCH_BFS : DSEARCH_HEAP;
+        int rc = dsearch_set_queue (search, queue, self->max_weight > 0 ? self->max_weight : 1);
+        assert (rc == 0);
+    }
+    return search;
+}
+
+//  Search adjacency, translating ids if nodes are relabeled
+
+static void
+dijkstra_search_sparse (dijkstra_t *self, dsearch_t *search, int from, int *distance, int *parent)
+{
+    int number_of_nodes = matrix_x (self->distances);
+    //  Only the sparse search runs in relabeled ids
+    reorder_t *order = search == self->search ? self->order : NULL;
+    if (order)
+        from = reorder_to_new (order, from);
+    dsearch_run (search, from);
+    for (int i = 0; i < number_of_nodes; i++) {
+        int node = order ? reorder_to_new (order, i) : i;
+        distance [i] = dsearch_distance (search, node);
+        if (parent) {
+            int p = dsearch_parent (search, node);
+            parent [i] = order && p >= 0 ? reorder_to_old (order, p) : p;
+        }
+    }
+}
+
+//  Search dense graph from node 'from', stopping once node 'to' is settled
+//  unless it is -1. Fills distance array and, when parent is not NULL, the
+//  parent array; both must hold one item per node.
+
+static void
+dijkstra_search_dense (dijkstra_t *self, int from, int to, int *distance, int *parent)
+{
+    int number_of_nodes = matrix_x (self->distances);
+    // one bit per node, kernels spread them to masks
+    DTRACE_BEGIN ("dbitset_new");
+    dbitset_t *node_visited = dbitset_new (number_of_nodes, 1);
+    DTRACE_END ("dbitset_new");
+    const uint64_t *visited = dbitset_row (node_visited, 0);
+
+    for (int i = 0; i < number_of_nodes; ++i) {
+        distance [i] = (i == from ? 0 : INT_MAX);
+        if (parent)
+            parent [i] = -1;
+    }
+
+    while (true) {
+        // find nearest node which is not visited yet
+        int node = dkernel_argmin (distance, visited, number_of_nodes);
+        if (node == -1)
+            break;
+        dbitset_set (node_visited, node, 0);
+        zsys_debug ("node %i - %i", node, distance [node]);
+        if (node == to)
+            break;
+
+        // relax edges going out of the node, zero means there is no edge
+        const int *weights = (const int *) matrix_get_ptr (self->distances, 0, node);
+        dkernel_relax (weights, distance, parent, visited, number_of_nodes, node, distance [node]);
+    }
+    dbitset_destroy (&node_visited);
+}
+
+//  Search shortest paths from node 'from' with engine of the request.
+//  Fills distance array and, when parent is not NULL, the parent array;
+//  both must hold one item per node.
+
+static void
+dijkstra_search (dijkstra_t *self, int from, int *distance, int *parent)
+{
+    dijkstra_prepare (self);
+    DTRACE_BEGIN ("search");
+    dsearch_t *search = NULL;
+    if (self->engine != DIJKSTRA_ENGINE_DENSE)
+        search = dijkstra_engine_search (self, self->engine);
+    if (search)
+        dijkstra_search_sparse (self, search, from, distance, parent);
+    else
+        dijkstra_search_dense (self, from, -1, distance, parent);
+    DTRACE_END ("search");
+}
+
+//  Search shortest path from node to node with engine of the request.
+//  Returns path as array of int: distance, then nodes from first to last,
+//  and sets its size. Path is
+//  distance INT_MAX alone if there is none. Target in another component
+//  is rejected by connectivity index without search.
+
+static int *
+dijkstra_route (dijkstra_t *self, int from, int to, int *size_p)
+{
+    dijkstra_prepare (self);
+    DTRACE_BEGIN ("search");
+    int number_of_nodes = matrix_x (self->distances);
+    int *path = NULL;
+    int length = 0;
+    dsearch_t *search = NULL;
+    if (!dconnect_reachable (dijkstra_connect (self), from, to)) {
+        if (self->verbose)
+            zsys_info ("dijkstra: %d cannot reach %d, no search", from, to);
+    }
+    else
+    if (self->engine != DIJKSTRA_ENGINE_DENSE
+    &&  (search = dijkstra_engine_search (self, self->engine))) {
+        //  Search settles just nodes closer than target
+        reorder_t *order = search == self->search ? self->order : NULL;
+        int source = order ? reorder_to_new (order, from) : from;
+        int target = order ? reorder_to_new (order, to) : to;
+        dsearch_run_to (search, source, target);
+        if (dsearch_distance (search, target) != INT_MAX) {
+            for (int v = target; v != -1; v = dsearch_parent (search, v))
+                length++;
+            path = (int *) malloc ((length + 1) * sizeof (int));
+            assert (path);
+            path [0] = dsearch_distance (search, target);
+            int i = length;
+            for (int v = target; v != -1; v = dsearch_parent (search, v))
+                path [i--] = order ? reorder_to_old (order, v) : v;
+        }
+    }
+    else {
+        int *distance = (int *) malloc (number_of_nodes * sizeof (int));
+        int *parent = (int *) malloc (number_of_nodes * sizeof (int));
+        assert (distance && parent);
+        dijkstra_search_dense (self, from, to, distance, parent);
+        if (distance [to] != INT_MAX) {
+            for (int v = to; v != -1; v = parent [v])
+                length++;
+            path = (int *) malloc ((length + 1) * sizeof (int));
+            assert (path);
+            path [0] = distance [to];
+            int i = length;
+            for (int v = to; v != -1; v = parent [v])
+                path [i--] = v;
+        }
+        free (distance);
+        free (parent);
+    }
+    if (!path) {
+        path = (int *) malloc (sizeof (int));
+        assert (path);
+        path [0] = INT_MAX;
+        length = 0;
+    }
+    DTRACE_END ("search");
+    *size_p = length + 1;
+    return path;
 }
 
 matrix_t *
 dijkstra_find_path (dijkstra_t *self, int from)
 {
     int number_of_nodes = matrix_x (self->distances);
-    matrix_t *node_visited = vector_new (number_of_nodes, sizeof (int));
-    matrix_t *queue = vector_new (number_of_nodes, sizeof (int));
-    int queue_len = 0;
+    int *distance = (int *) zmalloc (number_of_nodes * sizeof (int));
+    int *parent = (int *) zmalloc (number_of_nodes * sizeof (int));
+    DTRACE_BEGIN ("vector_new");
     matrix_t *result = vector_new (number_of_nodes, sizeof (dnode_t));
-    // matrix_t *result = dijkstra_init_result (self, from);
+    DTRACE_END ("vector_new");
 
+    dijkstra_search (self, from, distance, parent);
     for (int i = 0; i < number_of_nodes; ++i) {
         dnode_t n = {
-            .parent = -1,
-            .distance = (i == from ? 0 : INT_MAX)
+            .parent = parent [i],
+            .distance = distance [i]
         };
         vector_set (result, i, &n);
     }
-    add_to_queue (queue, &queue_len, from);
-
-    while (queue_len) {
-        int min_dist = INT_MAX;
-        int node = -1;
-        int node_queue_idx = -1;
-        // find nearest node in queue
-        for(int i = 0; i < queue_len; i++) {
-            int qnode = vector_as_int (queue, i);
-            dnode_t *curr_dist = (dnode_t *) vector_get_ptr (result, qnode);
-            zsys_debug ("checking node %i - %i", qnode, curr_dist->distance);
-            if (curr_dist->distance  < min_dist) {
-                min_dist = curr_dist->distance;
-                node = qnode;
-                node_queue_idx = i;
-            }
+    free (distance);
+    free (parent);
+    return result;
+}
+
+//  Same search as dijkstra_find_path, but result is returned in
+//  struct-of-arrays layout. Parents are left out if with_parents is false.
+
+dresult_t *
+dijkstra_find_path_soa (dijkstra_t *self, int from, bool with_parents)
+{
+    int number_of_nodes = matrix_x (self->distances);
+    dresult_t *result = dresult_new (number_of_nodes, with_parents);
+    if (!result)
+        return NULL;
+
+    if (!with_parents) {
+        dijkstra_search (self, from, dresult_distances (result), NULL);
+        return result;
+    }
+    int *parent = (int *) zmalloc (number_of_nodes * sizeof (int));
+    dijkstra_search (self, from, dresult_distances (result), parent);
+    for (int i = 0; i < number_of_nodes; ++i)
+        dresult_set (result, i, dresult_distance (result, i), parent [i]);
+    free (parent);
+    return result;
+}
+
+//  Parse decimal argument from request. Returns true if text is a whole
+//  number from min to max, with nothing after it.
+
+static bool
+s_parse_int (const char *text, long min, long max, int *value_p)
+{
+    char *end = NULL;
+    long value = text ? strtol (text, &end, 10) : 0;
+    if (!text || end == text || *end || value < min || value > max)
+        return false;
+    *value_p = (int) value;
+    return true;
+}
+
+//  Execute TASK request, message holds the arguments after the command.
+//  Returns "DONE" with the packed result, or "ERROR" with a reason.
+
+static zmsg_t *
+dijkstra_task (dijkstra_t *self, zmsg_t *request)
+{
+    char *from = zmsg_popstr (request);
+    char *layout = zmsg_popstr (request);
+    char *engine = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    int node;
+    if (!s_parse_int (from, 0, number_of_nodes - 1, &node)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid node");
+    }
+    else
+    if (layout && !streq (layout, "AOS") && !streq (layout, "SOA") && !streq (layout, "DIST")) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid layout");
+    }
+    else
+    if ((self->engine = dijkstra_choose (self, DIJKSTRA_QUERY_TASK, engine)) == -1) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid engine");
+    }
+    else {
+        self->from = node;
+        zchunk_t *chunk = NULL;
+        if (!layout || streq (layout, "AOS")) {
+            matrix_t *result = dijkstra_find_path (self, self->from);
+            DTRACE_BEGIN ("matrix_as_chunk");
+            chunk = matrix_as_chunk (result);
+            DTRACE_END ("matrix_as_chunk");
+            matrix_destroy (&result);
         }
-        if (node != -1) {
-            // remove selected node from queue
-            pop_from_queue (queue, &queue_len, node_queue_idx);
-            vector_set_int (node_visited, node, 1);
+        else {
+            dresult_t *result = dijkstra_find_path_soa (self, self->from, !streq (layout, "DIST"));
+            DTRACE_BEGIN ("dresult_as_chunk");
+            chunk = dresult_as_chunk (result);
+            DTRACE_END ("dresult_as_chunk");
+            dresult_destroy (&result);
         }
-        zsys_debug ("node %i", node);
-        for (int i = 0; i < number_of_nodes; i++) {
-            if (!vector_as_int (node_visited, i)) {
+        DTRACE_BEGIN ("zchunk_pack");
+        zframe_t *frame = zchunk_pack (chunk);
+        DTRACE_END ("zchunk_pack");
+        zmsg_addstr (reply, "DONE");
+        zmsg_append (reply, &frame);
+        zchunk_destroy (&chunk);
+    }
+    zstr_free (&from);
+    zstr_free (&layout);
+    zstr_free (&engine);
+    return reply;
+}
 
-            }
+//  Execute KPATHS request, message holds from, to and k. Returns "DONE"
+//  followed by one frame per path, or "ERROR" with a reason.
+
+static zmsg_t *
+dijkstra_kpaths (dijkstra_t *self, zmsg_t *request)
+{
+    char *from = zmsg_popstr (request);
+    char *to = zmsg_popstr (request);
+    char *k = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    int from_node, to_node, paths;
+    if (!s_parse_int (from, 0, number_of_nodes - 1, &from_node)
+    ||  !s_parse_int (to, 0, number_of_nodes - 1, &to_node)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid node");
+    }
+    else
+    if (!s_parse_int (k, 1, INT_MAX, &paths)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else {
+        //  Sparse graph has its adjacency already, in original ids
+        if (!self->kpaths)
+            self->kpaths = kpaths_new (dijkstra_adjacency (self));
+        if (dconnect_reachable (dijkstra_connect (self), from_node, to_node))
+            paths = kpaths_find (self->kpaths, from_node, to_node, paths);
+        else
+            paths = 0;
+        if (self->verbose)
+            zsys_info ("dijkstra: %d paths %d -> %d, %zu spur searches, %zu from tree",
+                       paths, from_node, to_node, kpaths_searches (self->kpaths),
+                       kpaths_reused (self->kpaths));
+        zmsg_addstr (reply, "DONE");
+        for (int i = 0; i < paths; i++) {
+            int length = kpaths_length (self->kpaths, i);
+            int *path = (int *) malloc ((length + 1) * sizeof (int));
+            assert (path);
+            path [0] = kpaths_cost (self->kpaths, i);
+            memcpy (path + 1, kpaths_nodes (self->kpaths, i), length * sizeof (int));
+            zmsg_addmem (reply, path, (length + 1) * sizeof (int));
+            free (path);
         }
-        zsys_debug ("queue_len %i", queue_len);
     }
-    vector_destroy (&node_visited);
-    vector_destroy (&queue);
+    zstr_free (&from);
+    zstr_free (&to);
+    zstr_free (&k);
+    return reply;
+}
 
-    return result;
+//  Execute ROUTE request, message holds from and to. Returns "DONE" and
+//  the path frame, or "ERROR" with a reason.
+
+static zmsg_t *
+dijkstra_route_request (dijkstra_t *self, zmsg_t *request)
+{
+    char *from = zmsg_popstr (request);
+    char *to = zmsg_popstr (request);
+    char *engine = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    int from_node, to_node;
+    if (!s_parse_int (from, 0, number_of_nodes - 1, &from_node)
+    ||  !s_parse_int (to, 0, number_of_nodes - 1, &to_node)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else
+    if ((self->engine = dijkstra_choose (self, DIJKSTRA_QUERY_ROUTE, engine)) == -1) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid engine");
+    }
+    else {
+        int size;
+        int *path = dijkstra_route (self, from_node, to_node, &size);
+        zmsg_addstr (reply, "DONE");
+        zmsg_addmem (reply, path, size * sizeof (int));
+        free (path);
+    }
+    zstr_free (&from);
+    zstr_free (&to);
+    zstr_free (&engine);
+    return reply;
+}
+
+//  Execute RADIUS request, message holds node and distance limit. Returns
+//  "DONE" and a frame of (node, distance, parent) int triples of nodes
+//  within limit, nearest first.
+
+static zmsg_t *
+dijkstra_radius_request (dijkstra_t *self, zmsg_t *request)
+{
+    char *from = zmsg_popstr (request);
+    char *limit = zmsg_popstr (request);
+    char *engine = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    int from_node, limit_value;
+    dsearch_t *search = NULL;
+    if (!s_parse_int (from, 0, number_of_nodes - 1, &from_node)
+    ||  !s_parse_int (limit, 0, INT_MAX, &limit_value)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else
+    if ((self->engine = dijkstra_choose (self, DIJKSTRA_QUERY_RADIUS, engine)) == -1) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid engine");
+    }
+    else
+    if (!(search = dijkstra_engine_search (self, self->engine))) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "no graph");
+    }
+    else {
+        //  Only the sparse search runs in relabeled ids
+        reorder_t *order = search == self->search ? self->order : NULL;
+        dsearch_run_within (search, order ? reorder_to_new (order, from_node) : from_node,
+                            limit_value);
+        int count = dsearch_settled (search);
+        int *triples = (int *) malloc ((3 * count + 1) * sizeof (int));
+        assert (triples);
+        for (int i = 0; i < count; i++) {
+            int node = dsearch_settled_node (search, i);
+            int parent = dsearch_parent (search, node);
+            triples [3 * i] = order ? reorder_to_old (order, node) : node;
+            triples [3 * i + 1] = dsearch_distance (search, node);
+            triples [3 * i + 2] = order && parent >= 0 ? reorder_to_old (order, parent) : parent;
+        }
+        zmsg_addstr (reply, "DONE");
+        zmsg_addmem (reply, triples, 3 * count * sizeof (int));
+        free (triples);
+    }
+    zstr_free (&from);
+    zstr_free (&limit);
+    zstr_free (&engine);
+    return reply;
+}
+
+//  Get distance oracle, built on first use
+
+static doracle_t *
+dijkstra_oracle (dijkstra_t *self)
+{
+    if (!self->oracle) {
+        graph_t *graph = dijkstra_adjacency (self);
+        if (!graph)
+            return NULL;
+        int64_t start = zclock_usecs ();
+        self->oracle = doracle_new (graph, self->oracle_landmarks, 0);
+        if (self->verbose)
+            zsys_info ("dijkstra: oracle of %d landmarks, %zu bytes in %lld usecs",
+                       doracle_landmarks (self->oracle), doracle_size (self->oracle),
+                       (long long) (zclock_usecs () - start));
+    }
+    return self->oracle;
+}
+
+//  Set number of landmarks of distance oracle and build it
+
+static void
+dijkstra_set_oracle (dijkstra_t *self, int landmarks)
+{
+    if (landmarks <= 0) {
+        zsys_error ("dijkstra: invalid number of landmarks %d", landmarks);
+        return;
+    }
+    self->oracle_landmarks = landmarks;
+    doracle_destroy (&self->oracle);
+    dijkstra_oracle (self);
+}
+
+//  Execute ESTIMATE request, message holds pairs of nodes. Returns "DONE"
+//  and a frame of (estimate, lower bound) int pairs, one per pair of
+//  nodes, from the distance oracle.
+
+static zmsg_t *
+dijkstra_estimate_request (dijkstra_t *self, zmsg_t *request)
+{
+    zmsg_t *reply = zmsg_new ();
+    int number_of_nodes = self->distances ? matrix_x (self->distances) : 0;
+    int pairs = (int) zmsg_size (request) / 2;
+    int *nodes = (int *) malloc ((2 * pairs + 1) * sizeof (int));
+    assert (nodes);
+    bool valid = pairs > 0 && zmsg_size (request) % 2 == 0;
+    for (int i = 0; i < 2 * pairs; i++) {
+        char *node = zmsg_popstr (request);
+        if (!s_parse_int (node, 0, number_of_nodes - 1, &nodes [i]))
+            valid = false;
+        zstr_free (&node);
+    }
+    doracle_t *oracle = NULL;
+    if (!valid) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else
+    if (!(oracle = dijkstra_oracle (self))) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "no graph");
+    }
+    else {
+        //  Estimates replace their nodes in place
+        for (int i = 0; i < pairs; i++) {
+            int lower;
+            int upper = doracle_estimate (oracle, nodes [2 * i], nodes [2 * i + 1], &lower);
+            nodes [2 * i] = upper;
+            nodes [2 * i + 1] = lower;
+        }
+        zmsg_addstr (reply, "DONE");
+        zmsg_addmem (reply, nodes, 2 * pairs * sizeof (int));
+    }
+    free (nodes);
+    return reply;
 }
 
+//  Get distance tables, hierarchy is built on first use
+
+static dtable_t *
+dijkstra_table (dijkstra_t *self)
+{
+    if (!self->table) {
+        graph_t *graph = dijkstra_adjacency (self);
+        int64_t start = zclock_usecs ();
+        self->table = dtable_new (graph);
+        if (self->table && self->verbose)
+            zsys_info ("dijkstra: hierarchy with %d shortcuts in %lld usecs",
+                       dtable_shortcuts (self->table), (long long) (zclock_usecs () - start));
+    }
+    return self->table;
+}
+
+//  Execute TABLE request, message holds frame of source nodes and frame of
+//  target nodes as int arrays, and may hold number of threads. Returns
+//  "DONE" and matrix of sources by targets (see dtable_compute). Hierarchy
+//  of the graph is built on first use.
+
+static zmsg_t *
+dijkstra_table_request (dijkstra_t *self, zmsg_t *request)
+{
+    zframe_t *sources = zmsg_pop (request);
+    zframe_t *targets = zmsg_pop (request);
+    char *threads = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    matrix_t *table = NULL;
+    int thread_count = 0;
+    if (!dijkstra_table (self)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "no graph");
+    }
+    else
+    if (!sources || !targets
+    ||  zframe_size (sources) % sizeof (int) || zframe_size (targets) % sizeof (int)
+    ||  (threads && !s_parse_int (threads, 0, INT_MAX, &thread_count))
+    || !(table = dtable_compute (self->table,
+                                 (const int *) zframe_data (sources),
+                                 (int) (zframe_size (sources) / sizeof (int)),
+                                 (const int *) zframe_data (targets),
+                                 (int) (zframe_size (targets) / sizeof (int)),
+                                 thread_count))) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else {
+        if (self->verbose)
+            zsys_info ("dijkstra: table of %d by %d, %zu buckets, %zu settled",
+                       matrix_y (table), matrix_x (table),
+                       dtable_buckets (self->table), dtable_settled (self->table));
+        zchunk_t *chunk = matrix_as_chunk (table);
+        zframe_t *frame = zchunk_pack (chunk);
+        zmsg_addstr (reply, "DONE");
+        zmsg_append (reply, &frame);
+        zchunk_destroy (&chunk);
+        matrix_destroy (&table);
+    }
+    zframe_destroy (&sources);
+    zframe_destroy (&targets);
+    zstr_free (&threads);
+    return reply;
+}
+
+//  Execute MSF request, message may hold number of threads. Returns "DONE",
+//  total weight and a frame of (from, to, weight) int triples, lightest
+//  edge first.
+
+static zmsg_t *
+dijkstra_msf_request (dijkstra_t *self, zmsg_t *request)
+{
+    char *threads = zmsg_popstr (request);
+    zmsg_t *reply = zmsg_new ();
+    graph_t *graph = dijkstra_adjacency (self);
+    int thread_count = 0;
+    if (!graph) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "no graph");
+    }
+    else
+    if (threads && !s_parse_int (threads, 0, INT_MAX, &thread_count)) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid arguments");
+    }
+    else {
+        int64_t start = zclock_usecs ();
+        msf_t *forest = msf_new (graph, thread_count);
+        int edges = msf_edges (forest);
+        if (self->verbose)
+            zsys_info ("dijkstra: spanning forest of %d edges, %d trees, %d rounds in %lld usecs",
+                       edges, msf_components (forest), msf_rounds (forest),
+                       (long long) (zclock_usecs () - start));
+        int *triples = (int *) malloc ((3 * edges + 1) * sizeof (int));
+        assert (triples);
+        for (int i = 0; i < edges; i++) {
+            triples [3 * i] = msf_from (forest) [i];
+            triples [3 * i + 1] = msf_to (forest) [i];
+            triples [3 * i + 2] = msf_weights (forest) [i];
+        }
+        zmsg_addstr (reply, "DONE");
+        zmsg_addstrf (reply, "%lld", (long long) msf_weight (forest));
+        zmsg_addmem (reply, triples, 3 * edges * sizeof (int));
+        free (triples);
+        msf_destroy (&forest);
+    }
+    zstr_free (&threads);
+    return reply;
+}
+
+//  Send reply to QUERY, body is status and payload frames
+
+static void
+dijkstra_query_reply (dijkstra_t *self, dijkstra_query_t *query, zmsg_t **body_p)
+{
+    zmsg_t *reply = *body_p;
+    zmsg_pushstr (reply, query->id ? query->id : "");
+    zmsg_pushstr (reply, DIJKSTRA_PROTOCOL_VERSION);
+    zmsg_pushstr (reply, "REPLY");
+    if (query->client) {
+        zmsg_wrap (reply, query->client);
+        query->client = NULL;
+    }
+    DTRACE_BEGIN ("send");
+    zmsg_send (&reply, query->reply_to);
+    DTRACE_END ("send");
+    *body_p = NULL;
+}
+
+//  Accept QUERY request, message holds the frames after the command. Valid
+//  queries are queued, so they can be answered in deadline order.
+
+static void
+dijkstra_query_accept (dijkstra_t *self, zmsg_t **request_p, zframe_t **client_p, zsock_t *reply_to)
+{
+    zmsg_t *request = *request_p;
+    dijkstra_query_t *query = (dijkstra_query_t *) zmalloc (sizeof (dijkstra_query_t));
+    assert (query);
+    char *version = zmsg_popstr (request);
+    char *deadline = NULL;
+    query->id = zmsg_popstr (request);
+    query->client = client_p ? *client_p : NULL;
+    query->reply_to = reply_to;
+    if (client_p)
+        *client_p = NULL;
+    if (query->id)
+        deadline = zmsg_popstr (request);
+
+    if (!version || !streq (version, DIJKSTRA_PROTOCOL_VERSION) || !deadline) {
+        zmsg_t *body = zmsg_new ();
+        zmsg_addstr (body, "ERROR");
+        zmsg_addstr (body, deadline ? "unsupported version" : "invalid request");
+        dijkstra_query_reply (self, query, &body);
+        s_query_destroy (&query);
+        zmsg_destroy (request_p);
+    }
+    else {
+        query->deadline = atoll (deadline);
+        query->request = request;
+        *request_p = NULL;
+        zlist_append (self->queries, query);
+        DTRACE_ASYNC_BEGIN ("queued", (uint64_t) (uintptr_t) query);
+    }
+    zstr_free (&version);
+    zstr_free (&deadline);
+}
+
+//  Answer the queued query with the earliest deadline, queries without
+//  deadline go last and ties keep the order of arrival. Expired queries
+//  are answered with EXPIRED without searching.
+
+static void
+dijkstra_query_next (dijkstra_t *self)
+{
+    dijkstra_query_t *next = NULL;
+    dijkstra_query_t *query = (dijkstra_query_t *) zlist_first (self->queries);
+    while (query) {
+        if (!next
+        || (query->deadline && (!next->deadline || query->deadline < next->deadline)))
+            next = query;
+        query = (dijkstra_query_t *) zlist_next (self->queries);
+    }
+    if (!next)
+        return;
+    zlist_remove (self->queries, next);
+    DTRACE_ASYNC_END ("queued", (uint64_t) (uintptr_t) next);
+
+    zmsg_t *body = NULL;
+    if (next->deadline && zclock_time () > next->deadline) {
+        body = zmsg_new ();
+        zmsg_addstr (body, "EXPIRED");
+        if (self->verbose)
+            zsys_info ("dijkstra: query %s expired", next->id);
+    }
+    else
+        body = dijkstra_task (self, next->request);
+    dijkstra_query_reply (self, next, &body);
+    s_query_destroy (&next);
+}
+
+//  Serve requests of dservice broker at endpoint. Broker learns about us
+//  from the READY message and then sends one request at a time.
+
+static void
+dijkstra_connect_worker (dijkstra_t *self, const char *endpoint)
+{
+    if (self->worker || !endpoint)
+        return;
+    self->worker = zsock_new_dealer (endpoint);
+    if (!self->worker) {
+        zsys_error ("dijkstra: cannot connect worker to '%s'", endpoint);
+        return;
+    }
+    zpoller_add (self->poller, self->worker);
+    zstr_send (self->worker, "READY");
+    if (self->verbose)
+        zsys_info ("dijkstra: serving requests from %s", endpoint);
+}
+
+//  Here we handle request routed by dservice broker. Request starts with
+//  the client envelope, which we send back in front of the reply.
+
+static void
+dijkstra_recv_worker (dijkstra_t *self)
+{
+    zmsg_t *request = zmsg_recv (self->worker);
+    if (!request)
+        return;         //  Interrupted
+    DTRACE_BEGIN ("request");
+    zframe_t *client = zmsg_unwrap (request);
+    char *command = zmsg_popstr (request);
+    zmsg_t *reply = NULL;
+    if (client && command && streq (command, "QUERY"))
+        dijkstra_query_accept (self, &request, &client, self->worker);
+    else
+    if (client && command && streq (command, "TASK"))
+        reply = dijkstra_task (self, request);
+    else
+    if (client && command && streq (command, "KPATHS"))
+        reply = dijkstra_kpaths (self, request);
+    else
+    if (client && command && streq (command, "ROUTE"))
+        reply = dijkstra_route_request (self, request);
+    else
+    if (client && command && streq (command, "MSF"))
+        reply = dijkstra_msf_request (self, request);
+    else
+    if (client && command && streq (command, "RADIUS"))
+        reply = dijkstra_radius_request (self, request);
+    else
+    if (client && command && streq (command, "ESTIMATE"))
+        reply = dijkstra_estimate_request (self, request);
+    else
+    if (client && command && streq (command, "TABLE"))
+        reply = dijkstra_table_request (self, request);
+    else {
+        reply = zmsg_new ();
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid command");
+    }
+    if (client && reply) {
+        zmsg_wrap (reply, client);
+        client = NULL;
+        DTRACE_BEGIN ("send");
+        zmsg_send (&reply, self->worker);
+        DTRACE_END ("send");
+    }
+    zframe_destroy (&client);
+    zmsg_destroy (&reply);
+    zstr_free (&command);
+    zmsg_destroy (&request);
+    DTRACE_END ("request");
+}
+
+//  Use indexes saved in precomputation file for the graph. File computed
+//  for another graph, or with another relabeling, is computed again and
+//  saved for the next start.
+
+static bool
+dijkstra_load (dijkstra_t *self)
+{
+    int nodes = matrix_x (self->distances);
+    size_t size;
+    const int *connect = (const int *) dprecomp_section (self->precomp, "connect", &size);
+    if (!connect || size < 2 * sizeof (int) || connect [0] != nodes
+    ||  size != (2 + (size_t) (connect [1] ? 2 : 1) * nodes) * sizeof (int))
+        return false;
+    self->graph = dprecomp_graph (self->precomp, "graph");
+    if (self->graph) {
+        if (graph_nodes (self->graph) != nodes)
+            return false;
+        if (self->reorder_method != -1) {
+            const int *order = (const int *) dprecomp_section (self->precomp, "order", &size);
+            if (!order || size != (1 + (size_t) nodes) * sizeof (int)
+            ||  order [0] != self->reorder_method)
+                return false;
+            self->order = reorder_new_from_ids (nodes, order + 1);
+            self->relabeled = dprecomp_graph (self->precomp, "relabeled");
+            if (!self->order || !self->relabeled)
+                return false;
+            self->search = dsearch_new (self->relabeled);
+        }
+        else
+            self->search = dsearch_new (self->graph);
+    }
+    self->connect = dconnect_new_from_components (nodes, connect + 2,
+                                                  connect [1] ? connect + 2 + nodes : NULL);
+    if (!self->connect)
+        return false;
+    //  Oracle of another number of landmarks is built and saved again
+    const void *oracle = dprecomp_section (self->precomp, "oracle", &size);
+    self->oracle = doracle_new_from_data (oracle, size, nodes, self->oracle_landmarks);
+    if (!self->oracle)
+        return false;
+    //  Nodes and shortcuts, then the hierarchy
+    const int *table = (const int *) dprecomp_section (self->precomp, "table", &size);
+    if (!table || size != 2 * sizeof (int) || table [0] != nodes)
+        return false;
+    graph_t *up = dprecomp_graph (self->precomp, "table up");
+    graph_t *down = dprecomp_graph (self->precomp, "table down");
+    self->table = dtable_new_from_hierarchy (&up, &down, table [1]);
+    if (!self->table || graph_nodes (dtable_up (self->table)) != nodes)
+        return false;
+    self->prepared = true;
+    dijkstra_compress (self);
+    return true;
+}
+
+static int
+dijkstra_save (dijkstra_t *self, const char *path, uint64_t hash)
+{
+    dprecomp_t *file = dprecomp_new (path, hash);
+    if (!file)
+        return -1;
+    if (self->graph) {
+        dprecomp_add_graph (file, "graph", self->graph);
+        if (self->order) {
+            int size = reorder_size (self->order);
+            int *order = (int *) malloc ((1 + size) * sizeof (int));
+            assert (order);
+            order [0] = self->reorder_method;
+            for (int i = 0; i < size; i++)
+                order [1 + i] = reorder_to_new (self->order, i);
+            dprecomp_add (file, "order", order, (1 + size) * sizeof (int));
+            dprecomp_add_graph (file, "relabeled", self->relabeled);
+            free (order);
+        }
+    }
+    //  Nodes, directed, components, then strong components if directed
+    int nodes = matrix_x (self->distances);
+    bool directed = dconnect_directed (self->connect);
+    int *connect = (int *) malloc ((2 + 2 * (size_t) nodes) * sizeof (int));
+    assert (connect);
+    connect [0] = nodes;
+    connect [1] = directed;
+    for (int u = 0; u < nodes; u++) {
+        connect [2 + u] = dconnect_component (self->connect, u);
+        if (directed)
+            connect [2 + nodes + u] = dconnect_strong_component (self->connect, u);
+    }
+    dprecomp_add (file, "connect", connect, (2 + (size_t) (directed ? 2 : 1) * nodes) * sizeof (int));
+    free (connect);
+    if (self->oracle) {
+        zchunk_t *chunk = doracle_as_chunk (self->oracle);
+        dprecomp_add (file, "oracle", zchunk_data (chunk), zchunk_size (chunk));
+        zchunk_destroy (&chunk);
+    }
+    if (self->table) {
+        int table [2] = { nodes, dtable_shortcuts (self->table) };
+        dprecomp_add (file, "table", table, sizeof (table));
+        dprecomp_add_graph (file, "table up", dtable_up (self->table));
+        dprecomp_add_graph (file, "table down", dtable_down (self->table));
+    }
+    int rc = dprecomp_save (file);
+    dprecomp_destroy (&file);
+    return rc;
+}
+
+static void
+dijkstra_warm_start (dijkstra_t *self, const char *path)
+{
+    if (!self->distances || matrix_element_size (self->distances) != sizeof (int)
+    ||  matrix_x (self->distances) != matrix_y (self->distances)) {
+        dijkstra_prepare (self);
+        return;
+    }
+    int64_t start = zclock_usecs ();
+    uint64_t hash = dprecomp_hash (self->distances);
+    dijkstra_invalidate (self);
+    dconnect_destroy (&self->connect);
+    self->precomp = dprecomp_open (path, hash);
+    if (self->precomp && dijkstra_load (self)) {
+        if (self->verbose)
+            zsys_info ("dijkstra: %s graph loaded from %s in %" PRId64 " usecs",
+                       self->graph ? "sparse" : "dense", path, zclock_usecs () - start);
+        return;
+    }
+    dijkstra_invalidate (self);
+    dconnect_destroy (&self->connect);
+    //  File keeps plain adjacency, it is compressed once saved
+    bool compress = self->compress;
+    self->compress = false;
+    dijkstra_prepare (self);
+    self->compress = compress;
+    if (!dijkstra_connect (self) || !dijkstra_oracle (self) || !dijkstra_table (self))
+        return;
+    if (dijkstra_save (self, path, hash) == -1)
+        zsys_error ("dijkstra: cannot save precomputation to %s", path);
+    else
+    if (self->verbose)
+        zsys_info ("dijkstra: precomputation saved to %s in %" PRId64 " usecs",
+                   path, zclock_usecs () - start);
+    dijkstra_compress (self);
+}
+
+
 //  Start this actor. Return a value greater or equal to zero if initialization
 //  was successful. Otherwise -1.
 
 static int
-dijkstra_start (dijkstra_t *self)
+dijkstra_start (dijkstra_t *self, const char *path)
 {
     assert (self);
 
-    //  TODO: Add startup actions
+    if (path && *path)
+        dijkstra_warm_start (self, path);
+    else
+        dijkstra_prepare (self);
 
     return 0;
 }
@@ -179,10 +1541,14 @@ dijkstra_recv_api (dijkstra_t *self)
     zmsg_t *request = zmsg_recv (self->pipe);
     if (!request)
        return;        //  Interrupted
+    DTRACE_BEGIN ("request");
 
     char *command = zmsg_popstr (request);
-    if (streq (command, "START"))
-        dijkstra_start (self);
+    if (streq (command, "START")) {
+        char *path = zmsg_popstr (request);
+        dijkstra_start (self, path);
+        zstr_free (&path);
+    }
     else
     if (streq (command, "STOP"))
         dijkstra_stop (self);
@@ -190,18 +1556,97 @@ dijkstra_recv_api (dijkstra_t *self)
     if (streq (command, "VERBOSE"))
         self->verbose = true;
     else
+    if (streq (command, "REORDER")) {
+        char *method = zmsg_popstr (request);
+        dijkstra_reorder (self, method);
+        zstr_free (&method);
+    }
+    else
+    if (streq (command, "COMPRESS")) {
+        char *method = zmsg_popstr (request);
+        dijkstra_set_compress (self, method);
+        zstr_free (&method);
+    }
+    else
+    if (streq (command, "STORE")) {
+        //  Whatever was built from the old source goes
+        dijkstra_invalidate (self);
+        dconnect_destroy (&self->connect);
+        dsnapshot_destroy (&self->snapshot);
+        self->store = (dversion_t *) zmsg_popptr (request);
+        dijkstra_refresh (self);
+    }
+    else
+    if (streq (command, "WORKER")) {
+        char *endpoint = zmsg_popstr (request);
+        dijkstra_connect_worker (self, endpoint);
+        zstr_free (&endpoint);
+    }
+    else
     if (streq (command, "TASK")) {
+        zmsg_t *reply = dijkstra_task (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "KPATHS")) {
+        zmsg_t *reply = dijkstra_kpaths (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "ROUTE")) {
+        zmsg_t *reply = dijkstra_route_request (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "MSF")) {
+        zmsg_t *reply = dijkstra_msf_request (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "RADIUS")) {
+        zmsg_t *reply = dijkstra_radius_request (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "ORACLE")) {
+        char *landmarks = zmsg_popstr (request);
+        int count = 0;
+        if (s_parse_int (landmarks, 1, INT_MAX, &count))
+            dijkstra_set_oracle (self, count);
+        else
+            zsys_error ("dijkstra: invalid number of landmarks '%s'",
+                        landmarks ? landmarks : "");
+        zstr_free (&landmarks);
+    }
+    else
+    if (streq (command, "ESTIMATE")) {
+        zmsg_t *reply = dijkstra_estimate_request (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "TABLE")) {
+        zmsg_t *reply = dijkstra_table_request (self, request);
+        zmsg_send (&reply, self->pipe);
+    }
+    else
+    if (streq (command, "EDGE")) {
         char *from = zmsg_popstr (request);
-        self->from = atoi (from);
+        char *to = zmsg_popstr (request);
+        char *weight = zmsg_popstr (request);
+        //  Arguments which do not parse stay invalid, and are refused
+        int from_node = -1, to_node = -1, weight_value = 0;
+        s_parse_int (from, 0, INT_MAX, &from_node);
+        s_parse_int (to, 0, INT_MAX, &to_node);
+        s_parse_int (weight, 1, INT_MAX, &weight_value);
+        dijkstra_add_edge (self, from_node, to_node, weight_value);
         zstr_free (&from);
-        matrix_t *result = dijkstra_find_path (self, self->from);
-        zchunk_t *chunk = matrix_as_chunk (result);
-        zframe_t *frame = zchunk_pack (chunk);
-        zstr_sendm (self->pipe, "DONE");
-        zframe_send (&frame, self->pipe, 0);
-        zchunk_destroy (&chunk);
-        matrix_destroy (&result);
-    } else
+        zstr_free (&to);
+        zstr_free (&weight);
+    }
+    else
+    if (streq (command, "QUERY"))
+        dijkstra_query_accept (self, &request, NULL, self->pipe);
+    else
     if (streq (command, "$TERM"))
         //  The $TERM command is send by zactor_destroy() method
         self->terminated = true;
@@ -211,6 +1656,7 @@ dijkstra_recv_api (dijkstra_t *self)
     }
     zstr_free (&command);
     zmsg_destroy (&request);
+    DTRACE_END ("request");
 }
 
 
@@ -228,9 +1674,21 @@ dijkstra_actor (zsock_t *pipe, void *args)
     zsock_signal (self->pipe, 0);
 
     while (!self->terminated) {
-        zsock_t *which = (zsock_t *) zpoller_wait (self->poller, 0);
+        //  Take all requests which are already waiting before answering
+        //  queued queries, so the earliest deadline can go first
+        int timeout = zlist_size (self->queries) ? 0 : -1;
+        DTRACE_BEGIN ("wait");
+        zsock_t *which = (zsock_t *) zpoller_wait (self->poller, timeout);
+        DTRACE_END ("wait");
+        dijkstra_refresh (self);
         if (which == self->pipe)
             dijkstra_recv_api (self);
+        else
+        if (which && which == self->worker)
+            dijkstra_recv_worker (self);
+        else
+        if (zlist_size (self->queries))
+            dijkstra_query_next (self);
         //  Add other sockets when you need them.
     }
     dijkstra_destroy (&self);
@@ -252,6 +1710,36 @@ dijkstra_actor (zsock_t *pipe, void *args)
 #define SELFTEST_DIR_RO "src/selftest-ro"
 #define SELFTEST_DIR_RW "src/selftest-rw"
 
+//  Send TASK in default layout and return the result
+static matrix_t *
+s_task (zactor_t *dijkstra, const char *from)
+{
+    zstr_sendx (dijkstra, "TASK", from, NULL);
+    zmsg_t *msg = zmsg_recv (dijkstra);
+    char *str = zmsg_popstr (msg);
+    assert (streq (str, "DONE"));
+    zstr_free (&str);
+    zframe_t *frame = zmsg_pop (msg);
+    zchunk_t *chunk = zchunk_unpack (frame);
+    zframe_destroy (&frame);
+    zmsg_destroy (&msg);
+    return matrix_from_chunk (&chunk);
+}
+
+//  Send ROUTE and return distance of the path
+static int
+s_route_distance (zactor_t *dijkstra, const char *from, const char *to)
+{
+    zstr_sendx (dijkstra, "ROUTE", from, to, NULL);
+    zmsg_t *msg = zmsg_recv (dijkstra);
+    char *str = zmsg_popstr (msg);
+    assert (streq (str, "DONE"));
+    zstr_free (&str);
+    int distance = ((int *) zframe_data (zmsg_first (msg))) [0];
+    zmsg_destroy (&msg);
+    return distance;
+}
+
 void
 dijkstra_test (bool verbose)
 {
@@ -285,11 +1773,644 @@ dijkstra_test (bool verbose)
         zframe_destroy (&frame);
         matrix_t *result = matrix_from_chunk (&chunk);
         matrix_print_int (result);
+        for (int i = 0; i < 4; i++) {
+            dnode_t *n = (dnode_t *) vector_get_ptr (result, i);
+            assert (n->distance == i);
+            assert (n->parent == (i ? 0 : -1));
+        }
         matrix_destroy (&result);
         zmsg_destroy (&msg);
+
+        //  Same search in struct-of-arrays layout
+        zstr_sendx (dijkstra, "TASK", "3", "SOA", NULL);
+        msg = zmsg_recv (dijkstra);
+        str = zmsg_popstr (msg);
+        assert (streq (str, "DONE"));
+        zstr_free (&str);
+        frame = zmsg_pop (msg);
+        chunk = zchunk_unpack (frame);
+        zframe_destroy (&frame);
+        dresult_t *soa = dresult_from_chunk (&chunk);
+        assert (dresult_parent_width (soa) == sizeof (uint16_t));
+        for (int i = 0; i < 3; i++) {
+            assert (dresult_distance (soa, i) == 3);
+            assert (dresult_parent (soa, i) == 3);
+        }
+        assert (dresult_distance (soa, 3) == 0);
+        assert (dresult_parent (soa, 3) == -1);
+        dresult_destroy (&soa);
+        zmsg_destroy (&msg);
+
+        //  Distance only
+        zstr_sendx (dijkstra, "TASK", "1", "DIST", NULL);
+        msg = zmsg_recv (dijkstra);
+        str = zmsg_popstr (msg);
+        assert (streq (str, "DONE"));
+        zstr_free (&str);
+        frame = zmsg_pop (msg);
+        chunk = zchunk_unpack (frame);
+        zframe_destroy (&frame);
+        soa = dresult_from_chunk (&chunk);
+        assert (dresult_parent_width (soa) == 0);
+        assert (dresult_distance (soa, 0) == 1);
+        assert (dresult_distance (soa, 1) == 0);
+        assert (dresult_distance (soa, 2) == 2);
+        dresult_destroy (&soa);
+        zmsg_destroy (&msg);
+
+        //  Point to point route on dense graph
+        zstr_sendx (dijkstra, "ROUTE", "2", "3", NULL);
+        msg = zmsg_recv (dijkstra);
+        str = zmsg_popstr (msg);
+        assert (streq (str, "DONE"));
+        zstr_free (&str);
+        frame = zmsg_first (msg);
+        assert (zframe_size (frame) == 3 * sizeof (int));
+        assert (((int *) zframe_data (frame)) [0] == 3);
+        assert (((int *) zframe_data (frame)) [2] == 3);
+        zmsg_destroy (&msg);
+
+        //  Invalid requests are refused, actor keeps running
+        zstr_sendx (dijkstra, "TASK", "4", NULL);
+        char *reason = NULL;
+        zstr_recvx (dijkstra, &str, &reason, NULL);
+        assert (streq (str, "ERROR"));
+        assert (streq (reason, "invalid node"));
+        zstr_free (&str);
+        zstr_free (&reason);
+        zstr_sendx (dijkstra, "TASK", "0", "XML", NULL);
+        zstr_recvx (dijkstra, &str, &reason, NULL);
+        assert (streq (str, "ERROR"));
+        zstr_free (&str);
+        zstr_free (&reason);
+        zstr_sendx (dijkstra, "ROUTE", "2", "3x", NULL);
+        zstr_recvx (dijkstra, &str, &reason, NULL);
+        assert (streq (str, "ERROR"));
+        zstr_free (&str);
+        zstr_free (&reason);
+        zstr_sendx (dijkstra, "KPATHS", "1x", "2", "1", NULL);
+        zstr_recvx (dijkstra, &str, &reason, NULL);
+        assert (streq (str, "ERROR"));
+        assert (streq (reason, "invalid node"));
+        zstr_free (&str);
+        zstr_free (&reason);
+        zstr_sendx (dijkstra, "KPATHS", "1", "2", "two", NULL);
+        zstr_recvx (dijkstra, &str, &reason, NULL);
+        assert (streq (str, "ERROR"));
+        assert (streq (reason, "invalid arguments"));
+        zstr_free (&str);
+        zstr_free (&reason);
+
+        zactor_destroy (&dijkstra);
+        matrix_destroy (&d);
+    }
+    //  Sparse graph: ring with a few chords, nodes numbered out of order.
+    //  Relabeling nodes must not change results.
+    {
+        const int nodes = 40;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i < nodes; i++) {
+            int a = (i * 7) % nodes;
+            int b = ((i + 1) * 7) % nodes;
+            matrix_set_int (d, a, b, 1 + i % 5);
+            matrix_set_int (d, b, a, 1 + i % 5);
+            if (i % 10 == 0) {
+                b = ((i + 20) * 7) % nodes;
+                matrix_set_int (d, a, b, 7);
+                matrix_set_int (d, b, a, 7);
+            }
+        }
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        zstr_sendx (dijkstra, "START", NULL);
+        matrix_t *expected = s_task (dijkstra, "3");
+        //  Second round searches compressed adjacency
+        const char *methods [] = { "RCM", "BFS", "DEGREE", "NONE" };
+        for (int m = 0; m < 8; m++) {
+            if (m == 4)
+                zstr_sendx (dijkstra, "COMPRESS", "VARINT", NULL);
+            zstr_sendx (dijkstra, "REORDER", methods [m % 4], NULL);
+            matrix_t *result = s_task (dijkstra, "3");
+            for (int i = 0; i < nodes; i++) {
+                dnode_t *n = (dnode_t *) vector_get_ptr (result, i);
+                dnode_t *e = (dnode_t *) vector_get_ptr (expected, i);
+                assert (n->distance == e->distance);
+                if (n->parent != -1) {
+                    //  Parent may differ on ties, but must be on a shortest path
+                    dnode_t *p = (dnode_t *) vector_get_ptr (expected, n->parent);
+                    assert (p->distance + matrix_as_int (d, i, n->parent) == n->distance);
+                }
+            }
+            dnode_t *target = (dnode_t *) vector_get_ptr (expected, 20);
+            assert (s_route_distance (dijkstra, "3", "20") == target->distance);
+            matrix_destroy (&result);
+        }
+        //  Shortest of alternative routes is the one found by TASK
+        zstr_sendx (dijkstra, "KPATHS", "3", "20", "4", NULL);
+        zmsg_t *msg = zmsg_recv (dijkstra);
+        char *status = zmsg_popstr (msg);
+        assert (streq (status, "DONE"));
+        zstr_free (&status);
+        assert (zmsg_size (msg) == 4);
+        int previous = 0;
+        zframe_t *frame = zmsg_first (msg);
+        for (int i = 0; frame; i++) {
+            const int *path = (const int *) zframe_data (frame);
+            int length = zframe_size (frame) / sizeof (int) - 1;
+            assert (path [1] == 3 && path [length] == 20);
+            if (i == 0) {
+                dnode_t *target = (dnode_t *) vector_get_ptr (expected, 20);
+                assert (path [0] == target->distance);
+            }
+            assert (path [0] >= previous);
+            previous = path [0];
+            frame = zmsg_next (msg);
+        }
+        zmsg_destroy (&msg);
+
+        //  Node 3 is a ring neighbour of 10
+        dnode_t *n = (dnode_t *) vector_get_ptr (expected, 3);
+        assert (n->distance == 0);
+        n = (dnode_t *) vector_get_ptr (expected, 10);
+        assert (n->distance > 0 && n->distance <= matrix_as_int (d, 10, 3));
+        matrix_destroy (&expected);
         zactor_destroy (&dijkstra);
         matrix_destroy (&d);
     }
+    //  Radius queries return only nodes within the limit, nearest first,
+    //  in original ids whatever the graph is searched over
+    {
+        const int nodes = 200;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i < nodes; i++) {
+            matrix_set_int (d, (i + 1) % nodes, i, 1);
+            matrix_set_int (d, i, (i + 1) % nodes, 1);
+        }
+        //  Dense graph on top: all of 0 .. 4 know each other
+        matrix_t *dense = matrix_new (5, 5, sizeof (int));
+        for (int i = 0; i < 5; i++)
+            for (int j = 0; j < 5; j++)
+                if (i != j)
+                    matrix_set_int (dense, i, j, 1 + (i + j) % 3);
+        const char *setup [] = { "NONE", "RCM", "VARINT", "DENSE" };
+        for (int run = 0; run < 4; run++) {
+            bool is_dense = streq (setup [run], "DENSE");
+            zactor_t *dijkstra = zactor_new (dijkstra_actor, is_dense ? dense : d);
+            if (verbose)
+                zstr_send (dijkstra, "VERBOSE");
+            if (streq (setup [run], "VARINT"))
+                zstr_sendx (dijkstra, "COMPRESS", "VARINT", NULL);
+            else
+            if (!is_dense)
+                zstr_sendx (dijkstra, "REORDER", setup [run], NULL);
+            zstr_sendx (dijkstra, "START", NULL);
+            zstr_sendx (dijkstra, "RADIUS", is_dense ? "0" : "198", is_dense ? "1" : "5", NULL);
+            zmsg_t *msg = zmsg_recv (dijkstra);
+            char *status = zmsg_popstr (msg);
+            assert (streq (status, "DONE"));
+            zstr_free (&status);
+            zframe_t *frame = zmsg_first (msg);
+            const int *triple = (const int *) zframe_data (frame);
+            int count = zframe_size (frame) / (3 * sizeof (int));
+            if (is_dense) {
+                //  Node 0 itself and node 3, the only one at distance 1
+                assert (count == 2);
+                assert (triple [0] == 0 && triple [1] == 0 && triple [2] == -1);
+                assert (triple [3] == 3 && triple [4] == 1 && triple [5] == 0);
+            }
+            else {
+                //  Nodes 193 .. 199 and 0 .. 3 around 198 on the ring
+                assert (count == 11);
+                assert (triple [0] == 198 && triple [1] == 0 && triple [2] == -1);
+                for (int i = 1; i < count; i++) {
+                    int node = triple [3 * i];
+                    int distance = triple [3 * i + 1];
+                    int gap = abs (node - 198);
+                    assert (distance == (gap < nodes - gap ? gap : nodes - gap));
+                    assert (distance >= triple [3 * (i - 1) + 1]);
+                    assert (distance <= 5);
+                    int parent = triple [3 * i + 2];
+                    assert (parent == (node + 1) % nodes || parent == (node + nodes - 1) % nodes);
+                }
+            }
+            zmsg_destroy (&msg);
+            zstr_sendx (dijkstra, "RADIUS", "0", "-1", NULL);
+            msg = zmsg_recv (dijkstra);
+            status = zmsg_popstr (msg);
+            assert (streq (status, "ERROR"));
+            zstr_free (&status);
+            zmsg_destroy (&msg);
+            zstr_sendx (dijkstra, "RADIUS", "0", "5km", NULL);
+            msg = zmsg_recv (dijkstra);
+            status = zmsg_popstr (msg);
+            assert (streq (status, "ERROR"));
+            zstr_free (&status);
+            zmsg_destroy (&msg);
+            zactor_destroy (&dijkstra);
+        }
+        matrix_destroy (&dense);
+        matrix_destroy (&d);
+    }
+    //  Every engine the planner may choose finds the same distances, and
+    //  requests can ask for one which fits the graph
+    {
+        const int side = 12;
+        const int nodes = side * side;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int uniform = 0; uniform < 2; uniform++) {
+            for (int u = 0; u < nodes; u++) {
+                if (u % side < side - 1) {
+                    matrix_set_int (d, u + 1, u, uniform ? 2 : 1 + u % 7);
+                    matrix_set_int (d, u, u + 1, uniform ? 2 : 1 + u % 5);
+                }
+                if (u + side < nodes) {
+                    matrix_set_int (d, u + side, u, uniform ? 2 : 1 + u % 3);
+                    matrix_set_int (d, u, u + side, uniform ? 2 : 1 + u % 4);
+                }
+            }
+            zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+            if (verbose)
+                zstr_send (dijkstra, "VERBOSE");
+            zstr_sendx (dijkstra, "START", NULL);
+            const char *engines [] = { "AUTO", "DENSE", "HEAP", "BUCKETS", "BFS" };
+            int expected [nodes];
+            for (int e = 0; e < 5; e++) {
+                bool fits = uniform || !streq (engines [e], "BFS");
+                zstr_sendx (dijkstra, "TASK", "5", "DIST", engines [e], NULL);
+                zmsg_t *msg = zmsg_recv (dijkstra);
+                char *status = zmsg_popstr (msg);
+                assert (streq (status, fits ? "DONE" : "ERROR"));
+                zstr_free (&status);
+                if (fits) {
+                    zframe_t *frame = zmsg_pop (msg);
+                    zchunk_t *chunk = zchunk_unpack (frame);
+                    dresult_t *result = dresult_from_chunk (&chunk);
+                    for (int v = 0; v < nodes; v++) {
+                        if (e == 0)
+                            expected [v] = dresult_distance (result, v);
+                        assert (dresult_distance (result, v) == expected [v]);
+                    }
+                    dresult_destroy (&result);
+                    zframe_destroy (&frame);
+                }
+                zmsg_destroy (&msg);
+
+                zstr_sendx (dijkstra, "ROUTE", "5", "140", engines [e], NULL);
+                msg = zmsg_recv (dijkstra);
+                status = zmsg_popstr (msg);
+                assert (streq (status, fits ? "DONE" : "ERROR"));
+                if (fits)
+                    assert (((int *) zframe_data (zmsg_first (msg))) [0] == expected [140]);
+                zstr_free (&status);
+                zmsg_destroy (&msg);
+
+                zstr_sendx (dijkstra, "RADIUS", "5", "6", engines [e], NULL);
+                msg = zmsg_recv (dijkstra);
+                status = zmsg_popstr (msg);
+                fits = fits && !streq (engines [e], "DENSE");
+                assert (streq (status, fits ? "DONE" : "ERROR"));
+                if (fits) {
+                    int within = 0;
+                    for (int v = 0; v < nodes; v++)
+                        within += expected [v] <= 6;
+                    assert (zframe_size (zmsg_first (msg)) == 3 * within * sizeof (int));
+                }
+                zstr_free (&status);
+                zmsg_destroy (&msg);
+            }
+            zstr_sendx (dijkstra, "TASK", "5", "DIST", "SIMPLEX", NULL);
+            zmsg_t *msg = zmsg_recv (dijkstra);
+            char *status = zmsg_popstr (msg);
+            assert (streq (status, "ERROR"));
+            zstr_free (&status);
+            zmsg_destroy (&msg);
+            zactor_destroy (&dijkstra);
+        }
+        matrix_destroy (&d);
+    }
+    //  Estimates come from the oracle and tables from the hierarchy, which
+    //  are rebuilt when edges change
+    {
+        const int nodes = 100;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i < nodes; i++)
+            matrix_set_int (d, (i + 1) % nodes, i, 1);
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        zstr_sendx (dijkstra, "START", NULL);
+        for (int run = 0; run < 3; run++) {
+            if (run == 1) {
+                //  Every node a landmark makes estimates exact; malformed
+                //  count is ignored
+                zstr_sendx (dijkstra, "ORACLE", "100", NULL);
+                zstr_sendx (dijkstra, "ORACLE", "1x", NULL);
+            }
+            if (run == 2)
+                zstr_sendx (dijkstra, "EDGE", "0", "1", "10", NULL);
+            zstr_sendx (dijkstra, "ESTIMATE", "0", "5", "5", "0", NULL);
+            zmsg_t *msg = zmsg_recv (dijkstra);
+            char *status = zmsg_popstr (msg);
+            assert (streq (status, "DONE"));
+            zstr_free (&status);
+            zframe_t *frame = zmsg_first (msg);
+            assert (zframe_size (frame) == 4 * sizeof (int));
+            const int *pair = (const int *) zframe_data (frame);
+            int forward = run == 2 ? 14 : 5;
+            assert (pair [1] <= forward && forward <= pair [0]);
+            assert (pair [3] <= 95 && 95 <= pair [2]);
+            if (run > 0)
+                assert (pair [0] == forward && pair [1] == forward && pair [2] == 95);
+            zmsg_destroy (&msg);
+
+            //  Table is exact, and rebuilt too
+            int sources [] = { 0, 50 };
+            int targets [] = { 5, 0, 99 };
+            msg = zmsg_new ();
+            zmsg_addstr (msg, "TABLE");
+            zmsg_addmem (msg, sources, sizeof (sources));
+            zmsg_addmem (msg, targets, sizeof (targets));
+            zmsg_send (&msg, dijkstra);
+            msg = zmsg_recv (dijkstra);
+            status = zmsg_popstr (msg);
+            assert (streq (status, "DONE"));
+            zstr_free (&status);
+            frame = zmsg_pop (msg);
+            zchunk_t *chunk = zchunk_unpack (frame);
+            matrix_t *table = matrix_from_chunk (&chunk);
+            assert (matrix_x (table) == 3 && matrix_y (table) == 2);
+            for (int i = 0; i < 2; i++)
+                for (int j = 0; j < 3; j++) {
+                    int steps = (targets [j] - sources [i] + nodes) % nodes;
+                    //  Path crosses edge from 0 to 1
+                    if (run == 2 && (nodes - sources [i]) % nodes < steps)
+                        steps += 9;
+                    assert (matrix_as_int (table, j, i) == steps);
+                }
+            matrix_destroy (&table);
+            zframe_destroy (&frame);
+            zmsg_destroy (&msg);
+        }
+        int invalid [] = { 100 };
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "TABLE");
+        zmsg_addmem (msg, invalid, sizeof (invalid));
+        zmsg_addmem (msg, invalid, sizeof (invalid));
+        zmsg_send (&msg, dijkstra);
+        msg = zmsg_recv (dijkstra);
+        char *status = zmsg_popstr (msg);
+        assert (streq (status, "ERROR"));
+        zstr_free (&status);
+        zmsg_destroy (&msg);
+        int valid [] = { 0 };
+        msg = zmsg_new ();
+        zmsg_addstr (msg, "TABLE");
+        zmsg_addmem (msg, valid, sizeof (valid));
+        zmsg_addmem (msg, valid, sizeof (valid));
+        zmsg_addstr (msg, "two");
+        zmsg_send (&msg, dijkstra);
+        msg = zmsg_recv (dijkstra);
+        status = zmsg_popstr (msg);
+        assert (streq (status, "ERROR"));
+        zstr_free (&status);
+        zmsg_destroy (&msg);
+        zstr_sendx (dijkstra, "ESTIMATE", "0", "5", "3", NULL);
+        msg = zmsg_recv (dijkstra);
+        status = zmsg_popstr (msg);
+        assert (streq (status, "ERROR"));
+        zstr_free (&status);
+        zmsg_destroy (&msg);
+        zstr_sendx (dijkstra, "ESTIMATE", "0", "5", "3", "", NULL);
+        msg = zmsg_recv (dijkstra);
+        status = zmsg_popstr (msg);
+        assert (streq (status, "ERROR"));
+        zstr_free (&status);
+        zmsg_destroy (&msg);
+        zactor_destroy (&dijkstra);
+        matrix_destroy (&d);
+    }
+    //  Two separate rings: route between them is rejected without search,
+    //  until an edge joins them
+    {
+        const int nodes = 60;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i < nodes; i++) {
+            int next = i % 30 == 29 ? i - 29 : i + 1;
+            matrix_set_int (d, i, next, 1);
+            matrix_set_int (d, next, i, 1);
+        }
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        const char *routes [][2] = { { "0", "35" }, { "0", "5" }, { "0", "35" }, { "35", "0" } };
+        int expected [] = { INT_MAX, 5, 12, INT_MAX };
+        for (int i = 0; i < 4; i++) {
+            if (i == 2) {
+                zstr_sendx (dijkstra, "EDGE", "5", "35", "7", NULL);
+                zstr_sendx (dijkstra, "REORDER", "RCM", NULL);
+            }
+            zstr_sendx (dijkstra, "ROUTE", routes [i][0], routes [i][1], NULL);
+            zmsg_t *msg = zmsg_recv (dijkstra);
+            char *str = zmsg_popstr (msg);
+            assert (streq (str, "DONE"));
+            zstr_free (&str);
+            zframe_t *frame = zmsg_first (msg);
+            const int *path = (const int *) zframe_data (frame);
+            int length = zframe_size (frame) / sizeof (int) - 1;
+            assert (path [0] == expected [i]);
+            if (expected [i] != INT_MAX) {
+                assert (path [1] == atoi (routes [i][0]));
+                assert (path [length] == atoi (routes [i][1]));
+            }
+            else
+                assert (length == 0);
+            zmsg_destroy (&msg);
+        }
+        assert (matrix_as_int (d, 35, 5) == 7);
+
+        //  Spanning tree takes the joining edge, rings lose one edge each
+        zstr_sendx (dijkstra, "MSF", NULL);
+        zmsg_t *msg = zmsg_recv (dijkstra);
+        char *str = zmsg_popstr (msg);
+        assert (streq (str, "DONE"));
+        zstr_free (&str);
+        str = zmsg_popstr (msg);
+        assert (streq (str, "65"));
+        zstr_free (&str);
+        zframe_t *frame = zmsg_first (msg);
+        assert (zframe_size (frame) == 59 * 3 * sizeof (int));
+        const int *last = (const int *) zframe_data (frame) + 58 * 3;
+        assert (last [0] + last [1] == 40 && last [2] == 7);
+        zmsg_destroy (&msg);
+        zstr_sendx (dijkstra, "MSF", "-2", NULL);
+        msg = zmsg_recv (dijkstra);
+        str = zmsg_popstr (msg);
+        assert (streq (str, "ERROR"));
+        zstr_free (&str);
+        zmsg_destroy (&msg);
+        zactor_destroy (&dijkstra);
+        matrix_destroy (&d);
+    }
+    //  Versions published in a store show up on the next request, whoever
+    //  publishes them; matrix given at start is not touched
+    {
+        matrix_t *d = matrix_new (3, 3, sizeof (int));
+        matrix_set_int (d, 1, 0, 10);
+        matrix_set_int (d, 2, 1, 10);
+        dversion_t *store = dversion_new (d, 0);
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "STORE");
+        zmsg_addptr (msg, store);
+        zmsg_send (&msg, dijkstra);
+        assert (s_route_distance (dijkstra, "0", "2") == 20);
+        dversion_set_int (store, 2, 0, 5);
+        dversion_publish (store);
+        assert (s_route_distance (dijkstra, "0", "2") == 5);
+        zstr_sendx (dijkstra, "EDGE", "0", "2", "3", NULL);
+        assert (s_route_distance (dijkstra, "0", "2") == 3);
+        assert (dversion_current (store) == 3);
+        //  Weight which is not a number is refused, edge stays
+        zstr_sendx (dijkstra, "EDGE", "0", "2", "x", NULL);
+        assert (s_route_distance (dijkstra, "0", "2") == 3);
+        assert (dversion_current (store) == 3);
+        assert (matrix_as_int (d, 2, 0) == 0);
+        zactor_destroy (&dijkstra);
+        dversion_destroy (&store);
+        matrix_destroy (&d);
+    }
+    //  Sparse graph gets new weights patched in, new edges rebuild it
+    {
+        const int nodes = 40;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i + 1 < nodes; i++)
+            matrix_set_int (d, i + 1, i, 1);
+        dversion_t *store = dversion_new (d, 4);
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "STORE");
+        zmsg_addptr (msg, store);
+        zmsg_send (&msg, dijkstra);
+        zstr_sendx (dijkstra, "REORDER", "BFS", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 39);
+        dversion_set_int (store, 1, 0, 10);
+        dversion_set_int (store, 20, 19, 5);
+        dversion_publish (store);
+        assert (s_route_distance (dijkstra, "0", "39") == 52);
+        zstr_sendx (dijkstra, "EDGE", "0", "39", "2", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 2);
+        dversion_set_int (store, 39, 0, 100);
+        dversion_publish (store);
+        assert (s_route_distance (dijkstra, "0", "39") == 52);
+        zactor_destroy (&dijkstra);
+        dversion_destroy (&store);
+        matrix_destroy (&d);
+    }
+    //  Without store, new weights are patched in too
+    {
+        const int nodes = 40;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i + 1 < nodes; i++)
+            matrix_set_int (d, i + 1, i, 1);
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+        if (verbose)
+            zstr_send (dijkstra, "VERBOSE");
+        zstr_sendx (dijkstra, "REORDER", "BFS", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 39);
+        zstr_sendx (dijkstra, "EDGE", "0", "1", "10", NULL);
+        zstr_sendx (dijkstra, "EDGE", "19", "20", "5", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 52);
+        zstr_sendx (dijkstra, "EDGE", "0", "39", "2", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 2);
+        zstr_sendx (dijkstra, "EDGE", "0", "39", "100", NULL);
+        assert (s_route_distance (dijkstra, "0", "39") == 52);
+        zactor_destroy (&dijkstra);
+        matrix_destroy (&d);
+    }
+    //  Precomputation is saved on first start and mapped on the next one,
+    //  as long as the graph and relabeling stay the same
+    {
+        zsys_dir_create (SELFTEST_DIR_RW);
+        char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dijkstra.pre");
+        assert (filename);
+        zsys_file_delete (filename);
+        const int nodes = 40;
+        matrix_t *d = matrix_new (nodes, nodes, sizeof (int));
+        for (int i = 0; i + 1 < nodes; i++)
+            matrix_set_int (d, i + 1, i, 1 + i % 3);
+        const char *reorder [] = { "RCM", "RCM", "BFS", "NONE", "NONE" };
+        ino_t inode [5];
+        int distance [5];
+        for (int run = 0; run < 5; run++) {
+            if (run == 4)
+                matrix_set_int (d, 5, 4, 50);
+            zactor_t *dijkstra = zactor_new (dijkstra_actor, d);
+            if (verbose)
+                zstr_send (dijkstra, "VERBOSE");
+            zstr_sendx (dijkstra, "REORDER", reorder [run], NULL);
+            //  File holds plain adjacency, compressed after load
+            if (run >= 3)
+                zstr_sendx (dijkstra, "COMPRESS", "VARINT", NULL);
+            zstr_sendx (dijkstra, "START", filename, NULL);
+            distance [run] = s_route_distance (dijkstra, "0", "39");
+            //  Unreachable, answered from the connectivity index
+            assert (s_route_distance (dijkstra, "39", "0") == INT_MAX);
+            //  Oracle comes from the file too
+            zstr_sendx (dijkstra, "ESTIMATE", "0", "39", NULL);
+            zmsg_t *msg = zmsg_recv (dijkstra);
+            char *status = zmsg_popstr (msg);
+            assert (streq (status, "DONE"));
+            zstr_free (&status);
+            const int *pair = (const int *) zframe_data (zmsg_first (msg));
+            assert (pair [1] <= distance [run] && distance [run] <= pair [0]);
+            zmsg_destroy (&msg);
+            //  And hierarchy of distance tables
+            int ends [] = { 0, 39 };
+            msg = zmsg_new ();
+            zmsg_addstr (msg, "TABLE");
+            zmsg_addmem (msg, ends, sizeof (ends));
+            zmsg_addmem (msg, ends, sizeof (ends));
+            zmsg_send (&msg, dijkstra);
+            msg = zmsg_recv (dijkstra);
+            status = zmsg_popstr (msg);
+            assert (streq (status, "DONE"));
+            zstr_free (&status);
+            zframe_t *frame = zmsg_pop (msg);
+            zchunk_t *chunk = zchunk_unpack (frame);
+            matrix_t *table = matrix_from_chunk (&chunk);
+            assert (matrix_as_int (table, 1, 0) == distance [run]);
+            assert (matrix_as_int (table, 0, 1) == INT_MAX);
+            matrix_destroy (&table);
+            zframe_destroy (&frame);
+            zmsg_destroy (&msg);
+            zactor_destroy (&dijkstra);
+            struct stat stat_buf;
+            int rc = stat (filename, &stat_buf);
+            assert (rc == 0);
+            inode [run] = stat_buf.st_ino;
+        }
+        //  File is replaced whenever it had to be computed again
+        assert (inode [1] == inode [0]);
+        assert (inode [2] != inode [1]);
+        assert (inode [3] == inode [2]);
+        assert (inode [4] != inode [3]);
+        for (int run = 1; run < 4; run++)
+            assert (distance [run] == distance [0]);
+        assert (distance [4] == distance [0] + 48);
+        dprecomp_t *file = dprecomp_open (filename, dprecomp_hash (d));
+        assert (file);
+        assert (dprecomp_section (file, "oracle", NULL));
+        assert (dprecomp_section (file, "table", NULL));
+        dprecomp_destroy (&file);
+        matrix_destroy (&d);
+        zsys_file_delete (filename);
+        zstr_free (&filename);
+    }
     //  @end
 
     printf ("OK\n");
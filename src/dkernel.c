@@ -0,0 +1,642 @@
+/*  =========================================================================
+    dkernel - Vectorised kernels for dense graph search
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dkernel - Vectorised kernels for dense graph search
+@discuss
+    The array-based Dijkstra over a dense matrix_t spends all its time in
+    two loops: relaxing one adjacency row and looking for the nearest node
+    which is not visited yet. Both loops have AVX2 and SSE4.1 variants and
+    a scalar fallback; the best one is chosen at runtime from CPU features.
+    Visited flags are bits (see dbitset), spread to lane masks a vector at
+    a time; vectors of nodes which are all visited are skipped unread.
+    Distances are compared as weights [v] < distance [v] - du, so sums never
+    overflow INT_MAX.
+
+    Matrix operations (see matrix) reduce to the same kind of row loops:
+    adding a constant to one row and keeping the smaller of it and another
+    row, for min-plus products, and the plain elementwise minimum.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#   define DKERNEL_HAVE_X86
+#   include <immintrin.h>
+#endif
+
+typedef void (dkernel_relax_fn) (const int *weights, int *distance, int *parent,
+                                 const uint64_t *visited, int n, int u, int du);
+typedef int (dkernel_argmin_fn) (const int *distance, const uint64_t *visited, int n);
+typedef void (dkernel_min_plus_int_fn) (int *target, const int *row, int add, int n);
+typedef void (dkernel_min_plus_float_fn) (float *target, const float *row, float add, int n);
+typedef void (dkernel_min_int_fn) (int *target, const int *row, int n);
+typedef void (dkernel_min_float_fn) (float *target, const float *row, int n);
+
+typedef struct {
+    const char *name;
+    dkernel_relax_fn *relax;
+    dkernel_argmin_fn *argmin;
+    dkernel_min_plus_int_fn *min_plus_int;
+    dkernel_min_plus_float_fn *min_plus_float;
+    dkernel_min_int_fn *min_int;
+    dkernel_min_float_fn *min_float;
+} dkernel_impl_t;
+
+//  Is node v visited, bit v % 64 of word v / 64
+#define s_visited(visited,v) (((visited) [(v) / 64] >> ((v) % 64)) & 1)
+
+
+//  --------------------------------------------------------------------------
+//  Scalar kernels, also used for tails of vectorised loops
+
+static void
+s_relax_from (const int *weights, int *distance, int *parent,
+              const uint64_t *visited, int v, int n, int u, int du)
+{
+    for (; v < n; v++) {
+        int weight = weights [v];
+        if (weight > 0 && !s_visited (visited, v) && weight < distance [v] - du) {
+            distance [v] = du + weight;
+            if (parent)
+                parent [v] = u;
+        }
+    }
+}
+
+static void
+s_relax_scalar (const int *weights, int *distance, int *parent,
+                const uint64_t *visited, int n, int u, int du)
+{
+    s_relax_from (weights, distance, parent, visited, 0, n, u, du);
+}
+
+static int
+s_argmin_scalar (const int *distance, const uint64_t *visited, int n)
+{
+    int min_dist = INT_MAX;
+    int node = -1;
+    for (int v = 0; v < n; v++) {
+        if (!s_visited (visited, v) && distance [v] < min_dist) {
+            min_dist = distance [v];
+            node = v;
+        }
+    }
+    return node;
+}
+
+static void
+s_min_plus_int_scalar (int *target, const int *row, int add, int n)
+{
+    for (int v = 0; v < n; v++)
+        if (row [v] < target [v] - add)
+            target [v] = add + row [v];
+}
+
+static void
+s_min_plus_float_scalar (float *target, const float *row, float add, int n)
+{
+    for (int v = 0; v < n; v++) {
+        float sum = add + row [v];
+        if (sum < target [v])
+            target [v] = sum;
+    }
+}
+
+static void
+s_min_int_scalar (int *target, const int *row, int n)
+{
+    for (int v = 0; v < n; v++)
+        if (row [v] < target [v])
+            target [v] = row [v];
+}
+
+static void
+s_min_float_scalar (float *target, const float *row, int n)
+{
+    for (int v = 0; v < n; v++)
+        if (row [v] < target [v])
+            target [v] = row [v];
+}
+
+#ifdef DKERNEL_HAVE_X86
+
+//  --------------------------------------------------------------------------
+//  SSE4.1 kernels, 4 nodes per step
+
+__attribute__ ((target ("sse4.1"))) static void
+s_relax_sse41 (const int *weights, int *distance, int *parent,
+               const uint64_t *visited, int n, int u, int du)
+{
+    const __m128i lanes = _mm_setr_epi32 (1, 2, 4, 8);
+    const __m128i vdu = _mm_set1_epi32 (du);
+    const __m128i vu = _mm_set1_epi32 (u);
+    const __m128i zero = _mm_setzero_si128 ();
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+        int bits = (int) (visited [v / 64] >> (v % 64)) & 0xf;
+        if (bits == 0xf)
+            continue;
+        __m128i w = _mm_loadu_si128 ((const __m128i *) (weights + v));
+        __m128i d = _mm_loadu_si128 ((const __m128i *) (distance + v));
+        __m128i seen = _mm_cmpeq_epi32 (_mm_and_si128 (_mm_set1_epi32 (bits), lanes), lanes);
+        __m128i mask = _mm_and_si128 (_mm_cmpgt_epi32 (_mm_sub_epi32 (d, vdu), w),
+                                      _mm_cmpgt_epi32 (w, zero));
+        mask = _mm_andnot_si128 (seen, mask);
+        if (_mm_testz_si128 (mask, mask))
+            continue;
+        d = _mm_blendv_epi8 (d, _mm_add_epi32 (vdu, w), mask);
+        _mm_storeu_si128 ((__m128i *) (distance + v), d);
+        if (parent) {
+            __m128i p = _mm_loadu_si128 ((const __m128i *) (parent + v));
+            _mm_storeu_si128 ((__m128i *) (parent + v), _mm_blendv_epi8 (p, vu, mask));
+        }
+    }
+    if (v < n)
+        s_relax_from (weights, distance, parent, visited, v, n, u, du);
+}
+
+__attribute__ ((target ("sse4.1"))) static int
+s_argmin_sse41 (const int *distance, const uint64_t *visited, int n)
+{
+    const __m128i lanes = _mm_setr_epi32 (1, 2, 4, 8);
+    const __m128i inf = _mm_set1_epi32 (INT_MAX);
+    const __m128i step = _mm_set1_epi32 (4);
+    __m128i vmin = inf;
+    __m128i vidx = _mm_set1_epi32 (-1);
+    __m128i idx = _mm_setr_epi32 (0, 1, 2, 3);
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+        int bits = (int) (visited [v / 64] >> (v % 64)) & 0xf;
+        if (bits == 0xf) {
+            idx = _mm_add_epi32 (idx, step);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128 ((const __m128i *) (distance + v));
+        __m128i seen = _mm_cmpeq_epi32 (_mm_and_si128 (_mm_set1_epi32 (bits), lanes), lanes);
+        d = _mm_blendv_epi8 (d, inf, seen);
+        __m128i less = _mm_cmpgt_epi32 (vmin, d);
+        vmin = _mm_blendv_epi8 (vmin, d, less);
+        vidx = _mm_blendv_epi8 (vidx, idx, less);
+        idx = _mm_add_epi32 (idx, step);
+    }
+    int mins [4], idxs [4];
+    _mm_storeu_si128 ((__m128i *) mins, vmin);
+    _mm_storeu_si128 ((__m128i *) idxs, vidx);
+    int min_dist = INT_MAX;
+    int node = -1;
+    for (int lane = 0; lane < 4; lane++) {
+        if (mins [lane] < min_dist
+        || (mins [lane] == min_dist && min_dist != INT_MAX && idxs [lane] < node)) {
+            min_dist = mins [lane];
+            node = idxs [lane];
+        }
+    }
+    for (; v < n; v++) {
+        if (!s_visited (visited, v) && distance [v] < min_dist) {
+            min_dist = distance [v];
+            node = v;
+        }
+    }
+    return node;
+}
+
+
+__attribute__ ((target ("sse4.1"))) static void
+s_min_plus_int_sse41 (int *target, const int *row, int add, int n)
+{
+    const __m128i vadd = _mm_set1_epi32 (add);
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+        __m128i r = _mm_loadu_si128 ((const __m128i *) (row + v));
+        __m128i t = _mm_loadu_si128 ((const __m128i *) (target + v));
+        __m128i less = _mm_cmpgt_epi32 (_mm_sub_epi32 (t, vadd), r);
+        t = _mm_blendv_epi8 (t, _mm_add_epi32 (vadd, r), less);
+        _mm_storeu_si128 ((__m128i *) (target + v), t);
+    }
+    if (v < n)
+        s_min_plus_int_scalar (target + v, row + v, add, n - v);
+}
+
+__attribute__ ((target ("sse4.1"))) static void
+s_min_plus_float_sse41 (float *target, const float *row, float add, int n)
+{
+    const __m128 vadd = _mm_set1_ps (add);
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+        __m128 sum = _mm_add_ps (vadd, _mm_loadu_ps (row + v));
+        _mm_storeu_ps (target + v, _mm_min_ps (_mm_loadu_ps (target + v), sum));
+    }
+    if (v < n)
+        s_min_plus_float_scalar (target + v, row + v, add, n - v);
+}
+
+__attribute__ ((target ("sse4.1"))) static void
+s_min_int_sse41 (int *target, const int *row, int n)
+{
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+        __m128i r = _mm_loadu_si128 ((const __m128i *) (row + v));
+        __m128i t = _mm_loadu_si128 ((const __m128i *) (target + v));
+        _mm_storeu_si128 ((__m128i *) (target + v), _mm_min_epi32 (t, r));
+    }
+    if (v < n)
+        s_min_int_scalar (target + v, row + v, n - v);
+}
+
+__attribute__ ((target ("sse4.1"))) static void
+s_min_float_sse41 (float *target, const float *row, int n)
+{
+    int v = 0;
+    for (; v + 4 <= n; v += 4)
+        _mm_storeu_ps (target + v, _mm_min_ps (_mm_loadu_ps (target + v), _mm_loadu_ps (row + v)));
+    if (v < n)
+        s_min_float_scalar (target + v, row + v, n - v);
+}
+
+
+//  --------------------------------------------------------------------------
+//  AVX2 kernels, 8 nodes per step
+
+__attribute__ ((target ("avx2"))) static void
+s_relax_avx2 (const int *weights, int *distance, int *parent,
+              const uint64_t *visited, int n, int u, int du)
+{
+    const __m256i lanes = _mm256_setr_epi32 (1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i vdu = _mm256_set1_epi32 (du);
+    const __m256i vu = _mm256_set1_epi32 (u);
+    const __m256i zero = _mm256_setzero_si256 ();
+    int v = 0;
+    for (; v + 8 <= n; v += 8) {
+        int bits = (int) (visited [v / 64] >> (v % 64)) & 0xff;
+        if (bits == 0xff)
+            continue;
+        __m256i w = _mm256_loadu_si256 ((const __m256i *) (weights + v));
+        __m256i d = _mm256_loadu_si256 ((const __m256i *) (distance + v));
+        __m256i seen = _mm256_cmpeq_epi32 (_mm256_and_si256 (_mm256_set1_epi32 (bits), lanes), lanes);
+        __m256i mask = _mm256_and_si256 (_mm256_cmpgt_epi32 (_mm256_sub_epi32 (d, vdu), w),
+                                         _mm256_cmpgt_epi32 (w, zero));
+        mask = _mm256_andnot_si256 (seen, mask);
+        if (_mm256_testz_si256 (mask, mask))
+            continue;
+        d = _mm256_blendv_epi8 (d, _mm256_add_epi32 (vdu, w), mask);
+        _mm256_storeu_si256 ((__m256i *) (distance + v), d);
+        if (parent) {
+            __m256i p = _mm256_loadu_si256 ((const __m256i *) (parent + v));
+            _mm256_storeu_si256 ((__m256i *) (parent + v), _mm256_blendv_epi8 (p, vu, mask));
+        }
+    }
+    if (v < n)
+        s_relax_from (weights, distance, parent, visited, v, n, u, du);
+}
+
+__attribute__ ((target ("avx2"))) static int
+s_argmin_avx2 (const int *distance, const uint64_t *visited, int n)
+{
+    const __m256i lanes = _mm256_setr_epi32 (1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i inf = _mm256_set1_epi32 (INT_MAX);
+    const __m256i step = _mm256_set1_epi32 (8);
+    __m256i vmin = inf;
+    __m256i vidx = _mm256_set1_epi32 (-1);
+    __m256i idx = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+    int v = 0;
+    for (; v + 8 <= n; v += 8) {
+        int bits = (int) (visited [v / 64] >> (v % 64)) & 0xff;
+        if (bits == 0xff) {
+            idx = _mm256_add_epi32 (idx, step);
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256 ((const __m256i *) (distance + v));
+        __m256i seen = _mm256_cmpeq_epi32 (_mm256_and_si256 (_mm256_set1_epi32 (bits), lanes), lanes);
+        d = _mm256_blendv_epi8 (d, inf, seen);
+        __m256i less = _mm256_cmpgt_epi32 (vmin, d);
+        vmin = _mm256_blendv_epi8 (vmin, d, less);
+        vidx = _mm256_blendv_epi8 (vidx, idx, less);
+        idx = _mm256_add_epi32 (idx, step);
+    }
+    int mins [8], idxs [8];
+    _mm256_storeu_si256 ((__m256i *) mins, vmin);
+    _mm256_storeu_si256 ((__m256i *) idxs, vidx);
+    int min_dist = INT_MAX;
+    int node = -1;
+    for (int lane = 0; lane < 8; lane++) {
+        if (mins [lane] < min_dist
+        || (mins [lane] == min_dist && min_dist != INT_MAX && idxs [lane] < node)) {
+            min_dist = mins [lane];
+            node = idxs [lane];
+        }
+    }
+    for (; v < n; v++) {
+        if (!s_visited (visited, v) && distance [v] < min_dist) {
+            min_dist = distance [v];
+            node = v;
+        }
+    }
+    return node;
+}
+
+__attribute__ ((target ("avx2"))) static void
+s_min_plus_int_avx2 (int *target, const int *row, int add, int n)
+{
+    const __m256i vadd = _mm256_set1_epi32 (add);
+    int v = 0;
+    for (; v + 8 <= n; v += 8) {
+        __m256i r = _mm256_loadu_si256 ((const __m256i *) (row + v));
+        __m256i t = _mm256_loadu_si256 ((const __m256i *) (target + v));
+        __m256i less = _mm256_cmpgt_epi32 (_mm256_sub_epi32 (t, vadd), r);
+        t = _mm256_blendv_epi8 (t, _mm256_add_epi32 (vadd, r), less);
+        _mm256_storeu_si256 ((__m256i *) (target + v), t);
+    }
+    if (v < n)
+        s_min_plus_int_scalar (target + v, row + v, add, n - v);
+}
+
+__attribute__ ((target ("avx2"))) static void
+s_min_plus_float_avx2 (float *target, const float *row, float add, int n)
+{
+    const __m256 vadd = _mm256_set1_ps (add);
+    int v = 0;
+    for (; v + 8 <= n; v += 8) {
+        __m256 sum = _mm256_add_ps (vadd, _mm256_loadu_ps (row + v));
+        _mm256_storeu_ps (target + v, _mm256_min_ps (_mm256_loadu_ps (target + v), sum));
+    }
+    if (v < n)
+        s_min_plus_float_scalar (target + v, row + v, add, n - v);
+}
+
+__attribute__ ((target ("avx2"))) static void
+s_min_int_avx2 (int *target, const int *row, int n)
+{
+    int v = 0;
+    for (; v + 8 <= n; v += 8) {
+        __m256i r = _mm256_loadu_si256 ((const __m256i *) (row + v));
+        __m256i t = _mm256_loadu_si256 ((const __m256i *) (target + v));
+        _mm256_storeu_si256 ((__m256i *) (target + v), _mm256_min_epi32 (t, r));
+    }
+    if (v < n)
+        s_min_int_scalar (target + v, row + v, n - v);
+}
+
+__attribute__ ((target ("avx2"))) static void
+s_min_float_avx2 (float *target, const float *row, int n)
+{
+    int v = 0;
+    for (; v + 8 <= n; v += 8)
+        _mm256_storeu_ps (target + v,
+                          _mm256_min_ps (_mm256_loadu_ps (target + v), _mm256_loadu_ps (row + v)));
+    if (v < n)
+        s_min_float_scalar (target + v, row + v, n - v);
+}
+
+#endif // DKERNEL_HAVE_X86
+
+static dkernel_impl_t
+s_impls [] = {
+#ifdef DKERNEL_HAVE_X86
+    { "avx2", s_relax_avx2, s_argmin_avx2,
+      s_min_plus_int_avx2, s_min_plus_float_avx2, s_min_int_avx2, s_min_float_avx2 },
+    { "sse4.1", s_relax_sse41, s_argmin_sse41,
+      s_min_plus_int_sse41, s_min_plus_float_sse41, s_min_int_sse41, s_min_float_sse41 },
+#endif
+    { "scalar", s_relax_scalar, s_argmin_scalar,
+      s_min_plus_int_scalar, s_min_plus_float_scalar, s_min_int_scalar, s_min_float_scalar },
+    { NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+//  Search threads read the selection while dkernel_select may change it
+static dkernel_impl_t *s_selected = NULL;
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+
+static bool
+s_supported (dkernel_impl_t *impl)
+{
+#ifdef DKERNEL_HAVE_X86
+    __builtin_cpu_init ();
+    if (streq (impl->name, "avx2"))
+        return __builtin_cpu_supports ("avx2");
+    if (streq (impl->name, "sse4.1"))
+        return __builtin_cpu_supports ("sse4.1");
+#endif
+    return true;
+}
+
+static void
+s_select_default (void)
+{
+    dkernel_select (NULL);
+}
+
+//  Get selected implementation, default one on first call
+
+static inline dkernel_impl_t *
+s_kernel (void)
+{
+    pthread_once (&s_once, s_select_default);
+    return __atomic_load_n (&s_selected, __ATOMIC_ACQUIRE);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Select kernel implementation
+
+int
+dkernel_select (const char *name)
+{
+    //  Make sure default selection does not override explicit one later
+    if (name)
+        pthread_once (&s_once, s_select_default);
+    for (dkernel_impl_t *impl = s_impls; impl->name; impl++) {
+        if (name && !streq (name, impl->name))
+            continue;
+        if (!s_supported (impl)) {
+            if (name)
+                return -1;
+            continue;
+        }
+        __atomic_store_n (&s_selected, impl, __ATOMIC_RELEASE);
+        return 0;
+    }
+    return -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return name of the selected kernel implementation
+
+const char *
+dkernel_name (void)
+{
+    return s_kernel ()->name;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Relax one adjacency row
+
+void
+dkernel_relax (const int *weights, int *distance, int *parent,
+               const uint64_t *visited, int n, int u, int du)
+{
+    s_kernel ()->relax (weights, distance, parent, visited, n, u, du);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Find nearest node which is not visited
+
+int
+dkernel_argmin (const int *distance, const uint64_t *visited, int n)
+{
+    return s_kernel ()->argmin (distance, visited, n);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep smaller of target and row plus constant, int elements
+
+void
+dkernel_min_plus_int (int *target, const int *row, int add, int n)
+{
+    s_kernel ()->min_plus_int (target, row, add, n);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep smaller of target and row plus constant, float elements
+
+void
+dkernel_min_plus_float (float *target, const float *row, float add, int n)
+{
+    s_kernel ()->min_plus_float (target, row, add, n);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep smaller of target and row, int elements
+
+void
+dkernel_min_int (int *target, const int *row, int n)
+{
+    s_kernel ()->min_int (target, row, n);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep smaller of target and row, float elements
+
+void
+dkernel_min_float (float *target, const float *row, int n)
+{
+    s_kernel ()->min_float (target, row, n);
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dkernel_test (bool verbose)
+{
+    printf (" * dkernel: ");
+
+    //  @selftest
+    //  Every kernel supported by this CPU must agree with the scalar one
+    const int n = 137;
+    int weights [137], distance [137], parent [137];
+    int expect_distance [137], expect_parent [137];
+    uint64_t visited [3];
+    const char *default_name = dkernel_name ();
+    assert (default_name);
+    for (dkernel_impl_t *impl = s_impls; impl->name; impl++) {
+        if (dkernel_select (impl->name) != 0)
+            continue;
+        if (verbose)
+            zsys_info ("dkernel: testing %s", dkernel_name ());
+        for (int round = 0; round < 100; round++) {
+            memset (visited, 0, sizeof (visited));
+            for (int v = 0; v < n; v++) {
+                weights [v] = (v * 7 + round * 13) % 11;
+                //  Some runs of visited nodes cover whole vectors
+                if ((v + round) % 5 == 0 || (v >= 64 && v < 64 + round % 24))
+                    visited [v / 64] |= (uint64_t) 1 << (v % 64);
+                distance [v] = ((v + round) % 3 == 0) ? INT_MAX : (v * 31 + round) % 97;
+                parent [v] = -1;
+            }
+            //  Large du checks that sums do not overflow
+            int du = (round % 10 == 0) ? INT_MAX - 5 : round % 17;
+            memcpy (expect_distance, distance, sizeof (distance));
+            memcpy (expect_parent, parent, sizeof (parent));
+            s_relax_scalar (weights, expect_distance, expect_parent, visited, n, 99, du);
+            dkernel_relax (weights, distance, parent, visited, n, 99, du);
+            assert (memcmp (distance, expect_distance, sizeof (distance)) == 0);
+            assert (memcmp (parent, expect_parent, sizeof (parent)) == 0);
+            assert (dkernel_argmin (distance, visited, n) == s_argmin_scalar (distance, visited, n));
+        }
+        //  Nothing reachable
+        memset (visited, 0, sizeof (visited));
+        for (int v = 0; v < n; v++)
+            distance [v] = INT_MAX;
+        assert (dkernel_argmin (distance, visited, n) == -1);
+        //  Ties resolve to the first node
+        distance [9] = distance [30] = distance [17] = distance [130] = 4;
+        assert (dkernel_argmin (distance, visited, n) == 9);
+        visited [0] = ~(uint64_t) 0;
+        assert (dkernel_argmin (distance, visited, n) == 130);
+
+        //  Row kernels, INT_MAX and infinity mean no path
+        for (int round = 0; round < 20; round++) {
+            int target [137], row [137], expect [137];
+            float target_f [137], row_f [137], expect_f [137];
+            for (int v = 0; v < n; v++) {
+                target [v] = ((v + round) % 4 == 0) ? INT_MAX : (v * 13 + round) % 50;
+                row [v] = ((v + round) % 3 == 0) ? INT_MAX : (v * 7 + round) % 40;
+                target_f [v] = target [v] == INT_MAX ? INFINITY : target [v] / 4.0f;
+                row_f [v] = row [v] == INT_MAX ? INFINITY : row [v] / 4.0f;
+            }
+            int add = (round % 5 == 0) ? INT_MAX - 3 : round;
+            memcpy (expect, target, sizeof (target));
+            s_min_plus_int_scalar (expect, row, add, n);
+            dkernel_min_plus_int (target, row, add, n);
+            assert (memcmp (target, expect, sizeof (target)) == 0);
+            s_min_int_scalar (expect, row, n);
+            dkernel_min_int (target, row, n);
+            assert (memcmp (target, expect, sizeof (target)) == 0);
+
+            memcpy (expect_f, target_f, sizeof (target_f));
+            s_min_plus_float_scalar (expect_f, row_f, round / 2.0f, n);
+            dkernel_min_plus_float (target_f, row_f, round / 2.0f, n);
+            assert (memcmp (target_f, expect_f, sizeof (target_f)) == 0);
+            s_min_float_scalar (expect_f, row_f, n);
+            dkernel_min_float (target_f, row_f, n);
+            assert (memcmp (target_f, expect_f, sizeof (target_f)) == 0);
+        }
+    }
+    dkernel_select (NULL);
+    assert (streq (dkernel_name (), default_name));
+    //  @end
+    printf ("OK\n");
+}
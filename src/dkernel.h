@@ -0,0 +1,74 @@
+/*  =========================================================================
+    dkernel - Vectorised kernels for dense graph search
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DKERNEL_H_INCLUDED
+#define DKERNEL_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Relax one adjacency row of node u with distance du. For every node v
+//  which is not visited and has weights [v] > 0, distance [v] becomes
+//  du + weights [v] if that is shorter and parent [v] becomes u. Node v
+//  is visited if bit v % 64 of visited [v / 64] is set, as in a row of
+//  dbitset. Parent may be NULL.
+GRAPHS_PRIVATE void
+    dkernel_relax (const int *weights, int *distance, int *parent,
+                   const uint64_t *visited, int n, int u, int du);
+
+//  Return index of the first smallest distance among nodes which are not
+//  visited, or -1 if all remaining nodes are unreachable.
+GRAPHS_PRIVATE int
+    dkernel_argmin (const int *distance, const uint64_t *visited, int n);
+
+//  Set target [v] to add + row [v] where that is smaller, for n elements.
+//  INT_MAX means no path; add must not be negative, sums never overflow.
+GRAPHS_PRIVATE void
+    dkernel_min_plus_int (int *target, const int *row, int add, int n);
+
+//  Set target [v] to add + row [v] where that is smaller, for n elements
+GRAPHS_PRIVATE void
+    dkernel_min_plus_float (float *target, const float *row, float add, int n);
+
+//  Set target [v] to row [v] where that is smaller, for n elements
+GRAPHS_PRIVATE void
+    dkernel_min_int (int *target, const int *row, int n);
+
+//  Set target [v] to row [v] where that is smaller, for n elements
+GRAPHS_PRIVATE void
+    dkernel_min_float (float *target, const float *row, int n);
+
+//  Select kernel implementation by name ("avx2", "sse4.1", "scalar") or
+//  the best one supported by this CPU when name is NULL. Returns 0 if
+//  selected, -1 if CPU does not support it. Other threads may be running
+//  kernels meanwhile, every call uses one implementation from start to end.
+GRAPHS_PRIVATE int
+    dkernel_select (const char *name);
+
+//  Return name of the selected kernel implementation
+GRAPHS_PRIVATE const char *
+    dkernel_name (void);
+
+//  Self test of this class
+GRAPHS_PRIVATE void
+    dkernel_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
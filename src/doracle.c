@@ -0,0 +1,526 @@
+/*  =========================================================================
+    doracle - Approximate distance oracle over landmarks
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    doracle - Approximate distance oracle over landmarks
+@discuss
+    Oracle keeps exact distances from every node to a few landmarks and
+    from the landmarks to every node. Any path through a landmark is a
+    path, so d (u, L) + d (L, v) bounds the distance from above, and the
+    triangle inequality, d (L, v) <= d (L, u) + d (u, v), bounds it from
+    below. Estimate takes the best of both bounds over all landmarks; its
+    error is never larger than their difference, which comes with every
+    estimate. Landmark which reaches u but not v, or which is reached
+    from v but not from u, proves there is no path at all.
+
+    Distances of one node are stored together, so estimate reads two rows
+    of 2 * landmarks ints. The number of landmarks is the trade-off: the
+    tables take 8 * landmarks bytes per node, and estimates get tighter
+    as landmarks cover more of the graph.
+
+    Landmarks are chosen farthest first: every round takes the nodes
+    least covered by the landmarks so far, the first round the ones
+    farthest from node 0, and nodes no landmark reaches come first. Each
+    of the round's landmarks is searched, forward over the graph and
+    backward over its reverse, on its own thread. Undirected graphs are
+    searched only forward.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DORACLE_MAX_THREADS 64
+
+//  Structure of our class
+
+struct _doracle_t {
+    int nodes;
+    int count;                  //  Number of landmarks chosen
+    int stride;                 //  Room for landmarks in a table row
+    int *landmark;              //  Landmark nodes
+    int *table;                 //  Per node stride distances to landmarks,
+                                //  then stride distances from landmarks
+};
+
+//  Searches of one thread
+
+typedef struct {
+    doracle_t *self;
+    dsearch_t *forward;         //  Over graph
+    dsearch_t *backward;        //  Over reverse graph, NULL if undirected
+    int index;                  //  Landmark to search this round
+} s_doracle_task_t;
+
+static void *
+s_doracle_worker (void *args)
+{
+    s_doracle_task_t *task = (s_doracle_task_t *) args;
+    doracle_t *self = task->self;
+    int l = task->index;
+    int node = self->landmark [l];
+    int row = 2 * self->stride;
+    dsearch_run (task->forward, node);
+    for (int v = 0; v < self->nodes; v++)
+        self->table [(size_t) v * row + self->stride + l] = dsearch_distance (task->forward, v);
+    if (task->backward) {
+        dsearch_run (task->backward, node);
+        for (int v = 0; v < self->nodes; v++)
+            self->table [(size_t) v * row + l] = dsearch_distance (task->backward, v);
+    }
+    else
+        for (int v = 0; v < self->nodes; v++)
+            self->table [(size_t) v * row + l] = self->table [(size_t) v * row + self->stride + l];
+    return NULL;
+}
+
+//  Run worker over all tasks, falling back to this thread for tasks whose
+//  thread did not start
+
+static void
+s_doracle_run (s_doracle_task_t *tasks, int threads)
+{
+    pthread_t thread [DORACLE_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+        if (pthread_create (&thread [t], NULL, s_doracle_worker, &tasks [t]) == 0)
+            started = t;
+        else
+            break;
+    s_doracle_worker (&tasks [0]);
+    for (int t = started + 1; t < threads; t++)
+        s_doracle_worker (&tasks [t]);
+    for (int t = 1; t <= started; t++)
+        pthread_join (thread [t], NULL);
+}
+
+//  Edges of graph are the same both ways
+
+static bool
+s_symmetric (graph_t *graph, graph_t *reverse)
+{
+    if (graph_edges (graph) != graph_edges (reverse))
+        return false;
+    for (int u = 0; u < graph_nodes (graph); u++) {
+        int degree = graph_degree (graph, u);
+        if (degree != graph_degree (reverse, u)
+        ||  memcmp (graph_targets (graph, u), graph_targets (reverse, u), degree * sizeof (int))
+        ||  memcmp (graph_weights (graph, u), graph_weights (reverse, u), degree * sizeof (int)))
+            return false;
+    }
+    return true;
+}
+
+//  Pick up to size nodes with the largest cover, lower ids first on ties.
+//  Nodes with cover 0 are landmarks already. Returns number picked.
+
+static int
+s_pick (const int *cover, int nodes, int *picks, int size)
+{
+    int count = 0;
+    for (int v = 0; v < nodes; v++) {
+        if (cover [v] == 0 || (count == size && cover [v] <= cover [picks [count - 1]]))
+            continue;
+        int i = count < size ? count++ : count - 1;
+        while (i > 0 && cover [picks [i - 1]] < cover [v]) {
+            picks [i] = picks [i - 1];
+            i--;
+        }
+        picks [i] = v;
+    }
+    return count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Build oracle for graph with up to landmarks landmarks
+
+doracle_t *
+doracle_new (graph_t *graph, int landmarks, int threads)
+{
+    if (!graph || landmarks <= 0)
+        return NULL;
+
+    int nodes = graph_nodes (graph);
+    if (landmarks > nodes)
+        landmarks = nodes;
+    if (threads <= 0) {
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    if (threads > DORACLE_MAX_THREADS)
+        threads = DORACLE_MAX_THREADS;
+    if (threads > landmarks)
+        threads = landmarks > 0 ? landmarks : 1;
+
+    doracle_t *self = (doracle_t *) zmalloc (sizeof (doracle_t));
+    assert (self);
+    self->nodes = nodes;
+    self->stride = landmarks;
+    self->landmark = (int *) malloc ((landmarks + 1) * sizeof (int));
+    self->table = (int *) malloc (((size_t) nodes * 2 * landmarks + 1) * sizeof (int));
+    assert (self->landmark && self->table);
+    if (nodes == 0)
+        return self;
+
+    graph_t *reverse = graph_reverse (graph);
+    bool symmetric = s_symmetric (graph, reverse);
+    s_doracle_task_t tasks [DORACLE_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        tasks [t].self = self;
+        tasks [t].forward = dsearch_new (graph);
+        tasks [t].backward = symmetric ? NULL : dsearch_new (reverse);
+    }
+
+    //  First round starts from the nodes farthest from node 0
+    int *cover = (int *) malloc (nodes * sizeof (int));
+    assert (cover);
+    dsearch_run (tasks [0].forward, 0);
+    for (int v = 0; v < nodes; v++)
+        cover [v] = dsearch_distance (tasks [0].forward, v);
+    bool first = true;
+
+    int picks [DORACLE_MAX_THREADS];
+    while (self->count < landmarks) {
+        int round = landmarks - self->count < threads ? landmarks - self->count : threads;
+        int picked = s_pick (cover, nodes, picks, round);
+        if (picked == 0 && first)
+            picks [picked++] = 0;       //  Single node graph
+        if (picked == 0)
+            break;                      //  Every node is a landmark
+        for (int t = 0; t < picked; t++) {
+            tasks [t].index = self->count + t;
+            self->landmark [self->count + t] = picks [t];
+        }
+        s_doracle_run (tasks, picked);
+        if (first) {
+            for (int v = 0; v < nodes; v++)
+                cover [v] = INT_MAX;
+            first = false;
+        }
+        //  Cover is distance from the nearest landmark
+        int row = 2 * self->stride;
+        for (int v = 0; v < nodes; v++)
+            for (int l = self->count; l < self->count + picked; l++) {
+                int distance = self->table [(size_t) v * row + self->stride + l];
+                if (distance < cover [v])
+                    cover [v] = distance;
+            }
+        self->count += picked;
+    }
+    free (cover);
+    for (int t = 0; t < threads; t++) {
+        dsearch_destroy (&tasks [t].forward);
+        dsearch_destroy (&tasks [t].backward);
+    }
+    graph_destroy (&reverse);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create oracle from data of doracle_as_chunk
+
+doracle_t *
+doracle_new_from_data (const void *data, size_t size, int nodes, int landmarks)
+{
+    //  Nodes, landmarks chosen, room for landmarks, then the arrays
+    const int *header = (const int *) data;
+    if (!data || size < 3 * sizeof (int) || nodes < 0 || landmarks <= 0)
+        return NULL;
+    int stride = landmarks < nodes ? landmarks : nodes;
+    if (header [0] != nodes || header [2] != stride
+    ||  header [1] < 0 || header [1] > stride
+    ||  size != (3 + (size_t) header [1] + (size_t) nodes * 2 * stride) * sizeof (int))
+        return NULL;
+    for (int i = 0; i < header [1]; i++)
+        if (header [3 + i] < 0 || header [3 + i] >= nodes)
+            return NULL;
+
+    doracle_t *self = (doracle_t *) zmalloc (sizeof (doracle_t));
+    assert (self);
+    self->nodes = nodes;
+    self->count = header [1];
+    self->stride = stride;
+    self->landmark = (int *) malloc ((stride + 1) * sizeof (int));
+    self->table = (int *) malloc (((size_t) nodes * 2 * stride + 1) * sizeof (int));
+    assert (self->landmark && self->table);
+    memcpy (self->landmark, header + 3, self->count * sizeof (int));
+    memcpy (self->table, header + 3 + self->count, (size_t) nodes * 2 * stride * sizeof (int));
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Estimate distance from node to node
+
+int
+doracle_estimate (doracle_t *self, int from, int to, int *lower_p)
+{
+    assert (self);
+    if (from < 0 || from >= self->nodes || to < 0 || to >= self->nodes) {
+        if (lower_p)
+            *lower_p = INT_MAX;
+        return INT_MAX;
+    }
+    if (from == to) {
+        if (lower_p)
+            *lower_p = 0;
+        return 0;
+    }
+    int stride = self->stride;
+    const int *to_landmark = self->table + (size_t) from * 2 * stride;
+    const int *from_landmark = to_landmark + stride;
+    const int *target_to = self->table + (size_t) to * 2 * stride;
+    const int *target_from = target_to + stride;
+
+    int64_t upper = INT_MAX;
+    int lower = 0;
+    for (int l = 0; l < self->count; l++) {
+        int out = to_landmark [l];          //  d (from, L)
+        int in = target_from [l];           //  d (L, to)
+        if (out != INT_MAX && in != INT_MAX && (int64_t) out + in < upper)
+            upper = (int64_t) out + in;
+        //  d (L, to) <= d (L, from) + d (from, to)
+        if (from_landmark [l] != INT_MAX) {
+            if (in == INT_MAX) {
+                lower = INT_MAX;
+                break;
+            }
+            if (in - from_landmark [l] > lower)
+                lower = in - from_landmark [l];
+        }
+        //  d (from, L) <= d (from, to) + d (to, L)
+        if (target_to [l] != INT_MAX) {
+            if (out == INT_MAX) {
+                lower = INT_MAX;
+                break;
+            }
+            if (out - target_to [l] > lower)
+                lower = out - target_to [l];
+        }
+    }
+    if (lower_p)
+        *lower_p = lower;
+    return lower == INT_MAX ? INT_MAX : (int) upper;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of landmarks
+
+int
+doracle_landmarks (doracle_t *self)
+{
+    if (!self) return 0;
+    return self->count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get landmark at index
+
+int
+doracle_landmark (doracle_t *self, int index)
+{
+    assert (self);
+    if (index < 0 || index >= self->count)
+        return -1;
+    return self->landmark [index];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get bytes taken by distance tables
+
+size_t
+doracle_size (doracle_t *self)
+{
+    if (!self) return 0;
+    return (size_t) self->nodes * 2 * self->stride * sizeof (int)
+         + self->stride * sizeof (int);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Convert oracle to chunk, for doracle_new_from_data
+
+zchunk_t *
+doracle_as_chunk (doracle_t *self)
+{
+    assert (self);
+    int header [3] = { self->nodes, self->count, self->stride };
+    zchunk_t *chunk = zchunk_new (header, sizeof (header));
+    zchunk_extend (chunk, self->landmark, self->count * sizeof (int));
+    zchunk_extend (chunk, self->table, (size_t) self->nodes * 2 * self->stride * sizeof (int));
+    return chunk;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the oracle
+
+void
+doracle_destroy (doracle_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        doracle_t *self = *self_p;
+        free (self->landmark);
+        free (self->table);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+doracle_test (bool verbose)
+{
+    printf (" * doracle: ");
+
+    //  @selftest
+    assert (doracle_new (NULL, 4, 1) == NULL);
+
+    //  Chain 0 -> 1 -> 2 and pair 3 <-> 4, every node is a landmark
+    int from [] = { 0, 1, 3, 4 };
+    int to [] = { 1, 2, 4, 3 };
+    int weight [] = { 2, 3, 1, 1 };
+    graph_t *graph = graph_new_from_edges (5, 4, from, to, weight);
+    doracle_t *self = doracle_new (graph, 8, 2);
+    assert (self);
+    assert (doracle_landmarks (self) == 5);
+    assert (doracle_landmark (self, 5) == -1);
+    assert (doracle_size (self) >= 5 * 2 * 5 * sizeof (int));
+    int lower;
+    assert (doracle_estimate (self, 0, 2, &lower) == 5);
+    assert (lower == 5);
+    assert (doracle_estimate (self, 3, 3, &lower) == 0);
+    //  Landmarks prove there is no way back, nor to the other component
+    assert (doracle_estimate (self, 2, 0, &lower) == INT_MAX);
+    assert (lower == INT_MAX);
+    assert (doracle_estimate (self, 0, 3, &lower) == INT_MAX);
+    assert (lower == INT_MAX);
+    assert (doracle_estimate (self, 0, 7, &lower) == INT_MAX);
+
+    //  Tables saved as chunk give the same estimates, for the same graph
+    //  and number of landmarks only
+    zchunk_t *chunk = doracle_as_chunk (self);
+    assert (doracle_new_from_data (zchunk_data (chunk), zchunk_size (chunk), 5, 4) == NULL);
+    assert (doracle_new_from_data (zchunk_data (chunk), zchunk_size (chunk), 6, 8) == NULL);
+    assert (doracle_new_from_data (zchunk_data (chunk), zchunk_size (chunk) - 1, 5, 8) == NULL);
+    doracle_t *copy = doracle_new_from_data (zchunk_data (chunk), zchunk_size (chunk), 5, 8);
+    assert (copy);
+    assert (doracle_landmarks (copy) == 5);
+    assert (doracle_landmark (copy, 4) == doracle_landmark (self, 4));
+    assert (doracle_estimate (copy, 0, 2, &lower) == 5 && lower == 5);
+    assert (doracle_estimate (copy, 2, 0, &lower) == INT_MAX);
+    doracle_destroy (&copy);
+    zchunk_destroy (&chunk);
+    doracle_destroy (&self);
+    doracle_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Directed grid with random weights, estimates bound exact distances
+    const int side = 15;
+    const int nodes = side * side;
+    int *edge_from = (int *) malloc (4 * nodes * sizeof (int));
+    int *edge_to = (int *) malloc (4 * nodes * sizeof (int));
+    int *edge_weight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (edge_from && edge_to && edge_weight);
+    int edges = 0;
+    unsigned int seed = 7;
+    for (int y = 0; y < side; y++)
+        for (int x = 0; x < side; x++) {
+            int u = y * side + x;
+            int near [4] = { x > 0 ? u - 1 : -1, x < side - 1 ? u + 1 : -1,
+                             y > 0 ? u - side : -1, y < side - 1 ? u + side : -1 };
+            for (int i = 0; i < 4; i++)
+                if (near [i] >= 0) {
+                    seed = seed * 1103515245 + 12345;
+                    edge_from [edges] = u;
+                    edge_to [edges] = near [i];
+                    edge_weight [edges] = 1 + (seed >> 16) % 20;
+                    edges++;
+                }
+        }
+    graph = graph_new_from_edges (nodes, edges, edge_from, edge_to, edge_weight);
+    doracle_t *coarse = doracle_new (graph, 4, 1);
+    doracle_t *fine = doracle_new (graph, 16, 1);
+    doracle_t *parallel = doracle_new (graph, 16, 3);
+    assert (doracle_landmarks (coarse) == 4);
+    assert (doracle_landmarks (fine) == 16);
+    assert (doracle_landmarks (parallel) == 16);
+    assert (doracle_size (fine) > doracle_size (coarse));
+    //  Landmarks of one thread are chosen one by one, so the first four
+    //  are the same
+    for (int l = 0; l < 4; l++)
+        assert (doracle_landmark (coarse, l) == doracle_landmark (fine, l));
+
+    dsearch_t *search = dsearch_new (graph);
+    int64_t coarse_error = 0;
+    int64_t fine_error = 0;
+    for (int u = 0; u < nodes; u++) {
+        dsearch_run (search, u);
+        for (int v = 0; v < nodes; v++) {
+            int exact = dsearch_distance (search, v);
+            int coarse_lower, fine_lower, parallel_lower;
+            int coarse_upper = doracle_estimate (coarse, u, v, &coarse_lower);
+            int fine_upper = doracle_estimate (fine, u, v, &fine_lower);
+            int parallel_upper = doracle_estimate (parallel, u, v, &parallel_lower);
+            assert (coarse_lower <= exact && exact <= coarse_upper);
+            assert (fine_lower <= exact && exact <= fine_upper);
+            assert (parallel_lower <= exact && exact <= parallel_upper);
+            //  More landmarks never make estimate worse
+            assert (fine_upper <= coarse_upper);
+            assert (fine_lower >= coarse_lower);
+            coarse_error += coarse_upper - exact;
+            fine_error += fine_upper - exact;
+        }
+    }
+    assert (fine_error < coarse_error);
+    //  Distances from a landmark are exact
+    int landmark = doracle_landmark (fine, 0);
+    dsearch_run (search, landmark);
+    for (int v = 0; v < nodes; v++)
+        assert (doracle_estimate (fine, landmark, v, NULL) == dsearch_distance (search, v));
+    if (verbose)
+        printf ("\nmean error %.2f with 4 landmarks, %.2f with 16\n",
+                (double) coarse_error / nodes / nodes, (double) fine_error / nodes / nodes);
+
+    dsearch_destroy (&search);
+    doracle_destroy (&coarse);
+    doracle_destroy (&fine);
+    doracle_destroy (&parallel);
+    graph_destroy (&graph);
+    free (edge_from);
+    free (edge_to);
+    free (edge_weight);
+    //  @end
+    printf ("OK\n");
+}
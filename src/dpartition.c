@@ -0,0 +1,484 @@
+/*  =========================================================================
+    dpartition - Graph partitioning into shards
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dpartition - Graph partitioning into shards
+@discuss
+    Shards start as consecutive runs of Cuthill-McKee order (see reorder),
+    which sweeps the graph in breadth-first layers from its periphery, so
+    every shard is a band of a few layers. Label propagation then moves every
+    node to the shard most of its edges, either way, lead to, as long as
+    that shard stays within DPARTITION_IMBALANCE of the average size and
+    the node's own shard does not become empty. Rounds repeat until no
+    node moves, or DPARTITION_ROUNDS times.
+
+    Shard file is a precomputation file (see dprecomp) whose hash is the
+    id of the partitioning. Its sections are:
+
+        shard       uint64_t id, shard, number of shards and graph nodes
+        graph       adjacency of the shard, nodes in local ids
+        ids         int global id of every local node, ascending
+        boundary    int local ids of nodes with an edge to or from
+                    another shard
+        cut         int triples, local from, global to and weight, of
+                    edges leaving the shard
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DPARTITION_ROUNDS       20
+#define DPARTITION_IMBALANCE    1.05
+
+//  Structure of our class
+
+struct _dpartition_t {
+    int nodes;
+    int shards;
+    int *shard;                 //  Shard of every node
+    int *size;                  //  Nodes of every shard
+    int cut;
+    int boundary;
+    uint64_t id;
+};
+
+//  Mix word into id, after MurmurHash3
+
+static uint64_t
+s_mix (uint64_t hash, uint64_t word)
+{
+    word *= 0x87c37b91114253d5ULL;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937fULL;
+    hash ^= word;
+    hash = (hash << 27) | (hash >> 37);
+    return hash * 5 + 0x52dce729;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Split nodes of graph into shards
+
+dpartition_t *
+dpartition_new (graph_t *graph, int shards)
+{
+    if (!graph || shards <= 0)
+        return NULL;
+
+    int nodes = graph_nodes (graph);
+    if (shards > nodes && nodes > 0)
+        shards = nodes;
+    dpartition_t *self = (dpartition_t *) zmalloc (sizeof (dpartition_t));
+    assert (self);
+    self->nodes = nodes;
+    self->shards = shards;
+    self->shard = (int *) malloc ((nodes + 1) * sizeof (int));
+    self->size = (int *) zmalloc (shards * sizeof (int));
+    assert (self->shard && self->size);
+
+    //  Consecutive runs of Cuthill-McKee order
+    reorder_t *order = reorder_new (graph, REORDER_RCM);
+    for (int u = 0; u < nodes; u++) {
+        self->shard [u] = (int) ((int64_t) reorder_to_new (order, u) * shards / nodes);
+        self->size [self->shard [u]]++;
+    }
+    reorder_destroy (&order);
+
+    graph_t *reverse = graph_reverse (graph);
+    int capacity = (int) ((double) nodes / shards * DPARTITION_IMBALANCE) + 1;
+    int *links = (int *) zmalloc (shards * sizeof (int));
+    int *near = (int *) malloc ((shards + 1) * sizeof (int));
+    assert (links && near);
+    for (int round = 0; round < DPARTITION_ROUNDS; round++) {
+        int moved = 0;
+        for (int u = 0; u < nodes; u++) {
+            //  Count edges of node leading to every shard
+            int near_count = 0;
+            for (int pass = 0; pass < 2; pass++) {
+                graph_t *edges = pass ? reverse : graph;
+                int degree = graph_degree (edges, u);
+                const int *targets = graph_targets (edges, u);
+                for (int i = 0; i < degree; i++) {
+                    int s = self->shard [targets [i]];
+                    if (links [s]++ == 0)
+                        near [near_count++] = s;
+                }
+            }
+            int current = self->shard [u];
+            int best = current;
+            for (int i = 0; i < near_count; i++) {
+                int s = near [i];
+                if (links [s] > links [best] && self->size [s] < capacity)
+                    best = s;
+            }
+            for (int i = 0; i < near_count; i++)
+                links [near [i]] = 0;
+            if (best != current && self->size [current] > 1) {
+                self->size [current]--;
+                self->size [best]++;
+                self->shard [u] = best;
+                moved++;
+            }
+        }
+        if (moved == 0)
+            break;
+    }
+    free (near);
+    free (links);
+    graph_destroy (&reverse);
+
+    bool *boundary = (bool *) zmalloc ((nodes + 1) * sizeof (bool));
+    assert (boundary);
+    self->id = s_mix (s_mix (0, nodes), shards);
+    for (int u = 0; u < nodes; u++) {
+        self->id = s_mix (self->id, self->shard [u]);
+        int degree = graph_degree (graph, u);
+        const int *targets = graph_targets (graph, u);
+        for (int i = 0; i < degree; i++)
+            if (self->shard [targets [i]] != self->shard [u]) {
+                self->cut++;
+                boundary [u] = true;
+                boundary [targets [i]] = true;
+            }
+    }
+    for (int u = 0; u < nodes; u++)
+        self->boundary += boundary [u];
+    free (boundary);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of shards
+
+int
+dpartition_shards (dpartition_t *self)
+{
+    if (!self) return 0;
+    return self->shards;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+dpartition_nodes (dpartition_t *self)
+{
+    if (!self) return 0;
+    return self->nodes;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get shard of node
+
+int
+dpartition_shard (dpartition_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return -1;
+    return self->shard [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes in shard
+
+int
+dpartition_size (dpartition_t *self, int shard)
+{
+    if (!self || shard < 0 || shard >= self->shards) return 0;
+    return self->size [shard];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges going from one shard to another
+
+int
+dpartition_cut (dpartition_t *self)
+{
+    if (!self) return 0;
+    return self->cut;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes with an edge to or from another shard
+
+int
+dpartition_boundary (dpartition_t *self)
+{
+    if (!self) return 0;
+    return self->boundary;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get id of the partitioning
+
+uint64_t
+dpartition_id (dpartition_t *self)
+{
+    assert (self);
+    return self->id;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Save shard of graph to precomputation file
+
+int
+dpartition_save (dpartition_t *self, graph_t *graph, int shard, const char *path)
+{
+    assert (self);
+    if (!graph || graph_nodes (graph) != self->nodes || shard < 0 || shard >= self->shards)
+        return -1;
+
+    int size = self->size [shard];
+    int *local = (int *) malloc ((self->nodes + 1) * sizeof (int));
+    int *ids = (int *) malloc ((size + 1) * sizeof (int));
+    bool *boundary = (bool *) zmalloc ((size + 1) * sizeof (bool));
+    assert (local && ids && boundary);
+    int count = 0;
+    for (int u = 0; u < self->nodes; u++)
+        if (self->shard [u] == shard) {
+            ids [count] = u;
+            local [u] = count++;
+        }
+        else
+            local [u] = -1;
+
+    //  Edges within shard, edges leaving it, and boundary of both ends
+    int inner = 0;
+    int leaving = 0;
+    for (int u = 0; u < self->nodes; u++) {
+        int degree = graph_degree (graph, u);
+        const int *targets = graph_targets (graph, u);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            if (local [u] >= 0 && local [v] >= 0)
+                inner++;
+            else
+            if (local [u] >= 0) {
+                leaving++;
+                boundary [local [u]] = true;
+            }
+            else
+            if (local [v] >= 0)
+                boundary [local [v]] = true;
+        }
+    }
+    int *from = (int *) malloc ((inner + 1) * sizeof (int));
+    int *to = (int *) malloc ((inner + 1) * sizeof (int));
+    int *weight = (int *) malloc ((inner + 1) * sizeof (int));
+    int *cut = (int *) malloc ((3 * leaving + 1) * sizeof (int));
+    assert (from && to && weight && cut);
+    inner = 0;
+    leaving = 0;
+    for (int l = 0; l < size; l++) {
+        int u = ids [l];
+        int degree = graph_degree (graph, u);
+        const int *targets = graph_targets (graph, u);
+        const int *weights = graph_weights (graph, u);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            if (local [v] >= 0) {
+                from [inner] = l;
+                to [inner] = local [v];
+                weight [inner++] = weights [i];
+            }
+            else {
+                cut [3 * leaving] = l;
+                cut [3 * leaving + 1] = v;
+                cut [3 * leaving + 2] = weights [i];
+                leaving++;
+            }
+        }
+    }
+    //  Boundary list reuses local ids array
+    int boundary_count = 0;
+    for (int l = 0; l < size; l++)
+        if (boundary [l])
+            local [boundary_count++] = l;
+
+    graph_t *subgraph = graph_new_from_edges (size, inner, from, to, weight);
+    uint64_t header [4] = { self->id, (uint64_t) shard, (uint64_t) self->shards,
+                            (uint64_t) self->nodes };
+    dprecomp_t *file = dprecomp_new (path, self->id);
+    int rc = file && subgraph ? 0 : -1;
+    if (rc == 0)
+        rc = dprecomp_add (file, "shard", header, sizeof (header));
+    if (rc == 0)
+        rc = dprecomp_add_graph (file, "graph", subgraph);
+    if (rc == 0)
+        rc = dprecomp_add (file, "ids", ids, size * sizeof (int));
+    if (rc == 0)
+        rc = dprecomp_add (file, "boundary", local, boundary_count * sizeof (int));
+    if (rc == 0)
+        rc = dprecomp_add (file, "cut", cut, 3 * leaving * sizeof (int));
+    if (rc == 0)
+        rc = dprecomp_save (file);
+    dprecomp_destroy (&file);
+    graph_destroy (&subgraph);
+    free (cut);
+    free (weight);
+    free (to);
+    free (from);
+    free (boundary);
+    free (ids);
+    free (local);
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the partitioning
+
+void
+dpartition_destroy (dpartition_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dpartition_t *self = *self_p;
+        free (self->shard);
+        free (self->size);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dpartition_test (bool verbose)
+{
+    printf (" * dpartition: ");
+
+    //  @selftest
+    assert (dpartition_new (NULL, 2) == NULL);
+
+    //  Grid, both ways, with node ids shuffled
+    const int side = 30;
+    const int nodes = side * side;
+    int *label = (int *) malloc (nodes * sizeof (int));
+    int *from = (int *) malloc (4 * nodes * sizeof (int));
+    int *to = (int *) malloc (4 * nodes * sizeof (int));
+    int *weight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (label && from && to && weight);
+    unsigned int seed = 3;
+    for (int i = 0; i < nodes; i++)
+        label [i] = i;
+    for (int i = nodes - 1; i > 0; i--) {
+        seed = seed * 1103515245 + 12345;
+        int j = (seed >> 8) % (i + 1);
+        int swap = label [i];
+        label [i] = label [j];
+        label [j] = swap;
+    }
+    int edges = 0;
+    for (int y = 0; y < side; y++)
+        for (int x = 0; x < side; x++) {
+            int u = label [y * side + x];
+            int right = x + 1 < side ? label [y * side + x + 1] : -1;
+            int down = y + 1 < side ? label [(y + 1) * side + x] : -1;
+            int next [2] = { right, down };
+            for (int i = 0; i < 2; i++)
+                if (next [i] >= 0) {
+                    from [edges] = u; to [edges] = next [i]; weight [edges++] = 1 + (u + i) % 5;
+                    from [edges] = next [i]; to [edges] = u; weight [edges++] = 1 + (u + i) % 5;
+                }
+        }
+    graph_t *graph = graph_new_from_edges (nodes, edges, from, to, weight);
+
+    dpartition_t *self = dpartition_new (graph, 4);
+    assert (self);
+    assert (dpartition_shards (self) == 4);
+    assert (dpartition_nodes (self) == nodes);
+    assert (dpartition_shard (self, nodes) == -1);
+    int total = 0;
+    for (int s = 0; s < 4; s++) {
+        assert (dpartition_size (self, s) > 0);
+        assert (dpartition_size (self, s) <= nodes / 4 * DPARTITION_IMBALANCE + 1);
+        total += dpartition_size (self, s);
+    }
+    assert (total == nodes);
+    int cut = 0;
+    for (int i = 0; i < edges; i++)
+        cut += dpartition_shard (self, from [i]) != dpartition_shard (self, to [i]);
+    assert (cut == dpartition_cut (self));
+    //  Random split would cut three quarters of the edges, regions cut
+    //  only their borders
+    assert (dpartition_cut (self) < edges / 8);
+    assert (dpartition_boundary (self) > 0 && dpartition_boundary (self) < nodes / 4);
+    if (verbose)
+        printf ("\n%d of %d edges cut, %d boundary nodes\n",
+                dpartition_cut (self), edges, dpartition_boundary (self));
+
+    //  Shard file holds the shard's nodes, edges and boundary
+    zsys_dir_create (SELFTEST_DIR_RW);
+    char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dpartition.shard");
+    assert (filename);
+    assert (dpartition_save (self, graph, 4, filename) == -1);
+    assert (dpartition_save (self, graph, 1, filename) == 0);
+    dprecomp_t *file = dprecomp_open (filename, dpartition_id (self));
+    assert (file);
+    size_t size;
+    const uint64_t *header = (const uint64_t *) dprecomp_section (file, "shard", &size);
+    assert (header && size == 4 * sizeof (uint64_t));
+    assert (header [0] == dpartition_id (self) && header [1] == 1 && header [2] == 4);
+    assert (header [3] == (uint64_t) nodes);
+    const int *ids = (const int *) dprecomp_section (file, "ids", &size);
+    assert (size == dpartition_size (self, 1) * sizeof (int));
+    for (size_t i = 0; i < size / sizeof (int); i++)
+        assert (dpartition_shard (self, ids [i]) == 1);
+    graph_t *shard = dprecomp_graph (file, "graph");
+    assert (graph_nodes (shard) == dpartition_size (self, 1));
+    const int *cut_edges = (const int *) dprecomp_section (file, "cut", &size);
+    assert (cut_edges || size == 0);
+    for (size_t i = 0; i < size / sizeof (int); i += 3)
+        assert (dpartition_shard (self, cut_edges [i + 1]) != 1);
+    int out = 0;
+    for (int u = 0; u < nodes; u++)
+        if (dpartition_shard (self, u) == 1)
+            out += graph_degree (graph, u);
+    assert (graph_edges (shard) + (int) (size / 3 / sizeof (int)) == out);
+    graph_destroy (&shard);
+    dprecomp_destroy (&file);
+    zsys_file_delete (filename);
+    zstr_free (&filename);
+
+    dpartition_destroy (&self);
+    graph_destroy (&graph);
+    free (label);
+    free (from);
+    free (to);
+    free (weight);
+    //  @end
+    printf ("OK\n");
+}
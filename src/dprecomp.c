@@ -0,0 +1,544 @@
+/*  =========================================================================
+    dprecomp - Precomputed indexes persisted in a file
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dprecomp - Precomputed indexes persisted in a file
+@discuss
+    Indexes built from a graph, such as its adjacency, node relabeling or
+    connectivity, are saved in one file of tagged sections, so the next
+    start maps them instead of computing them again. File is tagged with a
+    hash of the distance matrix and is only used for the very same graph.
+
+    Sections are stored the way they are used in memory, aligned to cache
+    lines, so a mapped file is used in place: pages are read on first
+    touch and shared by every process mapping the same file. Mapping is
+    private, changes made in memory never reach the file.
+
+    New file is written aside and renamed over the old one when complete,
+    so readers see either the old file or the new one, never a part. Files
+    are in native byte order of the machine which wrote them.
+@end
+*/
+
+#include "graphs_classes.h"
+#include <sys/mman.h>
+
+#define DPRECOMP_MAGIC      "GRAPHSPC"
+#define DPRECOMP_FORMAT     1
+#define DPRECOMP_ALIGNMENT  64
+#define DPRECOMP_TAG_SIZE   16
+
+typedef struct {
+    char magic [8];             //  DPRECOMP_MAGIC
+    uint32_t format;            //  DPRECOMP_FORMAT
+    uint32_t sections;          //  Entries of section table
+    uint64_t hash;              //  Hash of the distance matrix
+    uint64_t table;             //  Offset of section table
+    uint64_t size;              //  Size of the whole file
+    uint8_t padding [24];
+} dprecomp_header_t;
+
+typedef struct {
+    char tag [DPRECOMP_TAG_SIZE];
+    uint64_t offset;
+    uint64_t size;
+} dprecomp_section_t;
+
+//  Structure of our class
+
+struct _dprecomp_t {
+    char *path;
+    uint64_t hash;
+    //  New file
+    char *temp_path;            //  File being written, NULL when mapped
+    FILE *file;
+    uint64_t offset;            //  End of data written so far
+    bool failed;                //  Some write failed, file is not saved
+    dprecomp_section_t *table;
+    uint32_t sections;
+    uint32_t table_size;        //  Allocated entries
+    //  Mapped file
+    uint8_t *map;
+    size_t map_size;
+};
+
+//  Temporary files of one process get their own numbers
+static uint32_t s_temp_counter = 0;
+
+static inline uint64_t
+s_rotl (uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+//  Mix word into hash, after MurmurHash3
+
+static inline uint64_t
+s_mix (uint64_t hash, uint64_t word)
+{
+    word *= 0x87c37b91114253d5ULL;
+    word = s_rotl (word, 31);
+    word *= 0x4cf5ad432745937fULL;
+    hash ^= word;
+    return s_rotl (hash, 27) * 5 + 0x52dce729;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get hash of distance matrix
+
+uint64_t
+dprecomp_hash (matrix_t *distances)
+{
+    if (!distances) return 0;
+    uint64_t hash = s_mix (0, DPRECOMP_FORMAT);
+    hash = s_mix (hash, matrix_x (distances));
+    hash = s_mix (hash, matrix_y (distances));
+    hash = s_mix (hash, matrix_element_size (distances));
+    size_t row_bytes = matrix_x (distances) * matrix_element_size (distances);
+    for (int y = 0; y < matrix_y (distances); y++) {
+        const uint8_t *row = (const uint8_t *) matrix_get_ptr (distances, 0, y);
+        size_t i;
+        uint64_t word;
+        for (i = 0; i + sizeof (word) <= row_bytes; i += sizeof (word)) {
+            memcpy (&word, row + i, sizeof (word));
+            hash = s_mix (hash, word);
+        }
+        if (i < row_bytes) {
+            word = 0;
+            memcpy (&word, row + i, row_bytes - i);
+            hash = s_mix (hash, word);
+        }
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+
+//  Write to new file, remembering failure
+
+static void
+s_write (dprecomp_t *self, const void *data, size_t size)
+{
+    if (!self->failed && size && fwrite (data, 1, size, self->file) != size)
+        self->failed = true;
+    self->offset += size;
+}
+
+//  Pad new file to the next aligned offset
+
+static void
+s_align (dprecomp_t *self)
+{
+    static const uint8_t zeros [DPRECOMP_ALIGNMENT] = { 0 };
+    size_t pad = (DPRECOMP_ALIGNMENT - self->offset % DPRECOMP_ALIGNMENT) % DPRECOMP_ALIGNMENT;
+    s_write (self, zeros, pad);
+}
+
+//  Start section at aligned offset, its data follows
+
+static int
+s_section_begin (dprecomp_t *self, const char *tag)
+{
+    if (!self->file || !tag || strlen (tag) >= DPRECOMP_TAG_SIZE)
+        return -1;
+    if (self->sections == self->table_size) {
+        self->table_size = self->table_size ? self->table_size * 2 : 8;
+        self->table = (dprecomp_section_t *) realloc (self->table,
+                      self->table_size * sizeof (dprecomp_section_t));
+        assert (self->table);
+    }
+    s_align (self);
+    dprecomp_section_t *section = &self->table [self->sections++];
+    memset (section, 0, sizeof (dprecomp_section_t));
+    strcpy (section->tag, tag);
+    section->offset = self->offset;
+    return 0;
+}
+
+static int
+s_section_end (dprecomp_t *self)
+{
+    dprecomp_section_t *section = &self->table [self->sections - 1];
+    section->size = self->offset - section->offset;
+    return self->failed ? -1 : 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create precomputation file for graph with hash
+
+dprecomp_t *
+dprecomp_new (const char *path, uint64_t hash)
+{
+    if (!path) return NULL;
+
+    uint32_t counter = __atomic_add_fetch (&s_temp_counter, 1, __ATOMIC_RELAXED);
+    char *temp_path = zsys_sprintf ("%s.%d.%u.tmp", path, (int) getpid (), counter);
+    assert (temp_path);
+    FILE *file = fopen (temp_path, "wb");
+    if (!file) {
+        zstr_free (&temp_path);
+        return NULL;
+    }
+    dprecomp_t *self = (dprecomp_t *) zmalloc (sizeof (dprecomp_t));
+    assert (self);
+    self->path = strdup (path);
+    self->hash = hash;
+    self->temp_path = temp_path;
+    self->file = file;
+    //  Header is written when the file is complete
+    dprecomp_header_t header;
+    memset (&header, 0, sizeof (header));
+    s_write (self, &header, sizeof (header));
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Map precomputation file
+
+dprecomp_t *
+dprecomp_open (const char *path, uint64_t hash)
+{
+    if (!path) return NULL;
+
+    int handle = open (path, O_RDONLY);
+    if (handle == -1)
+        return NULL;
+    struct stat stat_buf;
+    if (fstat (handle, &stat_buf) == -1
+    ||  (size_t) stat_buf.st_size < sizeof (dprecomp_header_t)) {
+        close (handle);
+        return NULL;
+    }
+    size_t size = (size_t) stat_buf.st_size;
+    void *map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, handle, 0);
+    close (handle);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const dprecomp_header_t *header = (const dprecomp_header_t *) map;
+    bool valid = memcmp (header->magic, DPRECOMP_MAGIC, sizeof (header->magic)) == 0
+              && header->format == DPRECOMP_FORMAT
+              && (hash == 0 || header->hash == hash)
+              && header->size == size
+              && header->table <= size
+              && header->sections <= (size - header->table) / sizeof (dprecomp_section_t);
+    if (valid) {
+        const dprecomp_section_t *table =
+            (const dprecomp_section_t *) ((uint8_t *) map + header->table);
+        for (uint32_t i = 0; i < header->sections && valid; i++)
+            valid = table [i].offset % DPRECOMP_ALIGNMENT == 0
+                 && table [i].offset <= size
+                 && table [i].size <= size - table [i].offset
+                 && memchr (table [i].tag, 0, DPRECOMP_TAG_SIZE) != NULL;
+    }
+    if (!valid) {
+        munmap (map, size);
+        return NULL;
+    }
+    dprecomp_t *self = (dprecomp_t *) zmalloc (sizeof (dprecomp_t));
+    assert (self);
+    self->path = strdup (path);
+    self->hash = hash;
+    self->map = (uint8_t *) map;
+    self->map_size = size;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add section to new file
+
+int
+dprecomp_add (dprecomp_t *self, const char *tag, const void *data, size_t size)
+{
+    assert (self);
+    if (s_section_begin (self, tag) == -1)
+        return -1;
+    s_write (self, data, size);
+    return s_section_end (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add adjacency of graph as section: nodes, edges, then offsets, targets
+//  and weights arrays, all of int
+
+int
+dprecomp_add_graph (dprecomp_t *self, const char *tag, graph_t *graph)
+{
+    assert (self);
+    if (!graph || s_section_begin (self, tag) == -1)
+        return -1;
+    int nodes = graph_nodes (graph);
+    int edges = graph_edges (graph);
+    s_write (self, &nodes, sizeof (int));
+    s_write (self, &edges, sizeof (int));
+    for (int u = 0; u < nodes; u++) {
+        int offset = graph_offset (graph, u);
+        s_write (self, &offset, sizeof (int));
+    }
+    s_write (self, &edges, sizeof (int));
+    if (nodes) {
+        //  Edges of all nodes are consecutive
+        s_write (self, graph_targets (graph, 0), edges * sizeof (int));
+        s_write (self, graph_weights (graph, 0), edges * sizeof (int));
+    }
+    return s_section_end (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Finish new file and move it to its path
+
+int
+dprecomp_save (dprecomp_t *self)
+{
+    assert (self);
+    if (!self->file)
+        return -1;
+
+    s_align (self);
+    dprecomp_header_t header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, DPRECOMP_MAGIC, sizeof (header.magic));
+    header.format = DPRECOMP_FORMAT;
+    header.sections = self->sections;
+    header.hash = self->hash;
+    header.table = self->offset;
+    s_write (self, self->table, self->sections * sizeof (dprecomp_section_t));
+    header.size = self->offset;
+    if (!self->failed
+    &&  (fseek (self->file, 0, SEEK_SET) == -1
+    ||   fwrite (&header, sizeof (header), 1, self->file) != 1
+    ||   fflush (self->file) != 0
+    ||   fsync (fileno (self->file)) == -1))
+        self->failed = true;
+    if (fclose (self->file) != 0)
+        self->failed = true;
+    self->file = NULL;
+    if (self->failed || rename (self->temp_path, self->path) == -1) {
+        zsys_file_delete (self->temp_path);
+        zstr_free (&self->temp_path);
+        return -1;
+    }
+    zstr_free (&self->temp_path);
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get section of mapped file
+
+void *
+dprecomp_section (dprecomp_t *self, const char *tag, size_t *size_p)
+{
+    assert (self);
+    if (!self->map || !tag)
+        return NULL;
+    const dprecomp_header_t *header = (const dprecomp_header_t *) self->map;
+    const dprecomp_section_t *table = (const dprecomp_section_t *) (self->map + header->table);
+    for (uint32_t i = 0; i < header->sections; i++)
+        if (streq (table [i].tag, tag)) {
+            if (size_p)
+                *size_p = table [i].size;
+            return self->map + table [i].offset;
+        }
+    return NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create graph over adjacency section of mapped file
+
+graph_t *
+dprecomp_graph (dprecomp_t *self, const char *tag)
+{
+    size_t size;
+    int *data = (int *) dprecomp_section (self, tag, &size);
+    if (!data || size < 2 * sizeof (int))
+        return NULL;
+    int nodes = data [0];
+    int edges = data [1];
+    if (nodes <= 0 || edges < 0
+    ||  size != (2 + (size_t) nodes + 1 + 2 * (size_t) edges) * sizeof (int))
+        return NULL;
+    //  Hash does not cover the file itself, so check everything searches
+    //  index with
+    int *offsets = data + 2;
+    if (offsets [0] != 0 || offsets [nodes] != edges)
+        return NULL;
+    for (int node = 0; node < nodes; node++)
+        if (offsets [node] > offsets [node + 1])
+            return NULL;
+    int *targets = offsets + nodes + 1;
+    for (int edge = 0; edge < edges; edge++)
+        if (targets [edge] < 0 || targets [edge] >= nodes)
+            return NULL;
+    //  Searches settle nodes for good, which negative weights would break
+    int *weights = targets + edges;
+    for (int edge = 0; edge < edges; edge++)
+        if (weights [edge] < 0)
+            return NULL;
+    return graph_new_view (nodes, offsets, targets, weights);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Close the file
+
+void
+dprecomp_destroy (dprecomp_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dprecomp_t *self = *self_p;
+        if (self->file) {
+            fclose (self->file);
+            zsys_file_delete (self->temp_path);
+        }
+        if (self->map)
+            munmap (self->map, self->map_size);
+        zstr_free (&self->temp_path);
+        free (self->path);
+        free (self->table);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dprecomp_test (bool verbose)
+{
+    printf (" * dprecomp: ");
+
+    //  @selftest
+    zsys_dir_create (SELFTEST_DIR_RW);
+    char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dprecomp.pre");
+    assert (filename);
+    zsys_file_delete (filename);
+
+    //  Hash changes with any element
+    matrix_t *distances = matrix_new (5, 5, sizeof (int));
+    matrix_set_int (distances, 1, 0, 3);
+    matrix_set_int (distances, 4, 3, 2);
+    uint64_t hash = dprecomp_hash (distances);
+    assert (hash == dprecomp_hash (distances));
+    matrix_set_int (distances, 4, 4, 1);
+    assert (hash != dprecomp_hash (distances));
+    matrix_set_int (distances, 4, 4, 0);
+    assert (hash == dprecomp_hash (distances));
+    assert (dprecomp_open (filename, hash) == NULL);
+
+    //  Sections come back as saved, graph is used in place
+    graph_t *graph = graph_new_from_matrix (distances);
+    dprecomp_t *self = dprecomp_new (filename, hash);
+    assert (self);
+    int numbers [] = { 7, 8, 9 };
+    assert (dprecomp_add (self, "numbers", numbers, sizeof (numbers)) == 0);
+    assert (dprecomp_add_graph (self, "graph", graph) == 0);
+    assert (dprecomp_add (self, "empty", NULL, 0) == 0);
+    //  Nodes, edges, offsets, targets and weights which no search may use
+    int bad_target [] = { 2, 1, 0, 1, 1, 5, 1 };
+    int bad_offsets [] = { 2, 1, 0, 2, 1, 1, 1 };
+    int bad_weight [] = { 2, 1, 0, 1, 1, 1, -4 };
+    assert (dprecomp_add (self, "bad target", bad_target, sizeof (bad_target)) == 0);
+    assert (dprecomp_add (self, "bad offsets", bad_offsets, sizeof (bad_offsets)) == 0);
+    assert (dprecomp_add (self, "bad weight", bad_weight, sizeof (bad_weight)) == 0);
+    assert (dprecomp_add (self, "tag longer than 15", numbers, sizeof (numbers)) == -1);
+    //  Nothing is there before save
+    assert (dprecomp_open (filename, hash) == NULL);
+    assert (dprecomp_save (self) == 0);
+    dprecomp_destroy (&self);
+
+    self = dprecomp_open (filename, hash);
+    assert (self);
+    size_t size;
+    int *section = (int *) dprecomp_section (self, "numbers", &size);
+    assert (section && size == sizeof (numbers));
+    assert ((uintptr_t) section % 64 == 0);
+    assert (section [2] == 9);
+    assert (dprecomp_section (self, "empty", &size) && size == 0);
+    assert (dprecomp_section (self, "missing", NULL) == NULL);
+    assert (dprecomp_graph (self, "numbers") == NULL);
+    assert (dprecomp_graph (self, "bad target") == NULL);
+    assert (dprecomp_graph (self, "bad offsets") == NULL);
+    assert (dprecomp_graph (self, "bad weight") == NULL);
+    graph_t *mapped = dprecomp_graph (self, "graph");
+    assert (mapped);
+    assert (graph_nodes (mapped) == 5 && graph_edges (mapped) == 2);
+    assert (graph_degree (mapped, 3) == 1);
+    assert (graph_targets (mapped, 3) [0] == 4);
+    assert (graph_weights (mapped, 0) [0] == 3);
+    //  Changes stay in memory
+    assert (graph_set_weight (mapped, 0, 1, 10) == 0);
+    graph_destroy (&mapped);
+    dprecomp_destroy (&self);
+    self = dprecomp_open (filename, hash);
+    mapped = dprecomp_graph (self, "graph");
+    assert (graph_weights (mapped, 0) [0] == 3);
+    graph_destroy (&mapped);
+    dprecomp_destroy (&self);
+
+    //  File of another graph is not used
+    assert (dprecomp_open (filename, hash + 1) == NULL);
+    //  Hash 0 accepts it anyway
+    self = dprecomp_open (filename, 0);
+    assert (self);
+    dprecomp_destroy (&self);
+    //  Unsaved file leaves the old one in place
+    self = dprecomp_new (filename, hash + 1);
+    dprecomp_add (self, "numbers", numbers, sizeof (numbers));
+    dprecomp_destroy (&self);
+    self = dprecomp_open (filename, hash);
+    assert (self);
+    dprecomp_destroy (&self);
+
+    //  Truncated file is not used
+    FILE *file = fopen (filename, "r+b");
+    assert (file);
+    int rc = ftruncate (fileno (file), 100);
+    assert (rc == 0);
+    fclose (file);
+    assert (dprecomp_open (filename, hash) == NULL);
+
+    graph_destroy (&graph);
+    matrix_destroy (&distances);
+    zsys_file_delete (filename);
+    zstr_free (&filename);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,275 @@
+/*  =========================================================================
+    dresult - Search result in struct-of-arrays layout
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dresult - Search result in struct-of-arrays layout
+@discuss
+    Unlike the vector of dnode_t returned by TASK, distances and parents
+    live in separate arrays, so scanning distances does not drag parents
+    into cache. Parents are stored as 16-bit indexes for graphs with less
+    than 65536 nodes and can be left out completely for distance-only
+    queries.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Parent index which means "no parent" in 16-bit layout
+#define DRESULT_NO_PARENT16 0xFFFF
+
+//  Structure of our class
+
+struct _dresult_t {
+    unsigned int size;
+    unsigned int parent_width;  //  0, 2 or 4 bytes
+    int *distance;
+    void *parent;
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new result
+
+dresult_t *
+dresult_new (unsigned int size, bool with_parents)
+{
+    if (!size) return NULL;
+
+    dresult_t *self = (dresult_t *) zmalloc (sizeof (dresult_t));
+    assert (self);
+    self->size = size;
+    self->distance = (int *) zmalloc (size * sizeof (int));
+    assert (self->distance);
+    if (with_parents) {
+        self->parent_width = size <= DRESULT_NO_PARENT16? sizeof (uint16_t): sizeof (int32_t);
+        self->parent = zmalloc (size * self->parent_width);
+        assert (self->parent);
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+dresult_size (dresult_t *self)
+{
+    if (!self) return 0;
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get size of one parent index in bytes
+
+size_t
+dresult_parent_width (dresult_t *self)
+{
+    if (!self) return 0;
+    return self->parent_width;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get distance of node
+
+int
+dresult_distance (dresult_t *self, unsigned int node)
+{
+    if (!self || node >= self->size) return INT_MAX;
+    return self->distance [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get parent of node
+
+int
+dresult_parent (dresult_t *self, unsigned int node)
+{
+    if (!self || node >= self->size) return -1;
+    if (self->parent_width == sizeof (uint16_t)) {
+        uint16_t parent = ((uint16_t *) self->parent) [node];
+        return parent == DRESULT_NO_PARENT16? -1: parent;
+    }
+    if (self->parent_width == sizeof (int32_t))
+        return ((int32_t *) self->parent) [node];
+    return -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set distance and parent of node
+
+void
+dresult_set (dresult_t *self, unsigned int node, int distance, int parent)
+{
+    if (!self || node >= self->size) return;
+    self->distance [node] = distance;
+    if (self->parent_width == sizeof (uint16_t))
+        ((uint16_t *) self->parent) [node] = parent < 0? DRESULT_NO_PARENT16: (uint16_t) parent;
+    else
+    if (self->parent_width == sizeof (int32_t))
+        ((int32_t *) self->parent) [node] = parent;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get the distance array
+
+int *
+dresult_distances (dresult_t *self)
+{
+    if (!self) return NULL;
+    return self->distance;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the result
+
+void
+dresult_destroy (dresult_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dresult_t *self = *self_p;
+        free (self->distance);
+        free (self->parent);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+zchunk_t *
+dresult_as_chunk (dresult_t *self)
+{
+    zchunk_t *chunk = zchunk_new (&(self->size), sizeof (unsigned int));
+    zchunk_extend (chunk, &(self->parent_width), sizeof (unsigned int));
+    zchunk_extend (chunk, self->distance, self->size * sizeof (int));
+    if (self->parent_width)
+        zchunk_extend (chunk, self->parent, self->size * self->parent_width);
+    return chunk;
+}
+
+dresult_t *
+dresult_from_chunk (zchunk_t **chunk_ptr)
+{
+    if (! chunk_ptr || ! *chunk_ptr) return NULL;
+
+    zchunk_t *chunk = *chunk_ptr;
+    unsigned int size = 0, parent_width = 0;
+    byte *data = zchunk_data (chunk);
+    size_t header = 2 * sizeof (unsigned int);
+    //  Header comes from the wire, check it covers the arrays before use
+    bool valid = zchunk_size (chunk) >= header;
+    if (valid) {
+        memcpy (&size, &data[0], sizeof (unsigned int));
+        memcpy (&parent_width, &data[sizeof (unsigned int)], sizeof (unsigned int));
+        data += header;
+        valid = (parent_width == 0 || parent_width == 2 || parent_width == 4)
+             && (zchunk_size (chunk) - header) / (sizeof (int) + parent_width) >= size;
+    }
+    dresult_t *result = valid ? dresult_new (size, parent_width != 0) : NULL;
+    if (result && result->parent_width == parent_width) {
+        memcpy (result->distance, data, size * sizeof (int));
+        if (parent_width)
+            memcpy (result->parent, &data[size * sizeof (int)], size * parent_width);
+    }
+    else
+        dresult_destroy (&result);
+    zchunk_destroy (chunk_ptr);
+    return result;
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dresult_test (bool verbose)
+{
+    printf (" * dresult: ");
+
+    //  @selftest
+    //  Small graphs use 16-bit parents
+    dresult_t *self = dresult_new (5, true);
+    assert (self);
+    assert (dresult_size (self) == 5);
+    assert (dresult_parent_width (self) == sizeof (uint16_t));
+    dresult_set (self, 0, 0, -1);
+    dresult_set (self, 3, 7, 0);
+    assert (dresult_distance (self, 3) == 7);
+    assert (dresult_parent (self, 3) == 0);
+    assert (dresult_parent (self, 0) == -1);
+    assert (dresult_distances (self) [3] == 7);
+
+    zchunk_t *chunk = dresult_as_chunk (self);
+    assert (zchunk_size (chunk) == 2 * sizeof (unsigned int) + 5 * (sizeof (int) + sizeof (uint16_t)));
+    dresult_t *copy = dresult_from_chunk (&chunk);
+    assert (copy);
+    for (int i = 0; i < dresult_size (self); i++) {
+        assert (dresult_distance (copy, i) == dresult_distance (self, i));
+        assert (dresult_parent (copy, i) == dresult_parent (self, i));
+    }
+    dresult_destroy (&copy);
+    dresult_destroy (&self);
+
+    //  Large graphs fall back to 32-bit parents
+    self = dresult_new (70000, true);
+    assert (dresult_parent_width (self) == sizeof (int32_t));
+    dresult_set (self, 69999, 1, 65535);
+    assert (dresult_parent (self, 69999) == 65535);
+    dresult_destroy (&self);
+
+    //  Distance-only results carry no parents at all
+    self = dresult_new (5, false);
+    assert (dresult_parent_width (self) == 0);
+    dresult_set (self, 1, 2, 0);
+    assert (dresult_parent (self, 1) == -1);
+    chunk = dresult_as_chunk (self);
+    assert (zchunk_size (chunk) == 2 * sizeof (unsigned int) + 5 * sizeof (int));
+    copy = dresult_from_chunk (&chunk);
+    assert (dresult_distance (copy, 1) == 2);
+    dresult_destroy (&copy);
+
+    //  Truncated chunks and bad parent widths are rejected
+    zchunk_t *whole = dresult_as_chunk (self);
+    chunk = zchunk_new (zchunk_data (whole), zchunk_size (whole) - 1);
+    zchunk_destroy (&whole);
+    assert (dresult_from_chunk (&chunk) == NULL);
+    assert (chunk == NULL);
+    chunk = zchunk_new ("\x05", 1);
+    assert (dresult_from_chunk (&chunk) == NULL);
+    unsigned int header [2] = { 5, 3 };
+    chunk = zchunk_new (header, sizeof (header));
+    zchunk_extend (chunk, dresult_distances (self), 5 * sizeof (int));
+    assert (dresult_from_chunk (&chunk) == NULL);
+    dresult_destroy (&self);
+    //  @end
+    printf ("OK\n");
+}
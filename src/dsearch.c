@@ -0,0 +1,587 @@
+/*  =========================================================================
+    dsearch - Shortest path search over sparse graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dsearch - Shortest path search over sparse graph
+@discuss
+    Dijkstra method with a binary heap over graph_t adjacency. Distance and
+    parent arrays are allocated once per search object; nodes touched by a
+    run are remembered, so the next run only resets those.
+
+    Search over compressed adjacency (see cgraph) decodes edges of every
+    settled node into a small buffer, which stays in cache, and relaxes
+    them from there.
+
+    Graphs with small integer weights can use a bucket queue instead of
+    the heap (Dial's method). Nodes wait in a ring of max_weight + 1
+    doubly linked lists indexed by distance, so moving a node closer and
+    taking the nearest one are O(1), and the cursor walks each distance
+    once. Graphs whose edges all weigh the same need no queue at all:
+    breadth-first search settles nodes in the order they are reached,
+    which is the order of the touched list.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _dsearch_t {
+    graph_t *graph;             //  Graph we search, not owned
+    cgraph_t *packed;           //  Or compressed graph, not owned
+    int nodes;
+    int *edge_targets;          //  Decoded edges of compressed graph
+    int *edge_weights;
+    int *distance;              //  Distance of every node
+    int *parent;                //  Parent of every node
+    int *touched;               //  Nodes with distance set by last run
+    int touched_count;
+    int settled;                //  Nodes settled by last run
+    int *settled_nodes;         //  Nodes in the order they were settled
+    dheap_t *heap;
+    int queue;                  //  DSEARCH_HEAP, DSEARCH_BUCKETS or DSEARCH_BFS
+    int *bucket;                //  First node of every bucket, -1 if empty
+    int buckets;                //  Size of the bucket ring
+    int *bucket_next;           //  Links of nodes within their bucket
+    int *bucket_prev;
+};
+
+
+//  Allocate search state for nodes
+
+static dsearch_t *
+s_dsearch_alloc (int nodes)
+{
+    dsearch_t *self = (dsearch_t *) zmalloc (sizeof (dsearch_t));
+    assert (self);
+    self->nodes = nodes;
+    self->distance = (int *) malloc (nodes * sizeof (int));
+    self->parent = (int *) malloc (nodes * sizeof (int));
+    self->touched = (int *) malloc (nodes * sizeof (int));
+    self->settled_nodes = (int *) malloc (nodes * sizeof (int));
+    assert (self->distance && self->parent && self->touched && self->settled_nodes);
+    for (int i = 0; i < nodes; i++) {
+        self->distance [i] = INT_MAX;
+        self->parent [i] = -1;
+    }
+    self->heap = dheap_new (64);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new search
+
+dsearch_t *
+dsearch_new (graph_t *graph)
+{
+    if (!graph) return NULL;
+
+    dsearch_t *self = s_dsearch_alloc (graph_nodes (graph));
+    self->graph = graph;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new search over compressed graph
+
+dsearch_t *
+dsearch_new_compressed (cgraph_t *graph)
+{
+    if (!graph) return NULL;
+
+    dsearch_t *self = s_dsearch_alloc (cgraph_nodes (graph));
+    self->packed = graph;
+    int max_degree = cgraph_max_degree (graph);
+    self->edge_targets = (int *) malloc ((max_degree + 1) * sizeof (int));
+    self->edge_weights = (int *) malloc ((max_degree + 1) * sizeof (int));
+    assert (self->edge_targets && self->edge_weights);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set queue of next runs
+
+int
+dsearch_set_queue (dsearch_t *self, int queue, int max_weight)
+{
+    assert (self);
+    if (queue != DSEARCH_HEAP && queue != DSEARCH_BUCKETS && queue != DSEARCH_BFS)
+        return -1;
+    if (queue == DSEARCH_BUCKETS) {
+        if (max_weight < 1)
+            return -1;
+        if (!self->bucket_next) {
+            self->bucket_next = (int *) malloc ((self->nodes + 1) * sizeof (int));
+            self->bucket_prev = (int *) malloc ((self->nodes + 1) * sizeof (int));
+            assert (self->bucket_next && self->bucket_prev);
+        }
+        //  Ring only grows, it is empty between runs
+        if (max_weight >= self->buckets) {
+            free (self->bucket);
+            self->buckets = max_weight + 1;
+            self->bucket = (int *) malloc (self->buckets * sizeof (int));
+            assert (self->bucket);
+            for (int i = 0; i < self->buckets; i++)
+                self->bucket [i] = -1;
+        }
+    }
+    self->queue = queue;
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get queue of the search
+
+int
+dsearch_queue (dsearch_t *self)
+{
+    assert (self);
+    return self->queue;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Forget result of the last run
+
+static void
+s_dsearch_reset (dsearch_t *self)
+{
+    for (int i = 0; i < self->touched_count; i++) {
+        self->distance [self->touched [i]] = INT_MAX;
+        self->parent [self->touched [i]] = -1;
+    }
+    self->touched_count = 0;
+    self->settled = 0;
+    dheap_clear (self->heap);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Search shortest paths from node
+
+void
+dsearch_run (dsearch_t *self, int from)
+{
+    dsearch_run_to (self, from, -1);
+}
+
+
+//  Get edges going out of node, decoded if the graph is compressed
+
+static inline int
+s_dsearch_edges (dsearch_t *self, int node, const int **targets_p, const int **weights_p)
+{
+    if (self->packed) {
+        *targets_p = self->edge_targets;
+        *weights_p = self->edge_weights;
+        return cgraph_decode (self->packed, node, self->edge_targets, self->edge_weights);
+    }
+    *targets_p = graph_targets (self->graph, node);
+    *weights_p = graph_weights (self->graph, node);
+    return graph_degree (self->graph, node);
+}
+
+//  Search over binary heap
+
+static void
+s_dsearch_run_heap (dsearch_t *self, int from, int to, int limit)
+{
+    dheap_push (self->heap, from, 0);
+    int node, key;
+    while (dheap_pop (self->heap, &node, &key)) {
+        if (key != self->distance [node])
+            continue;           //  Stale entry, node was reached cheaper
+        if (key > limit)
+            break;
+        self->settled_nodes [self->settled++] = node;
+        if (node == to)
+            break;
+        const int *targets, *weights;
+        int degree = s_dsearch_edges (self, node, &targets, &weights);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            //  Compare without summing, so INT_MAX never overflows
+            if (weights [i] < self->distance [v] - key) {
+                if (self->distance [v] == INT_MAX)
+                    self->touched [self->touched_count++] = v;
+                self->distance [v] = key + weights [i];
+                self->parent [v] = node;
+                dheap_push (self->heap, v, self->distance [v]);
+            }
+        }
+    }
+}
+
+//  Unlink node from its bucket
+
+static inline void
+s_bucket_remove (dsearch_t *self, int node)
+{
+    int next = self->bucket_next [node];
+    int prev = self->bucket_prev [node];
+    if (prev == -1)
+        self->bucket [self->distance [node] % self->buckets] = next;
+    else
+        self->bucket_next [prev] = next;
+    if (next != -1)
+        self->bucket_prev [next] = prev;
+}
+
+//  Link node into bucket of its distance
+
+static inline void
+s_bucket_insert (dsearch_t *self, int node)
+{
+    int *head = &self->bucket [self->distance [node] % self->buckets];
+    self->bucket_prev [node] = -1;
+    self->bucket_next [node] = *head;
+    if (*head != -1)
+        self->bucket_prev [*head] = node;
+    *head = node;
+}
+
+//  Search over bucket queue. Nodes waiting in the ring are never farther
+//  than max_weight from the cursor, so no two distances share a bucket.
+
+static void
+s_dsearch_run_buckets (dsearch_t *self, int from, int to, int limit)
+{
+    s_bucket_insert (self, from);
+    int waiting = 1;
+    int key = 0;
+    while (waiting > 0) {
+        int node = self->bucket [key % self->buckets];
+        if (node == -1) {
+            key++;
+            continue;
+        }
+        if (key > limit)
+            break;
+        s_bucket_remove (self, node);
+        waiting--;
+        self->settled_nodes [self->settled++] = node;
+        if (node == to)
+            break;
+        const int *targets, *weights;
+        int degree = s_dsearch_edges (self, node, &targets, &weights);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            if (weights [i] < self->distance [v] - key) {
+                if (self->distance [v] == INT_MAX) {
+                    self->touched [self->touched_count++] = v;
+                    waiting++;
+                }
+                else
+                    s_bucket_remove (self, v);
+                self->distance [v] = key + weights [i];
+                self->parent [v] = node;
+                s_bucket_insert (self, v);
+            }
+        }
+    }
+    //  Empty the ring for the next run
+    while (waiting > 0) {
+        int node = self->bucket [key++ % self->buckets];
+        while (node != -1) {
+            self->bucket [self->distance [node] % self->buckets] = -1;
+            waiting--;
+            node = self->bucket_next [node];
+        }
+    }
+}
+
+//  Search in breadth-first order. Nodes are settled in the order they are
+//  touched, so the touched list is the queue.
+
+static void
+s_dsearch_run_bfs (dsearch_t *self, int to, int limit)
+{
+    for (int head = 0; head < self->touched_count; head++) {
+        int node = self->touched [head];
+        int key = self->distance [node];
+        if (key > limit)
+            break;
+        self->settled_nodes [self->settled++] = node;
+        if (node == to)
+            break;
+        const int *targets, *weights;
+        int degree = s_dsearch_edges (self, node, &targets, &weights);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            if (self->distance [v] == INT_MAX) {
+                self->touched [self->touched_count++] = v;
+                self->distance [v] = key + weights [i];
+                self->parent [v] = node;
+            }
+        }
+    }
+}
+
+//  Search from node until node 'to' is settled, unless it is -1, or next
+//  node is farther than limit
+
+static void
+s_dsearch_run (dsearch_t *self, int from, int to, int limit)
+{
+    s_dsearch_reset (self);
+    if (from < 0 || from >= self->nodes)
+        return;
+
+    self->distance [from] = 0;
+    self->touched [self->touched_count++] = from;
+    if (self->queue == DSEARCH_BUCKETS)
+        s_dsearch_run_buckets (self, from, to, limit);
+    else
+    if (self->queue == DSEARCH_BFS)
+        s_dsearch_run_bfs (self, to, limit);
+    else
+        s_dsearch_run_heap (self, from, to, limit);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Search shortest path from node to node
+
+void
+dsearch_run_to (dsearch_t *self, int from, int to)
+{
+    assert (self);
+    s_dsearch_run (self, from, to, INT_MAX);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Search shortest paths from node to nodes within limit
+
+void
+dsearch_run_within (dsearch_t *self, int from, int limit)
+{
+    assert (self);
+    s_dsearch_run (self, from, -1, limit);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get distance of node
+
+int
+dsearch_distance (dsearch_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return INT_MAX;
+    return self->distance [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get parent of node
+
+int
+dsearch_parent (dsearch_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return -1;
+    return self->parent [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes settled by the last run
+
+int
+dsearch_settled (dsearch_t *self)
+{
+    if (!self) return 0;
+    return self->settled;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get node settled by the last run, in order of settling
+
+int
+dsearch_settled_node (dsearch_t *self, int index)
+{
+    if (!self || index < 0 || index >= self->settled) return -1;
+    return self->settled_nodes [index];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the search
+
+void
+dsearch_destroy (dsearch_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dsearch_t *self = *self_p;
+        dheap_destroy (&self->heap);
+        free (self->distance);
+        free (self->parent);
+        free (self->touched);
+        free (self->settled_nodes);
+        free (self->edge_targets);
+        free (self->edge_weights);
+        free (self->bucket);
+        free (self->bucket_next);
+        free (self->bucket_prev);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dsearch_test (bool verbose)
+{
+    printf (" * dsearch: ");
+
+    //  @selftest
+    //  0 -1- 1 -1- 2 -1- 3, with a long shortcut 0 -5- 3 and isolated 4
+    int from [] = { 0, 1, 1, 2, 2, 3, 0, 3 };
+    int to [] = { 1, 0, 2, 1, 3, 2, 3, 0 };
+    int weight [] = { 1, 1, 1, 1, 1, 1, 5, 5 };
+    graph_t *graph = graph_new_from_edges (5, 8, from, to, weight);
+    dsearch_t *self = dsearch_new (graph);
+    assert (self);
+    dsearch_run (self, 0);
+    assert (dsearch_distance (self, 3) == 3);
+    assert (dsearch_parent (self, 3) == 2);
+    assert (dsearch_parent (self, 0) == -1);
+    assert (dsearch_distance (self, 4) == INT_MAX);
+    assert (dsearch_settled (self) == 4);
+
+    //  Next run starts from clean state
+    dsearch_run (self, 3);
+    assert (dsearch_distance (self, 3) == 0);
+    assert (dsearch_distance (self, 0) == 3);
+    assert (dsearch_parent (self, 0) == 1);
+    dsearch_run_to (self, 0, 1);
+    assert (dsearch_distance (self, 1) == 1);
+    assert (dsearch_settled (self) == 2);
+    //  Radius search settles nodes within limit only, nearest first
+    dsearch_run_within (self, 0, 2);
+    assert (dsearch_settled (self) == 3);
+    assert (dsearch_settled_node (self, 0) == 0);
+    assert (dsearch_settled_node (self, 2) == 2);
+    assert (dsearch_settled_node (self, 3) == -1);
+    assert (dsearch_distance (self, 2) == 2);
+    assert (dsearch_parent (self, 2) == 1);
+    dsearch_run_within (self, 0, 0);
+    assert (dsearch_settled (self) == 1);
+    dsearch_run (self, 4);
+    assert (dsearch_settled (self) == 1);
+    assert (dsearch_distance (self, 0) == INT_MAX);
+    assert (dsearch_parent (self, 1) == -1);
+
+    //  Bucket queue needs room for the largest weight
+    assert (dsearch_queue (self) == DSEARCH_HEAP);
+    assert (dsearch_set_queue (self, 7, 0) == -1);
+    assert (dsearch_set_queue (self, DSEARCH_BUCKETS, 0) == -1);
+    assert (dsearch_set_queue (self, DSEARCH_BUCKETS, 5) == 0);
+    assert (dsearch_queue (self) == DSEARCH_BUCKETS);
+    dsearch_run (self, 3);
+    assert (dsearch_distance (self, 0) == 3);
+    assert (dsearch_parent (self, 0) == 1);
+    dsearch_run_to (self, 0, 1);
+    assert (dsearch_settled (self) == 2);
+    dsearch_run_within (self, 0, 2);
+    assert (dsearch_settled (self) == 3);
+    assert (dsearch_settled_node (self, 2) == 2);
+    dsearch_run (self, 0);
+    assert (dsearch_distance (self, 3) == 3);
+    assert (dsearch_settled (self) == 4);
+    dsearch_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Every queue finds the same distances over random graph, BFS over
+    //  the same graph with unit weights
+    const int nodes = 300;
+    const int edges = 1500;
+    int *edge_from = (int *) malloc (edges * sizeof (int));
+    int *edge_to = (int *) malloc (edges * sizeof (int));
+    int *edge_weight = (int *) malloc (edges * sizeof (int));
+    int *unit = (int *) malloc (edges * sizeof (int));
+    assert (edge_from && edge_to && edge_weight && unit);
+    unsigned int seed = 11;
+    for (int i = 0; i < edges; i++) {
+        seed = seed * 1103515245 + 12345;
+        edge_from [i] = (seed >> 8) % nodes;
+        seed = seed * 1103515245 + 12345;
+        edge_to [i] = (seed >> 8) % nodes;
+        edge_weight [i] = 1 + (seed >> 16) % 30;
+        unit [i] = 3;
+    }
+    graph = graph_new_from_edges (nodes, edges, edge_from, edge_to, edge_weight);
+    graph_t *unit_graph = graph_new_from_edges (nodes, edges, edge_from, edge_to, unit);
+    dsearch_t *heap = dsearch_new (graph);
+    dsearch_t *buckets = dsearch_new (graph);
+    dsearch_t *unit_heap = dsearch_new (unit_graph);
+    dsearch_t *bfs = dsearch_new (unit_graph);
+    dsearch_set_queue (buckets, DSEARCH_BUCKETS, 30);
+    dsearch_set_queue (bfs, DSEARCH_BFS, 0);
+    for (int from = 0; from < nodes; from += 7) {
+        dsearch_run (heap, from);
+        dsearch_run (buckets, from);
+        dsearch_run (unit_heap, from);
+        dsearch_run (bfs, from);
+        assert (dsearch_settled (heap) == dsearch_settled (buckets));
+        assert (dsearch_settled (unit_heap) == dsearch_settled (bfs));
+        for (int v = 0; v < nodes; v++) {
+            assert (dsearch_distance (heap, v) == dsearch_distance (buckets, v));
+            assert (dsearch_distance (unit_heap, v) == dsearch_distance (bfs, v));
+            int p = dsearch_parent (buckets, v);
+            if (p >= 0)
+                assert (dsearch_distance (buckets, p) < dsearch_distance (buckets, v));
+        }
+        //  Settled in order of distance
+        for (int i = 1; i < dsearch_settled (bfs); i++)
+            assert (dsearch_distance (bfs, dsearch_settled_node (bfs, i - 1))
+                 <= dsearch_distance (bfs, dsearch_settled_node (bfs, i)));
+        //  Early stop leaves the ring empty for the next run
+        dsearch_run_within (buckets, from, 20);
+        dsearch_run_within (heap, from, 20);
+        assert (dsearch_settled (heap) == dsearch_settled (buckets));
+    }
+    dsearch_destroy (&heap);
+    dsearch_destroy (&buckets);
+    dsearch_destroy (&unit_heap);
+    dsearch_destroy (&bfs);
+    graph_destroy (&graph);
+    graph_destroy (&unit_graph);
+    free (edge_from);
+    free (edge_to);
+    free (edge_weight);
+    free (unit);
+    //  @end
+    printf ("OK\n");
+}
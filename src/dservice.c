@@ -0,0 +1,556 @@
+/*  =========================================================================
+    dservice - Shortest path query service
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dservice - Shortest path query service
+@discuss
+    Clients connect to a ROUTER frontend bound on ipc:// or tcp://. The
+    actor is a load balancing broker: each request goes to an idle worker
+    over an inproc ROUTER backend and the reply comes back with the client
+    envelope. Workers are dijkstra actors in WORKER mode, so every worker
+    searches in its own thread with its own search state. While all
+    workers are busy, the frontend is not polled and requests wait in the
+    socket queues.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DSERVICE_WORKERS 4
+
+//  Structure of our actor
+
+struct _dservice_t {
+    zsock_t *pipe;              //  Actor command pipe
+    zpoller_t *poller;          //  Socket poller
+    bool terminated;            //  Did caller ask us to quit?
+    bool verbose;               //  Verbose logging enabled?
+
+    matrix_t *distances;        //  Graph we serve, not owned
+    dversion_t *store;          //  Versions we serve instead, not owned
+    zsock_t *frontend;          //  Requests from clients
+    zsock_t *backend;           //  Requests to workers
+    char *backend_endpoint;
+    bool polling_frontend;      //  Is frontend in poller?
+    int workers_size;           //  Number of workers to start
+    zactor_t **workers;         //  Started workers, NULL if stopped
+    zlist_t *idle;              //  Identities of idle workers
+    uint64_t answered;          //  Number of replies sent to clients
+};
+
+
+//  Services created so far, numbers their backend endpoints
+static uint32_t s_instances = 0;
+
+
+//  --------------------------------------------------------------------------
+//  Create a new dservice instance
+
+static dservice_t *
+dservice_new (zsock_t *pipe, void *args)
+{
+    dservice_t *self = (dservice_t *) zmalloc (sizeof (dservice_t));
+    assert (self);
+
+    self->pipe = pipe;
+    self->terminated = false;
+    self->distances = (matrix_t *) args;
+    self->workers_size = DSERVICE_WORKERS;
+    self->frontend = zsock_new (ZMQ_ROUTER);
+    //  Endpoint of a destroyed service is released by libzmq later, so
+    //  names are never reused, as addresses of our objects would be
+    uint32_t instance = __atomic_add_fetch (&s_instances, 1, __ATOMIC_RELAXED);
+    self->backend_endpoint = zsys_sprintf ("inproc://dservice-%u", instance);
+    self->backend = zsock_new_router (self->backend_endpoint);
+    assert (self->frontend && self->backend);
+    self->idle = zlist_new ();
+    self->poller = zpoller_new (self->pipe, self->backend, NULL);
+    return self;
+}
+
+
+//  Forget idle workers
+
+static void
+dservice_idle_purge (dservice_t *self)
+{
+    zframe_t *identity = (zframe_t *) zlist_pop (self->idle);
+    while (identity) {
+        zframe_destroy (&identity);
+        identity = (zframe_t *) zlist_pop (self->idle);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the dservice instance
+
+static void
+dservice_destroy (dservice_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dservice_t *self = *self_p;
+        if (self->workers) {
+            for (int i = 0; i < self->workers_size; i++)
+                zactor_destroy (&self->workers [i]);
+            free (self->workers);
+        }
+        dservice_idle_purge (self);
+        zlist_destroy (&self->idle);
+        //  Free object itself
+        zpoller_destroy (&self->poller);
+        zsock_destroy (&self->frontend);
+        zsock_destroy (&self->backend);
+        zstr_free (&self->backend_endpoint);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  Poll frontend only while some worker is idle
+
+static void
+dservice_update_poller (dservice_t *self)
+{
+    bool poll = zlist_size (self->idle) > 0;
+    if (poll && !self->polling_frontend)
+        zpoller_add (self->poller, self->frontend);
+    else
+    if (!poll && self->polling_frontend)
+        zpoller_remove (self->poller, self->frontend);
+    self->polling_frontend = poll;
+}
+
+
+//  Start this actor. Return a value greater or equal to zero if initialization
+//  was successful. Otherwise -1.
+
+static int
+dservice_start (dservice_t *self, const char *path)
+{
+    assert (self);
+    if (self->workers)
+        return 0;
+    if (!self->distances && !self->store) {
+        zsys_error ("dservice: no graph to serve");
+        return -1;
+    }
+    self->workers = (zactor_t **) zmalloc (self->workers_size * sizeof (zactor_t *));
+    assert (self->workers);
+    for (int i = 0; i < self->workers_size; i++) {
+        self->workers [i] = zactor_new (dijkstra_actor, self->distances);
+        assert (self->workers [i]);
+        if (self->verbose)
+            zstr_send (self->workers [i], "VERBOSE");
+        if (self->store) {
+            zmsg_t *msg = zmsg_new ();
+            zmsg_addstr (msg, "STORE");
+            zmsg_addptr (msg, self->store);
+            zmsg_send (&msg, self->workers [i]);
+        }
+        zstr_sendx (self->workers [i], "START", path ? path : "", NULL);
+        zstr_sendx (self->workers [i], "WORKER", self->backend_endpoint, NULL);
+    }
+    if (self->verbose)
+        zsys_info ("dservice: started %d workers", self->workers_size);
+    return 0;
+}
+
+
+//  Stop this actor. Return a value greater or equal to zero if stopping
+//  was successful. Otherwise -1.
+
+static int
+dservice_stop (dservice_t *self)
+{
+    assert (self);
+    if (!self->workers)
+        return 0;
+    for (int i = 0; i < self->workers_size; i++)
+        zactor_destroy (&self->workers [i]);
+    free (self->workers);
+    self->workers = NULL;
+    dservice_idle_purge (self);
+    dservice_update_poller (self);
+    return 0;
+}
+
+
+//  Here we handle incoming message from the node
+
+static void
+dservice_recv_api (dservice_t *self)
+{
+    //  Get the whole message of the pipe in one go
+    zmsg_t *request = zmsg_recv (self->pipe);
+    if (!request)
+       return;        //  Interrupted
+
+    char *command = zmsg_popstr (request);
+    if (streq (command, "START")) {
+        char *path = zmsg_popstr (request);
+        dservice_start (self, path);
+        zstr_free (&path);
+    }
+    else
+    if (streq (command, "STOP"))
+        dservice_stop (self);
+    else
+    if (streq (command, "VERBOSE"))
+        self->verbose = true;
+    else
+    if (streq (command, "WORKERS")) {
+        char *size = zmsg_popstr (request);
+        if (self->workers)
+            zsys_error ("dservice: WORKERS must be sent before START");
+        else
+        if (size && atoi (size) > 0)
+            self->workers_size = atoi (size);
+        zstr_free (&size);
+    }
+    else
+    if (streq (command, "STORE")) {
+        if (self->workers)
+            zsys_error ("dservice: STORE must be sent before START");
+        else
+            self->store = (dversion_t *) zmsg_popptr (request);
+    }
+    else
+    if (streq (command, "EDGE")) {
+        char *from = zmsg_popstr (request);
+        char *to = zmsg_popstr (request);
+        char *weight = zmsg_popstr (request);
+        int from_node = from ? atoi (from) : -1;
+        int to_node = to ? atoi (to) : -1;
+        //  Workers pick the new version up with their next request
+        if (!self->store || from_node < 0 || to_node < 0 || !weight || atoi (weight) <= 0)
+            zsys_error ("dservice: cannot add edge %s -> %s", from ? from : "", to ? to : "");
+        else {
+            dversion_set_int (self->store, to_node, from_node, atoi (weight));
+            dversion_publish (self->store);
+        }
+        zstr_free (&from);
+        zstr_free (&to);
+        zstr_free (&weight);
+    }
+    else
+    if (streq (command, "BIND")) {
+        char *endpoint = zmsg_popstr (request);
+        int rc = endpoint ? zsock_bind (self->frontend, "%s", endpoint) : -1;
+        if (rc == -1)
+            zsys_error ("dservice: cannot bind to '%s'", endpoint ? endpoint : "");
+        else
+        if (self->verbose)
+            zsys_info ("dservice: serving at %s", endpoint);
+        zstr_sendf (self->pipe, "%d", rc);
+        zstr_free (&endpoint);
+    }
+    else
+    if (streq (command, "STATS"))
+        zstr_sendf (self->pipe, "%" PRIu64, self->answered);
+    else
+    if (streq (command, "TRACE")) {
+        char *path = zmsg_popstr (request);
+        int events = path ? dtrace_dump (path) : -1;
+        if (events == -1)
+            zsys_error ("dservice: cannot write trace to '%s'", path ? path : "");
+        zstr_sendf (self->pipe, "%d", events);
+        zstr_free (&path);
+    }
+    else
+    if (streq (command, "$TERM"))
+        //  The $TERM command is send by zactor_destroy() method
+        self->terminated = true;
+    else {
+        zsys_error ("invalid command '%s'", command);
+        assert (false);
+    }
+    zstr_free (&command);
+    zmsg_destroy (&request);
+}
+
+
+//  Request from client goes to the least recently used idle worker
+
+static void
+dservice_recv_frontend (dservice_t *self)
+{
+    zmsg_t *request = zmsg_recv (self->frontend);
+    if (!request)
+        return;         //  Interrupted
+    zframe_t *worker = (zframe_t *) zlist_pop (self->idle);
+    assert (worker);
+    zmsg_prepend (request, &worker);
+    zmsg_send (&request, self->backend);
+    dservice_update_poller (self);
+}
+
+
+//  Worker is ready for next request, its message is either READY or the
+//  reply to pass back to the client
+
+static void
+dservice_recv_backend (dservice_t *self)
+{
+    zmsg_t *reply = zmsg_recv (self->backend);
+    if (!reply)
+        return;         //  Interrupted
+    zframe_t *worker = zmsg_pop (reply);
+    if (self->workers)
+        zlist_append (self->idle, worker);
+    else
+        zframe_destroy (&worker);
+
+    zframe_t *first = zmsg_first (reply);
+    if (zmsg_size (reply) == 1 && zframe_streq (first, "READY"))
+        zmsg_destroy (&reply);
+    else {
+        zmsg_send (&reply, self->frontend);
+        self->answered++;
+    }
+    dservice_update_poller (self);
+}
+
+
+//  --------------------------------------------------------------------------
+//  This is the actor which runs in its own thread.
+
+void
+dservice_actor (zsock_t *pipe, void *args)
+{
+    dservice_t * self = dservice_new (pipe, args);
+    if (!self)
+        return;          //  Interrupted
+
+    //  Signal actor successfully initiated
+    zsock_signal (self->pipe, 0);
+
+    while (!self->terminated) {
+        zsock_t *which = (zsock_t *) zpoller_wait (self->poller, -1);
+        if (which == self->pipe)
+            dservice_recv_api (self);
+        else
+        if (which == self->backend)
+            dservice_recv_backend (self);
+        else
+        if (which && which == self->frontend)
+            dservice_recv_frontend (self);
+        else
+        if (zpoller_terminated (self->poller))
+            break;
+    }
+    dservice_destroy (&self);
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this actor.
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Receive reply to DIST request and return distance of node
+static int
+s_distance_of (zmsg_t *reply, int node)
+{
+    char *status = zmsg_popstr (reply);
+    assert (status && streq (status, "DONE"));
+    zstr_free (&status);
+    zframe_t *frame = zmsg_pop (reply);
+    zchunk_t *chunk = zchunk_unpack (frame);
+    zframe_destroy (&frame);
+    dresult_t *result = dresult_from_chunk (&chunk);
+    assert (result);
+    int distance = dresult_distance (result, node);
+    dresult_destroy (&result);
+    return distance;
+}
+
+void
+dservice_test (bool verbose)
+{
+    printf (" * dservice: ");
+    //  @selftest
+    //  Simple create/destroy test
+    {
+        zactor_t *dservice = zactor_new (dservice_actor, NULL);
+        assert (dservice);
+        zactor_destroy (&dservice);
+    }
+    //  Many clients at once
+    {
+        //  Distance between x and y is max (x, y)
+        matrix_t *d = matrix_new (4, 4, sizeof (int));
+        for (int x = 1; x < 4; x++) {
+            for (int y = 0; y < x; y++) {
+                matrix_set_int (d, x, y, x);
+                matrix_set_int (d, y, x, x);
+            }
+        }
+        zactor_t *dservice = zactor_new (dservice_actor, d);
+        assert (dservice);
+        if (verbose)
+            zstr_send (dservice, "VERBOSE");
+        zstr_sendx (dservice, "WORKERS", "3", NULL);
+        zstr_sendx (dservice, "BIND", "tcp://127.0.0.1:*", NULL);
+        char *port = zstr_recv (dservice);
+        assert (port && atoi (port) > 0);
+        zstr_sendx (dservice, "START", NULL);
+
+        //  Synchronous clients, all requests are in flight together
+        const int clients = 5;
+        zsock_t *client [5];
+        for (int i = 0; i < clients; i++) {
+            client [i] = zsock_new_req (NULL);
+            assert (client [i]);
+            zsock_connect (client [i], "tcp://127.0.0.1:%s", port);
+        }
+        for (int i = 0; i < clients; i++) {
+            char from [16];
+            snprintf (from, sizeof (from), "%d", i % 4);
+            zstr_sendx (client [i], "TASK", from, "DIST", NULL);
+        }
+        for (int i = 0; i < clients; i++) {
+            zmsg_t *reply = zmsg_recv (client [i]);
+            assert (reply);
+            //  Node 3 is the farthest from everyone else
+            assert (s_distance_of (reply, 3) == (i % 4 == 3 ? 0 : 3));
+            zmsg_destroy (&reply);
+        }
+        for (int i = 0; i < clients; i++)
+            zsock_destroy (&client [i]);
+
+        //  Asynchronous client pipelines requests with empty delimiter
+        zsock_t *dealer = zsock_new_dealer (NULL);
+        zsock_connect (dealer, "tcp://127.0.0.1:%s", port);
+        for (int i = 0; i < 20; i++)
+            zstr_sendx (dealer, "", "TASK", "0", "DIST", NULL);
+        for (int i = 0; i < 20; i++) {
+            zmsg_t *reply = zmsg_recv (dealer);
+            zframe_t *empty = zmsg_pop (reply);
+            assert (zframe_size (empty) == 0);
+            zframe_destroy (&empty);
+            assert (s_distance_of (reply, 2) == 2);
+            zmsg_destroy (&reply);
+        }
+
+        //  Bad requests get error replies
+        zstr_sendx (dealer, "", "TASK", "9", NULL);
+        zstr_sendx (dealer, "", "HELLO", NULL);
+        for (int i = 0; i < 2; i++) {
+            char *empty, *status, *reason;
+            zstr_recvx (dealer, &empty, &status, &reason, NULL);
+            assert (streq (status, "ERROR"));
+            zstr_free (&empty);
+            zstr_free (&status);
+            zstr_free (&reason);
+        }
+
+        //  Phases of a query are traced in the worker
+        dtrace_clear ();
+        dtrace_enable (true);
+        zstr_sendx (dealer, "", "TASK", "0", "DIST", NULL);
+        zmsg_t *traced = zmsg_recv (dealer);
+        zmsg_destroy (&traced);
+        dtrace_enable (false);
+        char *trace = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dservice-trace.json");
+        zsys_dir_create (SELFTEST_DIR_RW);
+        zstr_sendx (dservice, "TRACE", trace, NULL);
+        char *events = zstr_recv (dservice);
+        //  Request, search, dresult_as_chunk, zchunk_pack and send spans
+        assert (atoi (events) >= 10);
+        zstr_free (&events);
+        zchunk_t *json = zchunk_slurp (trace, 0);
+        assert (json);
+        zchunk_extend (json, "", 1);
+        assert (strstr ((char *) zchunk_data (json), "\"name\":\"zchunk_pack\""));
+        zchunk_destroy (&json);
+        zsys_file_delete (trace);
+        zstr_free (&trace);
+        dtrace_clear ();
+        zsock_destroy (&dealer);
+
+        zstr_sendx (dservice, "STATS", NULL);
+        char *answered = zstr_recv (dservice);
+        assert (atoi (answered) == clients + 23);
+        zstr_free (&answered);
+        zstr_free (&port);
+
+        zstr_sendx (dservice, "STOP", NULL);
+        zactor_destroy (&dservice);
+        matrix_destroy (&d);
+    }
+    //  Service over published versions, updated while serving
+    {
+        matrix_t *d = matrix_new (4, 4, sizeof (int));
+        for (int x = 1; x < 4; x++) {
+            for (int y = 0; y < x; y++) {
+                matrix_set_int (d, x, y, x);
+                matrix_set_int (d, y, x, x);
+            }
+        }
+        dversion_t *store = dversion_new (d, 0);
+        matrix_destroy (&d);
+        zactor_t *dservice = zactor_new (dservice_actor, NULL);
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "STORE");
+        zmsg_addptr (msg, store);
+        zmsg_send (&msg, dservice);
+        zstr_sendx (dservice, "WORKERS", "2", NULL);
+        zstr_sendx (dservice, "BIND", "inproc://dservice-test-store", NULL);
+        char *rc = zstr_recv (dservice);
+        assert (streq (rc, "0"));
+        zstr_free (&rc);
+        zstr_sendx (dservice, "START", NULL);
+
+        zsock_t *client = zsock_new_req ("inproc://dservice-test-store");
+        assert (client);
+        for (int i = 0; i < 2; i++) {
+            zstr_sendx (client, "TASK", "0", "DIST", NULL);
+            zmsg_t *reply = zmsg_recv (client);
+            assert (s_distance_of (reply, 3) == 3);
+            zmsg_destroy (&reply);
+        }
+        zstr_sendx (dservice, "EDGE", "0", "3", "1", NULL);
+        //  Any reply means EDGE is published already
+        zstr_sendx (dservice, "STATS", NULL);
+        char *answered = zstr_recv (dservice);
+        zstr_free (&answered);
+        assert (dversion_current (store) == 2);
+        //  Both workers serve the new version
+        for (int i = 0; i < 2; i++) {
+            zstr_sendx (client, "TASK", "0", "DIST", NULL);
+            zmsg_t *reply = zmsg_recv (client);
+            assert (s_distance_of (reply, 3) == 1);
+            zmsg_destroy (&reply);
+        }
+        zsock_destroy (&client);
+        zactor_destroy (&dservice);
+        dversion_destroy (&store);
+    }
+    //  @end
+
+    printf ("OK\n");
+}
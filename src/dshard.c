@@ -0,0 +1,547 @@
+/*  =========================================================================
+    dshard - Shard of partitioned graph served to other processes
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dshard - Shard of partitioned graph served to other processes
+@discuss
+    Serves one shard file written by dpartition, so a graph too big for
+    one process is searched by several, each holding its own part. The
+    actor only ever searches within its shard: paths which leave it are
+    put together by dshards over the overlay of boundary nodes, which
+    every shard describes once with the OVERLAY request.
+
+    Boundary-to-boundary distances are computed on the first OVERLAY
+    request and kept for the next ones.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our actor
+
+struct _dshard_t {
+    zsock_t *pipe;              //  Actor command pipe
+    zpoller_t *poller;          //  Socket poller
+    bool terminated;            //  Did caller ask us to quit?
+    bool verbose;               //  Verbose logging enabled?
+
+    zsock_t *router;            //  Requests from clients
+    dprecomp_t *file;           //  Mapped shard file
+    graph_t *graph;             //  Shard over the file
+    graph_t *reverse;           //  Shard with edges reversed
+    dsearch_t *forward;
+    dsearch_t *backward;
+    uint64_t id;                //  Id of partitioning
+    int shard;
+    int shards;
+    int nodes;                  //  Nodes of the whole graph
+    int size;                   //  Nodes of the shard
+    const int *ids;             //  Global id of every local node
+    const int *boundary;        //  Local ids of boundary nodes
+    int boundary_size;
+    const int *cut;             //  Edges leaving the shard
+    int cut_size;
+    int *overlay;               //  Overlay triples, NULL until asked
+    int overlay_size;
+    uint64_t answered;          //  Number of replies sent to clients
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new dshard instance
+
+static dshard_t *
+dshard_new (zsock_t *pipe, void *args)
+{
+    dshard_t *self = (dshard_t *) zmalloc (sizeof (dshard_t));
+    assert (self);
+
+    self->pipe = pipe;
+    self->terminated = false;
+    self->router = zsock_new (ZMQ_ROUTER);
+    assert (self->router);
+    self->poller = zpoller_new (self->pipe, self->router, NULL);
+    return self;
+}
+
+
+//  Forget loaded shard
+
+static void
+dshard_unload (dshard_t *self)
+{
+    dsearch_destroy (&self->forward);
+    dsearch_destroy (&self->backward);
+    graph_destroy (&self->reverse);
+    graph_destroy (&self->graph);
+    dprecomp_destroy (&self->file);
+    free (self->overlay);
+    self->overlay = NULL;
+    self->overlay_size = 0;
+    self->size = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the dshard instance
+
+static void
+dshard_destroy (dshard_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dshard_t *self = *self_p;
+        dshard_unload (self);
+        //  Free object itself
+        zpoller_destroy (&self->poller);
+        zsock_destroy (&self->router);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  Load shard file. Returns 0 if loaded, -1 on error.
+
+static int
+dshard_load (dshard_t *self, const char *path)
+{
+    dshard_unload (self);
+    //  Shard files carry the id of their partitioning as hash
+    self->file = dprecomp_open (path, 0);
+    if (!self->file)
+        return -1;
+    size_t header_size, ids_size, boundary_size, cut_size;
+    const uint64_t *header =
+        (const uint64_t *) dprecomp_section (self->file, "shard", &header_size);
+    self->ids = (const int *) dprecomp_section (self->file, "ids", &ids_size);
+    self->boundary = (const int *) dprecomp_section (self->file, "boundary", &boundary_size);
+    self->cut = (const int *) dprecomp_section (self->file, "cut", &cut_size);
+    self->graph = dprecomp_graph (self->file, "graph");
+    if (!header || header_size != 4 * sizeof (uint64_t)
+    ||  !self->ids || !self->boundary || !self->cut || !self->graph
+    ||  ids_size != graph_nodes (self->graph) * sizeof (int)) {
+        dshard_unload (self);
+        return -1;
+    }
+    self->id = header [0];
+    self->shard = (int) header [1];
+    self->shards = (int) header [2];
+    self->nodes = (int) header [3];
+    self->size = graph_nodes (self->graph);
+    self->boundary_size = (int) (boundary_size / sizeof (int));
+    self->cut_size = (int) (cut_size / sizeof (int) / 3);
+    self->reverse = graph_reverse (self->graph);
+    self->forward = dsearch_new (self->graph);
+    self->backward = dsearch_new (self->reverse);
+    if (self->verbose)
+        zsys_info ("dshard: shard %d of %d, %d nodes, %d boundary, %d cut edges",
+                   self->shard, self->shards, self->size,
+                   self->boundary_size, self->cut_size);
+    return 0;
+}
+
+
+//  Get local id of global node, -1 if it is in another shard
+
+static int
+dshard_local (dshard_t *self, int node)
+{
+    int low = 0;
+    int high = self->size;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (self->ids [middle] < node)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < self->size && self->ids [low] == node ? low : -1;
+}
+
+
+//  Get node of request as local id, -1 if it is missing or foreign
+
+static int
+dshard_node_arg (dshard_t *self, zmsg_t *request)
+{
+    char *node = zmsg_popstr (request);
+    int local = node ? dshard_local (self, atoi (node)) : -1;
+    zstr_free (&node);
+    return local;
+}
+
+
+//  Add frame of (boundary node, distance) pairs found by search
+
+static void
+dshard_add_boundary (dshard_t *self, zmsg_t *reply, dsearch_t *search)
+{
+    int *pairs = (int *) malloc ((2 * self->boundary_size + 1) * sizeof (int));
+    assert (pairs);
+    int count = 0;
+    for (int i = 0; i < self->boundary_size; i++) {
+        int distance = dsearch_distance (search, self->boundary [i]);
+        if (distance != INT_MAX) {
+            pairs [2 * count] = self->ids [self->boundary [i]];
+            pairs [2 * count + 1] = distance;
+            count++;
+        }
+    }
+    zmsg_addmem (reply, pairs, 2 * count * sizeof (int));
+    free (pairs);
+}
+
+
+//  Compute overlay triples of the shard
+
+static void
+dshard_overlay (dshard_t *self)
+{
+    int capacity = self->boundary_size * 4 + self->cut_size + 1;
+    self->overlay = (int *) malloc (3 * capacity * sizeof (int));
+    assert (self->overlay);
+    int count = 0;
+    for (int i = 0; i < self->boundary_size; i++) {
+        int from = self->boundary [i];
+        dsearch_run (self->forward, from);
+        for (int j = 0; j < self->boundary_size; j++) {
+            int distance = dsearch_distance (self->forward, self->boundary [j]);
+            if (j == i || distance == INT_MAX)
+                continue;
+            if (count == capacity) {
+                capacity *= 2;
+                self->overlay = (int *) realloc (self->overlay, 3 * capacity * sizeof (int));
+                assert (self->overlay);
+            }
+            self->overlay [3 * count] = self->ids [from];
+            self->overlay [3 * count + 1] = self->ids [self->boundary [j]];
+            self->overlay [3 * count + 2] = distance;
+            count++;
+        }
+    }
+    if (count + self->cut_size > capacity) {
+        capacity = count + self->cut_size;
+        self->overlay = (int *) realloc (self->overlay, 3 * capacity * sizeof (int));
+        assert (self->overlay);
+    }
+    for (int i = 0; i < self->cut_size; i++) {
+        self->overlay [3 * count] = self->ids [self->cut [3 * i]];
+        self->overlay [3 * count + 1] = self->cut [3 * i + 1];
+        self->overlay [3 * count + 2] = self->cut [3 * i + 2];
+        count++;
+    }
+    self->overlay_size = count;
+    if (self->verbose)
+        zsys_info ("dshard: overlay of %d edges", count);
+}
+
+
+//  Execute request of client and return the reply
+
+static zmsg_t *
+dshard_request (dshard_t *self, zmsg_t *request)
+{
+    zmsg_t *reply = zmsg_new ();
+    char *command = zmsg_popstr (request);
+    if (!self->size) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "no shard loaded");
+    }
+    else
+    if (command && streq (command, "INFO")) {
+        zmsg_addstr (reply, "DONE");
+        zmsg_addstrf (reply, "%d", self->shard);
+        zmsg_addstrf (reply, "%d", self->shards);
+        zmsg_addstrf (reply, "%d", self->nodes);
+        zmsg_addstrf (reply, "%016" PRIx64, self->id);
+        zmsg_addmem (reply, self->ids, self->size * sizeof (int));
+    }
+    else
+    if (command && streq (command, "OVERLAY")) {
+        if (!self->overlay)
+            dshard_overlay (self);
+        zmsg_addstr (reply, "DONE");
+        zmsg_addmem (reply, self->overlay, 3 * self->overlay_size * sizeof (int));
+    }
+    else
+    if (command && streq (command, "FROM")) {
+        int from = dshard_node_arg (self, request);
+        int to = dshard_node_arg (self, request);
+        if (from == -1) {
+            zmsg_addstr (reply, "ERROR");
+            zmsg_addstr (reply, "invalid node");
+        }
+        else {
+            dsearch_run (self->forward, from);
+            int distance = to == -1 ? INT_MAX : dsearch_distance (self->forward, to);
+            zmsg_addstr (reply, "DONE");
+            zmsg_addstrf (reply, "%d", distance);
+            dshard_add_boundary (self, reply, self->forward);
+        }
+    }
+    else
+    if (command && streq (command, "TO")) {
+        int to = dshard_node_arg (self, request);
+        if (to == -1) {
+            zmsg_addstr (reply, "ERROR");
+            zmsg_addstr (reply, "invalid node");
+        }
+        else {
+            dsearch_run (self->backward, to);
+            zmsg_addstr (reply, "DONE");
+            dshard_add_boundary (self, reply, self->backward);
+        }
+    }
+    else {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "invalid command");
+    }
+    zstr_free (&command);
+    return reply;
+}
+
+
+//  Here we handle incoming message from the node
+
+static void
+dshard_recv_api (dshard_t *self)
+{
+    //  Get the whole message of the pipe in one go
+    zmsg_t *request = zmsg_recv (self->pipe);
+    if (!request)
+       return;        //  Interrupted
+
+    char *command = zmsg_popstr (request);
+    if (streq (command, "VERBOSE"))
+        self->verbose = true;
+    else
+    if (streq (command, "LOAD")) {
+        char *path = zmsg_popstr (request);
+        int rc = path ? dshard_load (self, path) : -1;
+        if (rc == -1)
+            zsys_error ("dshard: cannot load '%s'", path ? path : "");
+        zstr_sendf (self->pipe, "%d", rc);
+        zstr_free (&path);
+    }
+    else
+    if (streq (command, "BIND")) {
+        char *endpoint = zmsg_popstr (request);
+        int rc = endpoint ? zsock_bind (self->router, "%s", endpoint) : -1;
+        if (rc == -1)
+            zsys_error ("dshard: cannot bind to '%s'", endpoint ? endpoint : "");
+        else
+        if (self->verbose)
+            zsys_info ("dshard: serving at %s", endpoint);
+        zstr_sendf (self->pipe, "%d", rc);
+        zstr_free (&endpoint);
+    }
+    else
+    if (streq (command, "STATS"))
+        zstr_sendf (self->pipe, "%" PRIu64, self->answered);
+    else
+    if (streq (command, "$TERM"))
+        //  The $TERM command is send by zactor_destroy() method
+        self->terminated = true;
+    else {
+        zsys_error ("invalid command '%s'", command);
+        assert (false);
+    }
+    zstr_free (&command);
+    zmsg_destroy (&request);
+}
+
+
+//  Request from client is answered right away
+
+static void
+dshard_recv_router (dshard_t *self)
+{
+    zmsg_t *request = zmsg_recv (self->router);
+    if (!request)
+        return;         //  Interrupted
+    zframe_t *identity = zmsg_unwrap (request);
+    zmsg_t *reply = dshard_request (self, request);
+    zmsg_wrap (reply, identity);
+    zmsg_send (&reply, self->router);
+    zmsg_destroy (&request);
+    self->answered++;
+}
+
+
+//  --------------------------------------------------------------------------
+//  This is the actor which runs in its own thread.
+
+void
+dshard_actor (zsock_t *pipe, void *args)
+{
+    dshard_t * self = dshard_new (pipe, args);
+    if (!self)
+        return;          //  Interrupted
+
+    //  Signal actor successfully initiated
+    zsock_signal (self->pipe, 0);
+
+    while (!self->terminated) {
+        zsock_t *which = (zsock_t *) zpoller_wait (self->poller, -1);
+        if (which == self->pipe)
+            dshard_recv_api (self);
+        else
+        if (which == self->router)
+            dshard_recv_router (self);
+        else
+        if (zpoller_terminated (self->poller))
+            break;
+    }
+    dshard_destroy (&self);
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this actor.
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dshard_test (bool verbose)
+{
+    printf (" * dshard: ");
+    //  @selftest
+    //  Simple create/destroy test
+    zactor_t *dshard = zactor_new (dshard_actor, NULL);
+    assert (dshard);
+    zactor_destroy (&dshard);
+
+    //  Pairs 0 <-> 1 and 2 <-> 3 split in halves, 1 -> 2 is cut
+    const int from [] = { 0, 1, 1, 2, 3 };
+    const int to [] = { 1, 0, 2, 3, 2 };
+    const int weight [] = { 5, 5, 7, 11, 11 };
+    graph_t *graph = graph_new_from_edges (4, 5, from, to, weight);
+    dpartition_t *partition = dpartition_new (graph, 2);
+    assert (dpartition_cut (partition) == 1);
+    int first = dpartition_shard (partition, 0);
+    assert (dpartition_shard (partition, 1) == first);
+    zsys_dir_create (SELFTEST_DIR_RW);
+    char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dshard.shard");
+    assert (filename);
+    assert (dpartition_save (partition, graph, first, filename) == 0);
+
+    dshard = zactor_new (dshard_actor, NULL);
+    if (verbose)
+        zstr_send (dshard, "VERBOSE");
+    zstr_sendx (dshard, "LOAD", SELFTEST_DIR_RW "/missing.shard", NULL);
+    char *rc = zstr_recv (dshard);
+    assert (streq (rc, "-1"));
+    zstr_free (&rc);
+    zstr_sendx (dshard, "LOAD", filename, NULL);
+    rc = zstr_recv (dshard);
+    assert (streq (rc, "0"));
+    zstr_free (&rc);
+    zstr_sendx (dshard, "BIND", "inproc://dshard-test", NULL);
+    rc = zstr_recv (dshard);
+    assert (streq (rc, "0"));
+    zstr_free (&rc);
+
+    zsock_t *client = zsock_new_dealer ("inproc://dshard-test");
+    assert (client);
+    zstr_sendx (client, "", "INFO", NULL);
+    zmsg_t *reply = zmsg_recv (client);
+    assert (reply && zmsg_size (reply) == 7);
+    zframe_t *frame = zmsg_pop (reply);
+    zframe_destroy (&frame);
+    char *status = zmsg_popstr (reply);
+    char *shard = zmsg_popstr (reply);
+    char *shards = zmsg_popstr (reply);
+    char *nodes = zmsg_popstr (reply);
+    char *id = zmsg_popstr (reply);
+    assert (streq (status, "DONE"));
+    assert (atoi (shard) == first && atoi (shards) == 2 && atoi (nodes) == 4);
+    assert (strtoull (id, NULL, 16) == dpartition_id (partition));
+    frame = zmsg_pop (reply);
+    assert (zframe_size (frame) == 2 * sizeof (int));
+    assert (((int *) zframe_data (frame)) [0] == 0 && ((int *) zframe_data (frame)) [1] == 1);
+    zframe_destroy (&frame);
+    zstr_free (&status);
+    zstr_free (&shard);
+    zstr_free (&shards);
+    zstr_free (&nodes);
+    zstr_free (&id);
+    zmsg_destroy (&reply);
+
+    //  Node 1 is the only boundary node, it has the cut edge to node 2
+    zstr_sendx (client, "", "OVERLAY", NULL);
+    reply = zmsg_recv (client);
+    frame = zmsg_pop (reply);
+    zframe_destroy (&frame);
+    status = zmsg_popstr (reply);
+    assert (streq (status, "DONE"));
+    zstr_free (&status);
+    frame = zmsg_pop (reply);
+    assert (zframe_size (frame) == 3 * sizeof (int));
+    const int *triple = (const int *) zframe_data (frame);
+    assert (triple [0] == 1 && triple [1] == 2 && triple [2] == 7);
+    zframe_destroy (&frame);
+    zmsg_destroy (&reply);
+
+    zstr_sendx (client, "", "FROM", "0", "1", NULL);
+    reply = zmsg_recv (client);
+    frame = zmsg_pop (reply);
+    zframe_destroy (&frame);
+    status = zmsg_popstr (reply);
+    char *distance = zmsg_popstr (reply);
+    assert (streq (status, "DONE") && atoi (distance) == 5);
+    frame = zmsg_pop (reply);
+    assert (zframe_size (frame) == 2 * sizeof (int));
+    assert (((int *) zframe_data (frame)) [0] == 1 && ((int *) zframe_data (frame)) [1] == 5);
+    zframe_destroy (&frame);
+    zstr_free (&status);
+    zstr_free (&distance);
+    zmsg_destroy (&reply);
+
+    //  Nodes of other shards are not served
+    zstr_sendx (client, "", "TO", "3", NULL);
+    zstr_sendx (client, "", "HELLO", NULL);
+    for (int i = 0; i < 2; i++) {
+        char *empty, *reason;
+        zstr_recvx (client, &empty, &status, &reason, NULL);
+        assert (streq (status, "ERROR"));
+        zstr_free (&empty);
+        zstr_free (&status);
+        zstr_free (&reason);
+    }
+    zstr_sendx (dshard, "STATS", NULL);
+    char *answered = zstr_recv (dshard);
+    assert (atoi (answered) == 5);
+    zstr_free (&answered);
+
+    zsock_destroy (&client);
+    zactor_destroy (&dshard);
+    zsys_file_delete (filename);
+    zstr_free (&filename);
+    dpartition_destroy (&partition);
+    graph_destroy (&graph);
+    //  @end
+
+    printf ("OK\n");
+}
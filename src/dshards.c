@@ -0,0 +1,655 @@
+/*  =========================================================================
+    dshards - Shortest paths over shards served by dshard processes
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dshards - Shortest paths over shards served by dshard processes
+@discuss
+    A shortest path runs within a shard until it takes an edge to another
+    shard, so it is a chain of stretches between boundary nodes. Every
+    shard describes its stretches once, as the distances between its
+    boundary nodes, and its edges leaving it; together they make the
+    overlay graph this client keeps. A query asks the shard of the source
+    for distances to its boundary and the shard of the target for
+    distances from its boundary, both requests in flight together, then
+    searches the overlay from the source's boundary until no boundary
+    node closer than the best path so far is left.
+
+    The client holds the overlay and the shard of every node, never the
+    graph itself.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DSHARDS_TIMEOUT 5000    //  Msecs to wait for shard reply
+
+//  Structure of our class
+
+struct _dshards_t {
+    int shards;
+    int nodes;
+    uint64_t id;                //  Id of partitioning
+    zsock_t **sockets;          //  Socket of every shard
+    char **endpoints;           //  Endpoint of every shard, to connect again
+    int connected;
+    int *part;                  //  Shard of every node
+    int *overlay_id;            //  Overlay node of every node, or -1
+    int overlay_nodes;
+    graph_t *overlay;
+    int *distance;              //  Distance of overlay node from source
+    int *exit;                  //  Distance of overlay node to target
+    int *touched;               //  Overlay nodes to reset after query
+    dheap_t *heap;
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new client of shards
+
+dshards_t *
+dshards_new (void)
+{
+    dshards_t *self = (dshards_t *) zmalloc (sizeof (dshards_t));
+    assert (self);
+    return self;
+}
+
+
+//  Create socket connected to endpoint of shard, NULL on error
+
+static zsock_t *
+s_dshards_socket (const char *endpoint)
+{
+    zsock_t *socket = zsock_new (ZMQ_DEALER);
+    assert (socket);
+    zsock_set_rcvtimeo (socket, DSHARDS_TIMEOUT);
+    zsock_set_linger (socket, 0);
+    if (zsock_connect (socket, "%s", endpoint) == -1)
+        zsock_destroy (&socket);
+    return socket;
+}
+
+
+//  Strip delimiter and DONE status from reply of shard. Returns NULL if
+//  there is no reply or it is an error.
+
+static zmsg_t *
+s_dshards_unwrap (zmsg_t *reply)
+{
+    if (!reply)
+        return NULL;
+    zframe_t *empty = zmsg_pop (reply);
+    zframe_destroy (&empty);
+    char *status = zmsg_popstr (reply);
+    if (!status || !streq (status, "DONE"))
+        zmsg_destroy (&reply);
+    zstr_free (&status);
+    return reply;
+}
+
+
+//  Receive reply of shard, without delimiter and DONE status. Returns
+//  NULL on error or timeout.
+
+static zmsg_t *
+s_dshards_recv (zsock_t *socket)
+{
+    return s_dshards_unwrap (zmsg_recv (socket));
+}
+
+
+//  Receive reply of connected shard, as s_dshards_recv. Replies are not
+//  matched to requests, so a shard which timed out gets a new socket and
+//  its late reply is dropped with the old one. Shard which cannot be
+//  connected again is left out until dshards_connect.
+
+static zmsg_t *
+s_dshards_reply (dshards_t *self, int shard)
+{
+    zmsg_t *reply = zmsg_recv (self->sockets [shard]);
+    if (!reply) {
+        zsock_destroy (&self->sockets [shard]);
+        self->sockets [shard] = s_dshards_socket (self->endpoints [shard]);
+        if (!self->sockets [shard])
+            self->connected--;
+    }
+    return s_dshards_unwrap (reply);
+}
+
+
+//  Parse decimal field of shard reply, which must lie in min..max.
+//  Returns false on missing, malformed or out of range text.
+
+static bool
+s_dshards_parse (const char *text, long min, long max, int *value_p)
+{
+    char *end = NULL;
+    long value = text ? strtol (text, &end, 10) : 0;
+    if (!text || end == text || *end || value < min || value > max)
+        return false;
+    *value_p = (int) value;
+    return true;
+}
+
+
+//  Parse hexadecimal graph id of shard reply. Returns false on missing
+//  or malformed text.
+
+static bool
+s_dshards_parse_id (const char *text, uint64_t *id_p)
+{
+    char *end = NULL;
+    unsigned long long value = text ? strtoull (text, &end, 16) : 0;
+    if (!text || end == text || *end)
+        return false;
+    *id_p = (uint64_t) value;
+    return true;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Connect to endpoint of dshard actor
+
+int
+dshards_connect (dshards_t *self, const char *endpoint)
+{
+    assert (self);
+    zsock_t *socket = s_dshards_socket (endpoint);
+    zmsg_t *reply = NULL;
+    if (socket && zstr_sendx (socket, "", "INFO", NULL) == 0)
+        reply = s_dshards_recv (socket);
+
+    bool valid = reply && zmsg_size (reply) == 5;
+    char *shard = valid ? zmsg_popstr (reply) : NULL;
+    char *shards = valid ? zmsg_popstr (reply) : NULL;
+    char *nodes = valid ? zmsg_popstr (reply) : NULL;
+    char *id = valid ? zmsg_popstr (reply) : NULL;
+    zframe_t *ids = valid ? zmsg_pop (reply) : NULL;
+    int shard_index = -1, shard_count = 0, node_count = 0;
+    uint64_t graph_id = 0;
+    valid = valid
+         && s_dshards_parse (shard, 0, INT_MAX, &shard_index)
+         && s_dshards_parse (shards, 1, INT_MAX, &shard_count)
+         && s_dshards_parse (nodes, 1, INT_MAX, &node_count)
+         && s_dshards_parse_id (id, &graph_id);
+    if (valid && !self->shards) {
+        self->shards = shard_count;
+        self->nodes = node_count;
+        self->id = graph_id;
+        self->sockets = (zsock_t **) zmalloc (self->shards * sizeof (zsock_t *));
+        self->endpoints = (char **) zmalloc (self->shards * sizeof (char *));
+        self->part = (int *) malloc (self->nodes * sizeof (int));
+        assert (self->sockets && self->endpoints && self->part);
+        for (int i = 0; i < self->nodes; i++)
+            self->part [i] = -1;
+    }
+    valid = valid
+         && shard_count == self->shards && node_count == self->nodes
+         && graph_id == self->id
+         && shard_index < self->shards
+         && !self->sockets [shard_index];
+    if (valid) {
+        const int *node = (const int *) zframe_data (ids);
+        size_t size = zframe_size (ids) / sizeof (int);
+        for (size_t i = 0; i < size && valid; i++)
+            valid = node [i] >= 0 && node [i] < self->nodes
+                 && (self->part [node [i]] == -1 || self->part [node [i]] == shard_index);
+        for (size_t i = 0; i < size && valid; i++)
+            self->part [node [i]] = shard_index;
+    }
+    if (valid) {
+        self->sockets [shard_index] = socket;
+        self->connected++;
+        free (self->endpoints [shard_index]);
+        self->endpoints [shard_index] = strdup (endpoint);
+    }
+    else {
+        zsys_error ("dshards: cannot use shard at '%s'", endpoint);
+        zsock_destroy (&socket);
+    }
+    zframe_destroy (&ids);
+    zstr_free (&shard);
+    zstr_free (&shards);
+    zstr_free (&nodes);
+    zstr_free (&id);
+    zmsg_destroy (&reply);
+    return valid ? 0 : -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of shards of the partitioning
+
+int
+dshards_shards (dshards_t *self)
+{
+    if (!self) return 0;
+    return self->shards;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of shards connected
+
+int
+dshards_connected (dshards_t *self)
+{
+    if (!self) return 0;
+    return self->connected;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes of the whole graph
+
+int
+dshards_nodes (dshards_t *self)
+{
+    if (!self) return 0;
+    return self->nodes;
+}
+
+
+//  Get overlay node of node, numbering it if it is new
+
+static int
+s_dshards_overlay_id (dshards_t *self, int node)
+{
+    if (self->overlay_id [node] == -1)
+        self->overlay_id [node] = self->overlay_nodes++;
+    return self->overlay_id [node];
+}
+
+
+//  Gather overlay from all shards. Returns 0 if done, -1 on error.
+
+static int
+s_dshards_overlay (dshards_t *self)
+{
+    //  Every request sent gets its reply taken, even if others fail
+    int sent = 0;
+    while (sent < self->shards && zstr_sendx (self->sockets [sent], "", "OVERLAY", NULL) == 0)
+        sent++;
+    self->overlay_id = (int *) malloc (self->nodes * sizeof (int));
+    assert (self->overlay_id);
+    for (int i = 0; i < self->nodes; i++)
+        self->overlay_id [i] = -1;
+
+    zframe_t **frames = (zframe_t **) zmalloc (self->shards * sizeof (zframe_t *));
+    assert (frames);
+    int rc = sent < self->shards ? -1 : 0;
+    size_t edges = 0;
+    for (int i = 0; i < sent; i++) {
+        zmsg_t *reply = s_dshards_reply (self, i);
+        frames [i] = reply ? zmsg_pop (reply) : NULL;
+        zmsg_destroy (&reply);
+        if (!frames [i])
+            rc = -1;
+        else
+            edges += zframe_size (frames [i]) / sizeof (int) / 3;
+    }
+    int *from = (int *) malloc ((edges + 1) * sizeof (int));
+    int *to = (int *) malloc ((edges + 1) * sizeof (int));
+    int *weight = (int *) malloc ((edges + 1) * sizeof (int));
+    assert (from && to && weight);
+    edges = 0;
+    for (int i = 0; i < self->shards && rc == 0; i++) {
+        const int *triple = (const int *) zframe_data (frames [i]);
+        size_t size = zframe_size (frames [i]) / sizeof (int) / 3;
+        for (size_t j = 0; j < size; j++, triple += 3) {
+            if (triple [0] < 0 || triple [0] >= self->nodes
+            ||  triple [1] < 0 || triple [1] >= self->nodes) {
+                rc = -1;
+                break;
+            }
+            from [edges] = s_dshards_overlay_id (self, triple [0]);
+            to [edges] = s_dshards_overlay_id (self, triple [1]);
+            weight [edges++] = triple [2];
+        }
+    }
+    if (rc == -1) {
+        //  Gathered again by the next query
+        free (self->overlay_id);
+        self->overlay_id = NULL;
+        self->overlay_nodes = 0;
+    }
+    else
+    if (self->overlay_nodes > 0) {
+        self->overlay = graph_new_from_edges (self->overlay_nodes, (int) edges, from, to, weight);
+        self->distance = (int *) malloc (self->overlay_nodes * sizeof (int));
+        self->exit = (int *) malloc (self->overlay_nodes * sizeof (int));
+        self->touched = (int *) malloc (2 * self->overlay_nodes * sizeof (int));
+        assert (self->distance && self->exit && self->touched);
+        for (int i = 0; i < self->overlay_nodes; i++) {
+            self->distance [i] = INT_MAX;
+            self->exit [i] = INT_MAX;
+        }
+    }
+    if (rc == 0)
+        self->heap = dheap_new (self->overlay_nodes + 1);
+    free (from);
+    free (to);
+    free (weight);
+    for (int i = 0; i < self->shards; i++)
+        zframe_destroy (&frames [i]);
+    free (frames);
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get shortest distance from node to node of the whole graph
+
+int
+dshards_distance (dshards_t *self, int from, int to)
+{
+    assert (self);
+    if (!self->shards || self->connected < self->shards
+    ||  from < 0 || from >= self->nodes || to < 0 || to >= self->nodes)
+        return -1;
+    if (!self->heap && s_dshards_overlay (self) == -1)
+        return -1;
+
+    //  Both ends are asked at once, same shard answers in order
+    zsock_t *source = self->sockets [self->part [from]];
+    zsock_t *target = self->sockets [self->part [to]];
+    char from_node [16], to_node [16];
+    snprintf (from_node, sizeof (from_node), "%d", from);
+    snprintf (to_node, sizeof (to_node), "%d", to);
+    bool sent_from = zstr_sendx (source, "", "FROM", from_node, to_node, NULL) == 0;
+    bool sent_to = sent_from && zstr_sendx (target, "", "TO", to_node, NULL) == 0;
+    zmsg_t *from_reply = sent_from ? s_dshards_reply (self, self->part [from]) : NULL;
+    //  Shard which timed out has new socket, nothing to wait for there
+    zmsg_t *to_reply = sent_to && (from_reply || target != source)
+                     ? s_dshards_reply (self, self->part [to]) : NULL;
+    char *local = from_reply ? zmsg_popstr (from_reply) : NULL;
+    zframe_t *entries = from_reply ? zmsg_pop (from_reply) : NULL;
+    zframe_t *exits = to_reply ? zmsg_pop (to_reply) : NULL;
+    zmsg_destroy (&from_reply);
+    zmsg_destroy (&to_reply);
+    //  Local distance is INT_MAX when target is not reached in the shard;
+    //  each boundary node is reported at most once per frame
+    int best = 0;
+    size_t max_size = (size_t) self->overlay_nodes * 2 * sizeof (int);
+    bool valid = local && entries && exits
+              && s_dshards_parse (local, 0, INT_MAX, &best)
+              && zframe_size (entries) <= max_size
+              && zframe_size (exits) <= max_size;
+    zstr_free (&local);
+    if (!valid) {
+        zframe_destroy (&entries);
+        zframe_destroy (&exits);
+        return -1;
+    }
+
+    //  Boundary nodes of target shard know their distance to target
+    int touched = 0;
+    const int *pair = (const int *) zframe_data (exits);
+    size_t size = zframe_size (exits) / sizeof (int) / 2;
+    for (size_t i = 0; i < size; i++, pair += 2) {
+        if (pair [0] < 0 || pair [0] >= self->nodes || self->overlay_id [pair [0]] == -1
+        ||  pair [1] < 0 || pair [1] == INT_MAX)
+            continue;
+        int node = self->overlay_id [pair [0]];
+        if (pair [1] < self->exit [node]) {
+            if (self->distance [node] == INT_MAX && self->exit [node] == INT_MAX)
+                self->touched [touched++] = node;
+            self->exit [node] = pair [1];
+        }
+    }
+    pair = (const int *) zframe_data (entries);
+    size = zframe_size (entries) / sizeof (int) / 2;
+    for (size_t i = 0; i < size; i++, pair += 2) {
+        if (pair [0] < 0 || pair [0] >= self->nodes || self->overlay_id [pair [0]] == -1
+        ||  pair [1] < 0)
+            continue;
+        int node = self->overlay_id [pair [0]];
+        if (pair [1] < self->distance [node]) {
+            if (self->distance [node] == INT_MAX && self->exit [node] == INT_MAX)
+                self->touched [touched++] = node;
+            self->distance [node] = pair [1];
+            dheap_push (self->heap, node, pair [1]);
+        }
+    }
+    zframe_destroy (&entries);
+    zframe_destroy (&exits);
+
+    //  Search overlay while a closer boundary node is left
+    int node, key;
+    while (dheap_min (self->heap) < best && dheap_pop (self->heap, &node, &key)) {
+        if (key > self->distance [node])
+            continue;           //  Stale entry
+        if (self->exit [node] != INT_MAX && (int64_t) key + self->exit [node] < best)
+            best = key + self->exit [node];
+        int degree = graph_degree (self->overlay, node);
+        const int *targets = graph_targets (self->overlay, node);
+        const int *weights = graph_weights (self->overlay, node);
+        for (int i = 0; i < degree; i++) {
+            int next = targets [i];
+            int64_t distance = (int64_t) key + weights [i];
+            if (distance < self->distance [next]) {
+                if (self->distance [next] == INT_MAX && self->exit [next] == INT_MAX)
+                    self->touched [touched++] = next;
+                self->distance [next] = (int) distance;
+                dheap_push (self->heap, next, (int) distance);
+            }
+        }
+    }
+    dheap_clear (self->heap);
+    for (int i = 0; i < touched; i++) {
+        self->distance [self->touched [i]] = INT_MAX;
+        self->exit [self->touched [i]] = INT_MAX;
+    }
+    return best;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of boundary nodes in the overlay
+
+int
+dshards_overlay_nodes (dshards_t *self)
+{
+    if (!self) return 0;
+    return self->overlay_nodes;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges in the overlay
+
+int
+dshards_overlay_edges (dshards_t *self)
+{
+    if (!self || !self->overlay) return 0;
+    return graph_edges (self->overlay);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the client
+
+void
+dshards_destroy (dshards_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dshards_t *self = *self_p;
+        for (int i = 0; i < self->shards; i++) {
+            zsock_destroy (&self->sockets [i]);
+            free (self->endpoints [i]);
+        }
+        free (self->sockets);
+        free (self->endpoints);
+        free (self->part);
+        free (self->overlay_id);
+        graph_destroy (&self->overlay);
+        free (self->distance);
+        free (self->exit);
+        free (self->touched);
+        dheap_destroy (&self->heap);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Start dshard actor serving shard at endpoint
+static zactor_t *
+s_test_shard (dpartition_t *partition, graph_t *graph, int shard, const char *endpoint)
+{
+    char *filename = zsys_sprintf ("%s/dshards-%d.shard", SELFTEST_DIR_RW, shard);
+    assert (dpartition_save (partition, graph, shard, filename) == 0);
+    zactor_t *dshard = zactor_new (dshard_actor, NULL);
+    zstr_sendx (dshard, "LOAD", filename, NULL);
+    char *rc = zstr_recv (dshard);
+    assert (streq (rc, "0"));
+    zstr_free (&rc);
+    zstr_sendx (dshard, "BIND", endpoint, NULL);
+    rc = zstr_recv (dshard);
+    assert (streq (rc, "0"));
+    zstr_free (&rc);
+    zsys_file_delete (filename);
+    zstr_free (&filename);
+    return dshard;
+}
+
+void
+dshards_test (bool verbose)
+{
+    printf (" * dshards: ");
+
+    //  @selftest
+    //  Grid with one-way streets, and a few nodes nobody reaches
+    const int side = 12;
+    const int nodes = side * side + 3;
+    int *from = (int *) malloc (4 * nodes * sizeof (int));
+    int *to = (int *) malloc (4 * nodes * sizeof (int));
+    int *weight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (from && to && weight);
+    unsigned int seed = 7;
+    int edges = 0;
+    for (int y = 0; y < side; y++)
+        for (int x = 0; x < side; x++) {
+            int u = y * side + x;
+            int next [2] = { x + 1 < side ? u + 1 : -1, y + 1 < side ? u + side : -1 };
+            for (int i = 0; i < 2; i++) {
+                if (next [i] == -1)
+                    continue;
+                seed = seed * 1103515245 + 12345;
+                int w = 1 + (seed >> 8) % 20;
+                int way = (seed >> 4) % 4;
+                if (way != 1) {
+                    from [edges] = u; to [edges] = next [i]; weight [edges++] = w;
+                }
+                if (way != 2) {
+                    from [edges] = next [i]; to [edges] = u; weight [edges++] = w;
+                }
+            }
+        }
+    from [edges] = side * side; to [edges] = 0; weight [edges++] = 3;
+    graph_t *graph = graph_new_from_edges (nodes, edges, from, to, weight);
+    free (from);
+    free (to);
+    free (weight);
+
+    const int shards = 3;
+    dpartition_t *partition = dpartition_new (graph, shards);
+    assert (dpartition_shards (partition) == shards);
+    zsys_dir_create (SELFTEST_DIR_RW);
+    zactor_t *dshard [3];
+    char *endpoint [3];
+    for (int i = 0; i < shards; i++) {
+        endpoint [i] = zsys_sprintf ("ipc://%s/dshards-%d.ipc", SELFTEST_DIR_RW, i);
+        dshard [i] = s_test_shard (partition, graph, i, endpoint [i]);
+    }
+
+    dshards_t *self = dshards_new ();
+    assert (self);
+    assert (dshards_distance (self, 0, 1) == -1);
+    for (int i = shards - 1; i >= 0; i--)
+        assert (dshards_connect (self, endpoint [i]) == 0);
+    //  Same shard is not connected twice
+    assert (dshards_connect (self, endpoint [0]) == -1);
+    assert (dshards_shards (self) == shards);
+    assert (dshards_connected (self) == shards);
+    assert (dshards_nodes (self) == nodes);
+    assert (dshards_distance (self, 0, nodes) == -1);
+
+    dsearch_t *search = dsearch_new (graph);
+    for (int u = 0; u < nodes; u += 5) {
+        dsearch_run (search, u);
+        for (int v = 0; v < nodes; v += 3)
+            assert (dshards_distance (self, u, v) == dsearch_distance (search, v));
+    }
+    assert (dshards_distance (self, 0, side * side) == INT_MAX);
+    assert (dshards_distance (self, side * side, side * side + 1) == INT_MAX);
+    assert (dshards_overlay_nodes (self) > 0);
+    assert (dshards_overlay_edges (self) > 0);
+    if (verbose)
+        printf ("\noverlay of %d nodes and %d edges\n",
+                dshards_overlay_nodes (self), dshards_overlay_edges (self));
+
+    //  Shard which stops replying fails queries, not the client: it gets
+    //  a new socket, so late replies are never taken for later ones, and
+    //  overlay is gathered again
+    dshards_t *fresh = dshards_new ();
+    for (int i = 0; i < shards; i++)
+        assert (dshards_connect (fresh, endpoint [i]) == 0);
+    int lost = 0;
+    while (dpartition_shard (partition, lost) != 1)
+        lost++;
+    zactor_destroy (&dshard [1]);
+    assert (dshards_distance (self, lost, 0) == -1);
+    assert (dshards_distance (fresh, 0, lost) == -1);
+    assert (dshards_overlay_nodes (fresh) == 0);
+    dshard [1] = s_test_shard (partition, graph, 1, endpoint [1]);
+    assert (dshards_connected (self) == shards);
+    for (int u = lost; u < nodes; u += 7) {
+        dsearch_run (search, u);
+        for (int v = 0; v < nodes; v += 11) {
+            assert (dshards_distance (self, u, v) == dsearch_distance (search, v));
+            assert (dshards_distance (fresh, u, v) == dsearch_distance (search, v));
+        }
+    }
+    assert (dshards_overlay_nodes (fresh) == dshards_overlay_nodes (self));
+    dshards_destroy (&fresh);
+    dsearch_destroy (&search);
+
+    dshards_destroy (&self);
+    for (int i = 0; i < shards; i++) {
+        zactor_destroy (&dshard [i]);
+        zsys_file_delete (endpoint [i] + strlen ("ipc://"));
+        zstr_free (&endpoint [i]);
+    }
+    dpartition_destroy (&partition);
+    graph_destroy (&graph);
+    //  @end
+    printf ("OK\n");
+}
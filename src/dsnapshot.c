@@ -0,0 +1,322 @@
+/*  =========================================================================
+    dsnapshot - Copy-on-write version of a distance matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dsnapshot - Copy-on-write version of a distance matrix
+@discuss
+    Rows of the matrix live in reference counted blocks. Forking a
+    snapshot copies just the block table, so the next version costs one
+    pointer per block; changing an element then copies the one block which
+    holds it, unless no other snapshot shares the block. Searches read a
+    snapshot through an ordinary matrix_t view over the block rows.
+
+    Snapshots are reference counted too, so a reader in another thread
+    can keep a version alive while newer ones are published (see
+    dversion). Block counts are updated atomically, because the last
+    reader of an old version may drop it at any time.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Rows start on their own cache line, as in matrix_new
+#define DSNAPSHOT_ALIGNMENT 64
+
+typedef struct {
+    int refs;                   //  Snapshots sharing the block
+    uint8_t *rows;
+} dsnapshot_block_t;
+
+//  Structure of our class
+
+struct _dsnapshot_t {
+    unsigned int x;
+    unsigned int y;
+    size_t element_size;
+    size_t row_size;            //  Bytes between rows of a block
+    int block_rows;             //  Rows per block, last block may have less
+    int blocks;
+    dsnapshot_block_t **block;
+    uint64_t version;
+    int refs;                   //  References to snapshot
+    size_t copied;              //  Blocks copied since fork
+    matrix_t *view;             //  Matrix over block rows, NULL if stale
+};
+
+
+//  Allocate block of rows, not initialized
+
+static dsnapshot_block_t *
+s_block_new (dsnapshot_t *self)
+{
+    dsnapshot_block_t *block = (dsnapshot_block_t *) zmalloc (sizeof (dsnapshot_block_t));
+    assert (block);
+    block->refs = 1;
+    int rc = posix_memalign ((void **) &block->rows, DSNAPSHOT_ALIGNMENT,
+                             self->block_rows * self->row_size);
+    assert (rc == 0);
+    return block;
+}
+
+static void
+s_block_unref (dsnapshot_block_t **block_p)
+{
+    dsnapshot_block_t *block = *block_p;
+    if (block && __atomic_sub_fetch (&block->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free (block->rows);
+        free (block);
+    }
+    *block_p = NULL;
+}
+
+//  Allocate snapshot with empty block table
+
+static dsnapshot_t *
+s_dsnapshot_alloc (unsigned int x, unsigned int y, size_t element_size, int block_rows)
+{
+    dsnapshot_t *self = (dsnapshot_t *) zmalloc (sizeof (dsnapshot_t));
+    assert (self);
+    self->x = x;
+    self->y = y;
+    self->element_size = element_size;
+    self->row_size = (x * element_size + DSNAPSHOT_ALIGNMENT - 1)
+                   / DSNAPSHOT_ALIGNMENT * DSNAPSHOT_ALIGNMENT;
+    self->block_rows = block_rows;
+    self->blocks = (y + block_rows - 1) / block_rows;
+    self->block = (dsnapshot_block_t **) zmalloc (self->blocks * sizeof (dsnapshot_block_t *));
+    assert (self->block);
+    self->refs = 1;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create snapshot holding a copy of matrix
+
+dsnapshot_t *
+dsnapshot_new (matrix_t *source, int block_rows)
+{
+    if (!source || block_rows < 0) return NULL;
+    if (block_rows == 0)
+        block_rows = 1;
+
+    dsnapshot_t *self = s_dsnapshot_alloc (matrix_x (source), matrix_y (source),
+                                           matrix_element_size (source), block_rows);
+    self->version = 1;
+    size_t row_bytes = self->x * self->element_size;
+    for (int b = 0; b < self->blocks; b++) {
+        self->block [b] = s_block_new (self);
+        for (int r = 0; r < block_rows; r++) {
+            unsigned int y = b * block_rows + r;
+            if (y < self->y)
+                memcpy (self->block [b]->rows + r * self->row_size,
+                        matrix_get_ptr (source, 0, y), row_bytes);
+        }
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create next version of snapshot, sharing its blocks
+
+dsnapshot_t *
+dsnapshot_fork (dsnapshot_t *self)
+{
+    assert (self);
+    dsnapshot_t *copy = s_dsnapshot_alloc (self->x, self->y, self->element_size, self->block_rows);
+    copy->version = self->version + 1;
+    for (int b = 0; b < self->blocks; b++) {
+        __atomic_add_fetch (&self->block [b]->refs, 1, __ATOMIC_RELAXED);
+        copy->block [b] = self->block [b];
+    }
+    return copy;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set element, copying its block first if the block is shared
+
+void
+dsnapshot_set (dsnapshot_t *self, unsigned int x, unsigned int y, void *element)
+{
+    if (!self || x >= self->x || y >= self->y || !element) return;
+    int b = y / self->block_rows;
+    dsnapshot_block_t *block = self->block [b];
+    if (__atomic_load_n (&block->refs, __ATOMIC_ACQUIRE) > 1) {
+        dsnapshot_block_t *copy = s_block_new (self);
+        memcpy (copy->rows, block->rows, self->block_rows * self->row_size);
+        s_block_unref (&self->block [b]);
+        self->block [b] = copy;
+        self->copied++;
+    }
+    memcpy (self->block [b]->rows + (y % self->block_rows) * self->row_size
+                                  + x * self->element_size,
+            element, self->element_size);
+    matrix_destroy (&self->view);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set int element
+
+void
+dsnapshot_set_int (dsnapshot_t *self, unsigned int x, unsigned int y, int element)
+{
+    if (!self || self->element_size != sizeof (int)) return;
+    dsnapshot_set (self, x, y, &element);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get matrix view of snapshot
+
+matrix_t *
+dsnapshot_matrix (dsnapshot_t *self)
+{
+    assert (self);
+    if (!self->view) {
+        void **rows = (void **) malloc (self->y * sizeof (void *));
+        assert (rows);
+        for (unsigned int y = 0; y < self->y; y++)
+            rows [y] = self->block [y / self->block_rows]->rows
+                     + (y % self->block_rows) * self->row_size;
+        self->view = matrix_new_view (self->x, self->y, self->element_size, rows);
+        free (rows);
+    }
+    return self->view;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get version number
+
+uint64_t
+dsnapshot_version (dsnapshot_t *self)
+{
+    if (!self) return 0;
+    return self->version;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of blocks copied since fork
+
+size_t
+dsnapshot_copied (dsnapshot_t *self)
+{
+    if (!self) return 0;
+    return self->copied;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Take another reference to snapshot
+
+dsnapshot_t *
+dsnapshot_ref (dsnapshot_t *self)
+{
+    assert (self);
+    __atomic_add_fetch (&self->refs, 1, __ATOMIC_RELAXED);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Drop reference to snapshot, destroying it with the last one
+
+void
+dsnapshot_destroy (dsnapshot_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dsnapshot_t *self = *self_p;
+        if (__atomic_sub_fetch (&self->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+            for (int b = 0; b < self->blocks; b++)
+                s_block_unref (&self->block [b]);
+            free (self->block);
+            matrix_destroy (&self->view);
+            free (self);
+        }
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dsnapshot_test (bool verbose)
+{
+    printf (" * dsnapshot: ");
+
+    //  @selftest
+    matrix_t *source = matrix_new (5, 5, sizeof (int));
+    for (int y = 0; y < 5; y++)
+        for (int x = 0; x < 5; x++)
+            matrix_set_int (source, x, y, 10 * y + x);
+    dsnapshot_t *self = dsnapshot_new (source, 2);
+    assert (self);
+    assert (dsnapshot_version (self) == 1);
+    matrix_t *view = dsnapshot_matrix (self);
+    assert (matrix_x (view) == 5 && matrix_y (view) == 5);
+    assert (matrix_as_int (view, 3, 4) == 43);
+    assert ((uintptr_t) matrix_get_ptr (view, 0, 1) % 64 == 0);
+    //  Snapshot is a copy, source may change
+    matrix_set_int (source, 0, 0, 99);
+    assert (matrix_as_int (view, 0, 0) == 0);
+
+    //  Fork copies only the block it changes
+    dsnapshot_t *next = dsnapshot_fork (self);
+    assert (dsnapshot_version (next) == 2);
+    dsnapshot_set_int (next, 1, 2, -1);
+    dsnapshot_set_int (next, 2, 3, -2);
+    assert (dsnapshot_copied (next) == 1);
+    dsnapshot_set_int (next, 0, 4, -3);
+    assert (dsnapshot_copied (next) == 2);
+    matrix_t *next_view = dsnapshot_matrix (next);
+    assert (matrix_as_int (next_view, 1, 2) == -1);
+    assert (matrix_as_int (next_view, 0, 4) == -3);
+    assert (matrix_get_ptr (next_view, 0, 0) == matrix_get_ptr (view, 0, 0));
+    assert (matrix_get_ptr (next_view, 0, 2) != matrix_get_ptr (view, 0, 2));
+    assert (matrix_as_int (view, 1, 2) == 21);
+    assert (matrix_as_int (view, 0, 4) == 40);
+
+    //  Reader reference keeps old version, shared blocks survive either
+    dsnapshot_t *reader = dsnapshot_ref (self);
+    dsnapshot_destroy (&self);
+    assert (self == NULL);
+    assert (matrix_as_int (dsnapshot_matrix (reader), 1, 2) == 21);
+    dsnapshot_destroy (&reader);
+    assert (matrix_as_int (next_view, 4, 0) == 4);
+    assert (matrix_as_int (next_view, 4, 1) == 14);
+    dsnapshot_destroy (&next);
+    matrix_destroy (&source);
+    assert (dsnapshot_new (NULL, 0) == NULL);
+    //  @end
+    printf ("OK\n");
+}
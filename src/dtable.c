@@ -0,0 +1,868 @@
+/*  =========================================================================
+    dtable - Many-to-many distance tables by bucket scans
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dtable - Many-to-many distance tables by bucket scans
+@discuss
+    Table of S sources by T targets costs S full searches when done one
+    source at a time. Here the graph is first turned into a contraction
+    hierarchy: nodes are contracted one by one, least important first,
+    and every shortest path through a contracted node is kept as a
+    shortcut edge between its neighbours, unless a local witness search
+    finds another path as short. Every shortest path then has a version
+    which goes up the hierarchy and then down, and searches which only go
+    up settle a small part of the graph.
+
+    Every target is searched upward over reverse edges, and every node it
+    settles gets an entry (target, distance to target) in its bucket.
+    Then every source is searched upward, and every node it settles
+    offers its distance plus the ones in its bucket as paths to those
+    targets. The top node of the shortest up and down path is settled by
+    both searches, so the shortest of the offers is the distance.
+
+    Node order is picked by edge difference, the number of shortcuts a
+    contraction adds less the edges it removes, plus the number of
+    neighbours contracted already, which spreads contraction over the
+    graph. Priorities are updated lazily: a node taken from the queue is
+    contracted only if its priority computed again is still the smallest.
+
+    Hierarchy is built once, by dtable_new. Backward searches are spread
+    over threads by target, forward ones by source, and every forward
+    search writes its own row of the table.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DTABLE_MAX_THREADS  64
+
+//  Witness searches give up after settling this many nodes, and add the
+//  shortcut; shortcuts are never wrong, only more of them slow searches
+#define DTABLE_WITNESS_SETTLED  100
+
+//  Entry of node bucket
+
+typedef struct {
+    int target;                 //  Column of the target in the table
+    int distance;               //  From node to the target
+} dtable_entry_t;
+
+//  Structure of our class
+
+struct _dtable_t {
+    int nodes;
+    graph_t *up;                //  Edges to higher nodes, searched forward
+    graph_t *down;              //  Edges from higher nodes, reversed
+    int shortcuts;              //  Edges added by contraction
+    size_t buckets;             //  Entries of the last table
+    size_t settled;             //  Nodes settled for the last table
+};
+
+//  Edges of a node during contraction
+
+typedef struct {
+    int node;
+    int weight;
+} s_arc_t;
+
+typedef struct {
+    s_arc_t *arcs;
+    int size;
+    int capacity;
+} s_arcs_t;
+
+//  Graph being contracted
+
+typedef struct {
+    int nodes;
+    s_arcs_t *out;
+    s_arcs_t *in;               //  Edges from and to nodes not contracted
+    int *deleted;               //  Contracted neighbours of node
+    int shortcuts;
+    int *distance;              //  Witness search, valid where
+    unsigned int *reached;      //  reached [node] == stamp
+    unsigned int stamp;
+    dheap_t *heap;
+} s_builder_t;
+
+//  Table being computed, shared by all threads
+
+typedef struct {
+    dtable_t *self;
+    const int *sources;
+    int source_count;
+    const int *targets;
+    int target_count;
+    int next;                   //  Next source or target to search
+    int **ball_nodes;           //  Per target, nodes settled backward
+    int **ball_distances;       //  and their distances to the target
+    int *ball_size;
+    size_t *offsets;            //  Per node, first entry of its bucket
+    dtable_entry_t *entries;
+    matrix_t *table;
+} s_dtable_job_t;
+
+//  Search state of one thread
+
+typedef struct {
+    s_dtable_job_t *job;
+    int *distance;              //  Valid where reached [node] == stamp
+    unsigned int *reached;
+    unsigned int stamp;
+    int *settled_nodes;         //  Nodes settled by this search
+    int settled_count;
+    dheap_t *heap;
+    size_t settled;
+} s_dtable_task_t;
+
+
+//  Add edge to node, or make it lighter if there is one already. Returns
+//  true if edge is new.
+
+static bool
+s_arcs_add (s_arcs_t *self, int node, int weight)
+{
+    for (int i = 0; i < self->size; i++)
+        if (self->arcs [i].node == node) {
+            if (weight < self->arcs [i].weight)
+                self->arcs [i].weight = weight;
+            return false;
+        }
+    if (self->size == self->capacity) {
+        self->capacity = self->capacity ? 2 * self->capacity : 4;
+        self->arcs = (s_arc_t *) realloc (self->arcs, self->capacity * sizeof (s_arc_t));
+        assert (self->arcs);
+    }
+    self->arcs [self->size].node = node;
+    self->arcs [self->size++].weight = weight;
+    return true;
+}
+
+//  Remove edge to node
+
+static void
+s_arcs_remove (s_arcs_t *self, int node)
+{
+    for (int i = 0; i < self->size; i++)
+        if (self->arcs [i].node == node) {
+            self->arcs [i] = self->arcs [--self->size];
+            return;
+        }
+}
+
+//  Edges of the hierarchy as they are found
+
+typedef struct {
+    int *from;
+    int *to;
+    int *weight;
+    int size;
+    int capacity;
+} s_edges_t;
+
+static void
+s_edges_add (s_edges_t *self, int from, int to, int weight)
+{
+    if (self->size == self->capacity) {
+        self->capacity = self->capacity ? 2 * self->capacity : 1024;
+        self->from = (int *) realloc (self->from, self->capacity * sizeof (int));
+        self->to = (int *) realloc (self->to, self->capacity * sizeof (int));
+        self->weight = (int *) realloc (self->weight, self->capacity * sizeof (int));
+        assert (self->from && self->to && self->weight);
+    }
+    self->from [self->size] = from;
+    self->to [self->size] = to;
+    self->weight [self->size++] = weight;
+}
+
+//  Search from node for witness paths which avoid node skip, up to limit
+
+static void
+s_witness_search (s_builder_t *builder, int from, int skip, int64_t limit)
+{
+    if (++builder->stamp == 0) {
+        memset (builder->reached, 0, builder->nodes * sizeof (unsigned int));
+        builder->stamp = 1;
+    }
+    dheap_clear (builder->heap);
+    builder->reached [from] = builder->stamp;
+    builder->distance [from] = 0;
+    dheap_push (builder->heap, from, 0);
+    int settled = 0;
+    int node, key;
+    while (dheap_pop (builder->heap, &node, &key)) {
+        if (key > builder->distance [node])
+            continue;
+        if (key > limit || ++settled > DTABLE_WITNESS_SETTLED)
+            break;
+        s_arcs_t *out = &builder->out [node];
+        for (int i = 0; i < out->size; i++) {
+            int v = out->arcs [i].node;
+            if (v == skip)
+                continue;
+            int64_t candidate = (int64_t) key + out->arcs [i].weight;
+            if (candidate > limit)
+                continue;
+            if (builder->reached [v] != builder->stamp || candidate < builder->distance [v]) {
+                builder->reached [v] = builder->stamp;
+                builder->distance [v] = (int) candidate;
+                dheap_push (builder->heap, v, (int) candidate);
+            }
+        }
+    }
+}
+
+//  Contract node, or just count shortcuts it needs if simulate is true.
+//  Returns number of shortcuts.
+
+static int
+s_contract (s_builder_t *builder, int node, bool simulate)
+{
+    s_arcs_t *in = &builder->in [node];
+    s_arcs_t *out = &builder->out [node];
+    int shortcuts = 0;
+    for (int i = 0; i < in->size; i++) {
+        int u = in->arcs [i].node;
+        int64_t limit = -1;
+        for (int k = 0; k < out->size; k++)
+            if (out->arcs [k].node != u
+            &&  (int64_t) in->arcs [i].weight + out->arcs [k].weight > limit)
+                limit = (int64_t) in->arcs [i].weight + out->arcs [k].weight;
+        if (limit == -1)
+            continue;
+        s_witness_search (builder, u, node, limit);
+        for (int k = 0; k < out->size; k++) {
+            int w = out->arcs [k].node;
+            int64_t via = (int64_t) in->arcs [i].weight + out->arcs [k].weight;
+            if (w == u || via >= INT_MAX)
+                continue;
+            if (builder->reached [w] == builder->stamp && builder->distance [w] <= via)
+                continue;           //  Witness is as short
+            shortcuts++;
+            if (!simulate) {
+                if (s_arcs_add (&builder->out [u], w, (int) via))
+                    builder->shortcuts++;
+                s_arcs_add (&builder->in [w], u, (int) via);
+            }
+        }
+    }
+    return shortcuts;
+}
+
+//  Get contraction priority of node, lower is contracted first
+
+static int
+s_priority (s_builder_t *builder, int node)
+{
+    int removed = builder->in [node].size + builder->out [node].size;
+    return s_contract (builder, node, true) - removed + builder->deleted [node];
+}
+
+//  Contract all nodes of graph. Edges of a node to nodes not contracted
+//  yet go up the hierarchy; the ones coming in are searched backward.
+
+static void
+s_dtable_build (dtable_t *self, graph_t *graph)
+{
+    int nodes = self->nodes;
+    s_builder_t builder = { 0 };
+    builder.nodes = nodes;
+    builder.out = (s_arcs_t *) zmalloc (nodes * sizeof (s_arcs_t));
+    builder.in = (s_arcs_t *) zmalloc (nodes * sizeof (s_arcs_t));
+    builder.deleted = (int *) zmalloc (nodes * sizeof (int));
+    builder.distance = (int *) malloc (nodes * sizeof (int));
+    builder.reached = (unsigned int *) zmalloc (nodes * sizeof (unsigned int));
+    builder.heap = dheap_new (0);
+    assert (builder.out && builder.in && builder.deleted && builder.distance && builder.reached);
+    for (int u = 0; u < nodes; u++) {
+        int degree = graph_degree (graph, u);
+        const int *targets = graph_targets (graph, u);
+        const int *weights = graph_weights (graph, u);
+        for (int i = 0; i < degree; i++)
+            if (targets [i] != u) {
+                s_arcs_add (&builder.out [u], targets [i], weights [i]);
+                s_arcs_add (&builder.in [targets [i]], u, weights [i]);
+            }
+    }
+
+    s_edges_t up = { 0 };
+    s_edges_t down = { 0 };
+    dheap_t *queue = dheap_new (nodes);
+    for (int v = 0; v < nodes; v++)
+        dheap_push (queue, v, s_priority (&builder, v));
+    int node, key;
+    while (dheap_pop (queue, &node, &key)) {
+        //  Priorities went stale as neighbours were contracted
+        int priority = s_priority (&builder, node);
+        if (dheap_size (queue) && priority > dheap_min (queue)) {
+            dheap_push (queue, node, priority);
+            continue;
+        }
+        s_contract (&builder, node, false);
+        s_arcs_t *in = &builder.in [node];
+        s_arcs_t *out = &builder.out [node];
+        for (int i = 0; i < out->size; i++) {
+            s_edges_add (&up, node, out->arcs [i].node, out->arcs [i].weight);
+            s_arcs_remove (&builder.in [out->arcs [i].node], node);
+            builder.deleted [out->arcs [i].node]++;
+        }
+        for (int i = 0; i < in->size; i++) {
+            s_edges_add (&down, node, in->arcs [i].node, in->arcs [i].weight);
+            s_arcs_remove (&builder.out [in->arcs [i].node], node);
+            builder.deleted [in->arcs [i].node]++;
+        }
+        free (in->arcs);
+        free (out->arcs);
+    }
+    dheap_destroy (&queue);
+
+    self->shortcuts = builder.shortcuts;
+    self->up = graph_new_from_edges (nodes, up.size, up.from, up.to, up.weight);
+    self->down = graph_new_from_edges (nodes, down.size, down.from, down.to, down.weight);
+    assert (self->up && self->down);
+    free (up.from);
+    free (up.to);
+    free (up.weight);
+    free (down.from);
+    free (down.to);
+    free (down.weight);
+    free (builder.out);
+    free (builder.in);
+    free (builder.deleted);
+    free (builder.distance);
+    free (builder.reached);
+    dheap_destroy (&builder.heap);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create tables over graph
+
+dtable_t *
+dtable_new (graph_t *graph)
+{
+    if (!graph || graph_nodes (graph) <= 0) return NULL;
+
+    dtable_t *self = (dtable_t *) zmalloc (sizeof (dtable_t));
+    assert (self);
+    self->nodes = graph_nodes (graph);
+    s_dtable_build (self, graph);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create tables over hierarchy saved before
+
+dtable_t *
+dtable_new_from_hierarchy (graph_t **up_p, graph_t **down_p, int shortcuts)
+{
+    assert (up_p && down_p);
+    dtable_t *self = NULL;
+    if (*up_p && *down_p && graph_nodes (*up_p) > 0
+    &&  graph_nodes (*up_p) == graph_nodes (*down_p) && shortcuts >= 0) {
+        self = (dtable_t *) zmalloc (sizeof (dtable_t));
+        assert (self);
+        self->nodes = graph_nodes (*up_p);
+        self->up = *up_p;
+        self->down = *down_p;
+        self->shortcuts = shortcuts;
+        *up_p = NULL;
+        *down_p = NULL;
+    }
+    graph_destroy (up_p);
+    graph_destroy (down_p);
+    return self;
+}
+
+
+//  Search upward from node over graph, to the end
+
+static void
+s_search_run (s_dtable_task_t *task, graph_t *graph, int from)
+{
+    if (++task->stamp == 0) {
+        //  Wrapped around, old marks would look current
+        memset (task->reached, 0, task->job->self->nodes * sizeof (unsigned int));
+        task->stamp = 1;
+    }
+    dheap_clear (task->heap);
+    task->settled_count = 0;
+    task->reached [from] = task->stamp;
+    task->distance [from] = 0;
+    dheap_push (task->heap, from, 0);
+    int node, key;
+    while (dheap_pop (task->heap, &node, &key)) {
+        if (key > task->distance [node])
+            continue;               //  Stale entry, node was reached cheaper
+        task->settled_nodes [task->settled_count++] = node;
+        int degree = graph_degree (graph, node);
+        const int *targets = graph_targets (graph, node);
+        const int *weights = graph_weights (graph, node);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            if (weights [i] >= INT_MAX - key)
+                continue;
+            int candidate = key + weights [i];
+            if (task->reached [v] != task->stamp || candidate < task->distance [v]) {
+                task->reached [v] = task->stamp;
+                task->distance [v] = candidate;
+                dheap_push (task->heap, v, candidate);
+            }
+        }
+    }
+    task->settled += task->settled_count;
+}
+
+//  Search upward from every target claimed, over reversed downward edges
+
+static void *
+s_backward_worker (void *args)
+{
+    s_dtable_task_t *task = (s_dtable_task_t *) args;
+    s_dtable_job_t *job = task->job;
+    int j;
+    while ((j = __atomic_fetch_add (&job->next, 1, __ATOMIC_RELAXED)) < job->target_count) {
+        s_search_run (task, job->self->down, job->targets [j]);
+        int count = task->settled_count;
+        int *nodes = (int *) malloc (count * sizeof (int));
+        int *distances = (int *) malloc (count * sizeof (int));
+        assert (nodes && distances);
+        for (int k = 0; k < count; k++) {
+            nodes [k] = task->settled_nodes [k];
+            distances [k] = task->distance [nodes [k]];
+        }
+        job->ball_nodes [j] = nodes;
+        job->ball_distances [j] = distances;
+        job->ball_size [j] = count;
+    }
+    return NULL;
+}
+
+//  Search upward from every source claimed, and scan buckets of nodes it
+//  settled into its row
+
+static void *
+s_forward_worker (void *args)
+{
+    s_dtable_task_t *task = (s_dtable_task_t *) args;
+    s_dtable_job_t *job = task->job;
+    int i;
+    while ((i = __atomic_fetch_add (&job->next, 1, __ATOMIC_RELAXED)) < job->source_count) {
+        int *row = (int *) matrix_get_ptr (job->table, 0, i);
+        for (int j = 0; j < job->target_count; j++)
+            row [j] = INT_MAX;
+        s_search_run (task, job->self->up, job->sources [i]);
+        for (int k = 0; k < task->settled_count; k++) {
+            int node = task->settled_nodes [k];
+            int distance = task->distance [node];
+            const dtable_entry_t *entry = job->entries + job->offsets [node];
+            const dtable_entry_t *end = job->entries + job->offsets [node + 1];
+            for (; entry < end; entry++)
+                if ((int64_t) distance + entry->distance < row [entry->target])
+                    row [entry->target] = distance + entry->distance;
+        }
+    }
+    return NULL;
+}
+
+//  Run worker on all tasks, falling back to this thread for tasks whose
+//  thread did not start
+
+static void
+s_dtable_run (s_dtable_task_t *tasks, int threads, void *(*worker) (void *))
+{
+    tasks [0].job->next = 0;
+    pthread_t thread [DTABLE_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+        if (pthread_create (&thread [t], NULL, worker, &tasks [t]) == 0)
+            started = t;
+        else
+            break;
+    worker (&tasks [0]);
+    for (int t = 1; t <= started; t++)
+        pthread_join (thread [t], NULL);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Compute shortest distances from every source to every target
+
+matrix_t *
+dtable_compute (dtable_t *self, const int *sources, int source_count,
+                const int *targets, int target_count, int threads)
+{
+    assert (self);
+    if (!sources || !targets || source_count <= 0 || target_count <= 0)
+        return NULL;
+    for (int i = 0; i < source_count; i++)
+        if (sources [i] < 0 || sources [i] >= self->nodes)
+            return NULL;
+    for (int j = 0; j < target_count; j++)
+        if (targets [j] < 0 || targets [j] >= self->nodes)
+            return NULL;
+
+    s_dtable_job_t job = { 0 };
+    job.self = self;
+    job.sources = sources;
+    job.source_count = source_count;
+    job.targets = targets;
+    job.target_count = target_count;
+    job.table = matrix_new (target_count, source_count, sizeof (int));
+    if (!job.table)
+        return NULL;
+
+    if (threads <= 0) {
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    if (threads > DTABLE_MAX_THREADS)
+        threads = DTABLE_MAX_THREADS;
+    int most = source_count > target_count ? source_count : target_count;
+    if (threads > most)
+        threads = most;
+    s_dtable_task_t tasks [DTABLE_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        tasks [t].job = &job;
+        tasks [t].distance = (int *) malloc (self->nodes * sizeof (int));
+        tasks [t].reached = (unsigned int *) zmalloc (self->nodes * sizeof (unsigned int));
+        tasks [t].stamp = 0;
+        tasks [t].settled_nodes = (int *) malloc (self->nodes * sizeof (int));
+        tasks [t].heap = dheap_new (0);
+        tasks [t].settled = 0;
+        assert (tasks [t].distance && tasks [t].reached && tasks [t].settled_nodes);
+    }
+
+    job.ball_nodes = (int **) malloc (target_count * sizeof (int *));
+    job.ball_distances = (int **) malloc (target_count * sizeof (int *));
+    job.ball_size = (int *) malloc (target_count * sizeof (int));
+    assert (job.ball_nodes && job.ball_distances && job.ball_size);
+    s_dtable_run (tasks, threads, s_backward_worker);
+
+    //  Gather nodes settled backward into their buckets
+    job.offsets = (size_t *) zmalloc ((self->nodes + 1) * sizeof (size_t));
+    assert (job.offsets);
+    size_t entries = 0;
+    for (int j = 0; j < target_count; j++) {
+        for (int k = 0; k < job.ball_size [j]; k++)
+            job.offsets [job.ball_nodes [j][k] + 1]++;
+        entries += job.ball_size [j];
+    }
+    for (int v = 0; v < self->nodes; v++)
+        job.offsets [v + 1] += job.offsets [v];
+    job.entries = (dtable_entry_t *) malloc ((entries + 1) * sizeof (dtable_entry_t));
+    size_t *fill = (size_t *) malloc ((self->nodes + 1) * sizeof (size_t));
+    assert (job.entries && fill);
+    memcpy (fill, job.offsets, self->nodes * sizeof (size_t));
+    for (int j = 0; j < target_count; j++) {
+        for (int k = 0; k < job.ball_size [j]; k++) {
+            dtable_entry_t *entry = &job.entries [fill [job.ball_nodes [j][k]]++];
+            entry->target = j;
+            entry->distance = job.ball_distances [j][k];
+        }
+        free (job.ball_nodes [j]);
+        free (job.ball_distances [j]);
+    }
+    free (fill);
+
+    s_dtable_run (tasks, threads, s_forward_worker);
+
+    self->buckets = entries;
+    self->settled = 0;
+    for (int t = 0; t < threads; t++) {
+        self->settled += tasks [t].settled;
+        free (tasks [t].distance);
+        free (tasks [t].reached);
+        free (tasks [t].settled_nodes);
+        dheap_destroy (&tasks [t].heap);
+    }
+    free (job.ball_nodes);
+    free (job.ball_distances);
+    free (job.ball_size);
+    free (job.offsets);
+    free (job.entries);
+    return job.table;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get edges going up the hierarchy
+
+graph_t *
+dtable_up (dtable_t *self)
+{
+    assert (self);
+    return self->up;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get edges coming down the hierarchy, reversed
+
+graph_t *
+dtable_down (dtable_t *self)
+{
+    assert (self);
+    return self->down;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of shortcut edges added by contraction
+
+int
+dtable_shortcuts (dtable_t *self)
+{
+    assert (self);
+    return self->shortcuts;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of bucket entries deposited for the last table
+
+size_t
+dtable_buckets (dtable_t *self)
+{
+    assert (self);
+    return self->buckets;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes settled by all searches of the last table
+
+size_t
+dtable_settled (dtable_t *self)
+{
+    assert (self);
+    return self->settled;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the tables
+
+void
+dtable_destroy (dtable_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dtable_t *self = *self_p;
+        graph_destroy (&self->up);
+        graph_destroy (&self->down);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Check every element of table against single source search
+static void
+s_test_check (matrix_t *table, graph_t *graph, const int *sources, int source_count,
+              const int *targets, int target_count)
+{
+    assert (table);
+    assert (matrix_x (table) == target_count);
+    assert (matrix_y (table) == source_count);
+    dsearch_t *search = dsearch_new (graph);
+    for (int i = 0; i < source_count; i++) {
+        dsearch_run (search, sources [i]);
+        for (int j = 0; j < target_count; j++)
+            assert (matrix_as_int (table, j, i) == dsearch_distance (search, targets [j]));
+    }
+    dsearch_destroy (&search);
+}
+
+void
+dtable_test (bool verbose)
+{
+    printf (" * dtable: ");
+
+    //  @selftest
+    //  Directed grid with random weights, one way streets and a node no
+    //  other one reaches
+    int side = 30;
+    int nodes = side * side + 1;
+    int *from = (int *) malloc (4 * nodes * sizeof (int));
+    int *to = (int *) malloc (4 * nodes * sizeof (int));
+    int *weight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (from && to && weight);
+    unsigned int seed = 5;
+    int edges = 0;
+    for (int y = 0; y < side; y++)
+        for (int x = 0; x < side; x++) {
+            int node = y * side + x;
+            int next [2] = { x + 1 < side ? node + 1 : -1, y + 1 < side ? node + side : -1 };
+            for (int k = 0; k < 2; k++) {
+                if (next [k] == -1)
+                    continue;
+                if (rand_r (&seed) % 8) {
+                    from [edges] = node;
+                    to [edges] = next [k];
+                    weight [edges++] = 1 + rand_r (&seed) % 20;
+                }
+                if (rand_r (&seed) % 8) {
+                    from [edges] = next [k];
+                    to [edges] = node;
+                    weight [edges++] = 1 + rand_r (&seed) % 20;
+                }
+            }
+        }
+    graph_t *graph = graph_new_from_edges (nodes, edges, from, to, weight);
+    assert (graph);
+    dtable_t *self = dtable_new (graph);
+    assert (self);
+
+    int sources [40], targets [60];
+    for (int i = 0; i < 40; i++)
+        sources [i] = rand_r (&seed) % nodes;
+    for (int j = 0; j < 60; j++)
+        targets [j] = rand_r (&seed) % nodes;
+    sources [1] = targets [2];                  //  Distance 0
+    sources [3] = nodes - 1;                    //  Reaches nothing else
+    targets [4] = nodes - 1;                    //  Nothing reaches it
+
+    //  Upward searches settle a fraction of the graph
+    matrix_t *table = dtable_compute (self, sources, 40, targets, 60, 1);
+    s_test_check (table, graph, sources, 40, targets, 60);
+    assert (matrix_as_int (table, 2, 1) == 0);
+    assert (matrix_as_int (table, 4, 0) == INT_MAX);
+    assert (matrix_as_int (table, 4, 3) == 0);
+    assert (dtable_buckets (self) > 0);
+    assert (dtable_settled (self) < (size_t) (40 + 60) * nodes / 2);
+    assert (dtable_shortcuts (self) > 0);
+    if (verbose)
+        printf ("\n%d shortcuts, %zu buckets, %zu settled", dtable_shortcuts (self),
+                dtable_buckets (self), dtable_settled (self));
+    matrix_destroy (&table);
+
+    //  Same table on more threads
+    for (int threads = 2; threads <= 4; threads++) {
+        table = dtable_compute (self, sources, 40, targets, 60, threads);
+        s_test_check (table, graph, sources, 40, targets, 60);
+        matrix_destroy (&table);
+    }
+
+    //  One source and one target
+    table = dtable_compute (self, sources, 1, targets + 5, 1, 0);
+    s_test_check (table, graph, sources, 1, targets + 5, 1);
+    matrix_destroy (&table);
+
+    //  Hierarchy taken over from saved graphs gives the same tables
+    graph_t *up = graph_reverse (dtable_up (self));
+    graph_t *down = graph_reverse (dtable_down (self));
+    graph_t *saved_up = graph_reverse (up);
+    graph_t *saved_down = graph_reverse (down);
+    graph_destroy (&up);
+    graph_destroy (&down);
+    dtable_t *copy = dtable_new_from_hierarchy (&saved_up, &saved_down, dtable_shortcuts (self));
+    assert (copy && !saved_up && !saved_down);
+    assert (dtable_shortcuts (copy) == dtable_shortcuts (self));
+    table = dtable_compute (copy, sources, 40, targets, 60, 2);
+    s_test_check (table, graph, sources, 40, targets, 60);
+    matrix_destroy (&table);
+    dtable_destroy (&copy);
+    saved_up = graph_reverse (graph);
+    assert (dtable_new_from_hierarchy (&saved_up, &saved_down, 0) == NULL);
+    assert (saved_up == NULL);
+
+    //  Invalid requests
+    int invalid [] = { nodes };
+    assert (dtable_compute (self, invalid, 1, targets, 60, 1) == NULL);
+    assert (dtable_compute (self, sources, 40, invalid, 1, 1) == NULL);
+    assert (dtable_compute (self, sources, 0, targets, 60, 1) == NULL);
+    dtable_destroy (&self);
+    assert (self == NULL);
+    graph_destroy (&graph);
+    free (from);
+    free (to);
+    free (weight);
+
+    if (verbose) {
+        //  Table against one full search per source, on a larger grid
+        side = 300;
+        nodes = side * side;
+        from = (int *) malloc (4 * nodes * sizeof (int));
+        to = (int *) malloc (4 * nodes * sizeof (int));
+        weight = (int *) malloc (4 * nodes * sizeof (int));
+        assert (from && to && weight);
+        edges = 0;
+        for (int node = 0; node < nodes; node++) {
+            int next [2] = { node % side + 1 < side ? node + 1 : -1,
+                             node + side < nodes ? node + side : -1 };
+            for (int k = 0; k < 2; k++)
+                if (next [k] != -1) {
+                    from [edges] = node;
+                    to [edges] = next [k];
+                    weight [edges++] = 1 + rand_r (&seed) % 100;
+                    from [edges] = next [k];
+                    to [edges] = node;
+                    weight [edges++] = 1 + rand_r (&seed) % 100;
+                }
+        }
+        graph = graph_new_from_edges (nodes, edges, from, to, weight);
+        int64_t start = zclock_usecs ();
+        self = dtable_new (graph);
+        int64_t built = zclock_usecs () - start;
+        int source_count = 100, target_count = 400;
+        int *some = (int *) malloc ((source_count + target_count) * sizeof (int));
+        assert (some);
+        for (int i = 0; i < source_count + target_count; i++)
+            some [i] = rand_r (&seed) % nodes;
+        start = zclock_usecs ();
+        table = dtable_compute (self, some, source_count, some + source_count, target_count, 0);
+        int64_t took = zclock_usecs () - start;
+        dsearch_t *search = dsearch_new (graph);
+        start = zclock_usecs ();
+        for (int i = 0; i < source_count; i++) {
+            dsearch_run (search, some [i]);
+            for (int j = 0; j < target_count; j++)
+                assert (matrix_as_int (table, j, i) == dsearch_distance (search, some [source_count + j]));
+        }
+        int64_t full = zclock_usecs () - start;
+        printf ("\nhierarchy of %d nodes, %d shortcuts in %" PRId64 " us\n"
+                "%dx%d table in %" PRId64 " us, %zu buckets, %zu settled;"
+                " %d full searches in %" PRId64 " us\n", nodes, dtable_shortcuts (self), built,
+                source_count, target_count, took, dtable_buckets (self), dtable_settled (self),
+                source_count, full);
+        dsearch_destroy (&search);
+        matrix_destroy (&table);
+        dtable_destroy (&self);
+        graph_destroy (&graph);
+        free (some);
+        free (from);
+        free (to);
+        free (weight);
+    }
+    //  @end
+    printf ("OK\n");
+}
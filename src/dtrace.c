@@ -0,0 +1,360 @@
+/*  =========================================================================
+    dtrace - Tracepoints exported as Chrome trace
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dtrace - Tracepoints exported as Chrome trace
+@discuss
+    Each thread gets its own ring on its first event, so recording is a
+    clock read, four stores and a release of the ring head, with no lock
+    and no sharing between threads. Only creating a ring and dumping take
+    the registry lock. Rings of threads which exited are kept for the dump
+    and reused by new threads once DTRACE_MAX_RINGS rings exist.
+
+    Dump writes the JSON object format of the Trace Event Format, with
+    timestamps in microseconds of the monotonic clock.
+@end
+*/
+
+#include "graphs_classes.h"
+
+#define DTRACE_MAX_RINGS    256
+
+typedef struct {
+    int64_t time;               //  Monotonic nanoseconds
+    const char *name;
+    uint64_t id;                //  Id of async event
+    char phase;
+} dtrace_record_t;
+
+typedef struct _dtrace_ring_t dtrace_ring_t;
+
+struct _dtrace_ring_t {
+    dtrace_record_t records [DTRACE_RING_SIZE];
+    uint64_t head;              //  Events recorded so far
+    int tid;                    //  Thread number in dump
+    int retired;                //  Did the thread exit?
+    dtrace_ring_t *next;
+};
+
+volatile int dtrace_active = 0;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+static pthread_key_t s_key;
+static dtrace_ring_t *s_rings = NULL;
+static int s_ring_count = 0;
+static int s_threads = 0;
+static char *s_exit_path = NULL;
+static bool s_exit_registered = false;
+
+static __thread dtrace_ring_t *s_ring = NULL;
+static __thread bool s_ring_refused = false;
+
+
+//  Thread exits, its ring stays for the dump
+
+static void
+s_ring_retire (void *ring)
+{
+    __atomic_store_n (&((dtrace_ring_t *) ring)->retired, 1, __ATOMIC_RELEASE);
+}
+
+static void
+s_key_create (void)
+{
+    pthread_key_create (&s_key, s_ring_retire);
+}
+
+//  Get ring for calling thread, NULL if none is left
+
+static dtrace_ring_t *
+s_ring_attach (void)
+{
+    pthread_once (&s_once, s_key_create);
+    dtrace_ring_t *ring = NULL;
+    pthread_mutex_lock (&s_lock);
+    if (s_ring_count < DTRACE_MAX_RINGS) {
+        ring = (dtrace_ring_t *) zmalloc (sizeof (dtrace_ring_t));
+        assert (ring);
+        ring->next = s_rings;
+        s_rings = ring;
+        s_ring_count++;
+    }
+    else {
+        //  Oldest retired ring is last in the list
+        for (dtrace_ring_t *item = s_rings; item; item = item->next)
+            if (__atomic_load_n (&item->retired, __ATOMIC_ACQUIRE))
+                ring = item;
+        if (ring) {
+            __atomic_store_n (&ring->head, 0, __ATOMIC_RELEASE);
+            ring->retired = 0;
+        }
+    }
+    if (ring)
+        ring->tid = ++s_threads;
+    pthread_mutex_unlock (&s_lock);
+
+    if (ring) {
+        pthread_setspecific (s_key, ring);
+        s_ring = ring;
+    }
+    else
+        s_ring_refused = true;
+    return ring;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Enable or disable tracing
+
+void
+dtrace_enable (bool enable)
+{
+    __atomic_store_n (&dtrace_active, enable ? 1 : 0, __ATOMIC_RELEASE);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return true if tracing is enabled
+
+bool
+dtrace_enabled (void)
+{
+    return __atomic_load_n (&dtrace_active, __ATOMIC_ACQUIRE) != 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Record event in the ring of the calling thread
+
+void
+dtrace_event (char phase, const char *name, uint64_t id)
+{
+    dtrace_ring_t *ring = s_ring;
+    if (!ring) {
+        if (s_ring_refused || !(ring = s_ring_attach ()))
+            return;
+    }
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    //  Only this thread writes the head, others read it
+    uint64_t head = ring->head;
+    dtrace_record_t *record = &ring->records [head % DTRACE_RING_SIZE];
+    record->time = (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+    record->name = name;
+    record->id = id;
+    record->phase = phase;
+    __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Write events of all threads to path as Chrome trace JSON
+
+int
+dtrace_dump (const char *path)
+{
+    FILE *file = path ? fopen (path, "w") : NULL;
+    if (!file)
+        return -1;
+
+    int pid = (int) getpid ();
+    int events = 0;
+    fprintf (file, "{\"traceEvents\":[");
+    pthread_mutex_lock (&s_lock);
+    for (dtrace_ring_t *ring = s_rings; ring; ring = ring->next) {
+        uint64_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > DTRACE_RING_SIZE ? head - DTRACE_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const dtrace_record_t *record = &ring->records [i % DTRACE_RING_SIZE];
+            fprintf (file, "%s\n{\"name\":\"%s\",\"cat\":\"graphs\",\"ph\":\"%c\","
+                     "\"ts\":%" PRId64 ".%03d,\"pid\":%d,\"tid\":%d",
+                     events ? "," : "", record->name, record->phase,
+                     record->time / 1000, (int) (record->time % 1000), pid, ring->tid);
+            if (record->phase == 'b' || record->phase == 'e')
+                fprintf (file, ",\"id\":\"0x%" PRIx64 "\"", record->id);
+            fprintf (file, "}");
+            events++;
+        }
+    }
+    pthread_mutex_unlock (&s_lock);
+    fprintf (file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    if (fclose (file) != 0)
+        return -1;
+    return events;
+}
+
+
+//  Dump registered with atexit
+
+static void
+s_dump_at_exit (void)
+{
+    pthread_mutex_lock (&s_lock);
+    char *path = s_exit_path;
+    s_exit_path = NULL;
+    pthread_mutex_unlock (&s_lock);
+    if (path) {
+        dtrace_enable (false);
+        int events = dtrace_dump (path);
+        if (events == -1)
+            zsys_error ("dtrace: cannot write trace to %s", path);
+        else
+            zsys_info ("dtrace: %d events written to %s", events, path);
+        free (path);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Dump events to path when the process exits
+
+void
+dtrace_dump_at_exit (const char *path)
+{
+    pthread_mutex_lock (&s_lock);
+    free (s_exit_path);
+    s_exit_path = path ? strdup (path) : NULL;
+    bool do_register = !s_exit_registered;
+    s_exit_registered = true;
+    pthread_mutex_unlock (&s_lock);
+    if (do_register)
+        atexit (s_dump_at_exit);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Forget events recorded so far. Owner threads bump head of their ring
+//  without the lock, so this is only safe while nothing records.
+
+void
+dtrace_clear (void)
+{
+    assert (!dtrace_enabled ());
+    pthread_mutex_lock (&s_lock);
+    for (dtrace_ring_t *ring = s_rings; ring; ring = ring->next)
+        __atomic_store_n (&ring->head, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock (&s_lock);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Records begin and end of count spans in a thread of its own
+static void *
+s_test_worker (void *args)
+{
+    int count = *(int *) args;
+    for (int i = 0; i < count; i++) {
+        DTRACE_BEGIN ("worker");
+        DTRACE_END ("worker");
+    }
+    DTRACE_ASYNC_END ("handover", 7);
+    return NULL;
+}
+
+//  Count occurrences of text in file
+static int
+s_test_count (const char *path, const char *text)
+{
+    zchunk_t *chunk = zchunk_slurp (path, 0);
+    assert (chunk);
+    int count = 0;
+    size_t size = zchunk_size (chunk);
+    const char *data = (const char *) zchunk_data (chunk);
+    size_t length = strlen (text);
+    for (size_t i = 0; i + length <= size; i++)
+        if (memcmp (data + i, text, length) == 0)
+            count++;
+    zchunk_destroy (&chunk);
+    return count;
+}
+
+void
+dtrace_test (bool verbose)
+{
+    printf (" * dtrace: ");
+
+    //  @selftest
+    zsys_dir_create (SELFTEST_DIR_RW);
+    char *filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RW, "dtrace.json");
+    assert (filename);
+    assert (!dtrace_enabled ());
+    dtrace_clear ();
+
+    //  Disabled tracepoints record nothing
+    int64_t start = zclock_usecs ();
+    const int loops = 10000000;
+    for (int i = 0; i < loops; i++)
+        DTRACE_BEGIN ("disabled");
+    int64_t disabled = zclock_usecs () - start;
+    assert (dtrace_dump (filename) == 0);
+
+    dtrace_enable (true);
+    assert (dtrace_enabled ());
+    DTRACE_BEGIN ("test");
+    DTRACE_BEGIN ("inner");
+    DTRACE_END ("inner");
+    DTRACE_ASYNC_BEGIN ("handover", 7);
+    DTRACE_END ("test");
+
+    //  Thread ends span begun here, and wraps its ring
+    int count = DTRACE_RING_SIZE;
+    pthread_t thread;
+    assert (pthread_create (&thread, NULL, s_test_worker, &count) == 0);
+    pthread_join (thread, NULL);
+    start = zclock_usecs ();
+    for (int i = 0; i < DTRACE_RING_SIZE / 2; i++)
+        DTRACE_BEGIN ("enabled");
+    int64_t enabled = zclock_usecs () - start;
+    dtrace_enable (false);
+
+    assert (dtrace_dump (filename) == 5 + DTRACE_RING_SIZE / 2 + DTRACE_RING_SIZE);
+    assert (s_test_count (filename, "\"traceEvents\"") == 1);
+    assert (s_test_count (filename, "\"ph\"") == 5 + DTRACE_RING_SIZE / 2 + DTRACE_RING_SIZE);
+    assert (s_test_count (filename, "\"name\":\"inner\",\"cat\":\"graphs\",\"ph\":\"B\"") == 1);
+    assert (s_test_count (filename, "\"ph\":\"b\"") == 1);
+    assert (s_test_count (filename, "\"ph\":\"e\"") == 1);
+    assert (s_test_count (filename, "\"id\":\"0x7\"") == 2);
+    //  Oldest worker events were overwritten
+    assert (s_test_count (filename, "\"name\":\"worker\"") == DTRACE_RING_SIZE - 1);
+    assert (s_test_count (filename, "\"name\":\"disabled\"") == 0);
+    if (verbose)
+        printf ("\ntracepoint costs %.2f ns disabled, %.1f ns enabled\n",
+                disabled * 1000.0 / loops, enabled * 1000.0 / (DTRACE_RING_SIZE / 2));
+
+    dtrace_clear ();
+    assert (dtrace_dump (filename) == 0);
+    assert (dtrace_dump (SELFTEST_DIR_RW "/missing/dtrace.json") == -1);
+    dtrace_dump_at_exit (filename);
+    dtrace_dump_at_exit (NULL);
+    zsys_file_delete (filename);
+    zstr_free (&filename);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,194 @@
+/*  =========================================================================
+    dunion - Lock-free union-find forest
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dunion - Lock-free union-find forest
+@discuss
+    Disjoint sets shared by several threads without locks. Roots are
+    linked with compare-and-swap, always from the larger id to the smaller
+    one, so concurrent unions never form a cycle and the root of every
+    tree is its smallest node. Finds halve the path on the way; a halving
+    step which loses a race is simply skipped.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _dunion_t {
+    int size;
+    int *parent;                //  Parent of node, parent of root is itself
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new forest of size single node trees
+
+dunion_t *
+dunion_new (int size)
+{
+    if (size < 0) return NULL;
+
+    dunion_t *self = (dunion_t *) zmalloc (sizeof (dunion_t));
+    assert (self);
+    self->size = size;
+    self->parent = (int *) malloc ((size + 1) * sizeof (int));
+    assert (self->parent);
+    dunion_reset (self);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Make every node a single node tree again
+
+void
+dunion_reset (dunion_t *self)
+{
+    assert (self);
+    for (int u = 0; u < self->size; u++)
+        self->parent [u] = u;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Find root of node, halving the path on the way
+
+int
+dunion_find (dunion_t *self, int node)
+{
+    assert (self);
+    int *parent = self->parent;
+    while (true) {
+        int up = __atomic_load_n (&parent [node], __ATOMIC_RELAXED);
+        if (up == node)
+            return node;
+        int grand = __atomic_load_n (&parent [up], __ATOMIC_RELAXED);
+        if (grand != up)
+            __atomic_compare_exchange_n (&parent [node], &up, grand, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        node = grand;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Unite trees of both nodes
+
+bool
+dunion_unite (dunion_t *self, int a, int b)
+{
+    assert (self);
+    while (true) {
+        a = dunion_find (self, a);
+        b = dunion_find (self, b);
+        if (a == b)
+            return false;
+        if (a < b) {
+            int swap = a;
+            a = b;
+            b = swap;
+        }
+        //  Fails if a stopped being root meanwhile, then try again
+        int expected = a;
+        if (__atomic_compare_exchange_n (&self->parent [a], &expected, b, false,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return true;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Point every node straight to its root
+
+void
+dunion_flatten (dunion_t *self)
+{
+    assert (self);
+    //  Parent of node is never larger than node, so one pass in id order
+    //  sees every parent already flat
+    for (int u = 0; u < self->size; u++)
+        self->parent [u] = self->parent [self->parent [u]];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+dunion_size (dunion_t *self)
+{
+    if (!self) return 0;
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the forest
+
+void
+dunion_destroy (dunion_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dunion_t *self = *self_p;
+        free (self->parent);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+dunion_test (bool verbose)
+{
+    printf (" * dunion: ");
+
+    //  @selftest
+    dunion_t *self = dunion_new (8);
+    assert (self);
+    assert (dunion_size (self) == 8);
+    assert (dunion_find (self, 5) == 5);
+    assert (dunion_unite (self, 7, 5));
+    assert (dunion_unite (self, 5, 6));
+    assert (dunion_unite (self, 3, 6));
+    assert (!dunion_unite (self, 7, 3));
+    //  Root is the smallest node of the tree
+    assert (dunion_find (self, 7) == 3);
+    assert (dunion_find (self, 0) == 0);
+    dunion_flatten (self);
+    assert (dunion_find (self, 6) == 3);
+    dunion_reset (self);
+    assert (dunion_find (self, 7) == 7);
+    dunion_destroy (&self);
+    assert (dunion_new (-1) == NULL);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,63 @@
+/*  =========================================================================
+    dunion - Lock-free union-find forest
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef DUNION_H_INCLUDED
+#define DUNION_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new forest of size single node trees
+GRAPHS_PRIVATE dunion_t *
+    dunion_new (int size);
+
+//  Make every node a single node tree again
+GRAPHS_PRIVATE void
+    dunion_reset (dunion_t *self);
+
+//  Find root of node. Safe to call from several threads at once.
+GRAPHS_PRIVATE int
+    dunion_find (dunion_t *self, int node);
+
+//  Unite trees of both nodes, root with larger id goes under the smaller.
+//  Returns true if the trees were different. Safe to call from several
+//  threads at once; exactly one of racing calls merging the same two
+//  trees returns true.
+GRAPHS_PRIVATE bool
+    dunion_unite (dunion_t *self, int a, int b);
+
+//  Point every node straight to its root. Not thread safe.
+GRAPHS_PRIVATE void
+    dunion_flatten (dunion_t *self);
+
+//  Get number of nodes
+GRAPHS_PRIVATE int
+    dunion_size (dunion_t *self);
+
+//  Destroy the forest
+GRAPHS_PRIVATE void
+    dunion_destroy (dunion_t **self_p);
+
+//  Self test of this class
+GRAPHS_PRIVATE void
+    dunion_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,322 @@
+/*  =========================================================================
+    dversion - Published versions of a distance matrix
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    dversion - Published versions of a distance matrix
+@discuss
+    Writers change a private fork of the latest version (see dsnapshot),
+    which copies only the rows they touch, and publish it by swapping one
+    pointer. Readers take the latest version without any lock and keep
+    it, unchanged, for as long as they hold their reference; a search
+    started before an update finishes on the version it started with.
+
+    The store itself holds a reference to the latest version. Reader takes
+    its own reference right after loading the pointer, so a replaced
+    version cannot be dropped by the store while some reader is between
+    these two steps. Readers announce this window in a counter; replaced
+    versions are kept until the writer sees the counter at zero, which is
+    a grace period after which nobody can take them any more. Then the
+    store drops its reference, and the last reader to drop its own frees
+    the version and the blocks no other version shares.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _dversion_t {
+    dsnapshot_t *current;       //  Latest published version
+    uint64_t version;           //  Its number
+    int acquiring;              //  Readers between load and reference
+    pthread_mutex_t writer;     //  Serializes writers
+    dsnapshot_t *pending;       //  Version being prepared, NULL if none
+    zlist_t *retired;           //  Replaced versions still referenced
+};
+
+
+//  Drop replaced versions once no reader can be taking them any more
+
+static void
+s_dversion_reclaim (dversion_t *self)
+{
+    if (!zlist_size (self->retired))
+        return;
+    if (__atomic_load_n (&self->acquiring, __ATOMIC_SEQ_CST) != 0)
+        return;                 //  Try again on next publish
+    dsnapshot_t *snapshot = (dsnapshot_t *) zlist_pop (self->retired);
+    while (snapshot) {
+        dsnapshot_destroy (&snapshot);
+        snapshot = (dsnapshot_t *) zlist_pop (self->retired);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create store publishing a copy of matrix as version 1
+
+dversion_t *
+dversion_new (matrix_t *distances, int block_rows)
+{
+    dsnapshot_t *first = dsnapshot_new (distances, block_rows);
+    if (!first) return NULL;
+
+    dversion_t *self = (dversion_t *) zmalloc (sizeof (dversion_t));
+    assert (self);
+    dsnapshot_matrix (first);
+    self->current = first;
+    self->version = dsnapshot_version (first);
+    self->retired = zlist_new ();
+    int rc = pthread_mutex_init (&self->writer, NULL);
+    assert (rc == 0);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get the latest published version
+
+dsnapshot_t *
+dversion_acquire (dversion_t *self)
+{
+    assert (self);
+    __atomic_add_fetch (&self->acquiring, 1, __ATOMIC_SEQ_CST);
+    dsnapshot_t *snapshot = __atomic_load_n (&self->current, __ATOMIC_SEQ_CST);
+    dsnapshot_ref (snapshot);
+    __atomic_sub_fetch (&self->acquiring, 1, __ATOMIC_SEQ_CST);
+    return snapshot;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of the latest published version
+
+uint64_t
+dversion_current (dversion_t *self)
+{
+    assert (self);
+    return __atomic_load_n (&self->version, __ATOMIC_ACQUIRE);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set element in the version being prepared
+
+void
+dversion_set (dversion_t *self, unsigned int x, unsigned int y, void *element)
+{
+    assert (self);
+    pthread_mutex_lock (&self->writer);
+    if (!self->pending)
+        self->pending = dsnapshot_fork (self->current);
+    dsnapshot_set (self->pending, x, y, element);
+    pthread_mutex_unlock (&self->writer);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set int element in the version being prepared
+
+void
+dversion_set_int (dversion_t *self, unsigned int x, unsigned int y, int element)
+{
+    dversion_set (self, x, y, &element);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Publish the version being prepared
+
+uint64_t
+dversion_publish (dversion_t *self)
+{
+    assert (self);
+    pthread_mutex_lock (&self->writer);
+    if (self->pending) {
+        //  View is built here, readers only ever read it
+        dsnapshot_matrix (self->pending);
+        dsnapshot_t *replaced = __atomic_exchange_n (&self->current, self->pending, __ATOMIC_SEQ_CST);
+        __atomic_store_n (&self->version, dsnapshot_version (self->pending), __ATOMIC_RELEASE);
+        self->pending = NULL;
+        zlist_append (self->retired, replaced);
+    }
+    s_dversion_reclaim (self);
+    uint64_t version = self->version;
+    pthread_mutex_unlock (&self->writer);
+    return version;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of replaced versions the store still holds
+
+size_t
+dversion_retired (dversion_t *self)
+{
+    assert (self);
+    pthread_mutex_lock (&self->writer);
+    size_t retired = zlist_size (self->retired);
+    pthread_mutex_unlock (&self->writer);
+    return retired;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the store
+
+void
+dversion_destroy (dversion_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        dversion_t *self = *self_p;
+        dsnapshot_t *snapshot = (dsnapshot_t *) zlist_pop (self->retired);
+        while (snapshot) {
+            dsnapshot_destroy (&snapshot);
+            snapshot = (dsnapshot_t *) zlist_pop (self->retired);
+        }
+        zlist_destroy (&self->retired);
+        dsnapshot_destroy (&self->pending);
+        dsnapshot_destroy (&self->current);
+        pthread_mutex_destroy (&self->writer);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+typedef struct {
+    dversion_t *store;
+    int nodes;
+    bool stop;
+    size_t reads;
+    bool consistent;
+} s_test_reader_t;
+
+//  Writer keeps every row constant within a version, so a reader which
+//  sees two values in one row has seen an update in place
+
+static void *
+s_test_reader (void *args)
+{
+    s_test_reader_t *reader = (s_test_reader_t *) args;
+    reader->consistent = true;
+    while (!__atomic_load_n (&reader->stop, __ATOMIC_ACQUIRE)) {
+        dsnapshot_t *snapshot = dversion_acquire (reader->store);
+        matrix_t *view = dsnapshot_matrix (snapshot);
+        for (int y = 0; y < reader->nodes; y++) {
+            const int *row = (const int *) matrix_get_ptr (view, 0, y);
+            for (int x = 1; x < reader->nodes; x++)
+                if (row [x] != row [0])
+                    reader->consistent = false;
+        }
+        dsnapshot_destroy (&snapshot);
+        reader->reads++;
+    }
+    return NULL;
+}
+
+void
+dversion_test (bool verbose)
+{
+    printf (" * dversion: ");
+
+    //  @selftest
+    matrix_t *distances = matrix_new (4, 4, sizeof (int));
+    matrix_set_int (distances, 1, 0, 5);
+    dversion_t *self = dversion_new (distances, 0);
+    assert (self);
+    assert (dversion_current (self) == 1);
+
+    //  Reader keeps its version while writer publishes the next one
+    dsnapshot_t *reader = dversion_acquire (self);
+    dversion_set_int (self, 1, 0, 7);
+    dversion_set_int (self, 2, 3, 1);
+    assert (dversion_current (self) == 1);
+    assert (dversion_publish (self) == 2);
+    assert (matrix_as_int (dsnapshot_matrix (reader), 1, 0) == 5);
+    dsnapshot_t *latest = dversion_acquire (self);
+    assert (dsnapshot_version (latest) == 2);
+    assert (matrix_as_int (dsnapshot_matrix (latest), 1, 0) == 7);
+    assert (matrix_as_int (dsnapshot_matrix (latest), 2, 3) == 1);
+    //  Rows nobody changed are shared
+    assert (matrix_get_ptr (dsnapshot_matrix (latest), 0, 1)
+         == matrix_get_ptr (dsnapshot_matrix (reader), 0, 1));
+    //  Nothing pending, nothing published
+    assert (dversion_publish (self) == 2);
+    //  Replaced version is dropped by the store, reader still has it
+    assert (dversion_retired (self) == 0);
+    assert (matrix_as_int (dsnapshot_matrix (reader), 2, 3) == 0);
+    dsnapshot_destroy (&reader);
+    dsnapshot_destroy (&latest);
+    //  Snapshots outlive the store
+    reader = dversion_acquire (self);
+    dversion_destroy (&self);
+    assert (matrix_as_int (dsnapshot_matrix (reader), 1, 0) == 7);
+    dsnapshot_destroy (&reader);
+    matrix_destroy (&distances);
+
+    //  Readers in other threads never see a half written version
+    const int nodes = 64;
+    distances = matrix_new (nodes, nodes, sizeof (int));
+    self = dversion_new (distances, 4);
+    s_test_reader_t readers [2];
+    pthread_t thread [2];
+    for (int t = 0; t < 2; t++) {
+        readers [t].store = self;
+        readers [t].nodes = nodes;
+        readers [t].stop = false;
+        readers [t].reads = 0;
+        int rc = pthread_create (&thread [t], NULL, s_test_reader, &readers [t]);
+        assert (rc == 0);
+    }
+    for (int version = 1; version <= 200; version++) {
+        int y = version % nodes;
+        for (int x = 0; x < nodes; x++)
+            dversion_set_int (self, x, y, version);
+        dversion_publish (self);
+        if (version % 50 == 0)
+            zclock_sleep (1);
+    }
+    for (int t = 0; t < 2; t++) {
+        __atomic_store_n (&readers [t].stop, true, __ATOMIC_RELEASE);
+        pthread_join (thread [t], NULL);
+        assert (readers [t].consistent);
+        assert (readers [t].reads > 0);
+    }
+    assert (dversion_current (self) == 201);
+    dversion_publish (self);
+    assert (dversion_retired (self) == 0);
+    if (verbose)
+        printf ("\n%zu and %zu reads\n", readers [0].reads, readers [1].reads);
+    dversion_destroy (&self);
+    matrix_destroy (&distances);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,470 @@
+/*  =========================================================================
+    graph - Sparse adjacency of a distance graph
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    graph - Sparse adjacency of a distance graph
+@discuss
+    Edges are kept in compressed sparse row layout: targets and weights of
+    all edges going out of node u are stored next to each other, sorted by
+    target, starting at offsets [u]. Memory use is O(V + E) instead of the
+    O(V^2) of a dense matrix_t.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _graph_t {
+    int nodes;
+    int edges;
+    int *offsets;               //  nodes + 1 items
+    int *targets;               //  edges items
+    int *weights;               //  edges items
+    bool view;                  //  Arrays belong to somebody else
+};
+
+typedef struct {
+    int target;
+    int weight;
+} graph_edge_t;
+
+static int
+s_edge_compare (const void *a, const void *b)
+{
+    const graph_edge_t *ea = (const graph_edge_t *) a;
+    const graph_edge_t *eb = (const graph_edge_t *) b;
+    return (ea->target > eb->target) - (ea->target < eb->target);
+}
+
+//  Allocate graph with offsets already set from degree [u] stored at
+//  offsets [u + 1]
+
+static graph_t *
+s_graph_alloc (int nodes, int *offsets)
+{
+    graph_t *self = (graph_t *) zmalloc (sizeof (graph_t));
+    assert (self);
+    self->nodes = nodes;
+    self->offsets = offsets;
+    for (int u = 0; u < nodes; u++)
+        self->offsets [u + 1] += self->offsets [u];
+    self->edges = self->offsets [nodes];
+    self->targets = (int *) malloc ((self->edges + 1) * sizeof (int));
+    self->weights = (int *) malloc ((self->edges + 1) * sizeof (int));
+    assert (self->targets && self->weights);
+    return self;
+}
+
+//  Sort adjacency of every node by target, edges are given as pairs
+
+static void
+s_graph_fill_sorted (graph_t *self, graph_edge_t *edges)
+{
+    for (int u = 0; u < self->nodes; u++) {
+        int begin = self->offsets [u];
+        int end = self->offsets [u + 1];
+        qsort (&edges [begin], end - begin, sizeof (graph_edge_t), s_edge_compare);
+        for (int e = begin; e < end; e++) {
+            self->targets [e] = edges [e].target;
+            self->weights [e] = edges [e].weight;
+        }
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a graph from a distance matrix
+
+graph_t *
+graph_new_from_matrix (matrix_t *distances)
+{
+    if (!distances || matrix_element_size (distances) != sizeof (int)) return NULL;
+    int nodes = matrix_x (distances);
+    if (nodes != matrix_y (distances)) return NULL;
+
+    int *offsets = (int *) zmalloc ((nodes + 1) * sizeof (int));
+    assert (offsets);
+    for (int u = 0; u < nodes; u++) {
+        const int *row = (const int *) matrix_get_ptr (distances, 0, u);
+        for (int v = 0; v < nodes; v++)
+            if (row [v] > 0)
+                offsets [u + 1]++;
+    }
+    graph_t *self = s_graph_alloc (nodes, offsets);
+    //  Rows are scanned in order of targets, so no sort is needed
+    for (int u = 0; u < nodes; u++) {
+        const int *row = (const int *) matrix_get_ptr (distances, 0, u);
+        int e = self->offsets [u];
+        for (int v = 0; v < nodes; v++) {
+            if (row [v] > 0) {
+                self->targets [e] = v;
+                self->weights [e] = row [v];
+                e++;
+            }
+        }
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a graph over adjacency arrays of another owner
+
+graph_t *
+graph_new_view (int nodes, int *offsets, int *targets, int *weights)
+{
+    if (nodes <= 0 || !offsets || !targets || !weights) return NULL;
+    if (offsets [0] != 0) return NULL;
+    for (int u = 0; u < nodes; u++)
+        if (offsets [u + 1] < offsets [u])
+            return NULL;
+
+    graph_t *self = (graph_t *) zmalloc (sizeof (graph_t));
+    assert (self);
+    self->nodes = nodes;
+    self->edges = offsets [nodes];
+    self->offsets = offsets;
+    self->targets = targets;
+    self->weights = weights;
+    self->view = true;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a graph from list of edges
+
+graph_t *
+graph_new_from_edges (int nodes, int edges, const int *from, const int *to, const int *weight)
+{
+    if (nodes <= 0 || edges < 0) return NULL;
+
+    int *offsets = (int *) zmalloc ((nodes + 1) * sizeof (int));
+    assert (offsets);
+    for (int i = 0; i < edges; i++) {
+        if (from [i] < 0 || from [i] >= nodes || to [i] < 0 || to [i] >= nodes || weight [i] <= 0)
+            continue;
+        offsets [from [i] + 1]++;
+    }
+    graph_t *self = s_graph_alloc (nodes, offsets);
+    graph_edge_t *pairs = (graph_edge_t *) malloc ((self->edges + 1) * sizeof (graph_edge_t));
+    int *next = (int *) malloc (nodes * sizeof (int));
+    assert (pairs && next);
+    memcpy (next, self->offsets, nodes * sizeof (int));
+    for (int i = 0; i < edges; i++) {
+        if (from [i] < 0 || from [i] >= nodes || to [i] < 0 || to [i] >= nodes || weight [i] <= 0)
+            continue;
+        int e = next [from [i]]++;
+        pairs [e].target = to [i];
+        pairs [e].weight = weight [i];
+    }
+    s_graph_fill_sorted (self, pairs);
+    free (next);
+    free (pairs);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+graph_nodes (graph_t *self)
+{
+    if (!self) return 0;
+    return self->nodes;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges
+
+int
+graph_edges (graph_t *self)
+{
+    if (!self) return 0;
+    return self->edges;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges going out of node
+
+int
+graph_degree (graph_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return 0;
+    return self->offsets [node + 1] - self->offsets [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get targets of edges going out of node
+
+const int *
+graph_targets (graph_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return NULL;
+    return &self->targets [self->offsets [node]];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get weights of edges going out of node
+
+const int *
+graph_weights (graph_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->nodes) return NULL;
+    return &self->weights [self->offsets [node]];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Change weight of existing edge
+
+int
+graph_set_weight (graph_t *self, int from, int to, int weight)
+{
+    if (!self || from < 0 || from >= self->nodes) return -1;
+    //  Targets of node are sorted
+    int low = self->offsets [from];
+    int high = self->offsets [from + 1];
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (self->targets [middle] < to)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == self->offsets [from + 1] || self->targets [low] != to)
+        return -1;
+    self->weights [low] = weight;
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get index of the first edge going out of node
+
+int
+graph_offset (graph_t *self, int node)
+{
+    if (!self || node < 0 || node > self->nodes) return -1;
+    return self->offsets [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a graph with all edges reversed
+
+graph_t *
+graph_reverse (graph_t *self)
+{
+    if (!self) return NULL;
+
+    int *offsets = (int *) zmalloc ((self->nodes + 1) * sizeof (int));
+    assert (offsets);
+    for (int e = 0; e < self->edges; e++)
+        offsets [self->targets [e] + 1]++;
+    graph_t *result = s_graph_alloc (self->nodes, offsets);
+    int *next = (int *) malloc ((self->nodes + 1) * sizeof (int));
+    assert (next);
+    memcpy (next, result->offsets, self->nodes * sizeof (int));
+    //  Sources are visited in ascending order, so targets come out sorted
+    for (int u = 0; u < self->nodes; u++) {
+        for (int i = self->offsets [u]; i < self->offsets [u + 1]; i++) {
+            int e = next [self->targets [i]]++;
+            result->targets [e] = u;
+            result->weights [e] = self->weights [i];
+        }
+    }
+    free (next);
+    return result;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a copy of the graph with nodes renamed
+
+graph_t *
+graph_permute (graph_t *self, const int *new_id)
+{
+    if (!self || !new_id) return NULL;
+
+    int *offsets = (int *) zmalloc ((self->nodes + 1) * sizeof (int));
+    assert (offsets);
+    for (int u = 0; u < self->nodes; u++)
+        offsets [new_id [u] + 1] = graph_degree (self, u);
+    graph_t *result = s_graph_alloc (self->nodes, offsets);
+    graph_edge_t *pairs = (graph_edge_t *) malloc ((self->edges + 1) * sizeof (graph_edge_t));
+    assert (pairs);
+    for (int u = 0; u < self->nodes; u++) {
+        int e = result->offsets [new_id [u]];
+        for (int i = self->offsets [u]; i < self->offsets [u + 1]; i++, e++) {
+            pairs [e].target = new_id [self->targets [i]];
+            pairs [e].weight = self->weights [i];
+        }
+    }
+    s_graph_fill_sorted (result, pairs);
+    free (pairs);
+    return result;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get average distance between ids of adjacent nodes
+
+double
+graph_edge_span (graph_t *self)
+{
+    if (!self || !self->edges) return 0;
+    double span = 0;
+    for (int u = 0; u < self->nodes; u++)
+        for (int i = self->offsets [u]; i < self->offsets [u + 1]; i++)
+            span += abs (self->targets [i] - u);
+    return span / self->edges;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the graph
+
+void
+graph_destroy (graph_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        graph_t *self = *self_p;
+        if (!self->view) {
+            free (self->offsets);
+            free (self->targets);
+            free (self->weights);
+        }
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+graph_test (bool verbose)
+{
+    printf (" * graph: ");
+
+    //  @selftest
+    //  Graph from matrix skips zero weights
+    matrix_t *d = matrix_new (4, 4, sizeof (int));
+    matrix_set_int (d, 1, 0, 5);
+    matrix_set_int (d, 3, 0, 2);
+    matrix_set_int (d, 0, 1, 5);
+    matrix_set_int (d, 2, 3, 7);
+    graph_t *self = graph_new_from_matrix (d);
+    assert (self);
+    assert (graph_nodes (self) == 4);
+    assert (graph_edges (self) == 4);
+    assert (graph_degree (self, 0) == 2);
+    assert (graph_targets (self, 0) [0] == 1);
+    assert (graph_weights (self, 0) [0] == 5);
+    assert (graph_targets (self, 0) [1] == 3);
+    assert (graph_degree (self, 2) == 0);
+    assert (graph_targets (self, 3) [0] == 2);
+    assert (graph_weights (self, 3) [0] == 7);
+
+    //  Same graph from edge list, given unsorted and with invalid edges
+    int from [] = { 3, 0, 1, 0, 2, 9 };
+    int to [] = { 2, 3, 0, 1, 1, 0 };
+    int weight [] = { 7, 2, 5, 5, 0, 1 };
+    graph_t *copy = graph_new_from_edges (4, 6, from, to, weight);
+    assert (graph_edges (copy) == 4);
+    for (int u = 0; u < 4; u++) {
+        assert (graph_degree (copy, u) == graph_degree (self, u));
+        for (int i = 0; i < graph_degree (self, u); i++) {
+            assert (graph_targets (copy, u) [i] == graph_targets (self, u) [i]);
+            assert (graph_weights (copy, u) [i] == graph_weights (self, u) [i]);
+        }
+    }
+    graph_destroy (&copy);
+
+    //  Renaming nodes keeps edges
+    int new_id [] = { 3, 2, 1, 0 };
+    copy = graph_permute (self, new_id);
+    assert (graph_edges (copy) == 4);
+    assert (graph_degree (copy, 3) == 2);
+    assert (graph_targets (copy, 3) [0] == 0);
+    assert (graph_weights (copy, 3) [0] == 2);
+    assert (graph_targets (copy, 3) [1] == 2);
+    assert (graph_weights (copy, 3) [1] == 5);
+    assert (graph_edge_span (copy) == graph_edge_span (self));
+    graph_destroy (&copy);
+
+    //  Reversed edges, numbered from offsets
+    copy = graph_reverse (self);
+    assert (graph_edges (copy) == 4);
+    assert (graph_degree (copy, 0) == 1);
+    assert (graph_targets (copy, 0) [0] == 1);
+    assert (graph_degree (copy, 1) == 1);
+    assert (graph_degree (copy, 2) == 1);
+    assert (graph_targets (copy, 2) [0] == 3);
+    assert (graph_weights (copy, 2) [0] == 7);
+    assert (graph_offset (copy, 0) == 0);
+    assert (graph_offset (copy, 4) == 4);
+    assert (graph_offset (self, 1) == 2);
+    graph_destroy (&copy);
+
+    //  Weights change in place, edges do not
+    assert (graph_set_weight (self, 3, 2, 4) == 0);
+    assert (graph_weights (self, 3) [0] == 4);
+    assert (graph_set_weight (self, 0, 3, 1) == 0);
+    assert (graph_weights (self, 0) [1] == 1);
+    assert (graph_set_weight (self, 3, 1, 4) == -1);
+    assert (graph_set_weight (self, 4, 0, 1) == -1);
+
+    //  View works on caller's arrays in place
+    int offsets [] = { 0, 2, 2, 3 };
+    int targets [] = { 1, 2, 0 };
+    int weights [] = { 4, 5, 6 };
+    graph_t *view = graph_new_view (3, offsets, targets, weights);
+    assert (view);
+    assert (graph_edges (view) == 3);
+    assert (graph_degree (view, 1) == 0);
+    assert (graph_targets (view, 2) [0] == 0);
+    assert (graph_set_weight (view, 0, 2, 9) == 0);
+    assert (weights [1] == 9);
+    graph_destroy (&view);
+    assert (weights [0] == 4);
+    offsets [2] = 1;
+    assert (graph_new_view (3, offsets, targets, weights) == NULL);
+
+    graph_destroy (&self);
+    matrix_destroy (&d);
+    //  @end
+    printf ("OK\n");
+}
@@ -19,16 +19,723 @@
 */
 
 #include "graphs_classes.h"
+#include <sys/wait.h>
+#if defined (__linux__)
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#endif
+
+//  Open hardware cache miss counter of this process, -1 if not available
+
+static int
+s_cache_counter_open (void)
+{
+#if defined (__linux__)
+    struct perf_event_attr attr;
+    memset (&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void
+s_cache_counter_start (int fd)
+{
+#if defined (__linux__)
+    if (fd >= 0) {
+        ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+static int64_t
+s_cache_counter_stop (int fd)
+{
+    int64_t misses = -1;
+#if defined (__linux__)
+    if (fd >= 0) {
+        ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read (fd, &misses, sizeof (misses)) != sizeof (misses))
+            misses = -1;
+    }
+#endif
+    return misses;
+}
+
+//  Run queries over search, return msecs per query
+
+static double
+s_bench_queries (dsearch_t *search, reorder_t *order, const int *sources, int queries)
+{
+    //  Warm up, then measure queries translated to new ids
+    dsearch_run (search, 0);
+    int64_t start = zclock_usecs ();
+    int64_t checksum = 0;
+    for (int i = 0; i < queries; i++) {
+        int source = order ? reorder_to_new (order, sources [i]) : sources [i];
+        dsearch_run (search, source);
+        checksum += dsearch_distance (search, order ? reorder_to_new (order, 0) : 0);
+    }
+    if (checksum < 0)
+        printf ("unexpected checksum\n");
+    return (zclock_usecs () - start) / 1000.0 / queries;
+}
+
+//  Benchmark distance oracles of growing size against exact searches from
+//  sources, to all nodes
+
+static void
+s_bench_oracle (graph_t *graph, const int *sources, int queries)
+{
+    int nodes = graph_nodes (graph);
+    dsearch_t *search = dsearch_new (graph);
+    printf ("%-9s %10s %10s %12s %12s\n", "landmarks", "build ms", "size KB", "usecs/est", "mean error");
+    for (int landmarks = 4; landmarks <= 64; landmarks *= 4) {
+        int64_t start = zclock_usecs ();
+        doracle_t *oracle = doracle_new (graph, landmarks, 0);
+        double build = (zclock_usecs () - start) / 1000.0;
+        int64_t checksum = 0;
+        start = zclock_usecs ();
+        for (int i = 0; i < queries; i++)
+            for (int v = 0; v < nodes; v++)
+                checksum += doracle_estimate (oracle, sources [i], v, NULL);
+        double estimate = (double) (zclock_usecs () - start) / queries / nodes;
+        double error = 0;
+        int counted = 0;
+        for (int i = 0; i < queries; i++) {
+            dsearch_run (search, sources [i]);
+            for (int v = 0; v < nodes; v++) {
+                int exact = dsearch_distance (search, v);
+                if (exact > 0 && exact != INT_MAX) {
+                    error += (double) (doracle_estimate (oracle, sources [i], v, NULL) - exact) / exact;
+                    counted++;
+                }
+            }
+        }
+        if (checksum < 0)
+            printf ("unexpected checksum\n");
+        printf ("%-9d %10.1f %10zu %12.3f %11.1f%%\n", landmarks, build,
+                doracle_size (oracle) / 1024, estimate, counted ? 100.0 * error / counted : 0.0);
+        doracle_destroy (&oracle);
+    }
+    dsearch_destroy (&search);
+}
+
+//  Benchmark searches over a side x side grid whose node ids are shuffled,
+//  once with original ids and once per reordering method, over plain and
+//  compressed adjacency, then estimates of distance oracles
+
+static void
+s_bench_reorder (int side, int queries)
+{
+    int nodes = side * side;
+    int *label = (int *) malloc (nodes * sizeof (int));
+    int *from = (int *) malloc (4 * nodes * sizeof (int));
+    int *to = (int *) malloc (4 * nodes * sizeof (int));
+    int *weight = (int *) malloc (4 * nodes * sizeof (int));
+    int *sources = (int *) malloc (queries * sizeof (int));
+    assert (label && from && to && weight && sources);
+
+    //  Upstream ids come in arbitrary order
+    srandom (42);
+    for (int i = 0; i < nodes; i++)
+        label [i] = i;
+    for (int i = nodes - 1; i > 0; i--) {
+        int j = random () % (i + 1);
+        int swap = label [i];
+        label [i] = label [j];
+        label [j] = swap;
+    }
+    int edges = 0;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int u = label [y * side + x];
+            if (x + 1 < side) {
+                int v = label [y * side + x + 1];
+                int w = 1 + random () % 9;
+                from [edges] = u; to [edges] = v; weight [edges++] = w;
+                from [edges] = v; to [edges] = u; weight [edges++] = w;
+            }
+            if (y + 1 < side) {
+                int v = label [(y + 1) * side + x];
+                int w = 1 + random () % 9;
+                from [edges] = u; to [edges] = v; weight [edges++] = w;
+                from [edges] = v; to [edges] = u; weight [edges++] = w;
+            }
+        }
+    }
+    for (int i = 0; i < queries; i++)
+        sources [i] = random () % nodes;
+    graph_t *graph = graph_new_from_edges (nodes, edges, from, to, weight);
+    int counter = s_cache_counter_open ();
+
+    printf ("grid %dx%d, %d nodes, %d edges, %d queries\n", side, side, nodes, edges, queries);
+    printf ("%-8s %10s %12s %16s %14s %12s\n", "order", "edge span", "ms/query", "cache misses",
+            "packed ms/q", "packed size");
+    const char *names [] = { "NONE", "BFS", "RCM", "DEGREE" };
+    int64_t baseline = -1;
+    for (int m = 0; m < 4; m++) {
+        reorder_t *order = m ? reorder_new (graph, reorder_method (names [m])) : NULL;
+        graph_t *relabeled = order ? reorder_graph (order, graph) : NULL;
+        graph_t *searched = relabeled ? relabeled : graph;
+        dsearch_t *search = dsearch_new (searched);
+        s_cache_counter_start (counter);
+        double elapsed = s_bench_queries (search, order, sources, queries);
+        int64_t misses = s_cache_counter_stop (counter);
+        cgraph_t *packed = cgraph_new (searched);
+        dsearch_t *packed_search = dsearch_new_compressed (packed);
+        double packed_elapsed = s_bench_queries (packed_search, order, sources, queries);
+        size_t plain_size = (nodes + 1) * sizeof (int) + 2 * (size_t) edges * sizeof (int);
+        char *miss_text = NULL;
+        if (m == 0)
+            baseline = misses;
+        if (misses >= 0 && baseline > 0)
+            miss_text = zsys_sprintf ("%lld (%.0f%%)", (long long) misses, 100.0 * misses / baseline);
+        else
+            miss_text = zsys_sprintf ("n/a");
+        printf ("%-8s %10.1f %12.2f %16s %14.2f %11.0f%%\n", names [m],
+                graph_edge_span (searched), elapsed, miss_text,
+                packed_elapsed, 100.0 * cgraph_size (packed) / plain_size);
+        zstr_free (&miss_text);
+        dsearch_destroy (&packed_search);
+        cgraph_destroy (&packed);
+        dsearch_destroy (&search);
+        graph_destroy (&relabeled);
+        reorder_destroy (&order);
+    }
+    if (counter >= 0)
+        close (counter);
+    s_bench_oracle (graph, sources, queries);
+    graph_destroy (&graph);
+    free (sources);
+    free (weight);
+    free (to);
+    free (from);
+    free (label);
+}
+
+//  Graph families for the planner benchmark: grids with unit, small and
+//  wide weights, random graph with half of all edges and complete graph
+//  with unit weights
+
+static matrix_t *
+s_plan_graph (int family, int nodes)
+{
+    matrix_t *distances = matrix_new (nodes, nodes, sizeof (int));
+    assert (distances);
+    srandom (family + 1);
+    int side = 1;
+    while ((side + 1) * (side + 1) <= nodes)
+        side++;
+    for (int u = 0; u < nodes; u++) {
+        if (family <= 2) {
+            int limit = family == 0 ? 1 : family == 1 ? 9 : 1000000;
+            int near [2] = { u % side < side - 1 ? u + 1 : -1, u + side };
+            for (int i = 0; i < 2; i++)
+                if (near [i] >= 0 && near [i] < nodes) {
+                    matrix_set_int (distances, near [i], u, 1 + random () % limit);
+                    matrix_set_int (distances, u, near [i], 1 + random () % limit);
+                }
+            //  Nodes beyond the square join the last row
+            if (u >= side * side)
+                matrix_set_int (distances, u - side, u, 1);
+        }
+        else
+            for (int v = 0; v < nodes; v++)
+                if (v != u && (family == 4 || random () % 2))
+                    matrix_set_int (distances, v, u, family == 4 ? 1 : 1 + random () % 100);
+    }
+    return distances;
+}
+
+//  Benchmark engines the planner chooses from against each other on every
+//  graph family: TASK and ROUTE queries with each fixed engine, then with
+//  the planner's choice. Returns 1 if the planner is more than half again
+//  slower than the best fixed engine anywhere.
+
+static int
+s_bench_plan (int nodes, int queries)
+{
+    const char *families [] = { "grid unit", "grid 1..9", "grid 1..1e6", "random 50%", "complete" };
+    const char *engines [] = { "DENSE", "HEAP", "BUCKETS", "BFS", "AUTO" };
+    const char *commands [] = { "TASK", "ROUTE" };
+    int *sources = (int *) malloc (2 * queries * sizeof (int));
+    assert (sources);
+    srandom (42);
+    for (int i = 0; i < 2 * queries; i++)
+        sources [i] = random () % nodes;
+    int failed = 0;
+    printf ("%d nodes, %d queries, msecs per query\n", nodes, queries);
+    printf ("%-12s %-6s %9s %9s %9s %9s %9s %7s\n", "graph", "query",
+            "DENSE", "HEAP", "BUCKETS", "BFS", "planner", "/best");
+    for (int family = 0; family < 5; family++) {
+        matrix_t *distances = s_plan_graph (family, nodes);
+        zactor_t *dijkstra = zactor_new (dijkstra_actor, distances);
+        zstr_sendx (dijkstra, "START", NULL);
+        for (int c = 0; c < 2; c++) {
+            double elapsed [5];
+            double best = -1;
+            for (int e = 0; e < 5; e++) {
+                //  Warm up builds whatever the engine needs, then the best
+                //  of three passes counts
+                elapsed [e] = -1;
+                bool done = true;
+                for (int pass = 0; pass < 3 && done; pass++) {
+                    int64_t start = zclock_usecs ();
+                    for (int i = pass ? 0 : -1; i < queries && done; i++) {
+                        if (i == 0)
+                            start = zclock_usecs ();
+                        char *from = zsys_sprintf ("%d", sources [i < 0 ? 0 : 2 * i]);
+                        char *to = zsys_sprintf ("%d", sources [i < 0 ? 1 : 2 * i + 1]);
+                        if (c == 0)
+                            zstr_sendx (dijkstra, "TASK", from, "DIST", engines [e], NULL);
+                        else
+                            zstr_sendx (dijkstra, "ROUTE", from, to, engines [e], NULL);
+                        zstr_free (&from);
+                        zstr_free (&to);
+                        zmsg_t *reply = zmsg_recv (dijkstra);
+                        done = reply && zframe_streq (zmsg_first (reply), "DONE");
+                        zmsg_destroy (&reply);
+                    }
+                    double pass_elapsed = (zclock_usecs () - start) / 1000.0 / queries;
+                    if (done && (elapsed [e] < 0 || pass_elapsed < elapsed [e]))
+                        elapsed [e] = pass_elapsed;
+                }
+                if (!done)
+                    elapsed [e] = -1;
+                if (e < 4 && elapsed [e] >= 0 && (best < 0 || elapsed [e] < best))
+                    best = elapsed [e];
+            }
+            double ratio = best > 0 ? elapsed [4] / best : 1;
+            printf ("%-12s %-6s", families [family], commands [c]);
+            for (int e = 0; e < 5; e++)
+                if (elapsed [e] >= 0)
+                    printf (" %9.3f", elapsed [e]);
+                else
+                    printf (" %9s", "n/a");
+            printf (" %6.2fx%s\n", ratio, ratio > 1.5 ? " WORSE" : "");
+            if (ratio > 1.5)
+                failed = 1;
+        }
+        zactor_destroy (&dijkstra);
+        matrix_destroy (&distances);
+    }
+    free (sources);
+    return failed;
+}
+
+//  Random sparse graph: ring of nodes plus a few random chords
+
+static matrix_t *
+s_random_graph (int nodes)
+{
+    matrix_t *distances = matrix_new (nodes, nodes, sizeof (int));
+    assert (distances);
+    srandom (7);
+    for (int u = 0; u < nodes; u++) {
+        int v = (u + 1) % nodes;
+        int w = 1 + random () % 9;
+        matrix_set_int (distances, u, v, w);
+        matrix_set_int (distances, v, u, w);
+        v = random () % nodes;
+        if (v != u) {
+            w = 10 + random () % 90;
+            matrix_set_int (distances, u, v, w);
+            matrix_set_int (distances, v, u, w);
+        }
+    }
+    return distances;
+}
+
+//  Serve queries at endpoint until interrupted. With updates per second
+//  set, random ring edges get new weights meanwhile, published as new
+//  versions every 10 msecs, as traffic updates would be.
+
+static int
+s_service (const char *endpoint, matrix_t *distances, int workers, int updates,
+           const char *precompute, bool verbose)
+{
+    zactor_t *service = zactor_new (dservice_actor, distances);
+    assert (service);
+    if (verbose)
+        zstr_send (service, "VERBOSE");
+    dversion_t *store = NULL;
+    if (updates) {
+        store = dversion_new (distances, 0);
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "STORE");
+        zmsg_addptr (msg, store);
+        zmsg_send (&msg, service);
+    }
+    char *size = zsys_sprintf ("%d", workers);
+    zstr_sendx (service, "WORKERS", size, NULL);
+    zstr_free (&size);
+    zstr_sendx (service, "BIND", endpoint, NULL);
+    char *port = zstr_recv (service);
+    int rc = port ? atoi (port) : -1;
+    zstr_free (&port);
+    if (rc == -1) {
+        zactor_destroy (&service);
+        dversion_destroy (&store);
+        return 1;
+    }
+    zstr_sendx (service, "START", precompute ? precompute : "", NULL);
+    zsys_info ("graphs: serving %d nodes at %s with %d workers, %d updates/s",
+               matrix_x (distances), endpoint, workers, updates);
+    int nodes = matrix_x (distances);
+    int64_t applied = 0;
+    int64_t start = zclock_mono ();
+    while (!zsys_interrupted) {
+        zclock_sleep (store ? 10 : 100);
+        if (!store)
+            continue;
+        int64_t due = (zclock_mono () - start) * updates / 1000;
+        for (; applied < due; applied++) {
+            int u = random () % nodes;
+            int v = (u + 1) % nodes;
+            int w = 1 + random () % 9;
+            dversion_set_int (store, u, v, w);
+            dversion_set_int (store, v, u, w);
+        }
+        dversion_publish (store);
+    }
+    zactor_destroy (&service);
+    if (store)
+        zsys_info ("graphs: %lld updates in %llu versions",
+                   (long long) applied, (unsigned long long) dversion_current (store));
+    dversion_destroy (&store);
+    return 0;
+}
+
+//  Serve shard file at endpoint until interrupted
+
+static int
+s_shard_service (const char *endpoint, const char *path, bool verbose)
+{
+    zactor_t *shard = zactor_new (dshard_actor, NULL);
+    assert (shard);
+    if (verbose)
+        zstr_send (shard, "VERBOSE");
+    zstr_sendx (shard, "LOAD", path, NULL);
+    char *rc = zstr_recv (shard);
+    bool loaded = rc && streq (rc, "0");
+    zstr_free (&rc);
+    if (loaded) {
+        zstr_sendx (shard, "BIND", endpoint, NULL);
+        rc = zstr_recv (shard);
+        loaded = rc && atoi (rc) != -1;
+        zstr_free (&rc);
+    }
+    if (loaded) {
+        zsys_info ("graphs: serving shard %s at %s", path, endpoint);
+        while (!zsys_interrupted)
+            zclock_sleep (100);
+    }
+    zactor_destroy (&shard);
+    return loaded ? 0 : 1;
+}
+
+//  Partition grid of roads into shards, serve each from its own process
+//  over ipc and check distances put together from them against searches
+//  over the whole graph
+
+static int
+s_shards (int shards, int nodes, int queries, bool verbose)
+{
+    int side = 1;
+    while ((side + 1) * (side + 1) <= nodes)
+        side++;
+    nodes = side * side;
+    int *from = (int *) malloc (4 * nodes * sizeof (int));
+    int *to = (int *) malloc (4 * nodes * sizeof (int));
+    int *weight = (int *) malloc (4 * nodes * sizeof (int));
+    assert (from && to && weight);
+    srandom (7);
+    int edges = 0;
+    for (int u = 0; u < nodes; u++) {
+        int near [2] = { u % side < side - 1 ? u + 1 : -1, u + side < nodes ? u + side : -1 };
+        for (int i = 0; i < 2; i++)
+            if (near [i] >= 0) {
+                int w = 1 + random () % 9;
+                from [edges] = u; to [edges] = near [i]; weight [edges++] = w;
+                from [edges] = near [i]; to [edges] = u; weight [edges++] = w;
+            }
+    }
+    graph_t *graph = graph_new_from_edges (nodes, edges, from, to, weight);
+    free (from);
+    free (to);
+    free (weight);
+    int64_t start = zclock_usecs ();
+    dpartition_t *partition = dpartition_new (graph, shards);
+    shards = dpartition_shards (partition);
+    printf ("%d nodes, %d edges in %d shards, %d cut edges, %d boundary nodes, %.1f ms\n",
+            nodes, graph_edges (graph), shards, dpartition_cut (partition),
+            dpartition_boundary (partition), (zclock_usecs () - start) / 1000.0);
+
+    char *dir = zsys_sprintf ("/tmp/graphs-shards-%d", (int) getpid ());
+    zsys_dir_create ("%s", dir);
+    char **files = (char **) zmalloc (shards * sizeof (char *));
+    char **endpoints = (char **) zmalloc (shards * sizeof (char *));
+    pid_t *children = (pid_t *) zmalloc (shards * sizeof (pid_t));
+    assert (files && endpoints && children);
+    int failed = 0;
+    for (int i = 0; i < shards; i++) {
+        files [i] = zsys_sprintf ("%s/shard-%d", dir, i);
+        endpoints [i] = zsys_sprintf ("ipc://%s/shard-%d.ipc", dir, i);
+        if (dpartition_save (partition, graph, i, files [i]) == -1)
+            failed++;
+    }
+    //  Children are forked before this process touches any socket
+    fflush (stdout);
+    for (int i = 0; i < shards && !failed; i++) {
+        children [i] = fork ();
+        if (children [i] == 0)
+            _exit (s_shard_service (endpoints [i], files [i], verbose));
+        if (children [i] == -1)
+            failed++;
+    }
+
+    dshards_t *client = dshards_new ();
+    for (int i = 0; i < shards && !failed; i++)
+        if (dshards_connect (client, endpoints [i]) == -1)
+            failed++;
+    if (!failed) {
+        dsearch_t *search = dsearch_new (graph);
+        int64_t sharded = 0;
+        int64_t whole = 0;
+        int wrong = 0;
+        srandom (11);
+        for (int i = 0; i < queries; i++) {
+            int from = random () % nodes;
+            int to = random () % nodes;
+            start = zclock_usecs ();
+            int distance = dshards_distance (client, from, to);
+            sharded += zclock_usecs () - start;
+            start = zclock_usecs ();
+            dsearch_run_to (search, from, to);
+            whole += zclock_usecs () - start;
+            if (distance != dsearch_distance (search, to))
+                wrong++;
+        }
+        dsearch_destroy (&search);
+        printf ("overlay of %d nodes, %d edges\n",
+                dshards_overlay_nodes (client), dshards_overlay_edges (client));
+        printf ("%d queries: sharded %.1f us, whole graph %.1f us per query, %d wrong\n",
+                queries, (double) sharded / queries, (double) whole / queries, wrong);
+        failed += wrong;
+    }
+    else
+        printf ("Cannot start shards\n");
+    dshards_destroy (&client);
+
+    for (int i = 0; i < shards; i++) {
+        if (children [i] > 0) {
+            kill (children [i], SIGTERM);
+            waitpid (children [i], NULL, 0);
+        }
+        zsys_file_delete (files [i]);
+        zstr_free (&files [i]);
+        zsys_file_delete (endpoints [i] + strlen ("ipc://"));
+        zstr_free (&endpoints [i]);
+    }
+    zsys_dir_delete ("%s", dir);
+    zstr_free (&dir);
+    free (files);
+    free (endpoints);
+    free (children);
+    dpartition_destroy (&partition);
+    graph_destroy (&graph);
+    return failed ? 1 : 0;
+}
+
+//  Load generator client, keeps window queries in flight and reports the
+//  number of error replies, the number of queries left without reply, and
+//  the latencies in microseconds of the completed ones back over the pipe
+
+typedef struct {
+    const char *endpoint;
+    int requests;
+    int nodes;
+    int window;
+    unsigned int seed;
+} s_client_args_t;
+
+static void
+s_client_actor (zsock_t *pipe, void *args)
+{
+    s_client_args_t *client_args = (s_client_args_t *) args;
+    zsock_t *socket = zsock_new_dealer (NULL);
+    assert (socket);
+    zsock_connect (socket, "%s", client_args->endpoint);
+    dclient_t *client = dclient_new (socket, client_args->window);
+    assert (client);
+    zsock_signal (pipe, 0);
+
+    //  Send time of query with correlation id is kept at index id - 1, as
+    //  ids are given in sequence; latencies are packed in order of reply
+    int64_t *started = (int64_t *) zmalloc (client_args->requests * sizeof (int64_t));
+    int64_t *latency = (int64_t *) zmalloc (client_args->requests * sizeof (int64_t));
+    assert (started && latency);
+    unsigned int seed = client_args->seed;
+    int errors = 0;
+    int sent = 0;
+    int completed = 0;
+    while (!zsys_interrupted) {
+        uint32_t id;
+        zmsg_t *reply = NULL;
+        if (sent < client_args->requests
+        &&  dclient_outstanding (client) < dclient_window (client)) {
+            id = dclient_query (client, rand_r (&seed) % client_args->nodes, "DIST", 0);
+            if (!id)
+                break;  //  Interrupted
+            started [id - 1] = zclock_usecs ();
+            sent++;
+            continue;
+        }
+        reply = dclient_recv (client, &id);
+        if (!reply)
+            break;      //  All done or interrupted
+        if (id > 0 && id <= (uint32_t) sent)
+            latency [completed++] = zclock_usecs () - started [id - 1];
+        if (!zframe_streq (zmsg_first (reply), "DONE"))
+            errors++;
+        zmsg_destroy (&reply);
+    }
+    dclient_destroy (&client);
+    zsock_destroy (&socket);
+    zstr_sendfm (pipe, "%d", errors);
+    zstr_sendfm (pipe, "%d", sent - completed);
+    zframe_t *frame = zframe_new (latency, completed * sizeof (int64_t));
+    zframe_send (&frame, pipe, 0);
+    free (started);
+    free (latency);
+    //  Wait for $TERM
+    char *command = zstr_recv (pipe);
+    zstr_free (&command);
+}
+
+static int
+s_int64_compare (const void *a, const void *b)
+{
+    int64_t ia = *(const int64_t *) a;
+    int64_t ib = *(const int64_t *) b;
+    return (ia > ib) - (ia < ib);
+}
+
+//  Run clients in parallel and print throughput and latency percentiles
+
+static int
+s_load (const char *endpoint, int clients, int window, int requests, int nodes)
+{
+    s_client_args_t *args = (s_client_args_t *) zmalloc (clients * sizeof (s_client_args_t));
+    zactor_t **actors = (zactor_t **) zmalloc (clients * sizeof (zactor_t *));
+    int64_t *latency = (int64_t *) malloc ((size_t) clients * requests * sizeof (int64_t));
+    assert (args && actors && latency);
+
+    int64_t start = zclock_usecs ();
+    for (int i = 0; i < clients; i++) {
+        args [i].endpoint = endpoint;
+        args [i].requests = requests;
+        args [i].nodes = nodes;
+        args [i].window = window;
+        args [i].seed = i + 1;
+        actors [i] = zactor_new (s_client_actor, &args [i]);
+        assert (actors [i]);
+    }
+    //  Only latencies of completed queries count in the percentiles
+    int errors = 0;
+    int lost = 0;
+    size_t total = 0;
+    for (int i = 0; i < clients; i++) {
+        zmsg_t *msg = zmsg_recv (actors [i]);
+        if (!msg)
+            break;      //  Interrupted
+        char *client_errors = zmsg_popstr (msg);
+        char *client_lost = zmsg_popstr (msg);
+        zframe_t *frame = zmsg_pop (msg);
+        if (client_errors && client_lost && frame) {
+            errors += atoi (client_errors);
+            lost += atoi (client_lost);
+            size_t count = zframe_size (frame) / sizeof (int64_t);
+            if (count > (size_t) requests)
+                count = requests;
+            memcpy (latency + total, zframe_data (frame), count * sizeof (int64_t));
+            total += count;
+        }
+        zframe_destroy (&frame);
+        zstr_free (&client_errors);
+        zstr_free (&client_lost);
+        zmsg_destroy (&msg);
+    }
+    double elapsed = (zclock_usecs () - start) / 1e6;
+    for (int i = 0; i < clients; i++)
+        zactor_destroy (&actors [i]);
+
+    qsort (latency, total, sizeof (int64_t), s_int64_compare);
+    printf ("%d clients, window %d, %zu requests, %d errors, %d lost in %.2f s\n",
+            clients, window, total, errors, lost, elapsed);
+    printf ("throughput %.0f requests/s\n", total / elapsed);
+    if (total)
+        printf ("latency us: p50 %lld p90 %lld p99 %lld p99.9 %lld max %lld\n",
+                (long long) latency [total * 50 / 100],
+                (long long) latency [total * 90 / 100],
+                (long long) latency [total * 99 / 100],
+                (long long) latency [total * 999 / 1000],
+                (long long) latency [total - 1]);
+    free (latency);
+    free (actors);
+    free (args);
+    return errors || lost ? 1 : 0;
+}
 
 int main (int argc, char *argv [])
 {
     bool verbose = false;
+    int bench = 0;
+    int plan = 0;
+    const char *service = NULL;
+    const char *client = NULL;
+    const char *matrix_file = NULL;
+    const char *precompute = NULL;
+    const char *shard = NULL;
+    const char *trace = NULL;
+    int shards = 0;
+    int nodes = 1000;
+    int workers = 4;
+    int clients = 8;
+    int requests = 1000;
+    int window = 1;
+    int updates = 0;
     int argn;
     for (argn = 1; argn < argc; argn++) {
         if (streq (argv [argn], "--help")
         ||  streq (argv [argn], "-h")) {
             puts ("graphs [options] ...");
             puts ("  --verbose / -v         verbose test output");
+            puts ("  --bench / -b [side]    benchmark node reordering on a grid");
+            puts ("  --plan / -p [nodes]    benchmark engine planner against fixed engines");
+            puts ("  --service / -s ep      serve queries at endpoint");
+            puts ("  --client / -c ep       generate load against service at endpoint");
+            puts ("  --matrix file          graph to serve, packed matrix of int");
+            puts ("  --nodes n              nodes of random graph to serve or query (1000)");
+            puts ("  --workers n            service worker threads (4)");
+            puts ("  --clients n            concurrent clients (8)");
+            puts ("  --requests n           requests per client (1000)");
+            puts ("  --window n             queries in flight per client (1)");
+            puts ("  --updates n            edge updates per second while serving (0)");
+            puts ("  --precompute file      map indexes from file, or save them there");
+            puts ("  --shard file           serve shard file at service endpoint");
+            puts ("  --trace file           trace phases of queries, write them at exit");
+            puts ("  --shards n             serve grid of nodes from n shard processes");
             puts ("  --help / -h            this information");
             return 0;
         }
@@ -36,6 +743,59 @@ int main (int argc, char *argv [])
         if (streq (argv [argn], "--verbose")
         ||  streq (argv [argn], "-v"))
             verbose = true;
+        else
+        if (streq (argv [argn], "--bench")
+        ||  streq (argv [argn], "-b")) {
+            bench = 300;
+            if (argn + 1 < argc && atoi (argv [argn + 1]) > 0)
+                bench = atoi (argv [++argn]);
+        }
+        else
+        if (streq (argv [argn], "--plan")
+        ||  streq (argv [argn], "-p")) {
+            plan = 2000;
+            if (argn + 1 < argc && atoi (argv [argn + 1]) > 0)
+                plan = atoi (argv [++argn]);
+        }
+        else
+        if ((streq (argv [argn], "--service") || streq (argv [argn], "-s")) && argn + 1 < argc)
+            service = argv [++argn];
+        else
+        if ((streq (argv [argn], "--client") || streq (argv [argn], "-c")) && argn + 1 < argc)
+            client = argv [++argn];
+        else
+        if (streq (argv [argn], "--matrix") && argn + 1 < argc)
+            matrix_file = argv [++argn];
+        else
+        if (streq (argv [argn], "--nodes") && argn + 1 < argc)
+            nodes = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--workers") && argn + 1 < argc)
+            workers = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--clients") && argn + 1 < argc)
+            clients = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--requests") && argn + 1 < argc)
+            requests = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--window") && argn + 1 < argc)
+            window = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--updates") && argn + 1 < argc)
+            updates = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--precompute") && argn + 1 < argc)
+            precompute = argv [++argn];
+        else
+        if (streq (argv [argn], "--shard") && argn + 1 < argc)
+            shard = argv [++argn];
+        else
+        if (streq (argv [argn], "--shards") && argn + 1 < argc)
+            shards = atoi (argv [++argn]);
+        else
+        if (streq (argv [argn], "--trace") && argn + 1 < argc)
+            trace = argv [++argn];
         else {
             printf ("Unknown option: %s\n", argv [argn]);
             return 1;
@@ -44,5 +804,41 @@ int main (int argc, char *argv [])
     //  Insert main code here
     if (verbose)
         zsys_info ("graphs - test graph search");
+    if (trace) {
+        dtrace_enable (true);
+        dtrace_dump_at_exit (trace);
+    }
+    if (bench)
+        s_bench_reorder (bench, 20);
+    if (plan && s_bench_plan (plan, 20))
+        return 1;
+    if (nodes <= 0 || workers <= 0 || clients <= 0 || requests <= 0 || window <= 0 || updates < 0
+    ||  shards < 0) {
+        printf ("Invalid number in options\n");
+        return 1;
+    }
+    if (shards)
+        return s_shards (shards, nodes, requests, verbose);
+    if (service && shard)
+        return s_shard_service (service, shard, verbose);
+    if (service) {
+        matrix_t *distances = NULL;
+        if (matrix_file) {
+            zchunk_t *chunk = zchunk_slurp (matrix_file, 0);
+            distances = chunk ? matrix_from_chunk (&chunk) : NULL;
+            zchunk_destroy (&chunk);
+        }
+        else
+            distances = s_random_graph (nodes);
+        if (!distances) {
+            printf ("Cannot read matrix from %s\n", matrix_file);
+            return 1;
+        }
+        int rc = s_service (service, distances, workers, updates, precompute, verbose);
+        matrix_destroy (&distances);
+        return rc;
+    }
+    if (client)
+        return s_load (client, clients, window, requests, nodes);
     return 0;
 }
@@ -27,8 +27,23 @@
 //  Extra headers
 
 //  Opaque class structures to allow forward references
+#ifndef DUNION_T_DEFINED
+typedef struct _dunion_t dunion_t;
+#define DUNION_T_DEFINED
+#endif
+#ifndef DHEAP_T_DEFINED
+typedef struct _dheap_t dheap_t;
+#define DHEAP_T_DEFINED
+#endif
+#ifndef DKERNEL_T_DEFINED
+typedef struct _dkernel_t dkernel_t;
+#define DKERNEL_T_DEFINED
+#endif
 
 //  Internal API
+#include "dunion.h"
+#include "dheap.h"
+#include "dkernel.h"
 
 
 //  *** To avoid double-definitions, only define if building without draft ***
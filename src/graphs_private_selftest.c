@@ -29,6 +29,13 @@
 void
 graphs_private_selftest (bool verbose, const char *subtest)
 {
+// Tests for stable private classes:
+    if (streq (subtest, "$ALL") || streq (subtest, "dkernel_test"))
+        dkernel_test (verbose);
+    if (streq (subtest, "$ALL") || streq (subtest, "dheap_test"))
+        dheap_test (verbose);
+    if (streq (subtest, "$ALL") || streq (subtest, "dunion_test"))
+        dunion_test (verbose);
 }
 /*
 ################################################################################
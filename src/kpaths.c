@@ -0,0 +1,607 @@
+/*  =========================================================================
+    kpaths - K shortest loopless paths
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    kpaths - K shortest loopless paths
+@discuss
+    Yen's method. Every path found is split into a root path and a spur
+    node; the spur path continues from the spur node avoiding nodes of the
+    root path and edges already used by found paths with the same root.
+    Instead of copying the graph, removed nodes and edges are marked in
+    overlay arrays with a stamp, so unmarking is just a new stamp.
+
+    One search on the reversed graph gives the shortest path tree towards
+    the target and exact distances to it. Edge from the spur node plus the
+    tree distance of its target is a lower bound of the spur path; if an
+    edge reaching the bound leads to a tree path which avoids removed
+    nodes, that is the spur path and no search is needed. Otherwise the
+    spur path is searched by A* guided by the tree distances, which stops
+    as soon as the target is settled. The tree is kept for the next search
+    to the same target.
+@end
+*/
+
+#include "graphs_classes.h"
+
+typedef struct {
+    int length;                 //  Number of nodes
+    int *nodes;
+    int *prefix;                //  Cost from first node to nodes [i]
+} kpaths_path_t;
+
+//  Structure of our class
+
+struct _kpaths_t {
+    graph_t *graph;             //  Graph we search, not owned
+    graph_t *reverse;           //  Graph with reversed edges
+    dsearch_t *tree;            //  Shortest path tree towards target
+    int target;                 //  Target of the tree, -1 if none
+    //  Spur search state, valid where visited [node] == stamp
+    int *distance;
+    int *parent;
+    unsigned int *visited;
+    //  Overlay of removed nodes and edges, removed where mask == stamp
+    unsigned int *node_mask;
+    unsigned int *edge_mask;
+    unsigned int stamp;
+    dheap_t *heap;
+    kpaths_path_t **found;      //  Paths found by the last search
+    int found_size;
+    kpaths_path_t **candidates; //  Candidates for the next path
+    int candidates_size;
+    int candidates_max;
+    size_t searches;
+    size_t reused;
+};
+
+
+static kpaths_path_t *
+s_path_new (int length)
+{
+    kpaths_path_t *self = (kpaths_path_t *) zmalloc (sizeof (kpaths_path_t));
+    assert (self);
+    self->length = length;
+    self->nodes = (int *) malloc (length * sizeof (int));
+    self->prefix = (int *) malloc (length * sizeof (int));
+    assert (self->nodes && self->prefix);
+    return self;
+}
+
+static void
+s_path_destroy (kpaths_path_t **self_p)
+{
+    if (*self_p) {
+        free ((*self_p)->nodes);
+        free ((*self_p)->prefix);
+        free (*self_p);
+        *self_p = NULL;
+    }
+}
+
+static int
+s_path_cost (kpaths_path_t *self)
+{
+    return self->prefix [self->length - 1];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new path finder
+
+kpaths_t *
+kpaths_new (graph_t *graph)
+{
+    if (!graph) return NULL;
+
+    kpaths_t *self = (kpaths_t *) zmalloc (sizeof (kpaths_t));
+    assert (self);
+    int nodes = graph_nodes (graph);
+    int edges = graph_edges (graph);
+    self->graph = graph;
+    self->reverse = graph_reverse (graph);
+    self->tree = dsearch_new (self->reverse);
+    self->target = -1;
+    self->distance = (int *) malloc (nodes * sizeof (int));
+    self->parent = (int *) malloc (nodes * sizeof (int));
+    self->visited = (unsigned int *) zmalloc (nodes * sizeof (unsigned int));
+    self->node_mask = (unsigned int *) zmalloc (nodes * sizeof (unsigned int));
+    self->edge_mask = (unsigned int *) zmalloc ((edges + 1) * sizeof (unsigned int));
+    assert (self->distance && self->parent && self->visited);
+    assert (self->node_mask && self->edge_mask);
+    self->heap = dheap_new (64);
+    return self;
+}
+
+
+//  Forget paths of the last search
+
+static void
+s_kpaths_clear (kpaths_t *self)
+{
+    for (int i = 0; i < self->found_size; i++)
+        s_path_destroy (&self->found [i]);
+    for (int i = 0; i < self->candidates_size; i++)
+        s_path_destroy (&self->candidates [i]);
+    free (self->found);
+    self->found = NULL;
+    self->found_size = 0;
+    self->candidates_size = 0;
+    self->searches = 0;
+    self->reused = 0;
+}
+
+//  Start new overlay with nothing removed
+
+static void
+s_kpaths_new_stamp (kpaths_t *self)
+{
+    if (++self->stamp == 0) {
+        //  Wrapped around, old marks would look current
+        int nodes = graph_nodes (self->graph);
+        memset (self->visited, 0, nodes * sizeof (unsigned int));
+        memset (self->node_mask, 0, nodes * sizeof (unsigned int));
+        memset (self->edge_mask, 0, (graph_edges (self->graph) + 1) * sizeof (unsigned int));
+        self->stamp = 1;
+    }
+}
+
+//  Remove all edges from node to target in the current overlay
+
+static void
+s_kpaths_remove_edges (kpaths_t *self, int node, int target)
+{
+    int degree = graph_degree (self->graph, node);
+    const int *targets = graph_targets (self->graph, node);
+    int offset = graph_offset (self->graph, node);
+    for (int i = 0; i < degree; i++)
+        if (targets [i] == target)
+            self->edge_mask [offset + i] = self->stamp;
+}
+
+//  Is tree path from node to target free of removed nodes and of avoid?
+
+static bool
+s_kpaths_tree_usable (kpaths_t *self, int node, int avoid)
+{
+    for (int v = node; v != self->target; v = dsearch_parent (self->tree, v))
+        if (v == avoid || self->node_mask [v] == self->stamp)
+            return false;
+    return self->target != avoid && self->node_mask [self->target] != self->stamp;
+}
+
+//  Create path of root, which is nodes [0 .. spur) of path, followed by
+//  spur node and the tree path of one of its neighbours, when this is the
+//  shortest spur path in the current overlay. That is so if the edge and
+//  the exact tree distance beyond it add up to the lower bound taken over
+//  all edges left. Root may be NULL to start at spur node alone.
+
+static kpaths_path_t *
+s_kpaths_tree_path (kpaths_t *self, kpaths_path_t *root, int spur, int node)
+{
+    int degree = graph_degree (self->graph, node);
+    const int *targets = graph_targets (self->graph, node);
+    const int *weights = graph_weights (self->graph, node);
+    int offset = graph_offset (self->graph, node);
+    int bound = INT_MAX;
+    if (node == self->target)
+        bound = 0;
+    for (int i = 0; i < degree && bound; i++) {
+        int h = dsearch_distance (self->tree, targets [i]);
+        if (h != INT_MAX && targets [i] != node
+        &&  self->node_mask [targets [i]] != self->stamp
+        &&  self->edge_mask [offset + i] != self->stamp
+        &&  weights [i] + h < bound)
+            bound = weights [i] + h;
+    }
+    if (bound == INT_MAX)
+        return NULL;
+
+    int next = -1;
+    int weight = 0;
+    for (int i = 0; i < degree && bound && next == -1; i++) {
+        int h = dsearch_distance (self->tree, targets [i]);
+        if (h != INT_MAX && weights [i] + h == bound
+        &&  self->edge_mask [offset + i] != self->stamp
+        &&  s_kpaths_tree_usable (self, targets [i], node)) {
+            next = targets [i];
+            weight = weights [i];
+        }
+    }
+    if (bound && next == -1)
+        return NULL;            //  Shortest spur path needs a search
+
+    int root_length = root ? spur : 0;
+    int root_cost = root ? root->prefix [spur] : 0;
+    int length = 1;
+    for (int v = next; v != -1 && v != self->target; v = dsearch_parent (self->tree, v))
+        length++;
+    if (next != -1)
+        length++;
+    kpaths_path_t *path = s_path_new (root_length + length);
+    if (root) {
+        memcpy (path->nodes, root->nodes, root_length * sizeof (int));
+        memcpy (path->prefix, root->prefix, root_length * sizeof (int));
+    }
+    path->nodes [root_length] = node;
+    path->prefix [root_length] = root_cost;
+    int h = next == -1 ? 0 : dsearch_distance (self->tree, next);
+    for (int i = root_length + 1, v = next; i < path->length; i++) {
+        path->nodes [i] = v;
+        path->prefix [i] = root_cost + weight + h - dsearch_distance (self->tree, v);
+        v = dsearch_parent (self->tree, v);
+    }
+    return path;
+}
+
+//  Search spur path from node nodes [spur] of root to target in the
+//  current overlay by A*, with tree distances as the estimate. Returns
+//  root followed by the spur path, or NULL if target cannot be reached.
+
+static kpaths_path_t *
+s_kpaths_spur_search (kpaths_t *self, kpaths_path_t *root, int spur)
+{
+    int node = root->nodes [spur];
+    self->searches++;
+    dheap_clear (self->heap);
+    self->distance [node] = 0;
+    self->parent [node] = -1;
+    self->visited [node] = self->stamp;
+    dheap_push (self->heap, node, dsearch_distance (self->tree, node));
+    bool reached = false;
+    int u, key;
+    while (dheap_pop (self->heap, &u, &key)) {
+        int h = dsearch_distance (self->tree, u);
+        if (key != self->distance [u] + h)
+            continue;           //  Stale entry
+        if (u == self->target) {
+            reached = true;
+            break;              //  Estimate is exact, no better path left
+        }
+        int degree = graph_degree (self->graph, u);
+        const int *targets = graph_targets (self->graph, u);
+        const int *weights = graph_weights (self->graph, u);
+        int offset = graph_offset (self->graph, u);
+        for (int i = 0; i < degree; i++) {
+            int v = targets [i];
+            int hv = dsearch_distance (self->tree, v);
+            if (hv == INT_MAX
+            ||  self->node_mask [v] == self->stamp
+            ||  self->edge_mask [offset + i] == self->stamp)
+                continue;
+            int d = self->distance [u] + weights [i];
+            if (self->visited [v] != self->stamp || d < self->distance [v]) {
+                self->visited [v] = self->stamp;
+                self->distance [v] = d;
+                self->parent [v] = u;
+                dheap_push (self->heap, v, d + hv);
+            }
+        }
+    }
+    if (!reached)
+        return NULL;
+
+    int length = 0;
+    for (int v = self->target; v != -1; v = self->parent [v])
+        length++;
+    kpaths_path_t *path = s_path_new (spur + length);
+    memcpy (path->nodes, root->nodes, spur * sizeof (int));
+    memcpy (path->prefix, root->prefix, spur * sizeof (int));
+    int i = path->length - 1;
+    for (int v = self->target; v != -1; v = self->parent [v], i--) {
+        path->nodes [i] = v;
+        path->prefix [i] = root->prefix [spur] + self->distance [v];
+    }
+    return path;
+}
+
+//  Add candidate unless it is known already
+
+static void
+s_kpaths_add_candidate (kpaths_t *self, kpaths_path_t *path)
+{
+    for (int i = 0; i < self->candidates_size; i++) {
+        kpaths_path_t *other = self->candidates [i];
+        if (other->length == path->length
+        &&  memcmp (other->nodes, path->nodes, path->length * sizeof (int)) == 0) {
+            s_path_destroy (&path);
+            return;
+        }
+    }
+    if (self->candidates_size == self->candidates_max) {
+        self->candidates_max = self->candidates_max ? self->candidates_max * 2 : 16;
+        self->candidates = (kpaths_path_t **) realloc (self->candidates,
+            self->candidates_max * sizeof (kpaths_path_t *));
+        assert (self->candidates);
+    }
+    self->candidates [self->candidates_size++] = path;
+}
+
+//  Remove and return cheapest candidate, NULL if there is none
+
+static kpaths_path_t *
+s_kpaths_take_candidate (kpaths_t *self)
+{
+    if (!self->candidates_size)
+        return NULL;
+    int best = 0;
+    for (int i = 1; i < self->candidates_size; i++) {
+        kpaths_path_t *path = self->candidates [i];
+        kpaths_path_t *other = self->candidates [best];
+        if (s_path_cost (path) < s_path_cost (other)
+        || (s_path_cost (path) == s_path_cost (other) && path->length < other->length))
+            best = i;
+    }
+    kpaths_path_t *path = self->candidates [best];
+    self->candidates [best] = self->candidates [--self->candidates_size];
+    return path;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Find up to k shortest loopless paths from node to node
+
+int
+kpaths_find (kpaths_t *self, int from, int to, int k)
+{
+    assert (self);
+    s_kpaths_clear (self);
+    int nodes = graph_nodes (self->graph);
+    if (from < 0 || from >= nodes || to < 0 || to >= nodes || k <= 0)
+        return 0;
+    if (self->target != to) {
+        dsearch_run (self->tree, to);
+        self->target = to;
+    }
+    if (dsearch_distance (self->tree, from) == INT_MAX)
+        return 0;
+
+    self->found = (kpaths_path_t **) zmalloc (k * sizeof (kpaths_path_t *));
+    assert (self->found);
+    s_kpaths_new_stamp (self);
+    self->found [self->found_size++] = s_kpaths_tree_path (self, NULL, 0, from);
+
+    while (self->found_size < k) {
+        kpaths_path_t *last = self->found [self->found_size - 1];
+        for (int spur = 0; spur < last->length - 1; spur++) {
+            int node = last->nodes [spur];
+            s_kpaths_new_stamp (self);
+            //  Root path nodes cannot be visited again
+            for (int i = 0; i < spur; i++)
+                self->node_mask [last->nodes [i]] = self->stamp;
+            //  Found paths with this root cannot continue the same way
+            for (int p = 0; p < self->found_size; p++) {
+                kpaths_path_t *path = self->found [p];
+                if (path->length > spur + 1
+                &&  memcmp (path->nodes, last->nodes, (spur + 1) * sizeof (int)) == 0)
+                    s_kpaths_remove_edges (self, node, path->nodes [spur + 1]);
+            }
+            kpaths_path_t *path = s_kpaths_tree_path (self, last, spur, node);
+            if (path)
+                self->reused++;
+            else
+                path = s_kpaths_spur_search (self, last, spur);
+            if (path)
+                s_kpaths_add_candidate (self, path);
+        }
+        kpaths_path_t *next = s_kpaths_take_candidate (self);
+        if (!next)
+            break;
+        self->found [self->found_size++] = next;
+    }
+    return self->found_size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get cost of path found by the last search
+
+int
+kpaths_cost (kpaths_t *self, int index)
+{
+    if (!self || index < 0 || index >= self->found_size) return -1;
+    return s_path_cost (self->found [index]);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes of path found by the last search
+
+int
+kpaths_length (kpaths_t *self, int index)
+{
+    if (!self || index < 0 || index >= self->found_size) return 0;
+    return self->found [index]->length;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get nodes of path found by the last search
+
+const int *
+kpaths_nodes (kpaths_t *self, int index)
+{
+    if (!self || index < 0 || index >= self->found_size) return NULL;
+    return self->found [index]->nodes;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of spur searches run by the last search
+
+size_t
+kpaths_searches (kpaths_t *self)
+{
+    if (!self) return 0;
+    return self->searches;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of spur paths taken from the shortest path tree
+
+size_t
+kpaths_reused (kpaths_t *self)
+{
+    if (!self) return 0;
+    return self->reused;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the path finder
+
+void
+kpaths_destroy (kpaths_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        kpaths_t *self = *self_p;
+        s_kpaths_clear (self);
+        free (self->candidates);
+        dheap_destroy (&self->heap);
+        dsearch_destroy (&self->tree);
+        graph_destroy (&self->reverse);
+        free (self->distance);
+        free (self->parent);
+        free (self->visited);
+        free (self->node_mask);
+        free (self->edge_mask);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+//  Collect costs of all loopless paths from node to target by brute force
+static void
+s_all_paths (graph_t *graph, int node, int target, int cost, bool *on_path,
+             int *costs, int *count)
+{
+    if (node == target) {
+        costs [(*count)++] = cost;
+        return;
+    }
+    on_path [node] = true;
+    for (int i = 0; i < graph_degree (graph, node); i++) {
+        int v = graph_targets (graph, node) [i];
+        if (!on_path [v])
+            s_all_paths (graph, v, target, cost + graph_weights (graph, node) [i],
+                         on_path, costs, count);
+    }
+    on_path [node] = false;
+}
+
+static int
+s_int_compare (const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+void
+kpaths_test (bool verbose)
+{
+    printf (" * kpaths: ");
+
+    //  @selftest
+    //  Graph from the description of Yen's method, nodes C D E F G H
+    int from [] = { 0, 0, 1, 2, 2, 2, 3, 3, 4 };
+    int to [] = { 1, 2, 3, 1, 3, 4, 4, 5, 5 };
+    int weight [] = { 3, 2, 4, 1, 2, 3, 2, 1, 2 };
+    graph_t *graph = graph_new_from_edges (6, 9, from, to, weight);
+    kpaths_t *self = kpaths_new (graph);
+    assert (self);
+    assert (kpaths_find (self, 0, 5, 3) == 3);
+    int first [] = { 0, 2, 3, 5 };
+    int second [] = { 0, 2, 4, 5 };
+    assert (kpaths_cost (self, 0) == 5);
+    assert (kpaths_length (self, 0) == 4);
+    assert (memcmp (kpaths_nodes (self, 0), first, sizeof (first)) == 0);
+    assert (kpaths_cost (self, 1) == 7);
+    assert (memcmp (kpaths_nodes (self, 1), second, sizeof (second)) == 0);
+    assert (kpaths_cost (self, 2) == 8);
+    assert (kpaths_reused (self) > 0);
+
+    //  There are only 7 loopless paths
+    assert (kpaths_find (self, 0, 5, 20) == 7);
+    for (int i = 1; i < 7; i++)
+        assert (kpaths_cost (self, i - 1) <= kpaths_cost (self, i));
+    assert (kpaths_cost (self, 7) == -1);
+
+    //  Trivial and impossible searches
+    assert (kpaths_find (self, 3, 3, 2) == 1);
+    assert (kpaths_cost (self, 0) == 0);
+    assert (kpaths_find (self, 5, 0, 2) == 0);
+    assert (kpaths_find (self, 0, 9, 2) == 0);
+    kpaths_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Random graph against brute force
+    const int nodes = 9;
+    int edges = 0;
+    int rfrom [81], rto [81], rweight [81];
+    srandom (1);
+    for (int u = 0; u < nodes; u++) {
+        for (int v = 0; v < nodes; v++) {
+            if (u != v && random () % 3 == 0) {
+                rfrom [edges] = u;
+                rto [edges] = v;
+                rweight [edges++] = 1 + random () % 10;
+            }
+        }
+    }
+    graph = graph_new_from_edges (nodes, edges, rfrom, rto, rweight);
+    self = kpaths_new (graph);
+    int *costs = (int *) malloc (100000 * sizeof (int));
+    bool on_path [9] = { false };
+    for (int target = 1; target < nodes; target++) {
+        int count = 0;
+        s_all_paths (graph, 0, target, 0, on_path, costs, &count);
+        assert (count < 100000);
+        qsort (costs, count, sizeof (int), s_int_compare);
+        int k = kpaths_find (self, 0, target, 25);
+        assert (k == (count < 25 ? count : 25));
+        for (int i = 0; i < k; i++) {
+            assert (kpaths_cost (self, i) == costs [i]);
+            //  Path is loopless and follows edges
+            const int *path = kpaths_nodes (self, i);
+            assert (path [0] == 0 && path [kpaths_length (self, i) - 1] == target);
+            for (int j = 0; j < kpaths_length (self, i); j++)
+                for (int l = 0; l < j; l++)
+                    assert (path [j] != path [l]);
+        }
+        if (verbose)
+            zsys_info ("kpaths: target %d, %d paths, %zu searches, %zu from tree",
+                       target, k, kpaths_searches (self), kpaths_reused (self));
+    }
+    free (costs);
+    kpaths_destroy (&self);
+    graph_destroy (&graph);
+    //  @end
+    printf ("OK\n");
+}
@@ -15,11 +15,43 @@
 @header
     matrix - Matrix
 @discuss
+    Transpose copies square tiles, so both the rows read and the rows
+    written stay in cache while a tile is done. Min-plus product walks b in
+    tiles of MATRIX_TILE_ROWS rows by MATRIX_TILE_COLUMNS columns, which
+    every row of the result reuses from L2 cache, and adds rows of a tile
+    to the result with vectorised row kernels (see dkernel). Rows of the
+    result are split between threads, which never share a row.
 @end
 */
 
 #include "graphs_classes.h"
 
+#if defined (__linux__)
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#endif
+
+//  Rows are padded and aligned to a cache line, which is also enough for
+//  aligned SIMD loads over whole rows
+#define MATRIX_ALIGNMENT 64
+
+//  Matrices backed by huge pages are rounded up to this size
+#define MATRIX_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+//  Linux memory policy used for NUMA-local placement
+#define MATRIX_MPOL_PREFERRED 1
+
+//  Transpose tile, elements on a side
+#define MATRIX_TILE         32
+
+//  Min-plus tile of b, rows by columns
+#define MATRIX_TILE_ROWS    64
+#define MATRIX_TILE_COLUMNS 1024
+
+//  Min-plus additions worth starting another thread for
+#define MATRIX_PARALLEL_WORK (1 << 22)
+#define MATRIX_MAX_THREADS  64
+
 //  Structure of our class
 
 struct _matrix_t {
@@ -27,25 +59,165 @@ struct _matrix_t {
     unsigned int y;
     pthread_mutex_t mutex;
     size_t element_size;
+    size_t row_size;            //  Bytes between rows, including padding
+    size_t mapped_size;         //  Size of mmap-ed elements, 0 if allocated
     uint8_t *elements;
+    uint8_t **rows;             //  Rows of a view, NULL if matrix owns elements
 };
 
+//  Failed NUMA placement is logged once
+
+static bool s_numa_warned = false;
+
+//  Address of row y
+
+static inline uint8_t *
+s_matrix_row (matrix_t *self, unsigned int y)
+{
+    return self->rows ? self->rows [y] : &(self->elements [y * self->row_size]);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Map elements with huge pages. Returns 0 if successful, -1 if huge pages
+//  are not available on this system.
+
+static int
+s_matrix_map (matrix_t *self, size_t size, int flags)
+{
+#if defined (__linux__)
+    size = (size + MATRIX_HUGEPAGE_SIZE - 1) / MATRIX_HUGEPAGE_SIZE * MATRIX_HUGEPAGE_SIZE;
+    void *elements = MAP_FAILED;
+#   if defined (MAP_HUGETLB)
+    if (flags & MATRIX_HUGETLB)
+        elements = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#   endif
+    if (elements == MAP_FAILED) {
+        //  No explicit huge pages reserved, fall back to transparent ones
+        elements = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (elements == MAP_FAILED)
+            return -1;
+#   if defined (MADV_HUGEPAGE)
+        madvise (elements, size, MADV_HUGEPAGE);
+#   endif
+    }
+    self->elements = (uint8_t *) elements;
+    self->mapped_size = size;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Prefer NUMA node of the calling thread for elements and fault them in
+//  from here, so placement does not depend on which thread touches first.
+//  Elements must start on a page. Returns 0 if placed, -1 with errno set
+//  if the kernel refused.
+
+static int
+s_matrix_place_local (matrix_t *self, size_t size)
+{
+    int rc = -1;
+#if defined (__linux__) && defined (SYS_mbind) && defined (SYS_getcpu)
+    unsigned int cpu, node;
+    if (syscall (SYS_getcpu, &cpu, &node, NULL) == 0) {
+        if (node < 8 * sizeof (unsigned long)) {
+            size_t page = (size_t) sysconf (_SC_PAGESIZE);
+            size_t length = self->mapped_size ? self->mapped_size
+                                              : (size + page - 1) / page * page;
+            unsigned long nodemask = 1UL << node;
+            rc = (int) syscall (SYS_mbind, self->elements, length,
+                                MATRIX_MPOL_PREFERRED, &nodemask, 8 * sizeof (unsigned long), 0);
+        }
+        else
+            errno = EINVAL;
+    }
+#else
+    errno = ENOSYS;
+#endif
+    memset (self->elements, 0, size);
+    return rc == 0 ? 0 : -1;
+}
+
 
 //  --------------------------------------------------------------------------
 //  Create a new matrix
 
 matrix_t *
 matrix_new (unsigned int x, unsigned int y, size_t element_size)
+{
+    return matrix_new_with (x, y, element_size, 0, 0);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new matrix with given row alignment and allocation flags
+
+matrix_t *
+matrix_new_with (unsigned int x, unsigned int y, size_t element_size,
+                 size_t row_alignment, int flags)
 {
     if (!x || !y || !element_size) return NULL;
+    if (row_alignment & (row_alignment - 1)) return NULL;
+    if (row_alignment < MATRIX_ALIGNMENT)
+        row_alignment = MATRIX_ALIGNMENT;
+
+    //  All sizes are computed in size_t and checked for overflow
+    if (element_size > (SIZE_MAX - row_alignment) / x) return NULL;
+    size_t row_size = (x * element_size + row_alignment - 1) / row_alignment * row_alignment;
+    if (row_size > (SIZE_MAX - MATRIX_HUGEPAGE_SIZE) / y) return NULL;
+    size_t size = row_size * y;
+
+    matrix_t *self = (matrix_t *) zmalloc (sizeof (matrix_t));
+    assert (self);
+    self->x = x;
+    self->y = y;
+    self->element_size = element_size;
+    self->row_size = row_size;
+    if ((flags & (MATRIX_HUGEPAGES | MATRIX_HUGETLB)) == 0
+    ||  s_matrix_map (self, size, flags) != 0) {
+        //  Memory policy applies to whole pages only
+        size_t alignment = row_alignment;
+        if ((flags & MATRIX_NUMA_LOCAL) && alignment < (size_t) sysconf (_SC_PAGESIZE))
+            alignment = (size_t) sysconf (_SC_PAGESIZE);
+        if (posix_memalign ((void **) &self->elements, alignment, size) != 0) {
+            free (self);
+            return NULL;
+        }
+        if ((flags & MATRIX_NUMA_LOCAL) == 0)
+            memset (self->elements, 0, size);
+    }
+    if ((flags & MATRIX_NUMA_LOCAL)
+    &&  s_matrix_place_local (self, size) != 0
+    &&  !__atomic_exchange_n (&s_numa_warned, true, __ATOMIC_RELAXED))
+        zsys_warning ("matrix: cannot place elements on local NUMA node: %s", strerror (errno));
+    int res = pthread_mutex_init (&self->mutex, NULL);
+    assert (res == 0);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a matrix viewing rows owned by the caller
+
+matrix_t *
+matrix_new_view (unsigned int x, unsigned int y, size_t element_size, void **rows)
+{
+    if (!x || !y || !element_size || !rows) return NULL;
 
     matrix_t *self = (matrix_t *) zmalloc (sizeof (matrix_t));
     assert (self);
     self->x = x;
     self->y = y;
     self->element_size = element_size;
-    self->elements = (uint8_t *) zmalloc (self->x * self->y * self->element_size);
-    assert (self->elements);
+    self->row_size = x * element_size;
+    self->rows = (uint8_t **) malloc (y * sizeof (uint8_t *));
+    assert (self->rows);
+    memcpy (self->rows, rows, y * sizeof (uint8_t *));
     int res = pthread_mutex_init (&self->mutex, NULL);
     assert (res == 0);
     return self;
@@ -60,7 +232,7 @@ matrix_set (matrix_t *self, unsigned int x, unsigned int y, void *element)
 {
     if (!self || x >= self->x || y >= self->y || !element) return;
     pthread_mutex_lock (&self->mutex);
-    uint8_t *dest = &(self->elements [(self->x * y + x) * self->element_size]);
+    uint8_t *dest = s_matrix_row (self, y) + x * self->element_size;
     memcpy (dest, element, self->element_size);
     pthread_mutex_unlock (&self->mutex);
 }
@@ -96,7 +268,7 @@ void *
 matrix_get_ptr (matrix_t *self, unsigned int x, unsigned int y)
 {
     if (!self || x >= self->x || y >= self->y) return NULL;
-    uint8_t *element = &(self->elements [(self->x * y + x) * self->element_size]);
+    uint8_t *element = s_matrix_row (self, y) + x * self->element_size;
     return (void *)element;
 }
 
@@ -128,6 +300,22 @@ matrix_y (matrix_t *self) {
     return self->y;
 }
 
+//  --------------------------------------------------------------------------
+//  Get number of bytes between two rows
+size_t
+matrix_row_size (matrix_t *self) {
+    if (!self) return 0;
+    return self->row_size;
+}
+
+//  --------------------------------------------------------------------------
+//  Get size of one element in bytes
+size_t
+matrix_element_size (matrix_t *self) {
+    if (!self) return 0;
+    return self->element_size;
+}
+
 //  --------------------------------------------------------------------------
 //  Destroy the matrix
 
@@ -137,20 +325,185 @@ matrix_destroy (matrix_t **self_p)
     assert (self_p);
     if (*self_p) {
         matrix_t *self = *self_p;
+#if defined (__linux__)
+        if (self->mapped_size)
+            munmap (self->elements, self->mapped_size);
+        else
+#endif
         if (self->elements) free (self->elements);
+        free (self->rows);
         pthread_mutex_destroy (&self->mutex);
         free (self);
         *self_p = NULL;
     }
 }
 
+//  --------------------------------------------------------------------------
+//  Create transposed copy of matrix
+
+matrix_t *
+matrix_transpose (matrix_t *self)
+{
+    if (!self) return NULL;
+
+    matrix_t *result = matrix_new (self->y, self->x, self->element_size);
+    if (!result)
+        return NULL;
+    size_t size = self->element_size;
+    for (unsigned int y0 = 0; y0 < self->y; y0 += MATRIX_TILE) {
+        unsigned int y1 = self->y - y0 < MATRIX_TILE ? self->y : y0 + MATRIX_TILE;
+        for (unsigned int x0 = 0; x0 < self->x; x0 += MATRIX_TILE) {
+            unsigned int x1 = self->x - x0 < MATRIX_TILE ? self->x : x0 + MATRIX_TILE;
+            for (unsigned int y = y0; y < y1; y++) {
+                const uint8_t *row = s_matrix_row (self, y);
+                if (size == sizeof (uint32_t))
+                    for (unsigned int x = x0; x < x1; x++)
+                        ((uint32_t *) s_matrix_row (result, x)) [y] = ((const uint32_t *) row) [x];
+                else
+                if (size == sizeof (uint64_t))
+                    for (unsigned int x = x0; x < x1; x++)
+                        ((uint64_t *) s_matrix_row (result, x)) [y] = ((const uint64_t *) row) [x];
+                else
+                    for (unsigned int x = x0; x < x1; x++)
+                        memcpy (s_matrix_row (result, x) + y * size, row + x * size, size);
+            }
+        }
+    }
+    return result;
+}
+
+
+//  Rows of min-plus product computed by one thread
+
+typedef struct {
+    matrix_t *a;
+    matrix_t *b;
+    matrix_t *c;
+    int type;
+    unsigned int first;         //  First row of c
+    unsigned int last;          //  Row after the last one
+} s_min_plus_task_t;
+
+static void *
+s_min_plus_worker (void *args)
+{
+    s_min_plus_task_t *task = (s_min_plus_task_t *) args;
+    unsigned int width = task->b->x;
+    unsigned int depth = task->a->x;
+    for (unsigned int x0 = 0; x0 < width; x0 += MATRIX_TILE_COLUMNS) {
+        int columns = width - x0 < MATRIX_TILE_COLUMNS ? width - x0 : MATRIX_TILE_COLUMNS;
+        for (unsigned int k0 = 0; k0 < depth; k0 += MATRIX_TILE_ROWS) {
+            unsigned int k1 = depth - k0 < MATRIX_TILE_ROWS ? depth : k0 + MATRIX_TILE_ROWS;
+            for (unsigned int y = task->first; y < task->last; y++) {
+                const uint8_t *row = s_matrix_row (task->a, y);
+                uint8_t *target = s_matrix_row (task->c, y) + x0 * sizeof (int);
+                for (unsigned int k = k0; k < k1; k++) {
+                    const uint8_t *source = s_matrix_row (task->b, k) + x0 * sizeof (int);
+                    if (task->type == MATRIX_INT) {
+                        int add = ((const int *) row) [k];
+                        if (add != INT_MAX)
+                            dkernel_min_plus_int ((int *) target, (const int *) source, add, columns);
+                    }
+                    else {
+                        float add = ((const float *) row) [k];
+                        if (add != INFINITY)
+                            dkernel_min_plus_float ((float *) target, (const float *) source, add, columns);
+                    }
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create min-plus product of two matrices
+
+matrix_t *
+matrix_min_plus (matrix_t *a, matrix_t *b, int type, int threads)
+{
+    if (!a || !b || a->x != b->y
+    ||  a->element_size != 4 || b->element_size != 4
+    ||  (type != MATRIX_INT && type != MATRIX_FLOAT))
+        return NULL;
+
+    matrix_t *c = matrix_new (b->x, a->y, 4);
+    if (!c)
+        return NULL;
+    for (unsigned int y = 0; y < c->y; y++) {
+        uint8_t *row = s_matrix_row (c, y);
+        for (unsigned int x = 0; x < c->x; x++)
+            if (type == MATRIX_INT)
+                ((int *) row) [x] = INT_MAX;
+            else
+                ((float *) row) [x] = INFINITY;
+    }
+    if (threads <= 0) {
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        double useful = (double) a->y * a->x * b->x / MATRIX_PARALLEL_WORK + 1;
+        threads = (int) (cpus < useful ? (cpus > 0 ? cpus : 1) : useful);
+    }
+    if (threads > MATRIX_MAX_THREADS)
+        threads = MATRIX_MAX_THREADS;
+    if ((unsigned int) threads > a->y)
+        threads = a->y > 0 ? (int) a->y : 1;
+
+    s_min_plus_task_t tasks [MATRIX_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        tasks [t].a = a;
+        tasks [t].b = b;
+        tasks [t].c = c;
+        tasks [t].type = type;
+        tasks [t].first = (unsigned int) ((uint64_t) a->y * t / threads);
+        tasks [t].last = (unsigned int) ((uint64_t) a->y * (t + 1) / threads);
+    }
+    pthread_t thread [MATRIX_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+        if (pthread_create (&thread [t], NULL, s_min_plus_worker, &tasks [t]) == 0)
+            started = t;
+        else
+            break;
+    s_min_plus_worker (&tasks [0]);
+    for (int t = started + 1; t < threads; t++)
+        s_min_plus_worker (&tasks [t]);
+    for (int t = 1; t <= started; t++)
+        pthread_join (thread [t], NULL);
+    return c;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Keep smaller of every element and the element of other matrix
+
+int
+matrix_min (matrix_t *self, matrix_t *other, int type)
+{
+    if (!self || !other || self->x != other->x || self->y != other->y
+    ||  self->element_size != 4 || other->element_size != 4
+    ||  (type != MATRIX_INT && type != MATRIX_FLOAT))
+        return -1;
+
+    for (unsigned int y = 0; y < self->y; y++)
+        if (type == MATRIX_INT)
+            dkernel_min_int ((int *) s_matrix_row (self, y),
+                             (const int *) s_matrix_row (other, y), self->x);
+        else
+            dkernel_min_float ((float *) s_matrix_row (self, y),
+                               (const float *) s_matrix_row (other, y), self->x);
+    return 0;
+}
+
 zchunk_t *
 matrix_as_chunk (matrix_t *self)
 {
     zchunk_t *chunk = zchunk_new (&(self->x), sizeof (unsigned int));
     zchunk_extend (chunk, &(self->y), sizeof (unsigned int));
     zchunk_extend (chunk, &(self->element_size), sizeof (size_t));
-    zchunk_extend (chunk, self->elements, self->x * self->y * self->element_size);
+    //  Padding is not sent
+    for (unsigned int y = 0; y < self->y; y++)
+        zchunk_extend (chunk, s_matrix_row (self, y), self->x * self->element_size);
     return chunk;
 }
 
@@ -160,16 +513,28 @@ matrix_from_chunk (zchunk_t **chunk_ptr)
     if (! chunk_ptr || ! *chunk_ptr) return NULL;
 
     zchunk_t *chunk = *chunk_ptr;
-    unsigned int x, y;
-    size_t element_size;
+    unsigned int x = 0, y = 0;
+    size_t element_size = 0;
     byte *data = zchunk_data (chunk);
-    memcpy (&x, &data[0], sizeof (unsigned int));
-    memcpy (&y, &data[sizeof (unsigned int)], sizeof (unsigned int));
-    memcpy (&element_size, &data[2*sizeof (unsigned int)], sizeof (size_t));
-
-    matrix_t *result = matrix_new (x, y, element_size);
+    size_t header = 2*sizeof (unsigned int) + sizeof (size_t);
+    //  Header comes from the wire, check elements are all there before
+    //  allocating for them
+    bool valid = zchunk_size (chunk) >= header;
+    if (valid) {
+        memcpy (&x, &data[0], sizeof (unsigned int));
+        memcpy (&y, &data[sizeof (unsigned int)], sizeof (unsigned int));
+        memcpy (&element_size, &data[2*sizeof (unsigned int)], sizeof (size_t));
+        size_t available = zchunk_size (chunk) - header;
+        valid = x && y && element_size
+             && element_size <= available / x
+             && (size_t) x * element_size <= available / y;
+    }
+    matrix_t *result = valid ? matrix_new (x, y, element_size) : NULL;
     if (result) {
-        memcpy (result->elements, &data[2*sizeof (unsigned int) + sizeof (size_t)], x * y * element_size);
+        size_t row_bytes = (size_t) x * element_size;
+        data += header;
+        for (unsigned int row = 0; row < y; row++)
+            memcpy (&(result->elements [row * result->row_size]), &data [row * row_bytes], row_bytes);
     }
     zchunk_destroy (chunk_ptr);
     return result;
@@ -226,6 +591,10 @@ matrix_test (bool verbose)
     matrix_set_int (self, 0, 0, -3);
     assert (matrix_as_int (self, 0, 0) == -3);
 
+    //  Every row starts on its own cache line
+    for (int y = 0; y < matrix_y (self); y++)
+        assert ((uintptr_t) matrix_get_ptr (self, 0, y) % 64 == 0);
+
     zchunk_t *chunk = matrix_as_chunk (self);
     matrix_t *copy = matrix_from_chunk (&chunk);
     for (int y = 0; y < matrix_y (self); y++) {
@@ -237,6 +606,183 @@ matrix_test (bool verbose)
     //matrix_print_int (copy);
     matrix_destroy (&copy);
     matrix_destroy (&self);
+
+    //  Sizes which do not fit into memory are refused, not wrapped around
+    self = matrix_new (UINT_MAX, UINT_MAX, SIZE_MAX / 2);
+    assert (self == NULL);
+
+    //  Custom row stride, huge pages and NUMA placement; explicit huge
+    //  pages fall back to transparent ones when none are reserved
+    self = matrix_new_with (100, 3, sizeof (int), 256, MATRIX_HUGETLB | MATRIX_NUMA_LOCAL);
+    assert (self);
+    assert (matrix_row_size (self) == 512);
+    for (int y = 0; y < matrix_y (self); y++)
+        assert ((uintptr_t) matrix_get_ptr (self, 0, y) % 256 == 0);
+    assert (matrix_as_int (self, 99, 2) == 0);
+    matrix_set_int (self, 99, 2, 42);
+    chunk = matrix_as_chunk (self);
+    assert (zchunk_size (chunk) == 2 * sizeof (unsigned int) + sizeof (size_t) + 300 * sizeof (int));
+    copy = matrix_from_chunk (&chunk);
+    assert (matrix_as_int (copy, 99, 2) == 42);
+    assert (matrix_row_size (copy) == 448);
+    matrix_destroy (&copy);
+    matrix_destroy (&self);
+    assert (matrix_new_with (4, 4, sizeof (int), 100, 0) == NULL);
+
+    //  NUMA placement alone gets elements on whole pages, which memory
+    //  policy needs; kernels without NUMA support may still refuse it
+    self = matrix_new_with (100, 3, sizeof (int), 0, MATRIX_NUMA_LOCAL);
+    assert (self);
+    assert ((uintptr_t) matrix_get_ptr (self, 0, 0) % sysconf (_SC_PAGESIZE) == 0);
+    assert (matrix_as_int (self, 99, 2) == 0);
+
+    //  Chunks shorter than their header says are refused
+    chunk = matrix_as_chunk (self);
+    zchunk_t *truncated = zchunk_new (zchunk_data (chunk), zchunk_size (chunk) - 1);
+    assert (matrix_from_chunk (&truncated) == NULL);
+    assert (truncated == NULL);
+    truncated = zchunk_new (zchunk_data (chunk), 2 * sizeof (unsigned int));
+    assert (matrix_from_chunk (&truncated) == NULL);
+    ((unsigned int *) zchunk_data (chunk)) [1] = UINT_MAX;
+    assert (matrix_from_chunk (&chunk) == NULL);
+    if (s_matrix_place_local (self, 3 * matrix_row_size (self)) != 0)
+        assert (errno == ENOSYS || errno == EPERM);
+    matrix_destroy (&self);
+
+    //  View shares rows with their owner, in any order
+    int first [3] = { 1, 2, 3 };
+    int second [3] = { 4, 5, 6 };
+    void *rows [] = { second, first };
+    self = matrix_new_view (3, 2, sizeof (int), rows);
+    assert (self);
+    assert (matrix_as_int (self, 0, 0) == 4);
+    assert (matrix_as_int (self, 2, 1) == 3);
+    matrix_set_int (self, 1, 1, 20);
+    assert (first [1] == 20);
+    chunk = matrix_as_chunk (self);
+    copy = matrix_from_chunk (&chunk);
+    assert (matrix_as_int (copy, 2, 0) == 6);
+    assert (matrix_as_int (copy, 1, 1) == 20);
+    matrix_destroy (&copy);
+
+    //  Transpose of view, and of elements of odd size
+    copy = matrix_transpose (self);
+    assert (matrix_x (copy) == 2 && matrix_y (copy) == 3);
+    assert (matrix_as_int (copy, 0, 2) == 6);
+    assert (matrix_as_int (copy, 1, 1) == 20);
+    matrix_destroy (&copy);
+    matrix_destroy (&self);
+    assert (first [0] == 1);
+
+    self = matrix_new (70, 45, 3);
+    for (int y = 0; y < 45; y++)
+        for (int x = 0; x < 70; x++) {
+            char value [3] = { (char) x, (char) y, 7 };
+            matrix_set (self, x, y, value);
+        }
+    copy = matrix_transpose (self);
+    assert (matrix_x (copy) == 45 && matrix_y (copy) == 70);
+    for (int y = 0; y < 70; y++)
+        for (int x = 0; x < 45; x++) {
+            const char *value = (const char *) matrix_get_ptr (copy, x, y);
+            assert (value [0] == y && value [1] == x && value [2] == 7);
+        }
+    matrix_destroy (&copy);
+    matrix_destroy (&self);
+
+    //  Min-plus product against the definition, over sizes which are not
+    //  multiples of tiles or vectors, with missing entries
+    int depth = 131, width = 1100, height = 37;
+    matrix_t *a = matrix_new (depth, height, sizeof (int));
+    matrix_t *b = matrix_new (width, depth, sizeof (int));
+    matrix_t *af = matrix_new (depth, height, sizeof (float));
+    matrix_t *bf = matrix_new (width, depth, sizeof (float));
+    unsigned int seed = 7;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < depth; x++) {
+            int value = rand_r (&seed) % 5 == 0 ? INT_MAX : rand_r (&seed) % 1000;
+            matrix_set_int (a, x, y, value);
+            *(float *) matrix_get_ptr (af, x, y) = value == INT_MAX ? INFINITY : value / 4.0f;
+        }
+    for (int y = 0; y < depth; y++)
+        for (int x = 0; x < width; x++) {
+            int value = rand_r (&seed) % 3 == 0 ? INT_MAX : rand_r (&seed) % 1000;
+            if (x == 5)
+                value = INT_MAX;        //  Column without any path
+            matrix_set_int (b, x, y, value);
+            *(float *) matrix_get_ptr (bf, x, y) = value == INT_MAX ? INFINITY : value / 4.0f;
+        }
+    matrix_t *product = matrix_min_plus (a, b, MATRIX_INT, 1);
+    matrix_t *productf = matrix_min_plus (af, bf, MATRIX_FLOAT, 3);
+    assert (product && productf);
+    assert (matrix_x (product) == width && matrix_y (product) == height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            int best = INT_MAX;
+            float bestf = INFINITY;
+            for (int k = 0; k < depth; k++) {
+                int left = matrix_as_int (a, k, y);
+                int right = matrix_as_int (b, x, k);
+                if (left != INT_MAX && right != INT_MAX && left + right < best)
+                    best = left + right;
+                float sum = *(float *) matrix_get_ptr (af, k, y)
+                          + *(float *) matrix_get_ptr (bf, x, k);
+                if (sum < bestf)
+                    bestf = sum;
+            }
+            assert (matrix_as_int (product, x, y) == best);
+            assert (*(float *) matrix_get_ptr (productf, x, y) == bestf);
+        }
+    assert (matrix_as_int (product, 5, 0) == INT_MAX);
+    assert (*(float *) matrix_get_ptr (productf, 5, 0) == INFINITY);
+
+    //  Elementwise minimum of two products is one product
+    copy = matrix_min_plus (a, b, MATRIX_INT, 0);
+    matrix_set_int (copy, 3, 2, -1);
+    assert (matrix_min (copy, product, MATRIX_INT) == 0);
+    assert (matrix_as_int (copy, 3, 2) == -1);
+    matrix_set_int (copy, 3, 2, matrix_as_int (product, 3, 2));
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            assert (matrix_as_int (copy, x, y) == matrix_as_int (product, x, y));
+    assert (matrix_min (copy, a, MATRIX_INT) == -1);
+    matrix_destroy (&copy);
+    copy = matrix_transpose (productf);
+    *(float *) matrix_get_ptr (copy, 0, 0) = 0.5f;
+    matrix_t *twice = matrix_transpose (copy);
+    assert (matrix_min (twice, productf, MATRIX_FLOAT) == 0);
+    assert (*(float *) matrix_get_ptr (twice, 0, 0) == 0.5f);
+    assert (*(float *) matrix_get_ptr (twice, 1, 0) == *(float *) matrix_get_ptr (productf, 1, 0));
+    matrix_destroy (&twice);
+    matrix_destroy (&copy);
+
+    //  Sizes must agree
+    assert (matrix_min_plus (b, b, MATRIX_INT, 1) == NULL);
+    assert (matrix_min_plus (a, b, 2, 1) == NULL);
+    copy = matrix_new (width, depth, sizeof (double));
+    assert (matrix_min_plus (a, copy, MATRIX_INT, 1) == NULL);
+    matrix_destroy (&copy);
+
+    if (verbose) {
+        int size = 512;
+        matrix_t *square = matrix_new (size, size, sizeof (int));
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+                matrix_set_int (square, x, y, rand_r (&seed) % 1000);
+        int64_t start = zclock_usecs ();
+        copy = matrix_min_plus (square, square, MATRIX_INT, 0);
+        int64_t took = zclock_usecs () - start;
+        printf ("\nmin-plus of %dx%d int matrices in %" PRId64 " us, %.2f ns per addition\n",
+                size, size, took, took * 1000.0 / size / size / size);
+        matrix_destroy (&copy);
+        matrix_destroy (&square);
+    }
+    matrix_destroy (&product);
+    matrix_destroy (&productf);
+    matrix_destroy (&a);
+    matrix_destroy (&b);
+    matrix_destroy (&af);
+    matrix_destroy (&bf);
     //  @end
     printf ("OK\n");
 }
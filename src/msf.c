@@ -0,0 +1,529 @@
+/*  =========================================================================
+    msf - Minimum spanning forest by parallel Boruvka
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    msf - Minimum spanning forest by parallel Boruvka
+@discuss
+    Every Boruvka round finds the cheapest edge leaving each component and
+    merges along all of them, so the number of components at least halves
+    and there are at most log2 (nodes) rounds.
+
+    Both steps of a round run on several threads. First every thread scans
+    a range of nodes with about the same number of edges and lowers the
+    best edge of both components with an atomic minimum. Edges are
+    compared by weight, then by index, which is a strict total order, so
+    the chosen edges never close a cycle. Then every thread takes a range
+    of components and merges along their best edges in a lock-free
+    union-find forest; an edge chosen by both its components is merged
+    only by the thread whose union wins.
+
+    Edge u -> v and its reverse are different edges of the graph, and
+    either may be chosen. The forest is reported ordered by weight, so the
+    result does not depend on the number of threads.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Graphs with less edges per thread are done by less threads
+#define MSF_PARALLEL_EDGES  (1 << 16)
+#define MSF_MAX_THREADS     64
+#define MSF_NONE            UINT64_MAX
+
+//  Structure of our class
+
+struct _msf_t {
+    int size;                   //  Number of forest edges
+    int *from;
+    int *to;
+    int *weight;
+    int64_t total;
+    int components;
+    int rounds;
+};
+
+//  Edge taken to the forest
+
+typedef struct {
+    uint64_t key;
+    int from;
+    int to;
+} s_msf_edge_t;
+
+//  State shared by threads of one computation
+
+typedef struct {
+    graph_t *graph;
+    dunion_t *forest;
+    int *label;                 //  Root of every node as of round start
+    uint64_t *best;             //  Best edge key of every root
+    s_msf_edge_t *chosen;       //  Forest edges
+    int chosen_count;
+    bool merged;                //  Some union happened this round
+} s_boruvka_t;
+
+typedef struct {
+    s_boruvka_t *shared;
+    int begin;                  //  Range of nodes to scan
+    int end;
+    int roots_begin;            //  Range of components to merge
+    int roots_end;
+} s_boruvka_task_t;
+
+
+//  Sort key of edge, weights of graph are positive
+
+static inline uint64_t
+s_key (int weight, int edge)
+{
+    return ((uint64_t) weight << 32) | (uint32_t) edge;
+}
+
+static inline int
+s_key_edge (uint64_t key)
+{
+    return (int) (uint32_t) key;
+}
+
+//  Lower best edge of component to key
+
+static inline void
+s_lower (uint64_t *best, uint64_t key)
+{
+    uint64_t old = __atomic_load_n (best, __ATOMIC_RELAXED);
+    while (key < old
+       && !__atomic_compare_exchange_n (best, &old, key, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+//  Node whose adjacency holds edge
+
+static int
+s_source (graph_t *graph, int edge)
+{
+    int low = 0;
+    int high = graph_nodes (graph) - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (graph_offset (graph, middle) <= edge)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+static void *
+s_scan_worker (void *args)
+{
+    s_boruvka_task_t *task = (s_boruvka_task_t *) args;
+    s_boruvka_t *shared = task->shared;
+    for (int u = task->begin; u < task->end; u++) {
+        int degree = graph_degree (shared->graph, u);
+        if (!degree)
+            continue;
+        const int *targets = graph_targets (shared->graph, u);
+        const int *weights = graph_weights (shared->graph, u);
+        int offset = graph_offset (shared->graph, u);
+        int root = shared->label [u];
+        uint64_t best = MSF_NONE;
+        for (int i = 0; i < degree; i++) {
+            int other = shared->label [targets [i]];
+            if (other == root)
+                continue;
+            uint64_t key = s_key (weights [i], offset + i);
+            if (key < best)
+                best = key;
+            s_lower (&shared->best [other], key);
+        }
+        if (best != MSF_NONE)
+            s_lower (&shared->best [root], best);
+    }
+    return NULL;
+}
+
+static void *
+s_merge_worker (void *args)
+{
+    s_boruvka_task_t *task = (s_boruvka_task_t *) args;
+    s_boruvka_t *shared = task->shared;
+    bool merged = false;
+    for (int c = task->roots_begin; c < task->roots_end; c++) {
+        uint64_t key = shared->best [c];
+        if (key == MSF_NONE)
+            continue;
+        shared->best [c] = MSF_NONE;
+        int edge = s_key_edge (key);
+        int u = s_source (shared->graph, edge);
+        int v = graph_targets (shared->graph, u) [edge - graph_offset (shared->graph, u)];
+        if (dunion_unite (shared->forest, u, v)) {
+            int slot = __atomic_fetch_add (&shared->chosen_count, 1, __ATOMIC_RELAXED);
+            shared->chosen [slot].key = key;
+            shared->chosen [slot].from = u;
+            shared->chosen [slot].to = v;
+            merged = true;
+        }
+    }
+    if (merged)
+        __atomic_store_n (&shared->merged, true, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *
+s_label_worker (void *args)
+{
+    s_boruvka_task_t *task = (s_boruvka_task_t *) args;
+    s_boruvka_t *shared = task->shared;
+    for (int u = task->roots_begin; u < task->roots_end; u++)
+        shared->label [u] = dunion_find (shared->forest, u);
+    return NULL;
+}
+
+//  Run worker over all tasks, falling back to this thread for tasks whose
+//  thread did not start
+
+static void
+s_run_tasks (s_boruvka_task_t *tasks, int threads, void *(*worker) (void *))
+{
+    pthread_t thread [MSF_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+        if (pthread_create (&thread [t], NULL, worker, &tasks [t]) == 0)
+            started = t;
+        else
+            break;
+    worker (&tasks [0]);
+    for (int t = started + 1; t < threads; t++)
+        worker (&tasks [t]);
+    for (int t = 1; t <= started; t++)
+        pthread_join (thread [t], NULL);
+}
+
+static int
+s_edge_compare (const void *a, const void *b)
+{
+    uint64_t ka = ((const s_msf_edge_t *) a)->key;
+    uint64_t kb = ((const s_msf_edge_t *) b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Compute minimum spanning forest of graph
+
+msf_t *
+msf_new (graph_t *graph, int threads)
+{
+    if (!graph) return NULL;
+
+    int nodes = graph_nodes (graph);
+    int edges = graph_edges (graph);
+    if (threads <= 0) {
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        long useful = edges / MSF_PARALLEL_EDGES + 1;
+        threads = (int) (cpus < useful ? (cpus > 0 ? cpus : 1) : useful);
+    }
+    if (threads > MSF_MAX_THREADS)
+        threads = MSF_MAX_THREADS;
+
+    msf_t *self = (msf_t *) zmalloc (sizeof (msf_t));
+    assert (self);
+    s_boruvka_t shared = { graph, dunion_new (nodes), NULL, NULL, NULL, 0, false };
+    shared.label = (int *) malloc ((nodes + 1) * sizeof (int));
+    shared.best = (uint64_t *) malloc ((nodes + 1) * sizeof (uint64_t));
+    shared.chosen = (s_msf_edge_t *) malloc ((nodes + 1) * sizeof (s_msf_edge_t));
+    assert (shared.forest && shared.label && shared.best && shared.chosen);
+    for (int u = 0; u < nodes; u++) {
+        shared.label [u] = u;
+        shared.best [u] = MSF_NONE;
+    }
+
+    s_boruvka_task_t tasks [MSF_MAX_THREADS];
+    int begin = 0;
+    for (int t = 0; t < threads; t++) {
+        //  Scan range ends where its share of edges does
+        int64_t share = (int64_t) edges * (t + 1) / threads;
+        int end = begin;
+        while (end < nodes && graph_offset (graph, end) < share)
+            end++;
+        if (t == threads - 1)
+            end = nodes;
+        tasks [t].shared = &shared;
+        tasks [t].begin = begin;
+        tasks [t].end = end;
+        tasks [t].roots_begin = (int) ((int64_t) nodes * t / threads);
+        tasks [t].roots_end = (int) ((int64_t) nodes * (t + 1) / threads);
+        begin = end;
+    }
+    do {
+        shared.merged = false;
+        s_run_tasks (tasks, threads, s_scan_worker);
+        s_run_tasks (tasks, threads, s_merge_worker);
+        if (shared.merged)
+            s_run_tasks (tasks, threads, s_label_worker);
+        self->rounds++;
+    } while (shared.merged);
+
+    qsort (shared.chosen, shared.chosen_count, sizeof (s_msf_edge_t), s_edge_compare);
+    self->size = shared.chosen_count;
+    self->components = nodes - self->size;
+    self->from = (int *) malloc ((self->size + 1) * sizeof (int));
+    self->to = (int *) malloc ((self->size + 1) * sizeof (int));
+    self->weight = (int *) malloc ((self->size + 1) * sizeof (int));
+    assert (self->from && self->to && self->weight);
+    for (int i = 0; i < self->size; i++) {
+        self->from [i] = shared.chosen [i].from;
+        self->to [i] = shared.chosen [i].to;
+        self->weight [i] = (int) (shared.chosen [i].key >> 32);
+        self->total += self->weight [i];
+    }
+    dunion_destroy (&shared.forest);
+    free (shared.label);
+    free (shared.best);
+    free (shared.chosen);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of edges in the forest
+
+int
+msf_edges (msf_t *self)
+{
+    if (!self) return 0;
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get sources of forest edges
+
+const int *
+msf_from (msf_t *self)
+{
+    assert (self);
+    return self->from;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get targets of forest edges
+
+const int *
+msf_to (msf_t *self)
+{
+    assert (self);
+    return self->to;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get weights of forest edges
+
+const int *
+msf_weights (msf_t *self)
+{
+    assert (self);
+    return self->weight;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get total weight of the forest
+
+int64_t
+msf_weight (msf_t *self)
+{
+    if (!self) return 0;
+    return self->total;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of trees in the forest
+
+int
+msf_components (msf_t *self)
+{
+    if (!self) return 0;
+    return self->components;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of Boruvka rounds
+
+int
+msf_rounds (msf_t *self)
+{
+    if (!self) return 0;
+    return self->rounds;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the forest
+
+void
+msf_destroy (msf_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        msf_t *self = *self_p;
+        free (self->from);
+        free (self->to);
+        free (self->weight);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+typedef struct {
+    int weight;
+    int from;
+    int to;
+} s_test_edge_t;
+
+static int
+s_test_edge_compare (const void *a, const void *b)
+{
+    const s_test_edge_t *ea = (const s_test_edge_t *) a;
+    const s_test_edge_t *eb = (const s_test_edge_t *) b;
+    return (ea->weight > eb->weight) - (ea->weight < eb->weight);
+}
+
+//  Weight of minimum spanning forest by Kruskal's method
+
+static int64_t
+s_test_kruskal (int nodes, int edges, const int *from, const int *to, const int *weight)
+{
+    s_test_edge_t *sorted = (s_test_edge_t *) malloc (edges * sizeof (s_test_edge_t));
+    assert (sorted);
+    for (int i = 0; i < edges; i++) {
+        sorted [i].weight = weight [i];
+        sorted [i].from = from [i];
+        sorted [i].to = to [i];
+    }
+    qsort (sorted, edges, sizeof (s_test_edge_t), s_test_edge_compare);
+    dunion_t *forest = dunion_new (nodes);
+    int64_t total = 0;
+    for (int i = 0; i < edges; i++)
+        if (dunion_unite (forest, sorted [i].from, sorted [i].to))
+            total += sorted [i].weight;
+    dunion_destroy (&forest);
+    free (sorted);
+    return total;
+}
+
+void
+msf_test (bool verbose)
+{
+    printf (" * msf: ");
+
+    //  @selftest
+    //  Ring 0 -1- 1 -3- 2 -5- 3 -4- 0 with diagonal 1 -2- 3, node 4 alone
+    int from [] = { 0, 1, 1, 2, 2, 3, 3, 0, 1, 3 };
+    int to [] = { 1, 0, 2, 1, 3, 2, 0, 3, 3, 1 };
+    int weight [] = { 1, 1, 3, 3, 5, 5, 4, 4, 2, 2 };
+    graph_t *graph = graph_new_from_edges (5, 10, from, to, weight);
+    msf_t *self = msf_new (graph, 1);
+    assert (self);
+    assert (msf_edges (self) == 3);
+    assert (msf_weight (self) == 6);
+    assert (msf_components (self) == 2);
+    //  Ordered by weight
+    assert (msf_weights (self) [0] == 1);
+    assert (msf_weights (self) [2] == 3);
+    assert (msf_from (self) [1] + msf_to (self) [1] == 4);
+    msf_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Directed edges count as undirected
+    int dfrom [] = { 0, 2, 1 };
+    int dto [] = { 1, 1, 2 };
+    int dweight [] = { 2, 1, 7 };
+    graph = graph_new_from_edges (3, 3, dfrom, dto, dweight);
+    self = msf_new (graph, 0);
+    assert (msf_edges (self) == 2);
+    assert (msf_weight (self) == 3);
+    msf_destroy (&self);
+    graph_destroy (&graph);
+
+    //  Random graphs agree with Kruskal on any number of threads, ties
+    //  and several components included
+    const int nodes = 20000;
+    const int edges = 60000;
+    int *rfrom = (int *) malloc (edges * sizeof (int));
+    int *rto = (int *) malloc (edges * sizeof (int));
+    int *rweight = (int *) malloc (edges * sizeof (int));
+    assert (rfrom && rto && rweight);
+    srandom (7);
+    for (int i = 0; i < edges; i++) {
+        rfrom [i] = random () % nodes;
+        rto [i] = random () % nodes;
+        rweight [i] = 1 + random () % 100;
+    }
+    graph = graph_new_from_edges (nodes, edges, rfrom, rto, rweight);
+    int64_t expected = s_test_kruskal (nodes, edges, rfrom, rto, rweight);
+    msf_t *single = msf_new (graph, 1);
+    assert (msf_weight (single) == expected);
+    dconnect_t *connect = dconnect_new (graph);
+    int trees = 0;
+    for (int u = 0; u < nodes; u++)
+        if (dconnect_component (connect, u) == u)
+            trees++;
+    assert (msf_components (single) == trees);
+    assert (msf_rounds (single) <= 16);
+    int thread_counts [] = { 2, 4, 7 };
+    for (int t = 0; t < 3; t++) {
+        self = msf_new (graph, thread_counts [t]);
+        assert (msf_weight (self) == expected);
+        assert (msf_edges (self) == msf_edges (single));
+        for (int i = 0; i < msf_edges (self); i++) {
+            assert (msf_weights (self) [i] == msf_weights (single) [i]);
+            assert (dconnect_component (connect, msf_from (self) [i])
+                 == dconnect_component (connect, msf_to (self) [i]));
+        }
+        msf_destroy (&self);
+    }
+    if (verbose)
+        printf ("\n%d edges, weight %lld in %d rounds\n",
+                msf_edges (single), (long long) msf_weight (single), msf_rounds (single));
+    dconnect_destroy (&connect);
+    msf_destroy (&single);
+    graph_destroy (&graph);
+    free (rfrom);
+    free (rto);
+    free (rweight);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,357 @@
+/*  =========================================================================
+    reorder - Locality-improving node relabeling
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    reorder - Locality-improving node relabeling
+@discuss
+    Node ids coming from outside are usually in arbitrary order, so
+    neighbours end up far apart in adjacency and result arrays. Reordering
+    computes new ids that keep neighbours close: breadth-first order,
+    Reverse Cuthill-McKee (breadth-first from a low degree node, visiting
+    neighbours by increasing degree, reversed) or plain descending degree
+    which packs hubs together. Both directions of the mapping are kept, so
+    callers can translate queries and results back to original ids.
+@end
+*/
+
+#include "graphs_classes.h"
+
+//  Structure of our class
+
+struct _reorder_t {
+    int size;
+    int *new_id;                //  New id of original node
+    int *old_id;                //  Original id of new node
+};
+
+typedef struct {
+    int degree;
+    int node;
+} reorder_item_t;
+
+static int
+s_item_compare (const void *a, const void *b)
+{
+    const reorder_item_t *ia = (const reorder_item_t *) a;
+    const reorder_item_t *ib = (const reorder_item_t *) b;
+    if (ia->degree != ib->degree)
+        return ia->degree < ib->degree ? -1 : 1;
+    return (ia->node > ib->node) - (ia->node < ib->node);
+}
+
+//  Nodes sorted by ascending degree, ties by id
+
+static void
+s_sort_by_degree (graph_t *graph, int *order)
+{
+    int nodes = graph_nodes (graph);
+    reorder_item_t *items = (reorder_item_t *) malloc (nodes * sizeof (reorder_item_t));
+    assert (items);
+    for (int u = 0; u < nodes; u++) {
+        items [u].degree = graph_degree (graph, u);
+        items [u].node = u;
+    }
+    qsort (items, nodes, sizeof (reorder_item_t), s_item_compare);
+    for (int u = 0; u < nodes; u++)
+        order [u] = items [u].node;
+    free (items);
+}
+
+//  Breadth-first order of all components. Roots are taken from roots array
+//  in its order, or in id order if roots is NULL. With by_degree set,
+//  neighbours are visited by increasing degree (Cuthill-McKee).
+
+static void
+s_breadth_first (graph_t *graph, const int *roots, int *order, bool by_degree)
+{
+    int nodes = graph_nodes (graph);
+    bool *visited = (bool *) zmalloc (nodes * sizeof (bool));
+    reorder_item_t *items = NULL;
+    size_t items_size = 0;
+    assert (visited);
+    int tail = 0;
+    for (int r = 0; r < nodes; r++) {
+        int root = roots ? roots [r] : r;
+        if (visited [root])
+            continue;
+        //  Order array doubles as BFS queue
+        int head = tail;
+        order [tail++] = root;
+        visited [root] = true;
+        while (head < tail) {
+            int u = order [head++];
+            int degree = graph_degree (graph, u);
+            const int *targets = graph_targets (graph, u);
+            int first = tail;
+            for (int i = 0; i < degree; i++) {
+                if (!visited [targets [i]]) {
+                    visited [targets [i]] = true;
+                    order [tail++] = targets [i];
+                }
+            }
+            if (!by_degree || tail - first < 2)
+                continue;
+            if ((size_t) (tail - first) > items_size) {
+                items_size = tail - first;
+                items = (reorder_item_t *) realloc (items, items_size * sizeof (reorder_item_t));
+                assert (items);
+            }
+            for (int i = first; i < tail; i++) {
+                items [i - first].degree = graph_degree (graph, order [i]);
+                items [i - first].node = order [i];
+            }
+            qsort (items, tail - first, sizeof (reorder_item_t), s_item_compare);
+            for (int i = first; i < tail; i++)
+                order [i] = items [i - first].node;
+        }
+    }
+    free (items);
+    free (visited);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Compute new node ids of graph with method
+
+reorder_t *
+reorder_new (graph_t *graph, int method)
+{
+    int nodes = graph_nodes (graph);
+    if (!nodes) return NULL;
+    if (method != REORDER_BFS && method != REORDER_RCM && method != REORDER_DEGREE)
+        return NULL;
+
+    reorder_t *self = (reorder_t *) zmalloc (sizeof (reorder_t));
+    assert (self);
+    self->size = nodes;
+    self->new_id = (int *) malloc (nodes * sizeof (int));
+    self->old_id = (int *) malloc (nodes * sizeof (int));
+    assert (self->new_id && self->old_id);
+
+    int *roots = (int *) malloc (nodes * sizeof (int));
+    assert (roots);
+    if (method == REORDER_BFS)
+        s_breadth_first (graph, NULL, self->old_id, false);
+    else
+    if (method == REORDER_RCM) {
+        //  Low degree nodes tend to lie on the periphery, start there
+        s_sort_by_degree (graph, roots);
+        s_breadth_first (graph, roots, self->old_id, true);
+        for (int i = 0; i < nodes / 2; i++) {
+            int swap = self->old_id [i];
+            self->old_id [i] = self->old_id [nodes - 1 - i];
+            self->old_id [nodes - 1 - i] = swap;
+        }
+    }
+    else {
+        s_sort_by_degree (graph, roots);
+        for (int i = 0; i < nodes; i++)
+            self->old_id [i] = roots [nodes - 1 - i];
+    }
+    free (roots);
+    for (int i = 0; i < nodes; i++)
+        self->new_id [self->old_id [i]] = i;
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create reordering from new ids computed before
+
+reorder_t *
+reorder_new_from_ids (int size, const int *new_id)
+{
+    if (size <= 0 || !new_id) return NULL;
+
+    reorder_t *self = (reorder_t *) zmalloc (sizeof (reorder_t));
+    assert (self);
+    self->size = size;
+    self->new_id = (int *) malloc (size * sizeof (int));
+    self->old_id = (int *) malloc (size * sizeof (int));
+    assert (self->new_id && self->old_id);
+    for (int i = 0; i < size; i++)
+        self->old_id [i] = -1;
+    for (int i = 0; i < size; i++) {
+        int id = new_id [i];
+        if (id < 0 || id >= size || self->old_id [id] != -1) {
+            reorder_destroy (&self);
+            return NULL;        //  Not a permutation
+        }
+        self->new_id [i] = id;
+        self->old_id [id] = i;
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get method by name
+
+int
+reorder_method (const char *name)
+{
+    if (!name) return -1;
+    if (streq (name, "BFS"))
+        return REORDER_BFS;
+    if (streq (name, "RCM"))
+        return REORDER_RCM;
+    if (streq (name, "DEGREE"))
+        return REORDER_DEGREE;
+    return -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get number of nodes
+
+int
+reorder_size (reorder_t *self)
+{
+    if (!self) return 0;
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get new id of node
+
+int
+reorder_to_new (reorder_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->size) return -1;
+    return self->new_id [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Get original id of node
+
+int
+reorder_to_old (reorder_t *self, int node)
+{
+    if (!self || node < 0 || node >= self->size) return -1;
+    return self->old_id [node];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create copy of graph with nodes renamed to new ids
+
+graph_t *
+reorder_graph (reorder_t *self, graph_t *graph)
+{
+    if (!self || graph_nodes (graph) != self->size) return NULL;
+    return graph_permute (graph, self->new_id);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the reordering
+
+void
+reorder_destroy (reorder_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        reorder_t *self = *self_p;
+        free (self->new_id);
+        free (self->old_id);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+// If your selftest reads SCMed fixture data, please keep it in
+// src/selftest-ro; if your test creates filesystem objects, please
+// do so under src/selftest-rw.
+// The following pattern is suggested for C selftest code:
+//    char *filename = NULL;
+//    filename = zsys_sprintf ("%s/%s", SELFTEST_DIR_RO, "mytemplate.file");
+//    assert (filename);
+//    ... use the "filename" for I/O ...
+//    zstr_free (&filename);
+// This way the same "filename" variable can be reused for many subtests.
+#define SELFTEST_DIR_RO "src/selftest-ro"
+#define SELFTEST_DIR_RW "src/selftest-rw"
+
+void
+reorder_test (bool verbose)
+{
+    printf (" * reorder: ");
+
+    //  @selftest
+    //  Path 0 - 1 - ... - 29 with scattered ids
+    const int nodes = 30;
+    int from [58], to [58], weight [58];
+    int scatter [30];
+    for (int i = 0; i < nodes; i++)
+        scatter [i] = (i * 7) % nodes;
+    for (int i = 0; i < nodes - 1; i++) {
+        from [2 * i] = to [2 * i + 1] = scatter [i];
+        to [2 * i] = from [2 * i + 1] = scatter [i + 1];
+        weight [2 * i] = weight [2 * i + 1] = i + 1;
+    }
+    graph_t *graph = graph_new_from_edges (nodes, 58, from, to, weight);
+    assert (graph_edge_span (graph) > 2);
+
+    assert (reorder_method ("RCM") == REORDER_RCM);
+    assert (reorder_method ("FOO") == -1);
+    int methods [] = { REORDER_BFS, REORDER_RCM, REORDER_DEGREE };
+    for (int m = 0; m < 3; m++) {
+        reorder_t *self = reorder_new (graph, methods [m]);
+        assert (self);
+        assert (reorder_size (self) == nodes);
+        //  Mapping is a permutation and the inverse matches
+        for (int i = 0; i < nodes; i++) {
+            assert (reorder_to_new (self, i) >= 0);
+            assert (reorder_to_old (self, reorder_to_new (self, i)) == i);
+        }
+        graph_t *relabeled = reorder_graph (self, graph);
+        assert (graph_edges (relabeled) == graph_edges (graph));
+        if (methods [m] != REORDER_DEGREE) {
+            //  Path becomes a straight line of consecutive ids
+            assert (graph_edge_span (relabeled) == 1.0);
+        }
+        //  Distances do not change, only the ids do
+        dsearch_t *search = dsearch_new (graph);
+        dsearch_t *search_relabeled = dsearch_new (relabeled);
+        dsearch_run (search, scatter [3]);
+        dsearch_run (search_relabeled, reorder_to_new (self, scatter [3]));
+        for (int i = 0; i < nodes; i++) {
+            assert (dsearch_distance (search, i) == dsearch_distance (search_relabeled, reorder_to_new (self, i)));
+        }
+        dsearch_destroy (&search);
+        dsearch_destroy (&search_relabeled);
+        //  Saved ids give the same reordering
+        int new_id [30];
+        for (int i = 0; i < nodes; i++)
+            new_id [i] = reorder_to_new (self, i);
+        reorder_t *copy = reorder_new_from_ids (nodes, new_id);
+        assert (copy);
+        for (int i = 0; i < nodes; i++)
+            assert (reorder_to_old (copy, i) == reorder_to_old (self, i));
+        reorder_destroy (&copy);
+        new_id [1] = new_id [0];
+        assert (reorder_new_from_ids (nodes, new_id) == NULL);
+        graph_destroy (&relabeled);
+        reorder_destroy (&self);
+    }
+    assert (reorder_new (graph, 42) == NULL);
+    graph_destroy (&graph);
+    //  @end
+    printf ("OK\n");
+}